@@ -25,6 +25,7 @@
 typedef struct {
     char *name;
     GList *props;
+    const char *depth;      /* queue depth of the edge into this task */
 } TaskDescription;
 
 
@@ -62,17 +63,22 @@ tokenize_args (int n, char* argv[])
     } state = NEW_TASK;
     GList *tasks = NULL;
     TaskDescription *current;
+    const char *depth = NULL;
 
     for (int i = 0; i < n; i++) {
         if (state == NEW_TASK) {
             current = g_new0 (TaskDescription, 1);
             current->name = argv[i];
+            current->depth = depth;
             tasks = g_list_append (tasks, current);
             state = NEW_PROP;
         }
         else {
-            if (!g_strcmp0 (g_strstrip (argv[i]), "!"))
+            /* `!' optionally followed by a queue depth, e.g. `!8' or `!auto' */
+            if (g_str_has_prefix (g_strstrip (argv[i]), "!")) {
+                depth = argv[i][1] != '\0' ? &argv[i][1] : NULL;
                 state = NEW_TASK;
+            }
             else
                 current->props = g_list_append (current->props, argv[i]);
         }
@@ -81,6 +87,29 @@ tokenize_args (int n, char* argv[])
     return tasks;
 }
 
+static gboolean
+set_depth (UfoTaskNode *task, const gchar *depth, GError **error)
+{
+    guint64 value;
+    gchar *end;
+
+    if (!g_strcmp0 (depth, "auto")) {
+        ufo_task_node_set_queue_depth (task, 0, UFO_QUEUE_DEPTH_AUTO);
+        return TRUE;
+    }
+
+    value = g_ascii_strtoull (depth, &end, 10);
+
+    if (*end != '\0' || value == 0 || value >= UFO_QUEUE_DEPTH_AUTO) {
+        g_set_error (error, G_OPTION_ERROR, G_OPTION_ERROR_BAD_VALUE,
+                     "Invalid queue depth `%s', expected a positive number or `auto'", depth);
+        return FALSE;
+    }
+
+    ufo_task_node_set_queue_depth (task, 0, (guint) value);
+    return TRUE;
+}
+
 static UfoTaskGraph *
 parse_pipeline (GList *pipeline, UfoPluginManager *pm, GError **error)
 {
@@ -158,6 +187,9 @@ parse_pipeline (GList *pipeline, UfoPluginManager *pm, GError **error)
         if (prev != NULL)
             ufo_task_graph_connect_nodes (graph, prev, task);
 
+        if (desc->depth != NULL && !set_depth (task, desc->depth, error))
+            return NULL;
+
         prev = task;
     }
 
@@ -199,7 +231,7 @@ main(int argc, char* argv[])
     g_type_init ();
 #endif
 
-    context = g_option_context_new ("TASK [PROP=VAR [PROP=VAR ...]] ! [TASK ...]");
+    context = g_option_context_new ("TASK [PROP=VAR [PROP=VAR ...]] ![DEPTH] [TASK ...]");
     g_option_context_add_main_entries (context, entries, NULL);
 
     if (!g_option_context_parse (context, &argc, &argv, &error)) {
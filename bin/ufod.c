@@ -48,7 +48,7 @@ opts_parse (gint *argc, gchar ***argv)
 
     GOptionEntry entries[] = {
         { "listen", 'l', 0, G_OPTION_ARG_STRING, &opts->addr,
-          "Address to listen on (see http://api.zeromq.org/3-2:zmq-tcp)", NULL },
+          "Address to listen on (see http://api.zeromq.org/3-2:zmq-tcp or use shm://name on the same host)", NULL },
         { "path", 'p', 0, G_OPTION_ARG_STRING_ARRAY, &opts->paths,
           "Path to node plugins or OpenCL kernels", NULL },
         { "version", 'v', 0, G_OPTION_ARG_NONE, &show_version,
@@ -18,6 +18,15 @@
  */
 
 #include <string.h>
+#include <unistd.h>
+#include <glib/gstdio.h>
+
+#ifdef __APPLE__
+#include <OpenCL/cl.h>
+#else
+#include <CL/cl.h>
+#endif
+
 #include <ufo/ufo.h>
 #include "test-suite.h"
 
@@ -163,6 +172,87 @@ test_copy_metadata (Fixture *fixture,
     other = ufo_buffer_get_metadata (copy, "foo");
     g_assert (g_value_get_int (other) == -123);
 
+    /* Modifying the copy must not change the original */
+    g_value_set_int (&value, 42);
+    ufo_buffer_set_metadata (copy, "foo", &value);
+    other = ufo_buffer_get_metadata (fixture->buffer, "foo");
+    g_assert (g_value_get_int (other) == -123);
+    other = ufo_buffer_get_metadata (copy, "foo");
+    g_assert (g_value_get_int (other) == 42);
+
+    g_object_unref (copy);
+}
+
+static void
+test_stable_metadata (Fixture *fixture,
+                      gconstpointer unused)
+{
+    GValue value = {0};
+    GValue *foo;
+    UfoBuffer *copy;
+
+    UfoRequisition requisition = {
+        .n_dims = 1,
+        .dims[0] = 8,
+    };
+
+    g_value_init (&value, G_TYPE_INT);
+    g_value_set_int (&value, 1);
+    ufo_buffer_set_metadata (fixture->buffer, "foo", &value);
+    foo = ufo_buffer_get_metadata (fixture->buffer, "foo");
+
+    /* Adding keys grows the table but must not move existing values */
+    for (gint i = 0; i < 32; i++) {
+        gchar *name = g_strdup_printf ("key-%i", i);
+
+        g_value_set_int (&value, i);
+        ufo_buffer_set_metadata (fixture->buffer, name, &value);
+        g_free (name);
+    }
+
+    g_assert (ufo_buffer_get_metadata (fixture->buffer, "foo") == foo);
+    g_assert (g_value_get_int (foo) == 1);
+
+    /* Neither does copying the shared table on write */
+    copy = ufo_buffer_new (&requisition, NULL);
+    ufo_buffer_copy_metadata (fixture->buffer, copy);
+    g_value_set_int (&value, 2);
+    ufo_buffer_set_metadata (fixture->buffer, "bar", &value);
+    g_object_unref (copy);
+
+    g_assert (ufo_buffer_get_metadata (fixture->buffer, "foo") == foo);
+    g_assert (g_value_get_int (foo) == 1);
+}
+
+static void
+test_merge_metadata (Fixture *fixture,
+                     gconstpointer unused)
+{
+    GValue value = {0};
+    GList *keys;
+    UfoBuffer *copy;
+
+    UfoRequisition requisition = {
+        .n_dims = 1,
+        .dims[0] = 8,
+    };
+
+    copy = ufo_buffer_new (&requisition, NULL);
+
+    g_value_init (&value, G_TYPE_INT);
+    g_value_set_int (&value, 1);
+    ufo_buffer_set_metadata (fixture->buffer, "foo", &value);
+    ufo_buffer_set_metadata (copy, "bar", &value);
+
+    /* Keys that only exist in the destination are kept */
+    ufo_buffer_copy_metadata (fixture->buffer, copy);
+    keys = ufo_buffer_get_metadata_keys (copy);
+    g_assert (g_list_length (keys) == 2);
+    g_assert (ufo_buffer_get_metadata (copy, "foo") != NULL);
+    g_assert (ufo_buffer_get_metadata (copy, "bar") != NULL);
+    g_assert (ufo_buffer_get_metadata (fixture->buffer, "bar") == NULL);
+
+    g_list_free (keys);
     g_object_unref (copy);
 }
 
@@ -175,6 +265,461 @@ test_location (Fixture *fixture,
     g_assert (ufo_buffer_get_location (fixture->buffer) == UFO_BUFFER_LOCATION_HOST);
 }
 
+static UfoBuffer *
+make_volume (void)
+{
+    UfoBuffer *volume;
+    gfloat *data;
+
+    UfoRequisition requisition = {
+        .n_dims = 3,
+        .dims = { 4, 3, 2 },
+    };
+
+    volume = ufo_buffer_new (&requisition, NULL);
+    data = ufo_buffer_get_host_array (volume, NULL);
+
+    for (guint i = 0; i < 4 * 3 * 2; i++)
+        data[i] = (gfloat) i;
+
+    return volume;
+}
+
+static void
+test_view_contiguous (Fixture *fixture,
+                      gconstpointer unused)
+{
+    UfoBuffer *volume;
+    UfoBuffer *view;
+    UfoRequisition requisition;
+    gfloat *data;
+
+    UfoRegion region = {
+        .origin = { 0, 1, 1 },
+        .size = { 4, 2, 1 },
+    };
+
+    volume = make_volume ();
+    view = ufo_buffer_new_view (volume, &region);
+    ufo_buffer_get_requisition (view, &requisition);
+
+    g_assert (requisition.n_dims == 3);
+    g_assert (requisition.dims[0] == 4 && requisition.dims[1] == 2 && requisition.dims[2] == 1);
+
+    data = ufo_buffer_get_host_array (view, NULL);
+    g_assert (data[0] == 16.0f);
+    g_assert (data[7] == 23.0f);
+
+    /* Views of whole rows alias the parent data */
+    data[0] = -1.0f;
+    g_assert (ufo_buffer_get_host_array (volume, NULL)[16] == -1.0f);
+
+    g_object_unref (view);
+    g_object_unref (volume);
+}
+
+static void
+test_view_copy (Fixture *fixture,
+                gconstpointer unused)
+{
+    UfoBuffer *volume;
+    UfoBuffer *view;
+    UfoBuffer *source;
+    UfoRequisition requisition;
+    gfloat *data;
+
+    UfoRegion region = {
+        .origin = { 0, 0, 1 },
+        .size = { 4, 3, 1 },
+    };
+
+    volume = make_volume ();
+    view = ufo_buffer_new_view (volume, &region);
+    ufo_buffer_get_requisition (view, &requisition);
+
+    source = ufo_buffer_new (&requisition, NULL);
+    data = ufo_buffer_get_host_array (source, NULL);
+
+    for (guint i = 0; i < 4 * 3; i++)
+        data[i] = -((gfloat) i);
+
+    /* Copying into the view must write the second slice of the parent */
+    ufo_buffer_copy (source, view);
+    data = ufo_buffer_get_host_array (volume, NULL);
+
+    for (guint i = 0; i < 4 * 3; i++) {
+        g_assert (data[i] == (gfloat) i);
+        g_assert (data[12 + i] == -((gfloat) i));
+    }
+
+    g_object_unref (source);
+    g_object_unref (view);
+    g_object_unref (volume);
+}
+
+static void
+test_slice (Fixture *fixture,
+            gconstpointer unused)
+{
+    UfoBuffer *volume;
+    UfoBuffer *slice;
+    UfoRequisition requisition;
+    gfloat *data;
+
+    volume = make_volume ();
+    g_assert (ufo_buffer_get_batch_size (volume) == 0);
+    ufo_buffer_set_batch_size (volume, 2);
+    g_assert (ufo_buffer_get_batch_size (volume) == 2);
+
+    slice = ufo_buffer_new_slice (volume, 1);
+    ufo_buffer_get_requisition (slice, &requisition);
+
+    g_assert (requisition.n_dims == 2);
+    g_assert (requisition.dims[0] == 4 && requisition.dims[1] == 3);
+    g_assert (ufo_buffer_get_batch_size (slice) == 0);
+
+    data = ufo_buffer_get_host_array (slice, NULL);
+    g_assert (data[0] == 12.0f);
+    g_assert (data[11] == 23.0f);
+
+    g_object_unref (slice);
+    g_object_unref (volume);
+}
+
+static void
+test_view_strided (Fixture *fixture,
+                   gconstpointer unused)
+{
+    UfoBuffer *volume;
+    UfoBuffer *view;
+    gfloat *data;
+
+    UfoRegion region = {
+        .origin = { 1, 1, 0 },
+        .size = { 2, 2, 2 },
+    };
+
+    static const gfloat expected[] = { 5, 6, 9, 10, 17, 18, 21, 22 };
+
+    volume = make_volume ();
+    view = ufo_buffer_new_view (volume, &region);
+    data = ufo_buffer_get_host_array (view, NULL);
+
+    for (guint i = 0; i < G_N_ELEMENTS (expected); i++)
+        g_assert (data[i] == expected[i]);
+
+    g_object_unref (view);
+    g_object_unref (volume);
+}
+
+static void
+test_mapped (Fixture *fixture,
+             gconstpointer unused)
+{
+    UfoBuffer *buffer;
+    GError *error = NULL;
+    gchar *filename;
+    gchar contents[4 + 8 * sizeof (guint16)];
+    gfloat *host_data;
+    gint fd;
+
+    UfoRequisition requisition = {
+        .n_dims = 1,
+        .dims[0] = 8,
+    };
+
+    /* Store data after a four byte header */
+    memset (contents, 0, sizeof (contents));
+    memcpy (contents + 4, fixture->data16, 8 * sizeof (guint16));
+
+    fd = g_file_open_tmp ("ufo-XXXXXX", &filename, &error);
+    g_assert_no_error (error);
+    close (fd);
+    g_file_set_contents (filename, contents, sizeof (contents), &error);
+    g_assert_no_error (error);
+
+    buffer = ufo_buffer_new_mapped (filename, &requisition, UFO_BUFFER_DEPTH_16U, 4, NULL, &error);
+    g_assert_no_error (error);
+    g_assert (ufo_buffer_get_location (buffer) == UFO_BUFFER_LOCATION_HOST);
+
+    host_data = ufo_buffer_get_host_array (buffer, NULL);
+
+    for (guint i = 0; i < fixture->n_data; i++)
+        g_assert (host_data[i] == ((gfloat) fixture->data16[i]));
+
+    g_object_unref (buffer);
+
+    requisition.dims[0] = 9;
+    buffer = ufo_buffer_new_mapped (filename, &requisition, UFO_BUFFER_DEPTH_16U, 4, NULL, &error);
+    g_assert (buffer == NULL);
+    g_assert_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL);
+    g_error_free (error);
+
+    g_unlink (filename);
+    g_free (filename);
+}
+
+static void
+test_migrate (void)
+{
+    UfoResources *resources;
+    UfoBuffer *buffer;
+    GError *error = NULL;
+    GList *queues;
+    gpointer first;
+    gpointer last;
+    gfloat *data;
+
+    UfoRequisition requisition = {
+        .n_dims = 1,
+        .dims[0] = 1024,
+    };
+
+    resources = ufo_resources_new (&error);
+    g_assert_no_error (error);
+
+    queues = ufo_resources_get_cmd_queues (resources);
+    first = g_list_first (queues)->data;
+    last = g_list_last (queues)->data;
+
+    buffer = ufo_buffer_new (&requisition, ufo_resources_get_context (resources));
+    data = ufo_buffer_get_host_array (buffer, NULL);
+
+    for (guint i = 0; i < 1024; i++)
+        data[i] = (gfloat) i;
+
+    /* Moving the data between devices must neither block nor lose it */
+    ufo_buffer_get_device_array (buffer, first);
+    ufo_buffer_get_device_array (buffer, last);
+    data = ufo_buffer_get_host_array (buffer, NULL);
+
+    for (guint i = 0; i < 1024; i++)
+        g_assert (data[i] == (gfloat) i);
+
+    g_object_unref (buffer);
+    g_list_free (queues);
+    g_object_unref (resources);
+}
+
+static void
+test_upload (void)
+{
+    UfoResources *resources;
+    UfoBuffer *buffer;
+    GError *error = NULL;
+    GList *queues;
+    gpointer queue;
+    cl_mem mem;
+    gfloat *data;
+    gfloat result[1024];
+
+    UfoRequisition requisition = {
+        .n_dims = 1,
+        .dims[0] = 1024,
+    };
+
+    resources = ufo_resources_new (&error);
+    g_assert_no_error (error);
+
+    queues = ufo_resources_get_cmd_queues (resources);
+    queue = g_list_first (queues)->data;
+
+    buffer = ufo_buffer_new (&requisition, ufo_resources_get_context (resources));
+    data = ufo_buffer_get_host_array (buffer, NULL);
+
+    for (guint i = 0; i < 1024; i++)
+        data[i] = (gfloat) i;
+
+    /* overwriting the host data must not change what is being uploaded */
+    mem = ufo_buffer_get_device_array (buffer, queue);
+    ufo_buffer_discard_location (buffer);
+    data = ufo_buffer_get_host_array (buffer, NULL);
+
+    for (guint i = 0; i < 1024; i++)
+        data[i] = -1.0f;
+
+    g_assert (clEnqueueReadBuffer (queue, mem, CL_TRUE, 0, sizeof (result), result, 0, NULL, NULL) == CL_SUCCESS);
+
+    for (guint i = 0; i < 1024; i++)
+        g_assert (result[i] == (gfloat) i);
+
+    g_object_unref (buffer);
+    g_list_free (queues);
+    g_object_unref (resources);
+}
+
+static void
+test_view_unaligned (void)
+{
+    UfoResources *resources;
+    UfoBuffer *volume;
+    UfoBuffer *slice;
+    UfoBuffer *source;
+    GError *error = NULL;
+    GList *queues;
+    gpointer queue;
+    cl_mem mem;
+    gfloat value;
+    gfloat *data;
+
+    /* One float per slice puts most slices at offsets no device can alias */
+    UfoRequisition requisition = {
+        .n_dims = 2,
+        .dims[0] = 1,
+        .dims[1] = 16,
+    };
+
+    UfoRequisition item = {
+        .n_dims = 1,
+        .dims[0] = 1,
+    };
+
+    resources = ufo_resources_new (&error);
+    g_assert_no_error (error);
+
+    queues = ufo_resources_get_cmd_queues (resources);
+    queue = g_list_first (queues)->data;
+
+    volume = ufo_buffer_new (&requisition, ufo_resources_get_context (resources));
+    source = ufo_buffer_new (&item, ufo_resources_get_context (resources));
+    data = ufo_buffer_get_host_array (volume, NULL);
+
+    for (guint i = 0; i < 16; i++)
+        data[i] = (gfloat) i;
+
+    /* Copy into a view of a parent on the host */
+    slice = ufo_buffer_new_slice (volume, 3);
+    ufo_buffer_get_host_array (source, NULL)[0] = -1.0f;
+    ufo_buffer_copy (source, slice);
+    g_object_unref (slice);
+
+    /* Copy into a view of a parent on the device */
+    ufo_buffer_get_device_array (volume, queue);
+    slice = ufo_buffer_new_slice (volume, 5);
+    ufo_buffer_get_host_array (source, NULL)[0] = -2.0f;
+    ufo_buffer_get_device_array (source, queue);
+    ufo_buffer_copy (source, slice);
+    g_object_unref (slice);
+
+    /* Write to the device array of a view */
+    slice = ufo_buffer_new_slice (volume, 7);
+    mem = ufo_buffer_get_device_array (slice, queue);
+    value = -3.0f;
+    g_assert (clEnqueueWriteBuffer (queue, mem, CL_TRUE, 0, sizeof (value), &value, 0, NULL, NULL) == CL_SUCCESS);
+    g_object_unref (slice);
+
+    data = ufo_buffer_get_host_array (volume, queue);
+
+    for (guint i = 0; i < 16; i++) {
+        if (i == 3)
+            g_assert (data[i] == -1.0f);
+        else if (i == 5)
+            g_assert (data[i] == -2.0f);
+        else if (i == 7)
+            g_assert (data[i] == -3.0f);
+        else
+            g_assert (data[i] == (gfloat) i);
+    }
+
+    g_object_unref (source);
+    g_object_unref (volume);
+    g_list_free (queues);
+    g_object_unref (resources);
+}
+
+static gchar *
+write_tmp_file (const gchar *contents,
+                gsize length)
+{
+    GError *error = NULL;
+    gchar *filename;
+    gint fd;
+
+    fd = g_file_open_tmp ("ufo-XXXXXX", &filename, &error);
+    g_assert_no_error (error);
+    close (fd);
+    g_file_set_contents (filename, contents, length, &error);
+    g_assert_no_error (error);
+    return filename;
+}
+
+static void
+test_mapped_copy (Fixture *fixture,
+                  gconstpointer unused)
+{
+    UfoBuffer *buffer;
+    UfoBuffer *copy;
+    GError *error = NULL;
+    gchar *filename;
+    gfloat *host_data;
+
+    UfoRequisition requisition = {
+        .n_dims = 1,
+        .dims[0] = 8,
+    };
+
+    filename = write_tmp_file ((const gchar *) fixture->data16, 8 * sizeof (guint16));
+    buffer = ufo_buffer_new_mapped (filename, &requisition, UFO_BUFFER_DEPTH_16U, 0, NULL, &error);
+    g_assert_no_error (error);
+
+    copy = ufo_buffer_new (&requisition, NULL);
+    ufo_buffer_copy (buffer, copy);
+    host_data = ufo_buffer_get_host_array (copy, NULL);
+
+    for (guint i = 0; i < fixture->n_data; i++)
+        g_assert (host_data[i] == ((gfloat) fixture->data16[i]));
+
+    g_object_unref (copy);
+    g_object_unref (buffer);
+    g_unlink (filename);
+    g_free (filename);
+}
+
+static void
+test_mapped_writeback (Fixture *fixture,
+                       gconstpointer unused)
+{
+    UfoBuffer *buffer;
+    GError *error = NULL;
+    gchar *filename;
+    gchar *contents;
+    gsize length;
+    gfloat data[8] = { 0 };
+    gfloat *host_data;
+
+    UfoRequisition requisition = {
+        .n_dims = 1,
+        .dims[0] = 8,
+    };
+
+    filename = write_tmp_file ((const gchar *) data, sizeof (data));
+    buffer = ufo_buffer_new_mapped (filename, &requisition, UFO_BUFFER_DEPTH_32F, 0, NULL, &error);
+    g_assert_no_error (error);
+
+    host_data = ufo_buffer_get_host_array (buffer, NULL);
+
+    for (guint i = 0; i < 8; i++)
+        host_data[i] = (gfloat) i;
+
+    /* Resizing drops the mapping and syncs it to the file */
+    requisition.dims[0] = 16;
+    ufo_buffer_resize (buffer, &requisition);
+    host_data = ufo_buffer_get_host_array (buffer, NULL);
+    host_data[0] = -1.0f;
+
+    g_file_get_contents (filename, &contents, &length, &error);
+    g_assert_no_error (error);
+    g_assert (length == sizeof (data));
+
+    for (guint i = 0; i < 8; i++)
+        g_assert (((gfloat *) contents)[i] == (gfloat) i);
+
+    g_free (contents);
+    g_object_unref (buffer);
+    g_unlink (filename);
+    g_free (filename);
+}
+
 void
 test_add_buffer (void)
 {
@@ -202,7 +747,47 @@ test_add_buffer (void)
                 Fixture, NULL,
                 setup, test_copy_metadata, teardown);
 
+    g_test_add ("/no-opencl/buffer/metadata/stable",
+                Fixture, NULL,
+                setup, test_stable_metadata, teardown);
+
+    g_test_add ("/no-opencl/buffer/metadata/merge",
+                Fixture, NULL,
+                setup, test_merge_metadata, teardown);
+
     g_test_add ("/no-opencl/buffer/location",
                 Fixture, NULL,
                 setup, test_location, teardown);
+
+    g_test_add ("/no-opencl/buffer/view/contiguous",
+                Fixture, NULL,
+                setup, test_view_contiguous, teardown);
+
+    g_test_add ("/no-opencl/buffer/view/copy",
+                Fixture, NULL,
+                setup, test_view_copy, teardown);
+
+    g_test_add ("/no-opencl/buffer/view/strided",
+                Fixture, NULL,
+                setup, test_view_strided, teardown);
+
+    g_test_add ("/no-opencl/buffer/view/slice",
+                Fixture, NULL,
+                setup, test_slice, teardown);
+
+    g_test_add ("/no-opencl/buffer/mapped",
+                Fixture, NULL,
+                setup, test_mapped, teardown);
+
+    g_test_add_func ("/opencl/buffer/migrate", test_migrate);
+    g_test_add_func ("/opencl/buffer/upload", test_upload);
+    g_test_add_func ("/opencl/buffer/view/unaligned", test_view_unaligned);
+
+    g_test_add ("/no-opencl/buffer/mapped/copy",
+                Fixture, NULL,
+                setup, test_mapped_copy, teardown);
+
+    g_test_add ("/no-opencl/buffer/mapped/writeback",
+                Fixture, NULL,
+                setup, test_mapped_writeback, teardown);
 }
@@ -17,6 +17,8 @@
  * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <unistd.h>
+#include <glib/gstdio.h>
 #include <ufo/ufo.h>
 #include "test-suite.h"
 
@@ -408,6 +410,229 @@ test_flatten (Fixture *fixture, gconstpointer data)
     g_list_free (levels);
 }
 
+static void
+test_ports (Fixture *fixture, gconstpointer data)
+{
+    UfoTaskGraph *graph;
+    UfoTaskNode *source;
+    UfoTaskNode *first;
+    UfoTaskNode *second;
+    guint output;
+    guint input;
+
+    graph = UFO_TASK_GRAPH (ufo_task_graph_new ());
+    source = UFO_TASK_NODE (ufo_dummy_task_new ());
+    first = UFO_TASK_NODE (ufo_dummy_task_new ());
+    second = UFO_TASK_NODE (ufo_dummy_task_new ());
+
+    ufo_task_graph_connect_nodes_full (graph, source, first, 1);
+    ufo_task_graph_connect_ports (graph, source, 2, second, 3);
+
+    ufo_task_graph_get_ports (graph, source, first, &output, &input);
+    g_assert (output == 0);
+    g_assert (input == 1);
+
+    ufo_task_graph_get_ports (graph, source, second, &output, &input);
+    g_assert (output == 2);
+    g_assert (input == 3);
+
+    g_object_unref (source);
+    g_object_unref (first);
+    g_object_unref (second);
+    g_object_unref (graph);
+}
+
+static void
+test_remove_node (Fixture *fixture, gconstpointer data)
+{
+    ufo_graph_remove_node (fixture->sequence, fixture->target1);
+    g_assert (ufo_graph_get_num_nodes (fixture->sequence) == 2);
+    g_assert (ufo_graph_get_num_edges (fixture->sequence) == 0);
+}
+
+static void
+test_merge_common (Fixture *fixture, gconstpointer data)
+{
+    UfoTaskGraph *graph;
+    UfoTaskNode *nodes[7];
+    GList *successors;
+
+    graph = UFO_TASK_GRAPH (ufo_task_graph_new ());
+
+    for (guint i = 0; i < 7; i++)
+        nodes[i] = UFO_TASK_NODE (ufo_dummy_task_new ());
+
+    /* two identical chains 0 -> 1 -> 2 and 3 -> 4 -> 5 and a differing 6 -> 2 */
+    ufo_task_node_set_priority (nodes[6], UFO_TASK_PRIORITY_HIGH);
+    ufo_task_graph_connect_nodes (graph, nodes[0], nodes[1]);
+    ufo_task_graph_connect_nodes (graph, nodes[1], nodes[2]);
+    ufo_task_graph_connect_nodes (graph, nodes[3], nodes[4]);
+    ufo_task_graph_connect_nodes (graph, nodes[4], nodes[5]);
+    ufo_task_graph_connect_nodes_full (graph, nodes[6], nodes[2], 1);
+
+    g_assert (ufo_task_graph_merge_common (graph) == 2);
+    g_assert (ufo_graph_get_num_nodes (UFO_GRAPH (graph)) == 5);
+    g_assert (ufo_task_node_get_send_pattern (nodes[1]) == UFO_SEND_BROADCAST);
+
+    successors = ufo_graph_get_successors (UFO_GRAPH (graph), UFO_NODE (nodes[1]));
+    g_assert (g_list_length (successors) == 2);
+    g_assert (g_list_find (successors, nodes[2]) != NULL);
+    g_assert (g_list_find (successors, nodes[5]) != NULL);
+    g_list_free (successors);
+
+    for (guint i = 0; i < 7; i++)
+        g_object_unref (nodes[i]);
+
+    g_object_unref (graph);
+}
+
+static void
+test_costs (Fixture *fixture, gconstpointer data)
+{
+    UfoTaskGraph *graph;
+    UfoTaskNode *nodes[3];
+    UfoTaskNode *copy = NULL;
+    GList *successors;
+    GList *path = NULL;
+    GList *it;
+    GError *error = NULL;
+    gchar *filename;
+    gint fd;
+
+    graph = UFO_TASK_GRAPH (ufo_task_graph_new ());
+
+    for (guint i = 0; i < 3; i++) {
+        gchar *identifier = g_strdup_printf ("node-%u", i);
+
+        nodes[i] = UFO_TASK_NODE (ufo_dummy_task_new ());
+        ufo_task_node_set_identifier (nodes[i], identifier);
+        path = g_list_append (path, nodes[i]);
+        g_free (identifier);
+    }
+
+    ufo_task_graph_connect_nodes (graph, nodes[0], nodes[1]);
+    ufo_task_graph_connect_nodes (graph, nodes[1], nodes[2]);
+    ufo_graph_expand (UFO_GRAPH (graph), path);
+    g_list_free (path);
+
+    successors = ufo_graph_get_successors (UFO_GRAPH (graph), UFO_NODE (nodes[0]));
+
+    for (it = successors; it != NULL; it = g_list_next (it)) {
+        if (it->data != nodes[1])
+            copy = UFO_TASK_NODE (it->data);
+    }
+
+    g_list_free (successors);
+    g_assert (copy != NULL);
+
+    /* the original and its copy processed different shares */
+    ufo_task_node_set_cost (nodes[0], 0.5);
+    ufo_task_node_set_cost (nodes[1], 1.0);
+    ufo_task_node_set_cost (copy, 3.0);
+
+    fd = g_file_open_tmp ("ufo-XXXXXX", &filename, &error);
+    g_assert_no_error (error);
+    close (fd);
+
+    g_assert (ufo_task_graph_save_costs (graph, filename, &error));
+    g_assert_no_error (error);
+
+    ufo_task_node_set_cost (nodes[0], 0.0);
+    ufo_task_node_set_cost (nodes[1], 0.0);
+    ufo_task_node_set_cost (copy, 0.0);
+
+    g_assert (ufo_task_graph_read_costs (graph, filename, &error));
+    g_assert_no_error (error);
+
+    g_assert_cmpfloat (ufo_task_node_get_cost (nodes[0]), ==, 0.5);
+    g_assert_cmpfloat (ufo_task_node_get_cost (nodes[1]), ==, 2.0);
+    g_assert_cmpfloat (ufo_task_node_get_cost (copy), ==, 2.0);
+    g_assert_cmpfloat (ufo_task_node_get_cost (nodes[2]), ==, 0.0);
+
+    g_unlink (filename);
+    g_free (filename);
+
+    for (guint i = 0; i < 3; i++)
+        g_object_unref (nodes[i]);
+
+    g_object_unref (graph);
+}
+
+/*
+ * Build a chain of @n_nodes nodes, expand its inner nodes @n_copies times and
+ * return the seconds this took.
+ */
+static gdouble
+expand_chain (guint n_nodes,
+              guint n_copies)
+{
+    UfoGraph *graph;
+    UfoNode *previous;
+    GList *path;
+    GList *levels;
+    GList *it;
+
+    g_test_timer_start ();
+
+    graph = ufo_graph_new ();
+    previous = ufo_node_new (NULL);
+
+    for (guint i = 1; i < n_nodes; i++) {
+        UfoNode *node = ufo_node_new (NULL);
+
+        ufo_graph_connect_nodes (graph, previous, node, NULL);
+        g_object_unref (previous);
+        previous = node;
+    }
+
+    g_object_unref (previous);
+    path = ufo_graph_find_longest_path (graph, always_true, NULL);
+    g_assert (g_list_length (path) == n_nodes);
+
+    for (guint i = 1; i < n_copies; i++)
+        ufo_graph_expand (graph, path);
+
+    g_assert (ufo_graph_get_num_nodes (graph) == n_copies * (n_nodes - 2) + 2);
+
+    levels = ufo_graph_flatten (graph);
+    g_assert (g_list_length (levels) == n_nodes);
+
+    for (it = levels; it != NULL; it = g_list_next (it))
+        g_list_free ((GList *) it->data);
+
+    g_list_free (levels);
+    g_list_free (path);
+    g_object_unref (graph);
+
+    return g_test_timer_elapsed ();
+}
+
+static void
+test_perf_expand (void)
+{
+    const guint n_nodes = 1000;
+    const guint n_copies = 5;
+    gdouble small;
+    gdouble large;
+
+    small = expand_chain (n_nodes, n_copies);
+    g_test_minimized_result (small, "Build and expand %u nodes: %.3f s",
+                             n_copies * (n_nodes - 2) + 2, small);
+
+    large = expand_chain (4 * n_nodes, n_copies);
+    g_test_minimized_result (large, "Build and expand %u nodes: %.3f s",
+                             n_copies * (4 * n_nodes - 2) + 2, large);
+
+    /*
+     * Compare against the same run on a four times larger graph instead of an
+     * older tree. Work per node must not grow with the graph. Scanning the
+     * whole graph per lookup, as before the adjacency index, would take
+     * about 16 times as long.
+     */
+    g_test_message ("Four times the nodes took %.1f times as long", large / MAX (small, 1e-6));
+    g_assert_cmpfloat (large, <, 8.0 * MAX (small, 1e-3));
+}
+
 void
 test_add_graph (void)
 {
@@ -423,11 +648,15 @@ test_add_graph (void)
         { "/no-opencl/graph/edges/number",            test_get_num_edges },
         { "/no-opencl/graph/edges/all",               test_get_edges },
         { "/no-opencl/graph/edges/remove",            test_remove_edge },
+        { "/no-opencl/graph/nodes/remove",            test_remove_node },
         { "/no-opencl/graph/labels",                  test_get_labels },
         { "/no-opencl/graph/expansion",               test_expansion },
         { "/no-opencl/graph/copy",                    test_copy },
         { "/no-opencl/graph/copy/shallow",            test_shallow_copy },
         { "/no-opencl/graph/flatten",                 test_flatten },
+        { "/no-opencl/graph/ports",                   test_ports },
+        { "/no-opencl/graph/merge",                   test_merge_common },
+        { "/no-opencl/graph/costs",                   test_costs },
         { NULL, NULL }
     };
 
@@ -435,4 +664,7 @@ test_add_graph (void)
         g_test_add (test_cases[i].path, Fixture, NULL,
                     fixture_setup, test_cases[i].test_func, fixture_teardown);
     }
+
+    if (g_test_perf ())
+        g_test_add_func ("/no-opencl/graph/perf/expand", test_perf_expand);
 }
@@ -0,0 +1,410 @@
+/*
+ * Copyright (C) 2011-2013 Karlsruhe Institute of Technology
+ *
+ * This file is part of Ufo.
+ *
+ * This library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <ufo/ufo.h>
+#include "ufo/ufo-priv.h"
+#include "test-suite.h"
+
+typedef struct {
+    UfoTask *targets[2];
+    GList *list;
+    UfoRequisition requisition;
+} Fixture;
+
+static void
+setup (Fixture *fixture, gconstpointer data)
+{
+    fixture->list = NULL;
+
+    for (guint i = 0; i < 2; i++) {
+        fixture->targets[i] = UFO_TASK (ufo_dummy_task_new ());
+        fixture->list = g_list_append (fixture->list, fixture->targets[i]);
+    }
+
+    fixture->requisition.n_dims = 1;
+    fixture->requisition.dims[0] = 16;
+}
+
+static void
+teardown (Fixture *fixture, gconstpointer data)
+{
+    g_list_free (fixture->list);
+
+    for (guint i = 0; i < 2; i++)
+        g_object_unref (fixture->targets[i]);
+}
+
+static guint
+get_num_sent (UfoGroup *group,
+              UfoTask *target)
+{
+    guint n_sent;
+
+    ufo_group_get_target_stats (group, target, &n_sent, NULL, NULL);
+    return n_sent;
+}
+
+/*
+ * Send one item and return the target it went to.
+ */
+static UfoTask *
+send_item (Fixture *fixture,
+           UfoGroup *group)
+{
+    UfoBuffer *buffer;
+    guint n_sent[2];
+
+    for (guint i = 0; i < 2; i++)
+        n_sent[i] = get_num_sent (group, fixture->targets[i]);
+
+    buffer = ufo_group_pop_output_buffer (group, &fixture->requisition);
+    ufo_group_push_output_buffer (group, buffer);
+
+    return get_num_sent (group, fixture->targets[0]) > n_sent[0] ?
+           fixture->targets[0] : fixture->targets[1];
+}
+
+/*
+ * Let @target process one item for @seconds.
+ */
+static void
+process_item (UfoGroup *group,
+              UfoTask *target,
+              gdouble seconds)
+{
+    UfoBuffer *input;
+
+    input = ufo_group_pop_input_buffer (group, target);
+    g_usleep ((gulong) (seconds * G_USEC_PER_SEC));
+    ufo_group_push_input_buffer (group, target, input);
+}
+
+static void
+test_least_loaded (Fixture *fixture, gconstpointer data)
+{
+    UfoGroup *group;
+    UfoTask *slow;
+    UfoTask *fast;
+
+    group = ufo_group_new (fixture->list, NULL, UFO_SEND_LEAST_LOADED);
+    ufo_group_set_depth (group, fixture->targets[0], 2);
+    ufo_group_set_depth (group, fixture->targets[1], 2);
+
+    /* targets without measurements are tried first */
+    slow = send_item (fixture, group);
+    process_item (group, slow, 0.02);
+
+    fast = send_item (fixture, group);
+    g_assert (fast != slow);
+    process_item (group, fast, 0.001);
+
+    /* the fast target gets items until it holds all of its buffers */
+    g_assert (send_item (fixture, group) == fast);
+    g_assert (send_item (fixture, group) == fast);
+    g_assert (send_item (fixture, group) == slow);
+
+    g_object_unref (group);
+}
+
+static void
+test_fallback (Fixture *fixture, gconstpointer data)
+{
+    UfoGroup *group;
+    UfoTask *gpu;
+    UfoTask *cpu;
+
+    gpu = fixture->targets[0];
+    cpu = fixture->targets[1];
+
+    group = ufo_group_new (fixture->list, NULL, UFO_SEND_LEAST_LOADED);
+    ufo_group_set_depth (group, gpu, 2);
+    ufo_group_set_depth (group, cpu, 2);
+    ufo_group_set_fallback (group, cpu, TRUE);
+
+    /* the fallback target is skipped although it has no measurements yet */
+    g_assert (send_item (fixture, group) == gpu);
+    g_assert (send_item (fixture, group) == gpu);
+
+    /* and only gets items while the other target holds all its buffers */
+    g_assert (send_item (fixture, group) == cpu);
+    process_item (group, gpu, 0.001);
+    g_assert (send_item (fixture, group) == gpu);
+    g_assert (send_item (fixture, group) == cpu);
+
+    g_assert_cmpuint (get_num_sent (group, gpu), ==, 3);
+    g_assert_cmpuint (get_num_sent (group, cpu), ==, 2);
+
+    g_object_unref (group);
+}
+
+static void
+test_budget (Fixture *fixture, gconstpointer data)
+{
+    UfoMemoryBudget *budget;
+    UfoGroup *group;
+    UfoTask *target;
+    GList *targets;
+    UfoRequisition large;
+    UfoBuffer *buffers[2];
+    gsize size;
+
+    size = 16 * sizeof (gfloat);
+    budget = ufo_memory_budget_new (2 * size);
+    target = fixture->targets[0];
+    targets = g_list_append (NULL, target);
+
+    group = ufo_group_new (targets, NULL, UFO_SEND_SCATTER);
+    ufo_group_set_memory_budget (group, budget);
+    ufo_group_set_depth (group, target, 2);
+    ufo_group_allocate_buffers (group, &fixture->requisition);
+    g_assert_cmpuint (ufo_memory_budget_get_used (budget), ==, 2 * size);
+
+    /* a buffer grows past the budget but its growth is accounted */
+    large.n_dims = 1;
+    large.dims[0] = 32;
+    buffers[0] = ufo_group_pop_output_buffer (group, &large);
+    g_assert_cmpuint (ufo_buffer_get_size (buffers[0]), ==, 2 * size);
+    g_assert_cmpuint (ufo_memory_budget_get_used (budget), ==, 3 * size);
+
+    ufo_group_push_output_buffer (group, buffers[0]);
+    process_item (group, target, 0.0);
+
+    /* shrinking gives the difference back */
+    for (guint i = 0; i < 2; i++)
+        buffers[i] = ufo_group_pop_output_buffer (group, &fixture->requisition);
+
+    g_assert_cmpuint (ufo_memory_budget_get_used (budget), ==, 2 * size);
+
+    for (guint i = 0; i < 2; i++) {
+        ufo_group_push_output_buffer (group, buffers[i]);
+        process_item (group, target, 0.0);
+    }
+
+    /* all buffers are given back with the group */
+    g_object_unref (group);
+    g_assert_cmpuint (ufo_memory_budget_get_used (budget), ==, 0);
+
+    ufo_memory_budget_free (budget);
+    g_list_free (targets);
+}
+
+static void
+test_drop_oldest (Fixture *fixture, gconstpointer data)
+{
+    UfoGroup *group;
+    UfoTask *target;
+    GList *targets;
+    UfoBuffer *buffers[3];
+
+    target = fixture->targets[0];
+    targets = g_list_append (NULL, target);
+
+    group = ufo_group_new (targets, NULL, UFO_SEND_SCATTER);
+    ufo_group_set_depth (group, target, 2);
+    ufo_group_set_drop_oldest (group, target, TRUE);
+
+    for (guint i = 0; i < 2; i++) {
+        buffers[i] = ufo_group_pop_output_buffer (group, &fixture->requisition);
+        ufo_group_push_output_buffer (group, buffers[i]);
+    }
+
+    /* with all buffers pending, the oldest one is taken back */
+    buffers[2] = ufo_group_pop_output_buffer (group, &fixture->requisition);
+    g_assert (buffers[2] == buffers[0]);
+    ufo_group_push_output_buffer (group, buffers[2]);
+
+    g_assert (ufo_group_pop_input_buffer (group, target) == buffers[1]);
+    ufo_group_push_input_buffer (group, target, buffers[1]);
+    g_assert (ufo_group_pop_input_buffer (group, target) == buffers[0]);
+    ufo_group_push_input_buffer (group, target, buffers[0]);
+
+    g_object_unref (group);
+    g_list_free (targets);
+}
+
+static void
+test_forward (Fixture *fixture, gconstpointer data)
+{
+    UfoGroup *upstream;
+    UfoGroup *downstream;
+    UfoTask *filter;
+    UfoTask *sink;
+    GList *filters;
+    GList *sinks;
+    UfoBuffer *buffer;
+
+    filter = fixture->targets[0];
+    sink = fixture->targets[1];
+    filters = g_list_append (NULL, filter);
+    sinks = g_list_append (NULL, sink);
+
+    upstream = ufo_group_new (filters, NULL, UFO_SEND_SCATTER);
+    downstream = ufo_group_new (sinks, NULL, UFO_SEND_SCATTER);
+    ufo_group_set_depth (upstream, filter, 1);
+    g_assert (ufo_group_can_forward (downstream));
+
+    /* the filter passes its input on, the sink gives it back upstream */
+    buffer = ufo_group_pop_output_buffer (upstream, &fixture->requisition);
+    ufo_group_push_output_buffer (upstream, buffer);
+    g_assert (ufo_group_pop_input_buffer (upstream, filter) == buffer);
+    ufo_group_push_output_buffer (downstream, buffer);
+    g_assert (ufo_group_pop_input_buffer (downstream, sink) == buffer);
+    ufo_group_push_input_buffer (downstream, sink, buffer);
+    g_assert (ufo_group_pop_output_buffer (upstream, &fixture->requisition) == buffer);
+
+    /* a reset returns pending items to their owner as well */
+    ufo_group_push_output_buffer (downstream, buffer);
+    ufo_group_reset (downstream);
+    g_assert (ufo_group_pop_output_buffer (upstream, &fixture->requisition) == buffer);
+    ufo_group_return_output_buffer (upstream, buffer);
+
+    /* dropped items would not be given back to their owner */
+    ufo_group_set_drop_oldest (downstream, sink, TRUE);
+    g_assert (!ufo_group_can_forward (downstream));
+
+    g_object_unref (downstream);
+    g_object_unref (upstream);
+    g_list_free (sinks);
+    g_list_free (filters);
+}
+
+static void
+test_depth (Fixture *fixture, gconstpointer data)
+{
+    UfoMemoryBudget *budget;
+    UfoGroup *group;
+    UfoTask *target;
+    GList *targets;
+    gsize size;
+
+    size = 16 * sizeof (gfloat);
+    budget = ufo_memory_budget_new (0);
+    target = fixture->targets[0];
+    targets = g_list_append (NULL, target);
+
+    group = ufo_group_new (targets, NULL, UFO_SEND_SCATTER);
+    ufo_group_set_memory_budget (group, budget);
+    ufo_group_set_depth (group, target, 5);
+
+    /* the producer fills all buffers of the edge without waiting */
+    for (guint i = 0; i < 5; i++)
+        send_item (fixture, group);
+
+    g_assert_cmpuint (ufo_memory_budget_get_used (budget), ==, 5 * size);
+
+    for (guint i = 0; i < 5; i++)
+        process_item (group, target, 0.0);
+
+    g_object_unref (group);
+    ufo_memory_budget_free (budget);
+    g_list_free (targets);
+}
+
+typedef struct {
+    UfoGroup *group;
+    UfoTask *target;
+} Consumer;
+
+static gpointer
+consume_slowly (Consumer *consumer)
+{
+    UfoBuffer *input;
+
+    while ((input = ufo_group_pop_input_buffer (consumer->group, consumer->target)) != UFO_END_OF_STREAM) {
+        g_usleep (5000);
+        ufo_group_push_input_buffer (consumer->group, consumer->target, input);
+    }
+
+    return NULL;
+}
+
+static void
+test_auto_depth (Fixture *fixture, gconstpointer data)
+{
+    UfoMemoryBudget *budget;
+    UfoGroup *group;
+    Consumer consumer;
+    GThread *thread;
+    GList *targets;
+    gsize size;
+
+    size = 16 * sizeof (gfloat);
+    budget = ufo_memory_budget_new (0);
+    consumer.target = fixture->targets[0];
+    targets = g_list_append (NULL, consumer.target);
+
+    group = ufo_group_new (targets, NULL, UFO_SEND_SCATTER);
+    ufo_group_set_memory_budget (group, budget);
+    ufo_group_set_depth (group, consumer.target, UFO_QUEUE_DEPTH_AUTO);
+    consumer.group = group;
+
+    thread = g_thread_create ((GThreadFunc) consume_slowly, &consumer, TRUE, NULL);
+
+    /*
+     * Bursts of eight items make the producer wait for the slow consumer and
+     * the pauses make the consumer wait, which is when the queue should grow.
+     */
+    for (guint burst = 0; burst < 8; burst++) {
+        for (guint i = 0; i < 8; i++)
+            send_item (fixture, group);
+
+        g_usleep (50000);
+    }
+
+    ufo_group_finish (group);
+    g_thread_join (thread);
+
+    g_assert_cmpuint (ufo_memory_budget_get_used (budget), >, 2 * size);
+
+    g_object_unref (group);
+    ufo_memory_budget_free (budget);
+    g_list_free (targets);
+}
+
+void
+test_add_group (void)
+{
+    g_test_add ("/no-opencl/group/least-loaded",
+                Fixture, NULL,
+                setup, test_least_loaded, teardown);
+
+    g_test_add ("/no-opencl/group/fallback",
+                Fixture, NULL,
+                setup, test_fallback, teardown);
+
+    g_test_add ("/no-opencl/group/budget",
+                Fixture, NULL,
+                setup, test_budget, teardown);
+
+    g_test_add ("/no-opencl/group/drop-oldest",
+                Fixture, NULL,
+                setup, test_drop_oldest, teardown);
+
+    g_test_add ("/no-opencl/group/forward",
+                Fixture, NULL,
+                setup, test_forward, teardown);
+
+    g_test_add ("/no-opencl/group/depth",
+                Fixture, NULL,
+                setup, test_depth, teardown);
+
+    g_test_add ("/no-opencl/group/auto-depth",
+                Fixture, NULL,
+                setup, test_auto_depth, teardown);
+}
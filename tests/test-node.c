@@ -55,6 +55,53 @@ test_copy (void)
     g_object_unref (copy);
 }
 
+static gpointer
+get_cmd_queue (UfoGpuNode *node)
+{
+    return ufo_gpu_node_get_cmd_queue (node);
+}
+
+static void
+test_gpu_queues (void)
+{
+    UfoResources *resources;
+    UfoGpuNode *node;
+    GThread *thread;
+    GList *nodes;
+    GError *error = NULL;
+    gpointer queue;
+
+    resources = ufo_resources_new (&error);
+    g_assert_no_error (error);
+
+    nodes = ufo_resources_get_gpu_nodes (resources);
+    node = UFO_GPU_NODE (nodes->data);
+
+    /* the default queue does not depend on the calling thread */
+    queue = ufo_gpu_node_get_cmd_queue (node);
+    thread = g_thread_create ((GThreadFunc) get_cmd_queue, node, TRUE, &error);
+    g_assert_no_error (error);
+    g_assert (g_thread_join (thread) == queue);
+
+    /* tasks are spread round-robin over the compute queues */
+    g_assert_cmpuint (ufo_gpu_node_get_num_compute_queues (node), ==, 2);
+    g_assert (ufo_gpu_node_get_cmd_queue_for (node, 0) == queue);
+    g_assert (ufo_gpu_node_get_cmd_queue_for (node, 1) != queue);
+    g_assert (ufo_gpu_node_get_cmd_queue_for (node, 2) == queue);
+
+    g_object_set (node, "num-compute-queues", 3, NULL);
+    g_assert_cmpuint (ufo_gpu_node_get_num_compute_queues (node), ==, 3);
+    g_assert (ufo_gpu_node_get_cmd_queue_for (node, 2) != queue);
+    g_assert (ufo_gpu_node_get_cmd_queue_for (node, 3) == queue);
+
+    /* the priority queue is not shared with other tasks */
+    for (guint i = 0; i < 3; i++)
+        g_assert (ufo_gpu_node_get_priority_queue (node) != ufo_gpu_node_get_cmd_queue_for (node, i));
+
+    g_list_free (nodes);
+    g_object_unref (resources);
+}
+
 void
 test_add_node (void)
 {
@@ -63,4 +110,7 @@ test_add_node (void)
 
     g_test_add_func ("/no-opencl/node/copy",
                      test_copy);
+
+    g_test_add_func ("/opencl/node/gpu/queues",
+                     test_gpu_queues);
 }
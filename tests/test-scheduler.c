@@ -0,0 +1,1359 @@
+/*
+ * Copyright (C) 2011-2013 Karlsruhe Institute of Technology
+ *
+ * This file is part of Ufo.
+ *
+ * This library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <ufo/ufo.h>
+#include <ufo/ufo-group-scheduler.h>
+#include <ufo/ufo-local-scheduler.h>
+#include "test-suite.h"
+
+#define N_ITEMS     10
+
+/*
+ * A CPU task that either generates N_ITEMS numbers, drops odd numbers, sums up
+ * what it receives or passes on the sums of what it reduced, depending on its
+ * mode. Generated items carry their number as "index" metadata. A processor
+ * with the batch flag sums up the elements of each batch and passes it on
+ * unchanged instead, one with the forward flag passes all items on after
+ * sleeping for its delay and adds the value of its second input if it has one,
+ * leaving them on the device if it is a GPU task. Tasks with the gpu
+ * flag are mapped to a GPU and remember their command queue. Tasks with the
+ * static_requisition flag declare a static output size and invalidate it at
+ * the middle item if invalidate is set, tasks with the inplace flag count the
+ * items they could write into their input. Reductors merge the sums of their
+ * copies and count the merges they received, with the skip flag they drop odd
+ * numbers and they stop after the item finish_at if it is set, just like
+ * generators. Processors that keep an item return bad_result instead of TRUE
+ * if it is set. Items leaving a
+ * sliding window are subtracted again. Tasks with n_outputs > 1 write
+ * the same item to all outputs. All tasks count the items that
+ * arrive after a larger one and how often they were asked for their
+ * requisition.
+ */
+typedef struct {
+    UfoTaskNode parent_instance;
+    UfoTaskMode mode;
+    gboolean batch;
+    gboolean gpu;
+    gboolean forward;
+    gboolean static_requisition;
+    gboolean invalidate;
+    gboolean inplace;
+    gboolean skip;
+    gboolean bad_result;
+    guint finish_at;
+    gulong delay;
+    guint n_inputs;
+    guint n_outputs;
+    gpointer queue;
+    guint current;
+    guint n_received;
+    guint n_batches;
+    guint n_mismatched;
+    guint n_unordered;
+    guint n_requisitions;
+    guint n_inplace;
+    guint n_merged;
+    gfloat last;
+    gfloat sum;
+} TestTask;
+
+typedef struct {
+    UfoTaskNodeClass parent_class;
+} TestTaskClass;
+
+static void test_task_interface_init (UfoTaskIface *iface);
+
+G_DEFINE_TYPE_WITH_CODE (TestTask, test_task, UFO_TYPE_TASK_NODE,
+                         G_IMPLEMENT_INTERFACE (UFO_TYPE_TASK,
+                                                test_task_interface_init))
+
+static TestTask *
+test_task_new (UfoTaskMode mode)
+{
+    TestTask *task;
+
+    task = g_object_new (test_task_get_type (), NULL);
+    task->mode = mode;
+    return task;
+}
+
+static void
+test_task_setup (UfoTask *task,
+                 UfoResources *resources,
+                 GError **error)
+{
+    ((TestTask *) task)->current = 0;
+}
+
+static void
+test_task_get_requisition (UfoTask *task,
+                           UfoBuffer **inputs,
+                           UfoRequisition *requisition)
+{
+    ((TestTask *) task)->n_requisitions++;
+
+    if (((TestTask *) task)->batch) {
+        ufo_buffer_get_requisition (inputs[0], requisition);
+        return;
+    }
+
+    requisition->n_dims = 1;
+    requisition->dims[0] = 1;
+}
+
+static guint
+test_task_get_num_inputs (UfoTask *task)
+{
+    TestTask *self = (TestTask *) task;
+
+    if (self->mode == UFO_TASK_MODE_GENERATOR)
+        return 0;
+
+    return self->n_inputs > 0 ? self->n_inputs : 1;
+}
+
+static guint
+test_task_get_num_dimensions (UfoTask *task,
+                              guint input)
+{
+    return 1;
+}
+
+static UfoTaskMode
+test_task_get_mode (UfoTask *task)
+{
+    TestTask *self = (TestTask *) task;
+
+    return self->mode | (self->gpu ? UFO_TASK_MODE_GPU : UFO_TASK_MODE_CPU) |
+           (self->batch ? UFO_TASK_MODE_BATCH : 0) |
+           (self->static_requisition ? UFO_TASK_MODE_STATIC_REQUISITION : 0) |
+           (self->inplace ? UFO_TASK_MODE_INPLACE : 0);
+}
+
+static gboolean
+test_task_process (UfoTask *task,
+                   UfoBuffer **inputs,
+                   UfoBuffer *output,
+                   UfoRequisition *requisition)
+{
+    TestTask *self = (TestTask *) task;
+    GValue *index;
+    gfloat value;
+
+    self->queue = ufo_task_node_get_cmd_queue (UFO_TASK_NODE (task));
+
+    if (self->batch) {
+        gfloat *data = ufo_buffer_get_host_array (inputs[0], NULL);
+
+        for (gsize i = 0; i < ufo_buffer_get_size (inputs[0]) / sizeof (gfloat); i++)
+            self->sum += data[i];
+
+        self->n_batches++;
+        ufo_buffer_copy (inputs[0], output);
+        return TRUE;
+    }
+
+    value = ufo_buffer_get_host_array (inputs[0], NULL)[0];
+    index = ufo_buffer_get_metadata (inputs[0], "index");
+
+    if (index == NULL || g_value_get_uint (index) != (guint) value)
+        self->n_mismatched++;
+
+    if (value < self->last)
+        self->n_unordered++;
+
+    self->last = value;
+
+    if (output == inputs[0])
+        self->n_inplace++;
+
+    if (self->invalidate && value == N_ITEMS / 2)
+        ufo_task_node_invalidate_requisition (UFO_TASK_NODE (task));
+
+    if (self->mode == UFO_TASK_MODE_SINK || self->mode == UFO_TASK_MODE_REDUCTOR) {
+        if (self->skip && ((guint) value) % 2) {
+            ufo_task_node_skip_output (UFO_TASK_NODE (task));
+            return TRUE;
+        }
+
+        self->n_received++;
+        self->sum += value;
+        return self->finish_at == 0 || (guint) value < self->finish_at;
+    }
+
+    if (self->forward) {
+        if (self->n_inputs > 1)
+            value += ufo_buffer_get_host_array (inputs[1], NULL)[0];
+
+        g_usleep (self->delay);
+        ufo_buffer_get_host_array (output, NULL)[0] = value;
+
+        if (self->gpu)
+            ufo_buffer_get_device_array (output, self->queue);
+
+        return TRUE;
+    }
+
+    if (((guint) value) % 2) {
+        ufo_task_node_skip_output (UFO_TASK_NODE (task));
+        return TRUE;
+    }
+
+    ufo_buffer_get_host_array (output, NULL)[0] = value;
+    return self->bad_result ? self->bad_result : TRUE;
+}
+
+static gboolean
+is_sliding (UfoTaskNode *node)
+{
+    guint size;
+    guint step;
+    gdouble duration;
+    gdouble interval;
+
+    ufo_task_node_get_window (node, &size, &step);
+    ufo_task_node_get_time_window (node, &duration, &interval);
+    return step < size || interval < duration;
+}
+
+static gboolean
+test_task_generate (UfoTask *task,
+                    UfoBuffer *output,
+                    UfoRequisition *requisition)
+{
+    TestTask *self = (TestTask *) task;
+    GValue index = {0};
+
+    if (self->mode == UFO_TASK_MODE_REDUCTOR) {
+        if (self->n_received == 0)
+            return FALSE;
+
+        ufo_buffer_get_host_array (output, NULL)[0] = self->sum;
+
+        /* sliding windows generate once per step and keep their state */
+        if (!is_sliding (UFO_TASK_NODE (task))) {
+            self->n_received = 0;
+            self->sum = 0.0f;
+        }
+
+        return TRUE;
+    }
+
+    if (self->current == N_ITEMS ||
+        (self->finish_at > 0 && self->current > self->finish_at))
+        return FALSE;
+
+    g_value_init (&index, G_TYPE_UINT);
+    g_value_set_uint (&index, self->current);
+    ufo_buffer_set_metadata (output, "index", &index);
+    g_value_unset (&index);
+
+    ufo_buffer_get_host_array (output, NULL)[0] = (gfloat) self->current++;
+    return TRUE;
+}
+
+static guint
+test_task_get_num_outputs (UfoTask *task)
+{
+    TestTask *self = (TestTask *) task;
+
+    return self->n_outputs > 0 ? self->n_outputs : 1;
+}
+
+static void
+test_task_get_output_requisition (UfoTask *task,
+                                  UfoBuffer **inputs,
+                                  guint output,
+                                  UfoRequisition *requisition)
+{
+    requisition->n_dims = 1;
+    requisition->dims[0] = 1;
+}
+
+static void
+copy_to_outputs (TestTask *self,
+                 UfoBuffer **outputs)
+{
+    for (guint i = 1; i < self->n_outputs; i++) {
+        ufo_buffer_get_host_array (outputs[i], NULL)[0] = ufo_buffer_get_host_array (outputs[0], NULL)[0];
+        ufo_buffer_copy_metadata (outputs[0], outputs[i]);
+    }
+}
+
+static gboolean
+test_task_process_outputs (UfoTask *task,
+                           UfoBuffer **inputs,
+                           UfoBuffer **outputs,
+                           UfoRequisition *requisitions)
+{
+    gboolean result;
+
+    result = test_task_process (task, inputs, outputs[0], &requisitions[0]);
+    copy_to_outputs ((TestTask *) task, outputs);
+    return result;
+}
+
+static gboolean
+test_task_generate_outputs (UfoTask *task,
+                            UfoBuffer **outputs,
+                            UfoRequisition *requisitions)
+{
+    gboolean result;
+
+    result = test_task_generate (task, outputs[0], &requisitions[0]);
+    copy_to_outputs ((TestTask *) task, outputs);
+    return result;
+}
+
+static void
+test_task_remove (UfoTask *task,
+                  UfoBuffer **inputs,
+                  UfoBuffer *output,
+                  UfoRequisition *requisition)
+{
+    TestTask *self = (TestTask *) task;
+
+    self->n_received--;
+    self->sum -= ufo_buffer_get_host_array (inputs[0], NULL)[0];
+}
+
+static void
+test_task_merge (UfoTask *task,
+                 UfoBuffer *output,
+                 UfoTask *partial,
+                 UfoBuffer *partial_output)
+{
+    TestTask *self = (TestTask *) task;
+    TestTask *other = (TestTask *) partial;
+
+    self->n_received += other->n_received;
+    self->sum += other->sum;
+    self->n_merged += other->n_merged + 1;
+}
+
+static void
+test_task_interface_init (UfoTaskIface *iface)
+{
+    iface->setup = test_task_setup;
+    iface->get_num_inputs = test_task_get_num_inputs;
+    iface->get_num_dimensions = test_task_get_num_dimensions;
+    iface->get_mode = test_task_get_mode;
+    iface->get_requisition = test_task_get_requisition;
+    iface->process = test_task_process;
+    iface->generate = test_task_generate;
+    iface->get_num_outputs = test_task_get_num_outputs;
+    iface->get_output_requisition = test_task_get_output_requisition;
+    iface->process_outputs = test_task_process_outputs;
+    iface->generate_outputs = test_task_generate_outputs;
+    iface->merge = test_task_merge;
+    iface->remove = test_task_remove;
+}
+
+static UfoNode *
+test_task_copy (UfoNode *node,
+                GError **error)
+{
+    TestTask *orig = (TestTask *) node;
+    TestTask *copy;
+
+    copy = (TestTask *) UFO_NODE_CLASS (test_task_parent_class)->copy (node, error);
+    copy->mode = orig->mode;
+    copy->batch = orig->batch;
+    copy->gpu = orig->gpu;
+    copy->forward = orig->forward;
+    copy->static_requisition = orig->static_requisition;
+    copy->invalidate = orig->invalidate;
+    copy->inplace = orig->inplace;
+    copy->skip = orig->skip;
+    copy->bad_result = orig->bad_result;
+    copy->finish_at = orig->finish_at;
+    copy->delay = orig->delay;
+    copy->n_inputs = orig->n_inputs;
+    copy->n_outputs = orig->n_outputs;
+    return UFO_NODE (copy);
+}
+
+static void
+test_task_class_init (TestTaskClass *klass)
+{
+    UFO_NODE_CLASS (klass)->copy = test_task_copy;
+}
+
+static void
+test_task_init (TestTask *task)
+{
+    task->last = -1.0f;
+    ufo_task_node_set_plugin_name (UFO_TASK_NODE (task), "[test]");
+}
+
+static void
+test_skip (gconstpointer data)
+{
+    UfoBaseScheduler *(*scheduler_new) (void) = (UfoBaseScheduler *(*) (void)) data;
+    UfoBaseScheduler *scheduler;
+    UfoTaskGraph *graph;
+    TestTask *source;
+    TestTask *filter;
+    TestTask *sink;
+    GError *error = NULL;
+
+    graph = UFO_TASK_GRAPH (ufo_task_graph_new ());
+    source = test_task_new (UFO_TASK_MODE_GENERATOR);
+    filter = test_task_new (UFO_TASK_MODE_PROCESSOR);
+    sink = test_task_new (UFO_TASK_MODE_SINK);
+
+    ufo_task_graph_connect_nodes (graph, UFO_TASK_NODE (source), UFO_TASK_NODE (filter));
+    ufo_task_graph_connect_nodes (graph, UFO_TASK_NODE (filter), UFO_TASK_NODE (sink));
+
+    scheduler = scheduler_new ();
+    ufo_base_scheduler_run (scheduler, graph, &error);
+    g_assert_no_error (error);
+
+    /* only the even numbers 0, 2, 4, 6 and 8 arrive */
+    g_assert_cmpuint (sink->n_received, ==, N_ITEMS / 2);
+    g_assert_cmpfloat (sink->sum, ==, 20.0f);
+
+    g_object_unref (scheduler);
+    g_object_unref (source);
+    g_object_unref (filter);
+    g_object_unref (sink);
+    g_object_unref (graph);
+}
+
+static void
+count_warnings (const gchar *domain,
+                GLogLevelFlags flags,
+                const gchar *message,
+                gpointer data)
+{
+    (*(guint *) data)++;
+}
+
+static void
+test_bad_result (void)
+{
+    TestTask *task;
+    UfoBuffer *input;
+    UfoBuffer *output;
+    UfoRequisition requisition;
+    GLogLevelFlags fatal;
+    guint handler;
+    guint n_warnings = 0;
+
+    requisition.n_dims = 1;
+    requisition.dims[0] = 1;
+    input = ufo_buffer_new (&requisition, NULL);
+    output = ufo_buffer_new (&requisition, NULL);
+    ufo_buffer_get_host_array (input, NULL)[0] = 2.0f;
+
+    task = test_task_new (UFO_TASK_MODE_PROCESSOR);
+    task->bad_result = 2;
+
+    fatal = g_log_set_always_fatal (G_LOG_FATAL_MASK);
+    handler = g_log_set_handler ("Ufo", G_LOG_LEVEL_WARNING, count_warnings, &n_warnings);
+
+    /* values other than TRUE and FALSE are reported and keep the stream going */
+    g_assert (ufo_task_process (UFO_TASK (task), &input, output, &requisition) == TRUE);
+    g_assert_cmpuint (n_warnings, ==, 1);
+
+    g_log_remove_handler ("Ufo", handler);
+    g_log_set_always_fatal (fatal);
+
+    g_object_unref (task);
+    g_object_unref (input);
+    g_object_unref (output);
+}
+
+static void
+test_session (void)
+{
+    UfoScheduler *scheduler;
+    UfoSession *session;
+    UfoTaskGraph *graph;
+    TestTask *source;
+    TestTask *sink;
+    GError *error = NULL;
+
+    graph = UFO_TASK_GRAPH (ufo_task_graph_new ());
+    source = test_task_new (UFO_TASK_MODE_GENERATOR);
+    sink = test_task_new (UFO_TASK_MODE_SINK);
+    ufo_task_graph_connect_nodes (graph, UFO_TASK_NODE (source), UFO_TASK_NODE (sink));
+
+    scheduler = UFO_SCHEDULER (ufo_scheduler_new ());
+    session = ufo_session_new (scheduler, graph, &error);
+    g_assert_no_error (error);
+
+    g_assert (!ufo_session_wait (session, &error));
+    g_assert_error (error, UFO_SESSION_ERROR, UFO_SESSION_ERROR_STATE);
+    g_clear_error (&error);
+
+    /* the generator starts from the beginning in each run */
+    for (guint i = 1; i <= 2; i++) {
+        g_assert (ufo_session_run (session, &error));
+        g_assert_no_error (error);
+        g_assert_cmpuint (ufo_session_get_num_runs (session), ==, i);
+        g_assert_cmpuint (sink->n_received, ==, i * N_ITEMS);
+        g_assert_cmpfloat (sink->sum, ==, i * 45.0f);
+    }
+
+    ufo_session_close (session);
+    g_assert (!ufo_session_run (session, &error));
+    g_assert_error (error, UFO_SESSION_ERROR, UFO_SESSION_ERROR_STATE);
+    g_clear_error (&error);
+
+    g_object_unref (session);
+    g_object_unref (scheduler);
+    g_object_unref (source);
+    g_object_unref (sink);
+    g_object_unref (graph);
+}
+
+static void
+test_session_errors (void)
+{
+    UfoScheduler *scheduler;
+    UfoSession *session;
+    UfoTaskGraph *graph;
+    TestTask *source;
+    TestTask *sink;
+    GError *error = NULL;
+
+    graph = UFO_TASK_GRAPH (ufo_task_graph_new ());
+    source = test_task_new (UFO_TASK_MODE_GENERATOR);
+    sink = test_task_new (UFO_TASK_MODE_SINK);
+    source->static_requisition = TRUE;
+    ufo_task_graph_connect_nodes (graph, UFO_TASK_NODE (source), UFO_TASK_NODE (sink));
+
+    /* setup fails, the source needs more than one float */
+    scheduler = UFO_SCHEDULER (ufo_scheduler_new ());
+    g_object_set (scheduler, "memory-budget", (guint64) sizeof (gfloat), NULL);
+    session = ufo_session_new (scheduler, graph, &error);
+    g_assert (session == NULL);
+    g_assert_error (error, UFO_SCHEDULER_ERROR, UFO_SCHEDULER_ERROR_SETUP);
+    g_clear_error (&error);
+    g_object_unref (scheduler);
+
+    /* the run succeeds but its costs cannot be saved */
+    scheduler = UFO_SCHEDULER (ufo_scheduler_new ());
+    g_object_set (scheduler, "cost-file", "/nonexistent/ufo-costs.json", NULL);
+    session = ufo_session_new (scheduler, graph, &error);
+    g_assert_no_error (error);
+    g_assert (!ufo_session_run (session, &error));
+    g_assert (error != NULL);
+    g_clear_error (&error);
+    g_assert_cmpuint (sink->n_received, ==, N_ITEMS);
+
+    g_object_unref (session);
+    g_object_unref (scheduler);
+    g_object_unref (source);
+    g_object_unref (sink);
+    g_object_unref (graph);
+}
+
+static void
+test_window (void)
+{
+    UfoBaseScheduler *scheduler;
+    UfoTaskGraph *graph;
+    TestTask *source;
+    TestTask *reductor;
+    TestTask *sink;
+    GError *error = NULL;
+
+    graph = UFO_TASK_GRAPH (ufo_task_graph_new ());
+    source = test_task_new (UFO_TASK_MODE_GENERATOR);
+    reductor = test_task_new (UFO_TASK_MODE_REDUCTOR);
+    sink = test_task_new (UFO_TASK_MODE_SINK);
+
+    ufo_task_node_set_window (UFO_TASK_NODE (reductor), 4, 0);
+    ufo_task_graph_connect_nodes (graph, UFO_TASK_NODE (source), UFO_TASK_NODE (reductor));
+    ufo_task_graph_connect_nodes (graph, UFO_TASK_NODE (reductor), UFO_TASK_NODE (sink));
+
+    scheduler = ufo_scheduler_new ();
+    ufo_base_scheduler_run (scheduler, graph, &error);
+    g_assert_no_error (error);
+
+    /* windows 0..3, 4..7 and the incomplete 8..9 */
+    g_assert_cmpuint (sink->n_received, ==, 3);
+    g_assert_cmpfloat (sink->sum, ==, 45.0f);
+
+    g_object_unref (scheduler);
+    g_object_unref (source);
+    g_object_unref (reductor);
+    g_object_unref (sink);
+    g_object_unref (graph);
+}
+
+static void
+test_reduce_tree (void)
+{
+    UfoBaseScheduler *scheduler;
+    UfoTaskGraph *graph;
+    TestTask *source;
+    TestTask *reductor;
+    TestTask *sink;
+    GError *error = NULL;
+
+    graph = UFO_TASK_GRAPH (ufo_task_graph_new ());
+    source = test_task_new (UFO_TASK_MODE_GENERATOR);
+    reductor = test_task_new (UFO_TASK_MODE_REDUCTOR);
+    sink = test_task_new (UFO_TASK_MODE_SINK);
+    reductor->gpu = TRUE;
+
+    /* a scattering producer lets the reductor run on every GPU */
+    ufo_task_node_set_send_pattern (UFO_TASK_NODE (source), UFO_SEND_SCATTER);
+    ufo_task_graph_connect_nodes (graph, UFO_TASK_NODE (source), UFO_TASK_NODE (reductor));
+    ufo_task_graph_connect_nodes (graph, UFO_TASK_NODE (reductor), UFO_TASK_NODE (sink));
+
+    scheduler = ufo_scheduler_new ();
+    ufo_base_scheduler_run (scheduler, graph, &error);
+    g_assert_no_error (error);
+
+    /* the shares of all copies end up in the single result */
+    g_assert_cmpuint (sink->n_received, ==, 1);
+    g_assert_cmpfloat (sink->sum, ==, 45.0f);
+
+    if (reductor->n_merged == 0)
+        g_test_message ("Reductor was not replicated, merging is not covered");
+
+    g_object_unref (scheduler);
+    g_object_unref (source);
+    g_object_unref (reductor);
+    g_object_unref (sink);
+    g_object_unref (graph);
+}
+
+static void
+test_batch (void)
+{
+    UfoBaseScheduler *scheduler;
+    UfoTaskGraph *graph;
+    TestTask *source;
+    TestTask *batcher;
+    TestTask *sink;
+    GError *error = NULL;
+
+    graph = UFO_TASK_GRAPH (ufo_task_graph_new ());
+    source = test_task_new (UFO_TASK_MODE_GENERATOR);
+    batcher = test_task_new (UFO_TASK_MODE_PROCESSOR);
+    sink = test_task_new (UFO_TASK_MODE_SINK);
+    batcher->batch = TRUE;
+
+    ufo_task_node_set_batch_size (UFO_TASK_NODE (batcher), 0, 4);
+    ufo_task_graph_connect_nodes (graph, UFO_TASK_NODE (source), UFO_TASK_NODE (batcher));
+    ufo_task_graph_connect_nodes (graph, UFO_TASK_NODE (batcher), UFO_TASK_NODE (sink));
+
+    scheduler = ufo_scheduler_new ();
+    ufo_base_scheduler_run (scheduler, graph, &error);
+    g_assert_no_error (error);
+
+    /* batches 0..3, 4..7 and the short 8..9 are split again for the sink */
+    g_assert_cmpuint (batcher->n_batches, ==, 3);
+    g_assert_cmpuint (sink->n_received, ==, N_ITEMS);
+    g_assert_cmpfloat (sink->sum, ==, 45.0f);
+
+    /* each item arrives with its own metadata */
+    g_assert_cmpuint (sink->n_mismatched, ==, 0);
+
+    g_object_unref (scheduler);
+    g_object_unref (source);
+    g_object_unref (batcher);
+    g_object_unref (sink);
+    g_object_unref (graph);
+}
+
+static void
+test_queues (void)
+{
+    UfoBaseScheduler *scheduler;
+    UfoTaskGraph *graph;
+    TestTask *source;
+    TestTask *first;
+    TestTask *second;
+    TestTask *sink;
+    GError *error = NULL;
+
+    graph = UFO_TASK_GRAPH (ufo_task_graph_new ());
+    source = test_task_new (UFO_TASK_MODE_GENERATOR);
+    first = test_task_new (UFO_TASK_MODE_PROCESSOR);
+    second = test_task_new (UFO_TASK_MODE_PROCESSOR);
+    sink = test_task_new (UFO_TASK_MODE_SINK);
+    first->gpu = TRUE;
+    second->gpu = TRUE;
+
+    ufo_task_graph_connect_nodes (graph, UFO_TASK_NODE (source), UFO_TASK_NODE (first));
+    ufo_task_graph_connect_nodes (graph, UFO_TASK_NODE (first), UFO_TASK_NODE (second));
+    ufo_task_graph_connect_nodes (graph, UFO_TASK_NODE (second), UFO_TASK_NODE (sink));
+
+    scheduler = ufo_scheduler_new ();
+    g_object_set (scheduler, "expand", FALSE, NULL);
+    ufo_base_scheduler_run (scheduler, graph, &error);
+    g_assert_no_error (error);
+
+    /* two tasks on the same GPU use different compute queues */
+    g_assert (first->queue != NULL);
+    g_assert (second->queue != NULL);
+    g_assert (first->queue != second->queue);
+
+    g_object_unref (scheduler);
+    g_object_unref (source);
+    g_object_unref (first);
+    g_object_unref (second);
+    g_object_unref (sink);
+    g_object_unref (graph);
+}
+
+static TestTask *
+add_forward (UfoTaskGraph *graph,
+             TestTask *from,
+             gulong delay)
+{
+    TestTask *task;
+
+    task = test_task_new (UFO_TASK_MODE_PROCESSOR);
+    task->forward = TRUE;
+    task->delay = delay;
+    ufo_task_graph_connect_nodes (graph, UFO_TASK_NODE (from), UFO_TASK_NODE (task));
+    return task;
+}
+
+static void
+run_unexpanded (UfoTaskGraph *graph)
+{
+    UfoBaseScheduler *scheduler;
+    GError *error = NULL;
+
+    scheduler = ufo_scheduler_new ();
+    g_object_set (scheduler, "expand", FALSE, NULL);
+    ufo_base_scheduler_run (scheduler, graph, &error);
+    g_assert_no_error (error);
+    g_object_unref (scheduler);
+}
+
+static void
+test_static_requisition (gconstpointer data)
+{
+    UfoBaseScheduler *(*scheduler_new) (void) = (UfoBaseScheduler *(*) (void)) data;
+    UfoBaseScheduler *scheduler;
+    UfoTaskGraph *graph;
+    TestTask *source;
+    TestTask *fixed;
+    TestTask *invalidated;
+    TestTask *sink;
+    GError *error = NULL;
+
+    graph = UFO_TASK_GRAPH (ufo_task_graph_new ());
+    source = test_task_new (UFO_TASK_MODE_GENERATOR);
+    fixed = add_forward (graph, source, 0);
+    invalidated = add_forward (graph, fixed, 0);
+    sink = test_task_new (UFO_TASK_MODE_SINK);
+    fixed->static_requisition = TRUE;
+    invalidated->static_requisition = TRUE;
+    invalidated->invalidate = TRUE;
+
+    ufo_task_graph_connect_nodes (graph, UFO_TASK_NODE (invalidated), UFO_TASK_NODE (sink));
+
+    scheduler = scheduler_new ();
+    ufo_base_scheduler_run (scheduler, graph, &error);
+    g_assert_no_error (error);
+
+    /* input sizes never change, so the requisition is only asked once ... */
+    g_assert_cmpuint (fixed->n_requisitions, ==, 1);
+
+    /* ... unless the task invalidates it */
+    g_assert_cmpuint (invalidated->n_requisitions, ==, 2);
+
+    g_assert_cmpuint (sink->n_received, ==, N_ITEMS);
+    g_assert_cmpfloat (sink->sum, ==, 45.0f);
+
+    g_object_unref (scheduler);
+    g_object_unref (source);
+    g_object_unref (fixed);
+    g_object_unref (invalidated);
+    g_object_unref (sink);
+    g_object_unref (graph);
+}
+
+static void
+test_unconnected_output (void)
+{
+    UfoTaskGraph *graph;
+    TestTask *source;
+    TestTask *filter;
+    TestTask *sink;
+
+    graph = UFO_TASK_GRAPH (ufo_task_graph_new ());
+    source = test_task_new (UFO_TASK_MODE_GENERATOR);
+    filter = test_task_new (UFO_TASK_MODE_PROCESSOR);
+    sink = test_task_new (UFO_TASK_MODE_SINK);
+    source->n_outputs = 2;
+    filter->n_outputs = 2;
+    filter->forward = TRUE;
+
+    /* nothing consumes the first output of both tasks */
+    ufo_task_graph_connect_ports (graph, UFO_TASK_NODE (source), 1, UFO_TASK_NODE (filter), 0);
+    ufo_task_graph_connect_ports (graph, UFO_TASK_NODE (filter), 1, UFO_TASK_NODE (sink), 0);
+    run_unexpanded (graph);
+
+    g_assert_cmpuint (filter->n_mismatched, ==, 0);
+    g_assert_cmpuint (sink->n_received, ==, N_ITEMS);
+    g_assert_cmpuint (sink->n_mismatched, ==, 0);
+    g_assert_cmpfloat (sink->sum, ==, 45.0f);
+
+    g_object_unref (source);
+    g_object_unref (filter);
+    g_object_unref (sink);
+    g_object_unref (graph);
+}
+
+/*
+ * Run a generator, a forward task with @delay if it is not 0, @reductor and a
+ * sink, and return the sink.
+ */
+static TestTask *
+run_reductor (TestTask *reductor,
+              gulong delay)
+{
+    UfoTaskGraph *graph;
+    TestTask *source;
+    TestTask *from;
+    TestTask *sink;
+
+    graph = UFO_TASK_GRAPH (ufo_task_graph_new ());
+    source = test_task_new (UFO_TASK_MODE_GENERATOR);
+    sink = test_task_new (UFO_TASK_MODE_SINK);
+    from = delay > 0 ? add_forward (graph, source, delay) : source;
+
+    ufo_task_graph_connect_nodes (graph, UFO_TASK_NODE (from), UFO_TASK_NODE (reductor));
+    ufo_task_graph_connect_nodes (graph, UFO_TASK_NODE (reductor), UFO_TASK_NODE (sink));
+    run_unexpanded (graph);
+
+    if (from != source)
+        g_object_unref (from);
+
+    g_object_unref (source);
+    g_object_unref (graph);
+    return sink;
+}
+
+static void
+test_window_sliding (void)
+{
+    TestTask *reductor;
+    TestTask *sink;
+
+    reductor = test_task_new (UFO_TASK_MODE_REDUCTOR);
+    ufo_task_node_set_window (UFO_TASK_NODE (reductor), 4, 2);
+    sink = run_reductor (reductor, 0);
+
+    /* windows 0..1, 0..3, 2..5, 4..7 and 6..9 */
+    g_assert_cmpuint (sink->n_received, ==, 5);
+    g_assert_cmpfloat (sink->sum, ==, 73.0f);
+
+    g_object_unref (reductor);
+    g_object_unref (sink);
+}
+
+static void
+test_window_skip (void)
+{
+    TestTask *reductor;
+    TestTask *sink;
+
+    reductor = test_task_new (UFO_TASK_MODE_REDUCTOR);
+    reductor->skip = TRUE;
+    ufo_task_node_set_window (UFO_TASK_NODE (reductor), 2, 0);
+    sink = run_reductor (reductor, 0);
+
+    /* skipped odd numbers do not count, so windows are 0+2, 4+6 and 8 */
+    g_assert_cmpuint (sink->n_received, ==, 3);
+    g_assert_cmpfloat (sink->sum, ==, 20.0f);
+
+    g_object_unref (reductor);
+    g_object_unref (sink);
+}
+
+static void
+test_window_finish (void)
+{
+    TestTask *reductor;
+    TestTask *sink;
+
+    reductor = test_task_new (UFO_TASK_MODE_REDUCTOR);
+    reductor->finish_at = 5;
+    ufo_task_node_set_window (UFO_TASK_NODE (reductor), 4, 0);
+    sink = run_reductor (reductor, 0);
+
+    /* the window 4..5 ends early and the rest of the stream is dropped */
+    g_assert_cmpuint (sink->n_received, ==, 2);
+    g_assert_cmpfloat (sink->sum, ==, 15.0f);
+
+    g_object_unref (reductor);
+    g_object_unref (sink);
+}
+
+static void
+test_time_window (void)
+{
+    TestTask *reductor;
+    TestTask *sink;
+
+    /* items arrive every 20 ms, so 50 ms windows end several times */
+    reductor = test_task_new (UFO_TASK_MODE_REDUCTOR);
+    ufo_task_node_set_time_window (UFO_TASK_NODE (reductor), 0.05, 0.0);
+    sink = run_reductor (reductor, 20000);
+
+    g_assert_cmpuint (sink->n_received, >=, 2);
+    g_assert_cmpfloat (sink->sum, ==, 45.0f);
+
+    g_object_unref (reductor);
+    g_object_unref (sink);
+
+    /* a sliding window that is longer than the stream ends with it */
+    reductor = test_task_new (UFO_TASK_MODE_REDUCTOR);
+    ufo_task_node_set_time_window (UFO_TASK_NODE (reductor), 10.0, 5.0);
+    sink = run_reductor (reductor, 0);
+
+    g_assert_cmpuint (sink->n_received, ==, 1);
+    g_assert_cmpfloat (sink->sum, ==, 45.0f);
+
+    g_object_unref (reductor);
+    g_object_unref (sink);
+}
+
+static void
+test_reorder (void)
+{
+    UfoTaskGraph *graph;
+    TestTask *source;
+    TestTask *slow;
+    TestTask *fast;
+    TestTask *sink;
+
+    graph = UFO_TASK_GRAPH (ufo_task_graph_new ());
+    source = test_task_new (UFO_TASK_MODE_GENERATOR);
+    sink = test_task_new (UFO_TASK_MODE_SINK);
+    slow = add_forward (graph, source, 20000);
+    fast = add_forward (graph, source, 0);
+
+    ufo_task_node_set_reorder_window (UFO_TASK_NODE (sink), 0, 4);
+    ufo_task_graph_connect_nodes (graph, UFO_TASK_NODE (slow), UFO_TASK_NODE (sink));
+    ufo_task_graph_connect_nodes (graph, UFO_TASK_NODE (fast), UFO_TASK_NODE (sink));
+    run_unexpanded (graph);
+
+    /* the fast branch runs ahead but its items wait for the slow ones */
+    g_assert_cmpuint (sink->n_received, ==, N_ITEMS);
+    g_assert_cmpuint (sink->n_unordered, ==, 0);
+    g_assert_cmpuint (sink->n_mismatched, ==, 0);
+    g_assert_cmpfloat (sink->sum, ==, 45.0f);
+
+    g_object_unref (source);
+    g_object_unref (slow);
+    g_object_unref (fast);
+    g_object_unref (sink);
+    g_object_unref (graph);
+}
+
+static void
+test_static_budget (void)
+{
+    UfoBaseScheduler *scheduler;
+    UfoTaskGraph *graph;
+    TestTask *source;
+    TestTask *sink;
+    GError *error = NULL;
+
+    graph = UFO_TASK_GRAPH (ufo_task_graph_new ());
+    source = test_task_new (UFO_TASK_MODE_GENERATOR);
+    sink = test_task_new (UFO_TASK_MODE_SINK);
+    source->static_requisition = TRUE;
+    ufo_task_graph_connect_nodes (graph, UFO_TASK_NODE (source), UFO_TASK_NODE (sink));
+
+    /* the source needs at least two buffers of one float */
+    scheduler = ufo_scheduler_new ();
+    g_object_set (scheduler, "expand", FALSE, "memory-budget", (guint64) sizeof (gfloat), NULL);
+    ufo_base_scheduler_run (scheduler, graph, &error);
+    g_assert_error (error, UFO_SCHEDULER_ERROR, UFO_SCHEDULER_ERROR_SETUP);
+    g_assert_cmpuint (sink->n_received, ==, 0);
+    g_clear_error (&error);
+    g_object_unref (scheduler);
+
+    scheduler = ufo_scheduler_new ();
+    g_object_set (scheduler, "expand", FALSE, "memory-budget", (guint64) (2 * sizeof (gfloat)), NULL);
+    ufo_base_scheduler_run (scheduler, graph, &error);
+    g_assert_no_error (error);
+    g_assert_cmpuint (sink->n_received, ==, N_ITEMS);
+    g_object_unref (scheduler);
+
+    g_object_unref (source);
+    g_object_unref (sink);
+    g_object_unref (graph);
+}
+
+static void
+test_inplace (void)
+{
+    UfoTaskGraph *graph;
+    TestTask *source;
+    TestTask *filter;
+    TestTask *sink;
+
+    graph = UFO_TASK_GRAPH (ufo_task_graph_new ());
+    source = test_task_new (UFO_TASK_MODE_GENERATOR);
+    filter = add_forward (graph, source, 0);
+    sink = test_task_new (UFO_TASK_MODE_SINK);
+    filter->inplace = TRUE;
+
+    ufo_task_graph_connect_nodes (graph, UFO_TASK_NODE (filter), UFO_TASK_NODE (sink));
+    run_unexpanded (graph);
+
+    /* every item is written into its input and keeps its metadata */
+    g_assert_cmpuint (filter->n_inplace, ==, N_ITEMS);
+    g_assert_cmpuint (sink->n_received, ==, N_ITEMS);
+    g_assert_cmpuint (sink->n_mismatched, ==, 0);
+    g_assert_cmpfloat (sink->sum, ==, 45.0f);
+
+    g_object_unref (source);
+    g_object_unref (filter);
+    g_object_unref (sink);
+    g_object_unref (graph);
+}
+
+static void
+test_reorder_inplace (void)
+{
+    UfoTaskGraph *graph;
+    TestTask *source;
+    TestTask *slow;
+    TestTask *fast;
+    TestTask *join;
+    TestTask *sink;
+
+    graph = UFO_TASK_GRAPH (ufo_task_graph_new ());
+    source = test_task_new (UFO_TASK_MODE_GENERATOR);
+    slow = add_forward (graph, source, 20000);
+    fast = add_forward (graph, source, 0);
+    sink = test_task_new (UFO_TASK_MODE_SINK);
+
+    join = test_task_new (UFO_TASK_MODE_PROCESSOR);
+    join->forward = TRUE;
+    join->inplace = TRUE;
+    ufo_task_node_set_reorder_window (UFO_TASK_NODE (join), 0, 4);
+    ufo_task_graph_connect_nodes (graph, UFO_TASK_NODE (slow), UFO_TASK_NODE (join));
+    ufo_task_graph_connect_nodes (graph, UFO_TASK_NODE (fast), UFO_TASK_NODE (join));
+    ufo_task_graph_connect_nodes (graph, UFO_TASK_NODE (join), UFO_TASK_NODE (sink));
+    run_unexpanded (graph);
+
+    /*
+     * Forwarded inputs must go back to the branch they came from, otherwise
+     * one branch runs out of buffers.
+     */
+    g_assert_cmpuint (join->n_inplace, ==, N_ITEMS);
+    g_assert_cmpuint (join->n_unordered, ==, 0);
+    g_assert_cmpuint (sink->n_received, ==, N_ITEMS);
+    g_assert_cmpuint (sink->n_unordered, ==, 0);
+    g_assert_cmpfloat (sink->sum, ==, 45.0f);
+
+    g_object_unref (source);
+    g_object_unref (slow);
+    g_object_unref (fast);
+    g_object_unref (join);
+    g_object_unref (sink);
+    g_object_unref (graph);
+}
+
+static void
+test_reorder_nested (void)
+{
+    UfoTaskGraph *graph;
+    TestTask *source;
+    TestTask *outer;
+    TestTask *slow;
+    TestTask *fast;
+    TestTask *join;
+    TestTask *other;
+    TestTask *sink;
+
+    graph = UFO_TASK_GRAPH (ufo_task_graph_new ());
+    source = test_task_new (UFO_TASK_MODE_GENERATOR);
+    sink = test_task_new (UFO_TASK_MODE_SINK);
+
+    /* one outer branch scatters again among a slow and a fast branch */
+    outer = add_forward (graph, source, 0);
+    other = add_forward (graph, source, 0);
+    slow = add_forward (graph, outer, 20000);
+    fast = add_forward (graph, outer, 0);
+
+    join = test_task_new (UFO_TASK_MODE_PROCESSOR);
+    join->forward = TRUE;
+    ufo_task_node_set_reorder_window (UFO_TASK_NODE (join), 0, 4);
+    ufo_task_graph_connect_nodes (graph, UFO_TASK_NODE (slow), UFO_TASK_NODE (join));
+    ufo_task_graph_connect_nodes (graph, UFO_TASK_NODE (fast), UFO_TASK_NODE (join));
+
+    ufo_task_node_set_reorder_window (UFO_TASK_NODE (sink), 0, 4);
+    ufo_task_graph_connect_nodes (graph, UFO_TASK_NODE (join), UFO_TASK_NODE (sink));
+    ufo_task_graph_connect_nodes (graph, UFO_TASK_NODE (other), UFO_TASK_NODE (sink));
+    run_unexpanded (graph);
+
+    /* the inner join must not disturb the numbers of the outer one */
+    g_assert_cmpuint (join->n_unordered, ==, 0);
+    g_assert_cmpuint (sink->n_received, ==, N_ITEMS);
+    g_assert_cmpuint (sink->n_unordered, ==, 0);
+    g_assert_cmpfloat (sink->sum, ==, 45.0f);
+
+    g_object_unref (source);
+    g_object_unref (outer);
+    g_object_unref (other);
+    g_object_unref (slow);
+    g_object_unref (fast);
+    g_object_unref (join);
+    g_object_unref (sink);
+    g_object_unref (graph);
+}
+
+static void
+test_expand_side_input (void)
+{
+    UfoTaskGraph *graph;
+    TestTask *source;
+    TestTask *first;
+    TestTask *join;
+    TestTask *reference;
+    TestTask *average;
+    TestTask *side;
+    TestTask *sink;
+    GList *successors;
+
+    graph = UFO_TASK_GRAPH (ufo_task_graph_new ());
+    source = test_task_new (UFO_TASK_MODE_GENERATOR);
+    reference = test_task_new (UFO_TASK_MODE_GENERATOR);
+    average = test_task_new (UFO_TASK_MODE_REDUCTOR);
+    sink = test_task_new (UFO_TASK_MODE_SINK);
+
+    /* a GPU path whose second node adds the sum 0 + ... + 9 to each item */
+    first = add_forward (graph, source, 0);
+    first->gpu = TRUE;
+    join = add_forward (graph, first, 0);
+    join->gpu = TRUE;
+    join->n_inputs = 2;
+
+    ufo_task_graph_connect_nodes (graph, UFO_TASK_NODE (reference), UFO_TASK_NODE (average));
+    side = add_forward (graph, average, 0);
+    ufo_task_graph_connect_nodes_full (graph, UFO_TASK_NODE (side), UFO_TASK_NODE (join), 1);
+    ufo_task_graph_connect_nodes (graph, UFO_TASK_NODE (join), UFO_TASK_NODE (sink));
+
+    ufo_task_graph_expand (graph, NULL, 2, FALSE);
+
+    /* the side input feeds both copies of the join */
+    successors = ufo_graph_get_successors (UFO_GRAPH (graph), UFO_NODE (side));
+    g_assert_cmpuint (g_list_length (successors), ==, 2);
+    g_list_free (successors);
+
+    run_unexpanded (graph);
+
+    g_assert_cmpuint (sink->n_received, ==, N_ITEMS);
+    g_assert_cmpfloat (sink->sum, ==, 45.0f + N_ITEMS * 45.0f);
+
+    g_object_unref (source);
+    g_object_unref (first);
+    g_object_unref (join);
+    g_object_unref (reference);
+    g_object_unref (average);
+    g_object_unref (side);
+    g_object_unref (sink);
+    g_object_unref (graph);
+}
+
+static void
+test_batch_stacked (gconstpointer data)
+{
+    gboolean on_device = GPOINTER_TO_INT (data);
+    UfoTaskGraph *graph;
+    TestTask *source;
+    TestTask *first;
+    TestTask *batcher;
+    TestTask *sink;
+
+    graph = UFO_TASK_GRAPH (ufo_task_graph_new ());
+    source = test_task_new (UFO_TASK_MODE_GENERATOR);
+    sink = test_task_new (UFO_TASK_MODE_SINK);
+    first = add_forward (graph, source, 0);
+    first->gpu = on_device;
+
+    batcher = test_task_new (UFO_TASK_MODE_PROCESSOR);
+    batcher->batch = TRUE;
+    batcher->gpu = on_device;
+    ufo_task_node_set_batch_size (UFO_TASK_NODE (batcher), 0, 4);
+    ufo_task_graph_connect_nodes (graph, UFO_TASK_NODE (first), UFO_TASK_NODE (batcher));
+    ufo_task_graph_connect_nodes (graph, UFO_TASK_NODE (batcher), UFO_TASK_NODE (sink));
+
+    run_unexpanded (graph);
+
+    /* single floats sit at offsets a device cannot alias, all must arrive */
+    g_assert_cmpuint (batcher->n_batches, ==, 3);
+    g_assert_cmpfloat (batcher->sum, ==, 45.0f);
+    g_assert_cmpuint (sink->n_received, ==, N_ITEMS);
+    g_assert_cmpfloat (sink->sum, ==, 45.0f);
+
+    g_object_unref (source);
+    g_object_unref (first);
+    g_object_unref (batcher);
+    g_object_unref (sink);
+    g_object_unref (graph);
+}
+
+static void
+test_priority (void)
+{
+    UfoTaskGraph *graph;
+    TestTask *source;
+    TestTask *normal;
+    TestTask *high;
+    TestTask *sink;
+    UfoGpuNode *gpu;
+
+    graph = UFO_TASK_GRAPH (ufo_task_graph_new ());
+    source = test_task_new (UFO_TASK_MODE_GENERATOR);
+    sink = test_task_new (UFO_TASK_MODE_SINK);
+    normal = add_forward (graph, source, 0);
+    normal->gpu = TRUE;
+    high = add_forward (graph, normal, 0);
+    high->gpu = TRUE;
+    ufo_task_node_set_priority (UFO_TASK_NODE (high), UFO_TASK_PRIORITY_HIGH);
+    ufo_task_graph_connect_nodes (graph, UFO_TASK_NODE (high), UFO_TASK_NODE (sink));
+
+    g_assert_cmpint (ufo_task_node_get_priority (UFO_TASK_NODE (normal)), ==, UFO_TASK_PRIORITY_NORMAL);
+    run_unexpanded (graph);
+
+    /* only the high-priority task runs on the reserved queue */
+    gpu = UFO_GPU_NODE (ufo_task_node_get_proc_node (UFO_TASK_NODE (high)));
+    g_assert (high->queue == ufo_gpu_node_get_priority_queue (gpu));
+    g_assert (normal->queue != high->queue);
+    g_assert_cmpuint (sink->n_received, ==, N_ITEMS);
+
+    g_object_unref (source);
+    g_object_unref (normal);
+    g_object_unref (high);
+    g_object_unref (sink);
+    g_object_unref (graph);
+}
+
+static void
+test_drop_oldest (void)
+{
+    UfoTaskGraph *graph;
+    TestTask *source;
+    TestTask *slow;
+    TestTask *sink;
+
+    graph = UFO_TASK_GRAPH (ufo_task_graph_new ());
+    source = test_task_new (UFO_TASK_MODE_GENERATOR);
+    sink = test_task_new (UFO_TASK_MODE_SINK);
+    slow = add_forward (graph, source, 20000);
+    ufo_task_node_set_drop_oldest (UFO_TASK_NODE (slow), 0, TRUE);
+    ufo_task_graph_connect_nodes (graph, UFO_TASK_NODE (slow), UFO_TASK_NODE (sink));
+
+    run_unexpanded (graph);
+
+    /* the source never waits, so items get lost but the newest one arrives */
+    g_assert_cmpuint (sink->n_received, <=, N_ITEMS);
+    g_assert_cmpuint (sink->n_unordered, ==, 0);
+    g_assert_cmpfloat (sink->last, ==, N_ITEMS - 1);
+
+    g_object_unref (source);
+    g_object_unref (slow);
+    g_object_unref (sink);
+    g_object_unref (graph);
+}
+
+static void
+test_group_short_input (void)
+{
+    UfoBaseScheduler *scheduler;
+    UfoTaskGraph *graph;
+    TestTask *source;
+    TestTask *shorter;
+    TestTask *join;
+    TestTask *sink;
+    GError *error = NULL;
+
+    graph = UFO_TASK_GRAPH (ufo_task_graph_new ());
+    source = test_task_new (UFO_TASK_MODE_GENERATOR);
+    shorter = test_task_new (UFO_TASK_MODE_GENERATOR);
+    sink = test_task_new (UFO_TASK_MODE_SINK);
+
+    /* the second input ends after item 4 while the first one still sends */
+    shorter->finish_at = 4;
+    join = add_forward (graph, source, 0);
+    join->n_inputs = 2;
+    ufo_task_graph_connect_nodes_full (graph, UFO_TASK_NODE (shorter), UFO_TASK_NODE (join), 1);
+    ufo_task_graph_connect_nodes (graph, UFO_TASK_NODE (join), UFO_TASK_NODE (sink));
+
+    scheduler = ufo_group_scheduler_new ();
+    ufo_base_scheduler_run (scheduler, graph, &error);
+    g_assert_no_error (error);
+
+    /* 0 + 0, 1 + 1, ..., 4 + 4 arrive and the longer source is not stuck */
+    g_assert_cmpuint (sink->n_received, ==, 5);
+    g_assert_cmpfloat (sink->sum, ==, 20.0f);
+    g_assert_cmpuint (source->current, ==, N_ITEMS);
+
+    g_object_unref (scheduler);
+    g_object_unref (source);
+    g_object_unref (shorter);
+    g_object_unref (join);
+    g_object_unref (sink);
+    g_object_unref (graph);
+}
+
+void
+test_add_scheduler (void)
+{
+    g_test_add_data_func ("/opencl/scheduler/skip", (gconstpointer) ufo_scheduler_new, test_skip);
+    g_test_add_data_func ("/opencl/scheduler/fixed/skip", (gconstpointer) ufo_fixed_scheduler_new, test_skip);
+    g_test_add_data_func ("/opencl/scheduler/group/skip", (gconstpointer) ufo_group_scheduler_new, test_skip);
+    g_test_add_data_func ("/opencl/scheduler/local/skip", (gconstpointer) ufo_local_scheduler_new, test_skip);
+    g_test_add_func ("/no-opencl/scheduler/bad-result", test_bad_result);
+    g_test_add_func ("/opencl/scheduler/group/short-input", test_group_short_input);
+    g_test_add_func ("/opencl/scheduler/priority", test_priority);
+    g_test_add_func ("/opencl/scheduler/drop-oldest", test_drop_oldest);
+    g_test_add_data_func ("/opencl/scheduler/static-requisition", (gconstpointer) ufo_scheduler_new, test_static_requisition);
+    g_test_add_data_func ("/opencl/scheduler/fixed/static-requisition", (gconstpointer) ufo_fixed_scheduler_new, test_static_requisition);
+    g_test_add_data_func ("/opencl/scheduler/group/static-requisition", (gconstpointer) ufo_group_scheduler_new, test_static_requisition);
+    g_test_add_data_func ("/opencl/scheduler/local/static-requisition", (gconstpointer) ufo_local_scheduler_new, test_static_requisition);
+    g_test_add_func ("/opencl/scheduler/session", test_session);
+    g_test_add_func ("/opencl/scheduler/session/errors", test_session_errors);
+    g_test_add_func ("/opencl/scheduler/window", test_window);
+    g_test_add_func ("/opencl/scheduler/window/sliding", test_window_sliding);
+    g_test_add_func ("/opencl/scheduler/window/skip", test_window_skip);
+    g_test_add_func ("/opencl/scheduler/window/finish", test_window_finish);
+    g_test_add_func ("/opencl/scheduler/window/time", test_time_window);
+    g_test_add_func ("/opencl/scheduler/reduce-tree", test_reduce_tree);
+    g_test_add_func ("/opencl/scheduler/batch", test_batch);
+    g_test_add_data_func ("/opencl/scheduler/batch/stacked/host", GINT_TO_POINTER (FALSE), test_batch_stacked);
+    g_test_add_data_func ("/opencl/scheduler/batch/stacked/device", GINT_TO_POINTER (TRUE), test_batch_stacked);
+    g_test_add_func ("/opencl/scheduler/queues", test_queues);
+    g_test_add_func ("/opencl/scheduler/unconnected-output", test_unconnected_output);
+    g_test_add_func ("/opencl/scheduler/reorder", test_reorder);
+    g_test_add_func ("/opencl/scheduler/reorder/nested", test_reorder_nested);
+    g_test_add_func ("/opencl/scheduler/static-budget", test_static_budget);
+    g_test_add_func ("/opencl/scheduler/inplace", test_inplace);
+    g_test_add_func ("/opencl/scheduler/reorder/inplace", test_reorder_inplace);
+    g_test_add_func ("/opencl/scheduler/expand/side-input", test_expand_side_input);
+}
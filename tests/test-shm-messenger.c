@@ -0,0 +1,382 @@
+/*
+ * Copyright (C) 2011-2013 Karlsruhe Institute of Technology
+ *
+ * This file is part of Ufo.
+ *
+ * This library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _GNU_SOURCE
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <ufo/ufo.h>
+#include <ufo/ufo-shm-messenger.h>
+#include "test-suite.h"
+#include "config.h"
+
+#ifdef WITH_ZMQ
+#include <ufo/ufo-zmq-messenger.h>
+#endif
+
+#define N_PERF_MESSAGES     64
+#define PERF_MESSAGE_SIZE   (8 << 20)
+
+typedef struct {
+    UfoMessenger *msger;
+    gboolean verify;
+} Server;
+
+static guint64
+checksum (UfoMessage *msg)
+{
+    guint8 *data = msg->data;
+    guint64 sum = 0;
+
+    for (guint64 i = 0; i < msg->data_size; i++)
+        sum += data[i];
+
+    return sum;
+}
+
+static void
+fill (UfoMessage *msg)
+{
+    guint8 *data = msg->data;
+
+    for (guint64 i = 0; i < msg->data_size; i++)
+        data[i] = (guint8) (i % 251);
+}
+
+static gpointer
+serve (Server *server)
+{
+    GError *error = NULL;
+    gboolean running = TRUE;
+    guint16 n_requests = 0;
+
+    while (running) {
+        UfoMessage *request;
+        UfoMessage *reply;
+
+        request = ufo_messenger_recv_blocking (server->msger, &error);
+        g_assert_no_error (error);
+
+        switch (request->type) {
+            case UFO_MESSAGE_GET_NUM_DEVICES:
+                reply = ufo_message_new (UFO_MESSAGE_ACK, sizeof (guint16));
+                *(guint16 *) reply->data = ++n_requests;
+                break;
+            case UFO_MESSAGE_SEND_INPUTS:
+                reply = ufo_message_new (UFO_MESSAGE_ACK, sizeof (guint64));
+                *(guint64 *) reply->data = server->verify ? checksum (request) : request->data_size;
+                break;
+            case UFO_MESSAGE_TERMINATE:
+                reply = ufo_message_new (UFO_MESSAGE_ACK, 0);
+                running = FALSE;
+                break;
+            default:
+                g_assert_not_reached ();
+        }
+
+        ufo_messenger_send_blocking (server->msger, reply, &error);
+        g_assert_no_error (error);
+
+        ufo_message_free (reply);
+        ufo_message_free (request);
+    }
+
+    return NULL;
+}
+
+static GThread *
+start_server (Server *server, const gchar *addr, gboolean verify)
+{
+    GError *error = NULL;
+
+    server->msger = ufo_messenger_create (addr, &error);
+    g_assert_no_error (error);
+
+    ufo_messenger_connect (server->msger, addr, UFO_MESSENGER_SERVER, &error);
+    g_assert_no_error (error);
+
+    server->verify = verify;
+    return g_thread_create ((GThreadFunc) serve, server, TRUE, NULL);
+}
+
+static void
+stop_server (Server *server, GThread *thread, UfoMessenger *client)
+{
+    GError *error = NULL;
+    UfoMessage *request;
+    UfoMessage *reply;
+
+    request = ufo_message_new (UFO_MESSAGE_TERMINATE, 0);
+    reply = ufo_messenger_send_blocking (client, request, &error);
+    g_assert_no_error (error);
+
+    g_thread_join (thread);
+
+    ufo_message_free (request);
+    ufo_message_free (reply);
+    ufo_messenger_disconnect (server->msger);
+    g_object_unref (server->msger);
+}
+
+static UfoMessenger *
+connect_client (const gchar *addr)
+{
+    UfoMessenger *msger;
+    GError *error = NULL;
+
+    msger = ufo_messenger_create (addr, &error);
+    g_assert_no_error (error);
+
+    ufo_messenger_connect (msger, addr, UFO_MESSENGER_CLIENT, &error);
+    g_assert_no_error (error);
+
+    return msger;
+}
+
+static guint64
+send_inputs (UfoMessenger *msger, UfoMessage *request)
+{
+    GError *error = NULL;
+    UfoMessage *reply;
+    guint64 result;
+
+    reply = ufo_messenger_send_blocking (msger, request, &error);
+    g_assert_no_error (error);
+    g_assert_cmpuint (reply->data_size, ==, sizeof (guint64));
+
+    result = *(guint64 *) reply->data;
+    ufo_message_free (reply);
+    return result;
+}
+
+static void
+test_exchange (void)
+{
+    Server server;
+    GThread *thread;
+    UfoMessenger *client;
+    UfoMessage *request;
+    GError *error = NULL;
+    guint64 expected;
+
+    thread = start_server (&server, "shm://test-exchange", TRUE);
+    client = connect_client ("shm://test-exchange");
+
+    for (guint16 i = 1; i <= 10; i++) {
+        UfoMessage *reply;
+
+        request = ufo_message_new (UFO_MESSAGE_GET_NUM_DEVICES, 0);
+        reply = ufo_messenger_send_blocking (client, request, &error);
+        g_assert_no_error (error);
+        g_assert_cmpuint (*(guint16 *) reply->data, ==, i);
+
+        ufo_message_free (request);
+        ufo_message_free (reply);
+    }
+
+    /* written into the slot directly */
+    request = ufo_messenger_new_message (client, UFO_MESSAGE_SEND_INPUTS, 1 << 20);
+    fill (request);
+    expected = checksum (request);
+    g_assert_cmpuint (send_inputs (client, request), ==, expected);
+    ufo_message_free (request);
+
+    /* split across several slots */
+    request = ufo_messenger_new_message (client, UFO_MESSAGE_SEND_INPUTS, 40 << 20);
+    fill (request);
+    expected = checksum (request);
+    g_assert_cmpuint (send_inputs (client, request), ==, expected);
+    ufo_message_free (request);
+
+    stop_server (&server, thread, client);
+    ufo_messenger_disconnect (client);
+    g_object_unref (client);
+}
+
+static void
+test_unsent_message (void)
+{
+    Server server;
+    GThread *thread;
+    UfoMessenger *client;
+    UfoMessage *request;
+    UfoMessage *other;
+    GError *error = NULL;
+
+    thread = start_server (&server, "shm://test-unsent", TRUE);
+    client = connect_client ("shm://test-unsent");
+
+    /* freeing a prepared message must give the ring back to other requests */
+    request = ufo_messenger_new_message (client, UFO_MESSAGE_SEND_INPUTS, 1024);
+    ufo_message_free (request);
+
+    /* another request must not wait for the prepared one to be sent */
+    request = ufo_messenger_new_message (client, UFO_MESSAGE_SEND_INPUTS, 1024);
+    other = ufo_message_new (UFO_MESSAGE_GET_NUM_DEVICES, 0);
+    g_assert (ufo_messenger_send_blocking (client, other, &error) == NULL);
+    g_assert_error (error, UFO_MESSENGER_ERROR, UFO_MESSENGER_BUFFER_FULL);
+    g_clear_error (&error);
+    ufo_message_free (other);
+    ufo_message_free (request);
+
+    request = ufo_messenger_new_message (client, UFO_MESSAGE_SEND_INPUTS, 1024);
+    fill (request);
+    g_assert_cmpuint (send_inputs (client, request), ==, checksum (request));
+    ufo_message_free (request);
+
+    stop_server (&server, thread, client);
+    ufo_messenger_disconnect (client);
+    g_object_unref (client);
+}
+
+static void
+test_dead_client (void)
+{
+    UfoMessenger *server;
+    UfoMessenger *client;
+    UfoMessage *request;
+    GError *error = NULL;
+    pid_t pid;
+    gint status;
+
+    server = ufo_messenger_create ("shm://test-dead", &error);
+    g_assert_no_error (error);
+    ufo_messenger_connect (server, "shm://test-dead", UFO_MESSENGER_SERVER, &error);
+    g_assert_no_error (error);
+
+    /* the child dies while it holds the segment for a prepared message */
+    pid = fork ();
+
+    if (pid == 0) {
+        client = connect_client ("shm://test-dead");
+        ufo_messenger_new_message (client, UFO_MESSAGE_SEND_INPUTS, 1024);
+        _exit (0);
+    }
+
+    g_assert (pid > 0);
+    g_assert (waitpid (pid, &status, 0) == pid);
+
+    client = connect_client ("shm://test-dead");
+    request = ufo_message_new (UFO_MESSAGE_GET_NUM_DEVICES, 0);
+    g_assert (ufo_messenger_send_blocking (client, request, &error) == NULL);
+    g_assert_error (error, UFO_MESSENGER_ERROR, UFO_MESSENGER_CONNECTION_PROBLEM);
+    g_clear_error (&error);
+
+    ufo_message_free (request);
+    ufo_messenger_disconnect (client);
+    g_object_unref (client);
+    ufo_messenger_disconnect (server);
+    g_object_unref (server);
+}
+
+static void
+test_slot_size (void)
+{
+    Server server;
+    GThread *thread;
+    UfoMessenger *client;
+    UfoMessenger *invalid;
+    UfoMessage *request;
+    GError *error = NULL;
+
+    /* clients take the slot size from the segment */
+    thread = start_server (&server, "shm://test-slot?slot=4k", TRUE);
+    client = connect_client ("shm://test-slot");
+
+    request = ufo_messenger_new_message (client, UFO_MESSAGE_SEND_INPUTS, 4096);
+    fill (request);
+    g_assert_cmpuint (send_inputs (client, request), ==, checksum (request));
+    ufo_message_free (request);
+
+    request = ufo_messenger_new_message (client, UFO_MESSAGE_SEND_INPUTS, 10000);
+    fill (request);
+    g_assert_cmpuint (send_inputs (client, request), ==, checksum (request));
+    ufo_message_free (request);
+
+    stop_server (&server, thread, client);
+    ufo_messenger_disconnect (client);
+    g_object_unref (client);
+
+    invalid = ufo_messenger_create ("shm://test-slot?slot=4x", &error);
+    g_assert_no_error (error);
+    ufo_messenger_connect (invalid, "shm://test-slot?slot=4x", UFO_MESSENGER_SERVER, &error);
+    g_assert_error (error, UFO_MESSENGER_ERROR, UFO_MESSENGER_INVALID_ADDRESS);
+    g_clear_error (&error);
+    g_object_unref (invalid);
+}
+
+static gdouble
+measure_throughput (const gchar *addr)
+{
+    Server server;
+    GThread *thread;
+    GTimer *timer;
+    UfoMessenger *client;
+    gdouble elapsed;
+
+    thread = start_server (&server, addr, FALSE);
+    client = connect_client (addr);
+    timer = g_timer_new ();
+
+    for (guint i = 0; i < N_PERF_MESSAGES; i++) {
+        UfoMessage *request;
+
+        request = ufo_messenger_new_message (client, UFO_MESSAGE_SEND_INPUTS, PERF_MESSAGE_SIZE);
+        memset (request->data, i, PERF_MESSAGE_SIZE);
+        g_assert_cmpuint (send_inputs (client, request), ==, PERF_MESSAGE_SIZE);
+        ufo_message_free (request);
+    }
+
+    elapsed = g_timer_elapsed (timer, NULL);
+    g_timer_destroy (timer);
+
+    stop_server (&server, thread, client);
+    ufo_messenger_disconnect (client);
+    g_object_unref (client);
+
+    return N_PERF_MESSAGES * (PERF_MESSAGE_SIZE / 1048576.0) / elapsed;
+}
+
+static void
+test_perf_throughput (void)
+{
+    gdouble shm;
+
+    shm = measure_throughput ("shm://test-perf");
+    g_test_maximized_result (shm, "shm: %.1f MB/s", shm);
+
+#ifdef WITH_ZMQ
+    gdouble ipc;
+
+    ipc = measure_throughput ("ipc:///tmp/ufo-test-perf");
+    g_test_maximized_result (ipc, "ipc: %.1f MB/s", ipc);
+#endif
+}
+
+void
+test_add_shm_messenger (void)
+{
+    g_test_add_func ("/no-opencl/shm_messenger/exchange", test_exchange);
+    g_test_add_func ("/no-opencl/shm_messenger/unsent", test_unsent_message);
+    g_test_add_func ("/no-opencl/shm_messenger/slot-size", test_slot_size);
+    g_test_add_func ("/no-opencl/shm_messenger/dead-client", test_dead_client);
+
+    if (g_test_perf ())
+        g_test_add_func ("/no-opencl/shm_messenger/perf/throughput", test_perf_throughput);
+}
@@ -44,8 +44,10 @@ int main(int argc, char *argv[])
 
     test_add_buffer ();
     test_add_graph ();
+    test_add_group ();
     test_add_profiler ();
     test_add_node ();
+    test_add_scheduler ();
 
 #ifdef WITH_MPI
     int provided;
@@ -58,6 +60,10 @@ int main(int argc, char *argv[])
     test_add_remote_node ();
 #endif
 
+#ifdef WITH_SHM
+    test_add_shm_messenger ();
+#endif
+
     g_test_run();
 
 #ifdef WITH_MPI
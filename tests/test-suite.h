@@ -22,10 +22,13 @@
 
 void test_add_buffer (void);
 void test_add_graph (void);
+void test_add_group (void);
 void test_add_node (void);
 void test_add_profiler (void);
 void test_add_remote_node (void);
+void test_add_scheduler (void);
 void test_add_mpi_remote_node (void);
 void test_add_zmq_messenger (void);
+void test_add_shm_messenger (void);
 
 #endif
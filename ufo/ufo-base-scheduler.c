@@ -29,8 +29,10 @@
 #endif
 
 #include <ufo/ufo-base-scheduler.h>
+#include <ufo/ufo-gpu-node.h>
 #include <ufo/ufo-task-node.h>
 #include <ufo/ufo-task-iface.h>
+#include <ufo/ufo-enums.h>
 #include "ufo-priv.h"
 #include "compat.h"
 
@@ -63,6 +65,9 @@ struct _UfoBaseSchedulerPrivate {
     gboolean         trace;
     gboolean         ran;
     gdouble          time;
+    UfoMappingStrategy mapping;
+    gchar           *cost_file;
+    guint64          memory_budget;
 };
 
 enum {
@@ -70,6 +75,9 @@ enum {
     PROP_EXPAND,
     PROP_ENABLE_TRACING,
     PROP_TIME,
+    PROP_MAPPING,
+    PROP_COST_FILE,
+    PROP_MEMORY_BUDGET,
     N_PROPERTIES,
 };
 
@@ -86,12 +94,82 @@ ufo_base_scheduler_error_quark (void)
     return g_quark_from_static_string ("ufo-scheduler-error-quark");
 }
 
+/*
+ * Check @graph and prepare resources and task costs for a run. Shared by
+ * ufo_base_scheduler_run() and #UfoSession.
+ */
+gboolean
+ufo_base_scheduler_begin_run (UfoBaseScheduler *scheduler,
+                              UfoTaskGraph *graph,
+                              GError **error)
+{
+    GList *gpu_nodes;
+    GList *it;
+
+    if (!ufo_task_graph_is_alright (graph, error))
+        return FALSE;
+
+#ifdef WITH_PYTHON
+    PyEval_InitThreads();
+#endif
+
+    /* Only pay for profiling OpenCL commands if we trace them */
+    gpu_nodes = ufo_resources_get_gpu_nodes (ufo_base_scheduler_get_resources (scheduler));
+
+    g_list_for (gpu_nodes, it) {
+        ufo_gpu_node_set_profiling (UFO_GPU_NODE (it->data), scheduler->priv->trace);
+    }
+
+    g_list_free (gpu_nodes);
+
+    /* Costs of a previous run may be used to map tasks */
+    if (scheduler->priv->cost_file != NULL &&
+        g_file_test (scheduler->priv->cost_file, G_FILE_TEST_EXISTS)) {
+        GError *cost_error = NULL;
+
+        if (!ufo_task_graph_read_costs (graph, scheduler->priv->cost_file, &cost_error)) {
+            g_warning ("Could not read task costs: %s", cost_error->message);
+            g_error_free (cost_error);
+        }
+    }
+
+    return TRUE;
+}
+
+/*
+ * Record the run time of the last run and save task costs if requested. @error
+ * holds the error of the run, costs of a failed run are not saved. Returns
+ * %FALSE if the run failed or the costs could not be saved.
+ */
+gboolean
+ufo_base_scheduler_end_run (UfoBaseScheduler *scheduler,
+                            UfoTaskGraph *graph,
+                            gdouble elapsed,
+                            GError **error)
+{
+    scheduler->priv->time = elapsed;
+
+    if (error != NULL && *error != NULL)
+        return FALSE;
+
+    if (scheduler->priv->cost_file != NULL &&
+        !ufo_task_graph_save_costs (graph, scheduler->priv->cost_file, error)) {
+        if (error != NULL)
+            g_prefix_error (error, "Could not save task costs: ");
+
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
 void
 ufo_base_scheduler_run (UfoBaseScheduler *scheduler,
                         UfoTaskGraph *graph,
                         GError **error)
 {
     UfoBaseSchedulerClass *klass;
+    GError *tmp_error = NULL;
     GTimer *timer;
 
     g_return_if_fail (UFO_IS_BASE_SCHEDULER (scheduler));
@@ -100,18 +178,17 @@ ufo_base_scheduler_run (UfoBaseScheduler *scheduler,
 
     g_return_if_fail (klass->run != NULL);
 
-    if (!ufo_task_graph_is_alright (graph, error))
+    if (!ufo_base_scheduler_begin_run (scheduler, graph, error))
         return;
 
-#ifdef WITH_PYTHON
-    PyEval_InitThreads();
-#endif
-
+    /* end_run must see a failed run even if the caller ignores errors */
     timer = g_timer_new ();
-    (*klass->run)(scheduler, graph, error);
-    scheduler->priv->time = g_timer_elapsed (timer, NULL);
-
+    (*klass->run)(scheduler, graph, &tmp_error);
+    ufo_base_scheduler_end_run (scheduler, graph, g_timer_elapsed (timer, NULL), &tmp_error);
     g_timer_destroy (timer);
+
+    if (tmp_error != NULL)
+        g_propagate_error (error, tmp_error);
 }
 
 void
@@ -201,6 +278,19 @@ ufo_base_scheduler_set_property (GObject *object,
             priv->trace = g_value_get_boolean (value);
             break;
 
+        case PROP_MAPPING:
+            priv->mapping = g_value_get_enum (value);
+            break;
+
+        case PROP_COST_FILE:
+            g_free (priv->cost_file);
+            priv->cost_file = g_value_dup_string (value);
+            break;
+
+        case PROP_MEMORY_BUDGET:
+            priv->memory_budget = g_value_get_uint64 (value);
+            break;
+
         default:
             G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
             break;
@@ -228,6 +318,18 @@ ufo_base_scheduler_get_property (GObject *object,
             g_value_set_double (value, priv->time);
             break;
 
+        case PROP_MAPPING:
+            g_value_set_enum (value, priv->mapping);
+            break;
+
+        case PROP_COST_FILE:
+            g_value_set_string (value, priv->cost_file);
+            break;
+
+        case PROP_MEMORY_BUDGET:
+            g_value_set_uint64 (value, priv->memory_budget);
+            break;
+
         default:
             G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
             break;
@@ -257,6 +359,7 @@ ufo_base_scheduler_finalize (GObject *object)
     priv = UFO_BASE_SCHEDULER_GET_PRIVATE (object);
 
     g_clear_error (&priv->construct_error);
+    g_free (priv->cost_file);
 
     G_OBJECT_CLASS (ufo_base_scheduler_parent_class)->finalize (object);
 }
@@ -328,6 +431,53 @@ ufo_base_scheduler_class_init (UfoBaseSchedulerClass *klass)
                               0.0, G_MAXDOUBLE, 0.0,
                               G_PARAM_READABLE);
 
+    /**
+     * UfoBaseScheduler:mapping:
+     *
+     * Strategy to map tasks to GPU nodes.
+     *
+     * Since: 0.8
+     */
+    properties[PROP_MAPPING] =
+        g_param_spec_enum ("mapping",
+                           "Strategy to map tasks to GPU nodes",
+                           "Strategy to map tasks to GPU nodes",
+                           UFO_TYPE_MAPPING_STRATEGY, UFO_MAPPING_ROUND_ROBIN,
+                           G_PARAM_READWRITE);
+
+    /**
+     * UfoBaseScheduler:cost-file:
+     *
+     * File from which task costs are read before and to which the measured
+     * costs are written after a run. A run fails if the costs cannot be
+     * written.
+     *
+     * Since: 0.8
+     */
+    properties[PROP_COST_FILE] =
+        g_param_spec_string ("cost-file",
+                             "File with estimated task costs",
+                             "File with estimated task costs",
+                             NULL,
+                             G_PARAM_READWRITE);
+
+    /**
+     * UfoBaseScheduler:memory-budget:
+     *
+     * Maximum number of bytes used for buffers passed between tasks or 0 for
+     * no limit. Queues between tasks are made shorter to stay within the
+     * budget. #UfoScheduler plans the buffers of tasks with static output size
+     * at setup and fails if they do not get at least two buffers per target.
+     *
+     * Since: 0.8
+     */
+    properties[PROP_MEMORY_BUDGET] =
+        g_param_spec_uint64 ("memory-budget",
+                             "Maximum memory for buffers between tasks",
+                             "Maximum memory in bytes for buffers between tasks, 0 for no limit",
+                             0, G_MAXUINT64, 0,
+                             G_PARAM_READWRITE);
+
     for (guint i = PROP_0 + 1; i < N_PROPERTIES; i++)
         g_object_class_install_property (oclass, i, properties[i]);
 
@@ -344,6 +494,8 @@ ufo_base_scheduler_init (UfoBaseScheduler *scheduler)
     priv->trace = FALSE;
     priv->ran = FALSE;
     priv->time = 0.0;
+    priv->mapping = UFO_MAPPING_ROUND_ROBIN;
+    priv->cost_file = NULL;
     priv->gpu_nodes = NULL;
     priv->resources = NULL;
 }
@@ -17,7 +17,13 @@
  * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#define _GNU_SOURCE
 #include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #ifdef __APPLE__
 #include <OpenCL/cl.h>
 #else
@@ -26,6 +32,7 @@
 
 #include <ufo/ufo-buffer.h>
 #include <ufo/ufo-resources.h>
+#include "ufo-priv.h"
 #include "compat.h"
 
 /**
@@ -56,7 +63,7 @@
  * @size: n-dimensional size of the region
  *
  * Defines a region with at most #UFO_BUFFER_MAX_NDIMS dimensions for use with
- * ufo_buffer_get_device_array_view().
+ * ufo_buffer_get_device_array_view() and ufo_buffer_new_view().
  */
 
 /**
@@ -86,6 +93,9 @@ G_DEFINE_TYPE(UfoBuffer, ufo_buffer, G_TYPE_OBJECT)
 
 #define UFO_BUFFER_GET_PRIVATE(obj) (G_TYPE_INSTANCE_GET_PRIVATE((obj), UFO_TYPE_BUFFER, UfoBufferPrivate))
 
+/* Granularity in which file-backed buffers are streamed to the device */
+#define MAPPED_CHUNK_SIZE   (4 * 1024 * 1024)
+
 enum {
     PROP_0,
     PROP_ID,
@@ -93,6 +103,29 @@ enum {
     N_PROPERTIES
 };
 
+/*
+ * Metadata is stored in small, reference counted tables that are shared between
+ * buffers by ufo_buffer_copy_metadata(). A table with more than one reference
+ * is immutable and copied on the first modification. Values are allocated and
+ * reference counted separately, so neither growing nor copying a table moves
+ * them.
+ */
+typedef struct {
+    gint    ref_count;
+    GValue  value;
+} MetadataValue;
+
+typedef struct {
+    GQuark          key;
+    MetadataValue  *value;
+} MetadataEntry;
+
+typedef struct {
+    gint            ref_count;
+    guint           n_entries;
+    MetadataEntry  *entries;
+} MetadataTable;
+
 struct _UfoBufferPrivate {
     UfoRequisition      requisition;
     gfloat             *host_array;
@@ -101,13 +134,38 @@ struct _UfoBufferPrivate {
     cl_mem              device_image;
     cl_context          context;
     cl_command_queue    last_queue;
+    cl_command_queue    device_queue;   /* queue that placed the device data */
+    cl_device_id        device;         /* device holding the device data */
     gsize               size;           /* size of buffer in bytes */
     UfoBufferLocation      location;
     UfoBufferLocation      last_location;
-    GHashTable         *metadata;
+    MetadataTable      *metadata;       /* shared, copy-on-write */
+    guint               batch_size;     /* items stacked in outermost dim */
+    GPtrArray          *item_metadata;  /* MetadataTable of each batch item */
     GList              *sub_device_arrays;
+
+    /* Only set for views created with ufo_buffer_new_view() */
+    UfoBuffer          *parent;
+    UfoRegion           view;
+    gsize               view_offset;    /* byte offset of aliasing views */
+    gboolean            view_alias;     /* TRUE if data is shared with parent */
+    gboolean            view_valid;     /* TRUE if strided view is filled */
+    gboolean            view_staged;    /* TRUE if aliased only on the host */
+    gboolean            view_dirty;     /* TRUE if staged data is not written back */
+
+    /* Only set for buffers created with ufo_buffer_new_mapped() */
+    gpointer            mapped;         /* page-aligned start of the mapping */
+    gsize               mapped_size;
+    gchar              *mapped_data;    /* start of the data in the mapping */
+    UfoBufferDepth      mapped_depth;
+    gboolean            mapped_writable;
+
+    cl_event            upload_event;   /* pending read of host_array */
 };
 
+static MetadataTable *metadata_table_ref (MetadataTable *table);
+static void clear_item_metadata (UfoBufferPrivate *priv);
+
 static void
 copy_requisition (UfoRequisition *src,
                   UfoRequisition *dst)
@@ -131,9 +189,26 @@ compute_required_size (UfoRequisition *requisition)
     return size;
 }
 
+/*
+ * Uploads do not block the host, so the host array must neither change nor go
+ * away until the device has read it.
+ */
+static void
+wait_for_upload (UfoBufferPrivate *priv)
+{
+    if (priv->upload_event == NULL)
+        return;
+
+    UFO_RESOURCES_CHECK_CLERR (clWaitForEvents (1, &priv->upload_event));
+    UFO_RESOURCES_CHECK_CLERR (clReleaseEvent (priv->upload_event));
+    priv->upload_event = NULL;
+}
+
 static void
 alloc_host_mem (UfoBufferPrivate *priv)
 {
+    wait_for_upload (priv);
+
     if (priv->host_array != NULL && priv->free)
         g_free (priv->host_array);
 
@@ -245,6 +320,370 @@ alloc_device_image (UfoBufferPrivate *priv)
 }
 #endif
 
+static void
+normalize_region (UfoRequisition *requisition,
+                  UfoRegion *src,
+                  UfoRegion *dst)
+{
+    for (guint i = 0; i < UFO_BUFFER_MAX_NDIMS; i++) {
+        if (i < requisition->n_dims) {
+            dst->origin[i] = src->origin[i];
+            dst->size[i] = src->size[i];
+        }
+        else {
+            dst->origin[i] = 0;
+            dst->size[i] = 1;
+        }
+    }
+}
+
+static gboolean
+region_fits (UfoRequisition *requisition,
+             UfoRegion *region)
+{
+    for (guint i = 0; i < requisition->n_dims; i++) {
+        if (region->size[i] == 0 ||
+            region->origin[i] + region->size[i] > requisition->dims[i])
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+static gboolean
+region_is_contiguous (UfoRequisition *requisition,
+                      UfoRegion *region)
+{
+    guint i = 0;
+
+    /*
+     * A region maps to one contiguous block of memory if its leading dimensions
+     * span the whole extent, followed by at most one partial dimension and only
+     * singular dimensions after that.
+     */
+    while (i < requisition->n_dims && region->size[i] == requisition->dims[i])
+        i++;
+
+    for (i = i + 1; i < requisition->n_dims; i++) {
+        if (region->size[i] != 1)
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+static void
+get_pitches (UfoRequisition *requisition,
+             gsize *row_pitch,
+             gsize *slice_pitch)
+{
+    *row_pitch = requisition->dims[0] * sizeof (gfloat);
+    *slice_pitch = *row_pitch;
+
+    if (requisition->n_dims > 1)
+        *slice_pitch *= requisition->dims[1];
+}
+
+static gsize
+get_region_offset (UfoRequisition *requisition,
+                   UfoRegion *region)
+{
+    gsize row_pitch;
+    gsize slice_pitch;
+
+    get_pitches (requisition, &row_pitch, &slice_pitch);
+
+    return region->origin[2] * slice_pitch +
+           region->origin[1] * row_pitch +
+           region->origin[0] * sizeof (gfloat);
+}
+
+static void
+get_rect_region (UfoRegion *region,
+                 size_t origin[3],
+                 size_t size[3])
+{
+    /* OpenCL expects the first dimension of rectangular copies in bytes */
+    origin[0] = region->origin[0] * sizeof (gfloat);
+    origin[1] = region->origin[1];
+    origin[2] = region->origin[2];
+    size[0] = region->size[0] * sizeof (gfloat);
+    size[1] = region->size[1];
+    size[2] = region->size[2];
+}
+
+static void
+copy_host_region (const gchar *src,
+                  UfoRequisition *requisition,
+                  UfoRegion *region,
+                  gchar *dst)
+{
+    gsize src_row_pitch;
+    gsize src_slice_pitch;
+    gsize dst_row_pitch;
+
+    get_pitches (requisition, &src_row_pitch, &src_slice_pitch);
+    dst_row_pitch = region->size[0] * sizeof (gfloat);
+    src += get_region_offset (requisition, region);
+
+    for (gsize z = 0; z < region->size[2]; z++) {
+        const gchar *row = src + z * src_slice_pitch;
+
+        for (gsize y = 0; y < region->size[1]; y++) {
+            memcpy (dst, row, dst_row_pitch);
+            dst += dst_row_pitch;
+            row += src_row_pitch;
+        }
+    }
+}
+
+static gboolean
+is_sub_buffer_aligned (cl_context context,
+                       gsize offset)
+{
+    cl_device_id *devices;
+    size_t size;
+    gboolean aligned = TRUE;
+
+    if (context == NULL)
+        return TRUE;
+
+    UFO_RESOURCES_CHECK_CLERR (clGetContextInfo (context, CL_CONTEXT_DEVICES, 0, NULL, &size));
+    devices = g_malloc0 (size);
+    UFO_RESOURCES_CHECK_CLERR (clGetContextInfo (context, CL_CONTEXT_DEVICES, size, devices, NULL));
+
+    for (guint i = 0; i < size / sizeof (cl_device_id); i++) {
+        cl_uint align;
+
+        /* Alignment is reported in bits */
+        UFO_RESOURCES_CHECK_CLERR (clGetDeviceInfo (devices[i], CL_DEVICE_MEM_BASE_ADDR_ALIGN,
+                                                    sizeof (cl_uint), &align, NULL));
+
+        if (offset % (align / 8) != 0)
+            aligned = FALSE;
+    }
+
+    g_free (devices);
+    return aligned;
+}
+
+/*
+ * Sub-buffers inherit the host pointer flags of their parent and must not
+ * specify them again, so only pass on the access flags.
+ */
+static cl_mem
+create_sub_buffer (cl_mem mem,
+                   gsize origin,
+                   gsize size)
+{
+    cl_buffer_region region;
+    cl_mem_flags mem_flags;
+    cl_mem sub_buffer;
+    cl_int errcode;
+
+    UFO_RESOURCES_CHECK_CLERR (clGetMemObjectInfo (mem, CL_MEM_FLAGS,
+                                                   sizeof (cl_mem_flags),
+                                                   &mem_flags, NULL));
+
+    mem_flags &= CL_MEM_READ_WRITE | CL_MEM_READ_ONLY | CL_MEM_WRITE_ONLY;
+    region.origin = origin;
+    region.size = size;
+
+    sub_buffer = clCreateSubBuffer (mem, mem_flags, CL_BUFFER_CREATE_TYPE_REGION,
+                                    &region, &errcode);
+
+    UFO_RESOURCES_CHECK_CLERR (errcode);
+    return sub_buffer;
+}
+
+static void
+convert_elements (gfloat *dst,
+                  gconstpointer data,
+                  gint n_pixels,
+                  UfoBufferDepth depth)
+{
+    /* To save a memory allocation and several copies, we process data from back
+     * to front. This is possible if src bit depth is at most half as wide as
+     * the 32-bit target buffer. The processor cache should not be a
+     * problem. */
+    if (depth == UFO_BUFFER_DEPTH_8U) {
+        const guint8 *src = (const guint8 *) data;
+
+        for (gint i = (n_pixels - 1); i >= 0; i--)
+            dst[i] = ((gfloat) src[i]);
+    }
+    else if (depth == UFO_BUFFER_DEPTH_16U) {
+        const guint16 *src = (const guint16 *) data;
+
+        for (gint i = (n_pixels - 1); i >= 0; i--)
+            dst[i] = ((gfloat) src[i]);
+    }
+    else if (depth == UFO_BUFFER_DEPTH_16S) {
+        const gint16 *src = (const gint16 *) data;
+
+        for (gint i = (n_pixels - 1); i >= 0; i--)
+            dst[i] = ((gfloat) src[i]);
+    }
+    else if (depth == UFO_BUFFER_DEPTH_32S) {
+        const gint32 *src = (const gint32 *) data;
+
+        for (gint i = (n_pixels - 1); i >= 0; i--)
+            dst[i] = ((gfloat) src[i]);
+    }
+    else if (depth == UFO_BUFFER_DEPTH_32U) {
+        const guint32 *src = (const guint32 *) data;
+
+        for (gint i = (n_pixels - 1); i >= 0; i--)
+            dst[i] = ((gfloat) src[i]);
+    }
+}
+
+static gsize
+get_depth_size (UfoBufferDepth depth)
+{
+    switch (depth) {
+        case UFO_BUFFER_DEPTH_8U:
+            return 1;
+        case UFO_BUFFER_DEPTH_16U:
+        case UFO_BUFFER_DEPTH_16S:
+            return 2;
+        default:
+            return 4;
+    }
+}
+
+static void
+advise_mapped (UfoBufferPrivate *priv,
+               gsize offset,
+               gsize length,
+               gint advice)
+{
+    gchar *start;
+    gchar *end;
+    gsize page_size;
+
+    /* posix_madvise() requires page-aligned addresses */
+    page_size = (gsize) sysconf (_SC_PAGESIZE);
+    start = priv->mapped_data + offset;
+    end = MIN (start + length, ((gchar *) priv->mapped) + priv->mapped_size);
+    start = ((gchar *) priv->mapped) + ((start - (gchar *) priv->mapped) / page_size) * page_size;
+
+    if (end > start)
+        posix_madvise (start, (gsize) (end - start), advice);
+}
+
+static gboolean
+is_mapped_on_host (UfoBufferPrivate *priv)
+{
+    return priv->mapped != NULL &&
+           (priv->host_array == NULL || (gchar *) priv->host_array == priv->mapped_data);
+}
+
+static void
+convert_mapped (UfoBufferPrivate *priv,
+                gfloat *dst)
+{
+    gsize bpp;
+    gsize n_elements;
+    gsize chunk;
+
+    bpp = get_depth_size (priv->mapped_depth);
+    n_elements = priv->size / sizeof (gfloat);
+    chunk = MAPPED_CHUNK_SIZE / sizeof (gfloat);
+
+    advise_mapped (priv, 0, chunk * bpp, POSIX_MADV_WILLNEED);
+
+    for (gsize i = 0; i < n_elements; i += chunk) {
+        gsize count = MIN (chunk, n_elements - i);
+
+        advise_mapped (priv, (i + count) * bpp, chunk * bpp, POSIX_MADV_WILLNEED);
+        convert_elements (dst + i, priv->mapped_data + i * bpp,
+                          (gint) count, priv->mapped_depth);
+    }
+}
+
+static void
+transfer_mapped_to_host (UfoBufferPrivate *priv)
+{
+    alloc_host_mem (priv);
+    convert_mapped (priv, priv->host_array);
+}
+
+static void
+transfer_mapped_to_device (UfoBufferPrivate *priv,
+                           cl_mem mem,
+                           cl_command_queue queue)
+{
+    gfloat *staging = NULL;
+    gsize bpp;
+    gsize n_elements;
+    gsize chunk;
+
+    bpp = get_depth_size (priv->mapped_depth);
+    n_elements = priv->size / sizeof (gfloat);
+    chunk = MAPPED_CHUNK_SIZE / sizeof (gfloat);
+
+    if (priv->mapped_depth != UFO_BUFFER_DEPTH_32F)
+        staging = g_malloc (chunk * sizeof (gfloat));
+
+    /*
+     * Stream the file in chunks so that we never fault in more than the chunk
+     * that is currently uploaded and the one that is prefetched.
+     */
+    advise_mapped (priv, 0, chunk * bpp, POSIX_MADV_WILLNEED);
+
+    for (gsize i = 0; i < n_elements; i += chunk) {
+        gsize count = MIN (chunk, n_elements - i);
+        gconstpointer src = priv->mapped_data + i * bpp;
+
+        advise_mapped (priv, (i + count) * bpp, chunk * bpp, POSIX_MADV_WILLNEED);
+
+        if (staging != NULL) {
+            convert_elements (staging, src, (gint) count, priv->mapped_depth);
+            src = staging;
+        }
+
+        UFO_RESOURCES_CHECK_CLERR (clEnqueueWriteBuffer (queue, mem, CL_TRUE,
+                                                         i * sizeof (gfloat), count * sizeof (gfloat),
+                                                         src, 0, NULL, NULL));
+    }
+
+    g_free (staging);
+}
+
+static void
+sync_mapped (UfoBufferPrivate *priv,
+             gint flags)
+{
+    if (priv->mapped_writable && (gchar *) priv->host_array == priv->mapped_data) {
+        if (msync (priv->mapped, priv->mapped_size, flags))
+            g_warning ("Could not sync mapped buffer: %s", g_strerror (errno));
+    }
+}
+
+static void
+unmap (UfoBufferPrivate *priv)
+{
+    if (priv->mapped == NULL)
+        return;
+
+    /* A pending upload may still read from the mapping */
+    wait_for_upload (priv);
+    sync_mapped (priv, MS_SYNC);
+
+    /* Host memory allocated from now on belongs to the buffer again */
+    if ((gchar *) priv->host_array == priv->mapped_data) {
+        priv->host_array = NULL;
+        priv->free = TRUE;
+    }
+
+    munmap (priv->mapped, priv->mapped_size);
+    priv->mapped = NULL;
+    priv->mapped_data = NULL;
+    priv->mapped_size = 0;
+    priv->mapped_writable = FALSE;
+}
+
 /**
  * ufo_buffer_new:
  * @requisition: (in): size requisition
@@ -325,6 +764,274 @@ ufo_buffer_new_with_data (UfoRequisition *requisition,
     return buffer;
 }
 
+/**
+ * ufo_buffer_new_mapped:
+ * @path: Path to a file
+ * @requisition: size requisition
+ * @depth: Bit depth of the data stored in @path
+ * @offset: Offset in bytes from the beginning of @path
+ * @context: (allow-none): cl_context to use for creating the device array
+ * @error: Location for a #GError or %NULL
+ *
+ * Create a new buffer that is backed by a memory mapping of @path instead of
+ * allocated host memory. Data is read on demand and uploaded to the device in
+ * chunks, so files larger than main memory can be processed. If @depth is
+ * #UFO_BUFFER_DEPTH_32F, the mapping is used directly as the host array and
+ * changes are written back to @path with msync(). Other depths are converted
+ * on access and changes are never written back.
+ *
+ * Returns: (transfer full): A new #UfoBuffer or %NULL in case of error.
+ *
+ * Since: 0.8
+ */
+UfoBuffer *
+ufo_buffer_new_mapped (const gchar *path,
+                       UfoRequisition *requisition,
+                       UfoBufferDepth depth,
+                       gsize offset,
+                       gpointer context,
+                       GError **error)
+{
+    UfoBuffer *buffer;
+    UfoBufferPrivate *priv;
+    struct stat st;
+    gpointer mapped;
+    gsize data_size;
+    gsize page_size;
+    gsize map_offset;
+    gboolean writable;
+    gint fd;
+
+    g_return_val_if_fail (path != NULL && requisition != NULL, NULL);
+    g_return_val_if_fail ((requisition->n_dims <= UFO_BUFFER_MAX_NDIMS) &&
+                          (requisition->n_dims > 0), NULL);
+
+    data_size = compute_required_size (requisition) / sizeof (gfloat) * get_depth_size (depth);
+    writable = depth == UFO_BUFFER_DEPTH_32F;
+    fd = open (path, writable ? O_RDWR : O_RDONLY);
+
+    if (fd < 0 && writable && errno == EACCES) {
+        writable = FALSE;
+        fd = open (path, O_RDONLY);
+    }
+
+    if (fd < 0) {
+        g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (errno),
+                     "Could not open `%s': %s", path, g_strerror (errno));
+        return NULL;
+    }
+
+    if (fstat (fd, &st) || (gsize) st.st_size < offset + data_size) {
+        g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+                     "`%s' is too small to hold the requested data", path);
+        close (fd);
+        return NULL;
+    }
+
+    /* mmap() offsets must be page-aligned */
+    page_size = (gsize) sysconf (_SC_PAGESIZE);
+    map_offset = offset - offset % page_size;
+
+    /* Private mappings of read-only files are copy-on-write */
+    mapped = mmap (NULL, data_size + offset - map_offset,
+                   PROT_READ | PROT_WRITE, writable ? MAP_SHARED : MAP_PRIVATE,
+                   fd, (off_t) map_offset);
+    close (fd);
+
+    if (mapped == MAP_FAILED) {
+        g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (errno),
+                     "Could not map `%s': %s", path, g_strerror (errno));
+        return NULL;
+    }
+
+    buffer = ufo_buffer_new (requisition, context);
+    priv = buffer->priv;
+
+    priv->mapped = mapped;
+    priv->mapped_size = data_size + offset - map_offset;
+    priv->mapped_data = ((gchar *) mapped) + offset - map_offset;
+    priv->mapped_depth = depth;
+    priv->mapped_writable = writable;
+
+    posix_madvise (priv->mapped, priv->mapped_size, POSIX_MADV_SEQUENTIAL);
+
+    if (depth == UFO_BUFFER_DEPTH_32F) {
+        priv->host_array = (gfloat *) priv->mapped_data;
+        priv->free = FALSE;
+    }
+
+    priv->location = UFO_BUFFER_LOCATION_HOST;
+    return buffer;
+}
+
+/**
+ * ufo_buffer_new_view:
+ * @parent: A #UfoBuffer
+ * @region: A #UfoRegion within @parent
+ *
+ * Create a new buffer that references @region of @parent without copying it.
+ * If @region is laid out contiguously in memory (i.e. it spans whole rows or
+ * slices), the view aliases the host memory of @parent and is backed by a
+ * sub-buffer of the parent device array, so that writes to the view are
+ * visible in @parent and vice versa. Otherwise, the data is copied with
+ * rectangular copies on first access and changes are not propagated back to
+ * @parent.
+ *
+ * Devices only allow sub-buffers at offsets that are a multiple of their base
+ * address alignment. At other offsets, a contiguous view still aliases the
+ * host memory but uses a device array of its own on the device. Copies into
+ * the view are written through to @parent, other device data of the view is
+ * written back when the view is accessed on the host or released.
+ *
+ * The view keeps a reference on @parent, which must not be resized while the
+ * view is alive.
+ *
+ * Returns: (transfer full): A new #UfoBuffer with the size of @region or %NULL
+ * if @region exceeds @parent.
+ *
+ * Since: 0.8
+ */
+UfoBuffer *
+ufo_buffer_new_view (UfoBuffer *parent,
+                     UfoRegion *region)
+{
+    UfoBuffer *buffer;
+    UfoBufferPrivate *priv;
+    UfoBufferPrivate *ppriv;
+    UfoRequisition requisition;
+    UfoRegion normalized;
+
+    g_return_val_if_fail (UFO_IS_BUFFER (parent) && (region != NULL), NULL);
+
+    ppriv = parent->priv;
+    normalize_region (&ppriv->requisition, region, &normalized);
+
+    if (!region_fits (&ppriv->requisition, &normalized)) {
+        g_warning ("Requested view exceeds buffer size");
+        return NULL;
+    }
+
+    requisition.n_dims = ppriv->requisition.n_dims;
+
+    for (guint i = 0; i < requisition.n_dims; i++)
+        requisition.dims[i] = normalized.size[i];
+
+    buffer = ufo_buffer_new (&requisition, ppriv->context);
+    priv = buffer->priv;
+
+    priv->parent = g_object_ref (parent);
+    priv->view = normalized;
+    priv->view_offset = get_region_offset (&ppriv->requisition, &normalized);
+    priv->view_alias = region_is_contiguous (&ppriv->requisition, &normalized);
+    priv->view_staged = priv->view_alias &&
+                        !is_sub_buffer_aligned (ppriv->context, priv->view_offset);
+
+    if (priv->view_alias)
+        priv->free = FALSE;
+
+    return buffer;
+}
+
+/**
+ * ufo_buffer_new_slice:
+ * @buffer: A #UfoBuffer with at least two dimensions
+ * @index: Index along the outermost dimension of @buffer
+ *
+ * Create a view on the @index-th element along the outermost dimension of
+ * @buffer, e.g. a single frame of a stack or an item of a batch. Unlike a view
+ * created with ufo_buffer_new_view(), the slice has one dimension less than
+ * @buffer. Slices are contiguous and thus share memory with @buffer as long as
+ * the OpenCL device permits a sub-buffer at that offset.
+ *
+ * Returns: (transfer full): A new #UfoBuffer or %NULL if @index is out of
+ * range.
+ *
+ * Since: 0.8
+ */
+UfoBuffer *
+ufo_buffer_new_slice (UfoBuffer *buffer,
+                      guint index)
+{
+    UfoBuffer *slice;
+    UfoRequisition *requisition;
+    UfoRegion region;
+    guint outer;
+
+    g_return_val_if_fail (UFO_IS_BUFFER (buffer), NULL);
+
+    requisition = &buffer->priv->requisition;
+    g_return_val_if_fail (requisition->n_dims > 1, NULL);
+
+    outer = requisition->n_dims - 1;
+
+    if (index >= requisition->dims[outer]) {
+        g_warning ("Slice %u exceeds outermost dimension of size %zu",
+                   index, requisition->dims[outer]);
+        return NULL;
+    }
+
+    for (guint i = 0; i < outer; i++) {
+        region.origin[i] = 0;
+        region.size[i] = requisition->dims[i];
+    }
+
+    region.origin[outer] = index;
+    region.size[outer] = 1;
+
+    slice = ufo_buffer_new_view (buffer, &region);
+
+    if (slice == NULL)
+        return NULL;
+
+    /* the trailing dimension of size one does not change the layout */
+    slice->priv->requisition.n_dims = outer;
+
+    /* an item of a batch keeps the metadata it had before it was stacked */
+    if (buffer->priv->item_metadata != NULL && index < buffer->priv->item_metadata->len)
+        slice->priv->metadata = metadata_table_ref (g_ptr_array_index (buffer->priv->item_metadata, index));
+
+    return slice;
+}
+
+/**
+ * ufo_buffer_set_batch_size:
+ * @buffer: A #UfoBuffer
+ * @batch_size: Number of stacked items or 0
+ *
+ * Mark @buffer as a batch of @batch_size items of identical size that are
+ * stacked along its outermost dimension. A @batch_size of 0 marks an ordinary
+ * buffer. Individual items can be accessed with ufo_buffer_new_slice(), which
+ * also hands out the metadata of each item. Changing the batch size drops the
+ * metadata of all items.
+ *
+ * Since: 0.8
+ */
+void
+ufo_buffer_set_batch_size (UfoBuffer *buffer,
+                           guint batch_size)
+{
+    g_return_if_fail (UFO_IS_BUFFER (buffer));
+    clear_item_metadata (buffer->priv);
+    buffer->priv->batch_size = batch_size;
+}
+
+/**
+ * ufo_buffer_get_batch_size:
+ * @buffer: A #UfoBuffer
+ *
+ * Get the number of items stacked in @buffer.
+ *
+ * Returns: The number of items or 0 if @buffer is not a batch.
+ *
+ * Since: 0.8
+ */
+guint
+ufo_buffer_get_batch_size (UfoBuffer *buffer)
+{
+    g_return_val_if_fail (UFO_IS_BUFFER (buffer), 0);
+    return buffer->priv->batch_size;
+}
+
 /**
  * ufo_buffer_get_size:
  * @buffer: A #UfoBuffer
@@ -518,32 +1225,485 @@ transfer_image_to_host (UfoBufferPrivate *src_priv,
                                   dst_priv->host_array,
                                   0, NULL, NULL);
 
-    UFO_RESOURCES_CHECK_CLERR (errcode);
+    UFO_RESOURCES_CHECK_CLERR (errcode);
+}
+
+static void
+transfer_image_to_device (UfoBufferPrivate *src_priv,
+                          UfoBufferPrivate *dst_priv,
+                          cl_command_queue queue)
+{
+    cl_event event;
+    cl_int errcode;
+    size_t region[3];
+    size_t origin[] = { 0, 0, 0 };
+
+    set_region_from_requisition (region, &src_priv->requisition);
+
+    errcode = clEnqueueCopyImageToBuffer (queue,
+                                          src_priv->device_image,
+                                          dst_priv->device_array,
+                                          origin, region, 0,
+                                          0, NULL, &event);
+
+    UFO_RESOURCES_CHECK_CLERR (errcode);
+    UFO_RESOURCES_CHECK_CLERR (clWaitForEvents (1, &event));
+    UFO_RESOURCES_CHECK_CLERR (clReleaseEvent (event));
+}
+
+
+static void
+update_last_queue (UfoBufferPrivate *priv,
+                   cl_command_queue queue)
+{
+    if (queue != NULL)
+        priv->last_queue = queue;
+}
+
+static void
+update_location (UfoBufferPrivate *priv,
+                 UfoBufferLocation new_location)
+{
+    priv->last_location = priv->location;
+    priv->location = new_location;
+}
+
+static cl_device_id
+get_queue_device (cl_command_queue queue)
+{
+    cl_device_id device = NULL;
+
+    if (queue != NULL)
+        UFO_RESOURCES_CHECK_CLERR (clGetCommandQueueInfo (queue, CL_QUEUE_DEVICE,
+                                                          sizeof (cl_device_id), &device, NULL));
+
+    return device;
+}
+
+static void
+update_device (UfoBufferPrivate *priv,
+               cl_command_queue queue)
+{
+    if (queue == NULL || queue == priv->device_queue)
+        return;
+
+    priv->device_queue = queue;
+    priv->device = get_queue_device (queue);
+}
+
+static cl_command_queue
+get_device_queue (UfoBufferPrivate *priv)
+{
+    return priv->device_queue != NULL ? priv->device_queue : priv->last_queue;
+}
+
+/*
+ * Make @queue wait for @event without blocking the host. Queues are in-order,
+ * so everything enqueued on @queue afterwards, kernels as well as transfers,
+ * sees the data.
+ */
+static void
+enqueue_wait (cl_command_queue queue,
+              cl_event event)
+{
+#ifdef CL_VERSION_1_2
+    UFO_RESOURCES_CHECK_CLERR (clEnqueueBarrierWithWaitList (queue, 1, &event, NULL));
+#else
+    UFO_RESOURCES_CHECK_CLERR (clEnqueueWaitForEvents (queue, 1, &event));
+#endif
+}
+
+static void
+migrate_to_queue (UfoBufferPrivate *priv,
+                  cl_mem mem,
+                  cl_command_queue queue)
+{
+    cl_device_id device;
+    cl_event marker;
+
+    if (mem == NULL || queue == NULL || priv->device_queue == NULL || queue == priv->device_queue)
+        return;
+
+    /*
+     * Commands on different queues are not ordered, so anything that is still
+     * enqueued on the producing queue must complete before @queue can use the
+     * data.
+     */
+#ifdef CL_VERSION_1_2
+    UFO_RESOURCES_CHECK_CLERR (clEnqueueMarkerWithWaitList (priv->device_queue, 0, NULL, &marker));
+#else
+    UFO_RESOURCES_CHECK_CLERR (clEnqueueMarker (priv->device_queue, &marker));
+#endif
+
+    device = get_queue_device (queue);
+
+#ifdef CL_VERSION_1_2
+    if (device != priv->device) {
+        cl_int errcode;
+
+        /* The migration itself is ordered before later commands on @queue */
+        errcode = clEnqueueMigrateMemObjects (queue, 1, &mem, 0, 1, &marker, NULL);
+
+        if (errcode == CL_SUCCESS) {
+            UFO_RESOURCES_CHECK_CLERR (clReleaseEvent (marker));
+            priv->device_queue = queue;
+            priv->device = device;
+            return;
+        }
+
+        g_debug ("Cannot migrate explicitly, falling back to implicit migration");
+    }
+#endif
+
+    /* Events of the same context can be waited for on any device */
+    enqueue_wait (queue, marker);
+    UFO_RESOURCES_CHECK_CLERR (clReleaseEvent (marker));
+    priv->device_queue = queue;
+    priv->device = device;
+}
+
+/*
+ * Return the dedicated copy queue for @queue if there is one. If @pending has
+ * commands that the copy must wait for, a marker is returned in @marker.
+ */
+static cl_command_queue
+get_copy_queue (cl_command_queue queue,
+                cl_command_queue pending,
+                gboolean upload,
+                cl_event *marker)
+{
+    cl_command_queue copy_queue;
+
+    *marker = NULL;
+
+    if (queue == NULL)
+        return queue;
+
+    copy_queue = upload ? ufo_gpu_node_lookup_upload_queue (queue) :
+                          ufo_gpu_node_lookup_download_queue (queue);
+
+    if (copy_queue == NULL)
+        return queue;
+
+    if (pending != NULL) {
+#ifdef CL_VERSION_1_2
+        UFO_RESOURCES_CHECK_CLERR (clEnqueueMarkerWithWaitList (pending, 0, NULL, marker));
+#else
+        UFO_RESOURCES_CHECK_CLERR (clEnqueueMarker (pending, marker));
+#endif
+    }
+
+    return copy_queue;
+}
+
+/*
+ * Upload without blocking, so that the host can prepare the next item while
+ * the copy engine transfers this one. Commands enqueued on @queue afterwards
+ * wait for the upload.
+ */
+static void
+upload_host_array (UfoBufferPrivate *priv,
+                   cl_command_queue queue)
+{
+    cl_command_queue copy_queue;
+    cl_event marker;
+
+    wait_for_upload (priv);
+    copy_queue = get_copy_queue (queue, priv->device_queue, TRUE, &marker);
+
+    UFO_RESOURCES_CHECK_CLERR (clEnqueueWriteBuffer (copy_queue, priv->device_array, CL_FALSE,
+                                                     0, priv->size, priv->host_array,
+                                                     marker != NULL ? 1 : 0,
+                                                     marker != NULL ? &marker : NULL,
+                                                     &priv->upload_event));
+
+    if (copy_queue != queue)
+        enqueue_wait (queue, priv->upload_event);
+
+    if (marker != NULL)
+        UFO_RESOURCES_CHECK_CLERR (clReleaseEvent (marker));
+}
+
+static void
+download_device_array (UfoBufferPrivate *priv,
+                       cl_command_queue queue)
+{
+    cl_command_queue copy_queue;
+    cl_event marker;
+
+    copy_queue = get_copy_queue (queue, queue, FALSE, &marker);
+
+    UFO_RESOURCES_CHECK_CLERR (clEnqueueReadBuffer (copy_queue, priv->device_array, CL_TRUE,
+                                                    0, priv->size, priv->host_array,
+                                                    marker != NULL ? 1 : 0,
+                                                    marker != NULL ? &marker : NULL,
+                                                    NULL));
+
+    if (marker != NULL)
+        UFO_RESOURCES_CHECK_CLERR (clReleaseEvent (marker));
+}
+
+/*
+ * Fill the device array of a view that cannot be a sub-buffer from @parent_array.
+ */
+static void
+stage_view (UfoBufferPrivate *priv,
+            cl_mem parent_array)
+{
+    cl_event event;
+
+    if (priv->device_array == NULL)
+        alloc_device_array (priv);
+
+    UFO_RESOURCES_CHECK_CLERR (clEnqueueCopyBuffer (priv->last_queue,
+                                                    parent_array, priv->device_array,
+                                                    priv->view_offset, 0, priv->size,
+                                                    0, NULL, &event));
+    UFO_RESOURCES_CHECK_CLERR (clWaitForEvents (1, &event));
+    UFO_RESOURCES_CHECK_CLERR (clReleaseEvent (event));
+}
+
+/*
+ * Write the device array of a staged view back to wherever the parent data
+ * currently is.
+ */
+static void
+write_back_view (UfoBufferPrivate *priv)
+{
+    UfoBufferPrivate *ppriv;
+
+    if (!priv->view_dirty)
+        return;
+
+    ppriv = priv->parent->priv;
+    priv->view_dirty = FALSE;
+
+    if (ppriv->location == UFO_BUFFER_LOCATION_DEVICE && ppriv->device_array != NULL) {
+        cl_event event;
+
+        UFO_RESOURCES_CHECK_CLERR (clEnqueueCopyBuffer (priv->last_queue,
+                                                        priv->device_array, ppriv->device_array,
+                                                        0, priv->view_offset, priv->size,
+                                                        0, NULL, &event));
+        UFO_RESOURCES_CHECK_CLERR (clWaitForEvents (1, &event));
+        UFO_RESOURCES_CHECK_CLERR (clReleaseEvent (event));
+    }
+    else {
+        gchar *data;
+
+        data = (gchar *) ufo_buffer_get_host_array (priv->parent, priv->last_queue);
+        UFO_RESOURCES_CHECK_CLERR (clEnqueueReadBuffer (priv->last_queue,
+                                                        priv->device_array, CL_TRUE,
+                                                        0, priv->size,
+                                                        data + priv->view_offset,
+                                                        0, NULL, NULL));
+    }
+}
+
+static void
+sync_view_host (UfoBufferPrivate *priv)
+{
+    UfoBufferPrivate *ppriv;
+
+    ppriv = priv->parent->priv;
+
+    if (priv->last_queue == NULL)
+        priv->last_queue = ppriv->last_queue;
+
+    if (priv->view_alias) {
+        gchar *data;
+
+        write_back_view (priv);
+        data = (gchar *) ufo_buffer_get_host_array (priv->parent, priv->last_queue);
+        priv->host_array = (gfloat *) (data + priv->view_offset);
+        update_location (priv, UFO_BUFFER_LOCATION_HOST);
+        return;
+    }
+
+    if (priv->view_valid)
+        return;
+
+    if (priv->host_array == NULL)
+        alloc_host_mem (priv);
+
+    if (ppriv->location == UFO_BUFFER_LOCATION_DEVICE_IMAGE)
+        ufo_buffer_get_device_array (priv->parent, priv->last_queue);
+
+    if (ppriv->location == UFO_BUFFER_LOCATION_DEVICE && ppriv->device_array) {
+        gsize src_row_pitch;
+        gsize src_slice_pitch;
+        size_t src_origin[3];
+        size_t size[3];
+        size_t dst_origin[] = { 0, 0, 0 };
+
+        get_pitches (&ppriv->requisition, &src_row_pitch, &src_slice_pitch);
+        get_rect_region (&priv->view, src_origin, size);
+
+        UFO_RESOURCES_CHECK_CLERR (clEnqueueReadBufferRect (priv->last_queue,
+                                                            ppriv->device_array,
+                                                            CL_TRUE,
+                                                            src_origin, dst_origin, size,
+                                                            src_row_pitch, src_slice_pitch,
+                                                            size[0], size[0] * size[1],
+                                                            priv->host_array,
+                                                            0, NULL, NULL));
+    }
+    else if (ppriv->location == UFO_BUFFER_LOCATION_HOST && ppriv->host_array) {
+        copy_host_region ((const gchar *) ppriv->host_array, &ppriv->requisition,
+                          &priv->view, (gchar *) priv->host_array);
+    }
+
+    priv->view_valid = TRUE;
+    update_location (priv, UFO_BUFFER_LOCATION_HOST);
+}
+
+static void
+sync_view_device (UfoBufferPrivate *priv)
+{
+    UfoBufferPrivate *ppriv;
+    gsize src_row_pitch;
+    gsize src_slice_pitch;
+    size_t src_origin[3];
+    size_t size[3];
+    size_t dst_origin[] = { 0, 0, 0 };
+
+    ppriv = priv->parent->priv;
+
+    if (priv->last_queue == NULL)
+        priv->last_queue = ppriv->last_queue;
+
+    if (priv->view_alias) {
+        cl_mem parent_array;
+
+        /* data that was not written back yet is newer than the parent */
+        if (priv->view_dirty) {
+            update_location (priv, UFO_BUFFER_LOCATION_DEVICE);
+            return;
+        }
+
+        parent_array = ufo_buffer_get_device_array (priv->parent, priv->last_queue);
+
+        if (priv->view_staged) {
+            /* callers may write to the device array, so assume they do */
+            stage_view (priv, parent_array);
+            priv->view_dirty = TRUE;
+        }
+        else if (priv->device_array == NULL)
+            priv->device_array = create_sub_buffer (parent_array, priv->view_offset, priv->size);
+
+        update_location (priv, UFO_BUFFER_LOCATION_DEVICE);
+        return;
+    }
+
+    if (priv->view_valid)
+        return;
+
+    if (priv->device_array == NULL)
+        alloc_device_array (priv);
+
+    if (ppriv->location == UFO_BUFFER_LOCATION_DEVICE_IMAGE)
+        ufo_buffer_get_device_array (priv->parent, priv->last_queue);
+
+    get_pitches (&ppriv->requisition, &src_row_pitch, &src_slice_pitch);
+    get_rect_region (&priv->view, src_origin, size);
+
+    if (ppriv->location == UFO_BUFFER_LOCATION_DEVICE && ppriv->device_array) {
+        cl_event event;
+
+        UFO_RESOURCES_CHECK_CLERR (clEnqueueCopyBufferRect (priv->last_queue,
+                                                            ppriv->device_array,
+                                                            priv->device_array,
+                                                            src_origin, dst_origin, size,
+                                                            src_row_pitch, src_slice_pitch,
+                                                            size[0], size[0] * size[1],
+                                                            0, NULL, &event));
+        UFO_RESOURCES_CHECK_CLERR (clWaitForEvents (1, &event));
+        UFO_RESOURCES_CHECK_CLERR (clReleaseEvent (event));
+    }
+    else if (ppriv->location == UFO_BUFFER_LOCATION_HOST && ppriv->host_array) {
+        UFO_RESOURCES_CHECK_CLERR (clEnqueueWriteBufferRect (priv->last_queue,
+                                                             priv->device_array,
+                                                             CL_TRUE,
+                                                             dst_origin, src_origin, size,
+                                                             size[0], size[0] * size[1],
+                                                             src_row_pitch, src_slice_pitch,
+                                                             ppriv->host_array,
+                                                             0, NULL, NULL));
+    }
+
+    priv->view_valid = TRUE;
+    update_location (priv, UFO_BUFFER_LOCATION_DEVICE);
+}
+
+/*
+ * Make an aliasing view use the storage of its parent as destination, so that
+ * a copy into the view ends up in the parent no matter where the parent data
+ * currently lives.
+ */
+static void
+sync_view_for_write (UfoBufferPrivate *priv)
+{
+    UfoBufferPrivate *ppriv;
+
+    ppriv = priv->parent->priv;
+
+    if (priv->last_queue == NULL)
+        priv->last_queue = ppriv->last_queue;
+
+    /* Images cannot be aliased, move the parent data to its device array */
+    if (ppriv->location == UFO_BUFFER_LOCATION_DEVICE_IMAGE)
+        ufo_buffer_get_device_array (priv->parent, priv->last_queue);
+
+    if (ppriv->location == UFO_BUFFER_LOCATION_DEVICE)
+        sync_view_device (priv);
+    else
+        sync_view_host (priv);
 }
 
 static void
-transfer_image_to_device (UfoBufferPrivate *src_priv,
-                          UfoBufferPrivate *dst_priv,
-                          cl_command_queue queue)
+sync_view (UfoBufferPrivate *priv)
 {
-    cl_event event;
-    cl_int errcode;
-    size_t region[3];
-    size_t origin[] = { 0, 0, 0 };
+    UfoBufferLocation location;
 
-    set_region_from_requisition (region, &src_priv->requisition);
+    if (priv->parent == NULL || (priv->view_valid && !priv->view_alias))
+        return;
 
-    errcode = clEnqueueCopyImageToBuffer (queue,
-                                          src_priv->device_image,
-                                          dst_priv->device_array,
-                                          origin, region, 0,
-                                          0, NULL, &event);
+    location = priv->parent->priv->location;
 
-    UFO_RESOURCES_CHECK_CLERR (errcode);
-    UFO_RESOURCES_CHECK_CLERR (clWaitForEvents (1, &event));
-    UFO_RESOURCES_CHECK_CLERR (clReleaseEvent (event));
+    if (location == UFO_BUFFER_LOCATION_DEVICE || location == UFO_BUFFER_LOCATION_DEVICE_IMAGE)
+        sync_view_device (priv);
+    else
+        sync_view_host (priv);
 }
 
+/*
+ * Copy a file-backed buffer whose data has not been converted to floats yet
+ * without building the float array of @src.
+ */
+static gboolean
+copy_mapped (UfoBufferPrivate *src,
+             UfoBufferPrivate *dst,
+             cl_command_queue queue)
+{
+    if (dst->location == UFO_BUFFER_LOCATION_DEVICE && dst->device_array != NULL && queue != NULL) {
+        transfer_mapped_to_device (src, dst->device_array, queue);
+        dst->last_queue = queue;
+        update_device (dst, queue);
+        return TRUE;
+    }
+
+    if (dst->location == UFO_BUFFER_LOCATION_INVALID || dst->location == UFO_BUFFER_LOCATION_HOST) {
+        if (dst->host_array == NULL)
+            alloc_host_mem (dst);
+
+        convert_mapped (src, dst->host_array);
+        update_location (dst, UFO_BUFFER_LOCATION_HOST);
+        sync_mapped (dst, MS_ASYNC);
+        return TRUE;
+    }
+
+    return FALSE;
+}
 
 /**
  * ufo_buffer_copy:
@@ -580,6 +1740,25 @@ ufo_buffer_copy (UfoBuffer *src, UfoBuffer *dst)
     dpriv = dst->priv;
     queue = spriv->last_queue != NULL ? spriv->last_queue : dpriv->last_queue;
 
+    /* dst may still be read by an upload on another queue */
+    wait_for_upload (dpriv);
+
+    /* Read device data on the device that holds it */
+    if (spriv->location != UFO_BUFFER_LOCATION_HOST && spriv->device_queue != NULL)
+        queue = spriv->device_queue;
+
+    sync_view (spriv);
+
+    if (dpriv->view_alias)
+        sync_view_for_write (dpriv);
+
+    /* Convert file data straight into the destination */
+    if (spriv->mapped != NULL && spriv->host_array == NULL && copy_mapped (spriv, dpriv, queue))
+        return;
+
+    if (spriv->mapped != NULL && spriv->host_array == NULL)
+        transfer_mapped_to_host (spriv);
+
     if (spriv->location == UFO_BUFFER_LOCATION_INVALID) {
         alloc_host_mem (spriv);
         spriv->location = UFO_BUFFER_LOCATION_HOST;
@@ -593,6 +1772,20 @@ ufo_buffer_copy (UfoBuffer *src, UfoBuffer *dst)
 
     transfer[spriv->location][dpriv->location](spriv, dpriv, queue);
     dpriv->last_queue = queue;
+
+    if (dpriv->location != UFO_BUFFER_LOCATION_HOST)
+        update_device (dpriv, queue);
+
+    /* The parent has to wait for the copy before it uses the data elsewhere */
+    if (dpriv->view_alias && dpriv->location == UFO_BUFFER_LOCATION_DEVICE)
+        update_device (dpriv->parent->priv, queue);
+
+    /* A staged view writes through, so that the parent sees the copy at once */
+    if (dpriv->view_staged)
+        write_back_view (dpriv);
+
+    if (dpriv->location == UFO_BUFFER_LOCATION_HOST)
+        sync_mapped (dpriv, MS_ASYNC);
 }
 
 /**
@@ -638,6 +1831,14 @@ ufo_buffer_resize (UfoBuffer *buffer,
 
     priv = UFO_BUFFER_GET_PRIVATE (buffer);
 
+    if (priv->parent != NULL) {
+        g_warning ("Cannot resize a buffer view");
+        return;
+    }
+
+    wait_for_upload (priv);
+    unmap (priv);
+
     if (priv->host_array != NULL && priv->free) {
         g_free (priv->host_array);
         priv->host_array = NULL;
@@ -706,22 +1907,6 @@ ufo_buffer_get_requisition (UfoBuffer *buffer,
     copy_requisition (&priv->requisition, requisition);
 }
 
-static void
-update_last_queue (UfoBufferPrivate *priv,
-                   cl_command_queue queue)
-{
-    if (queue != NULL)
-        priv->last_queue = queue;
-}
-
-static void
-update_location (UfoBufferPrivate *priv,
-                 UfoBufferLocation new_location)
-{
-    priv->last_location = priv->location;
-    priv->location = new_location;
-}
-
 /**
  * ufo_buffer_set_host_array:
  * @buffer: A #UfoBuffer
@@ -740,6 +1925,7 @@ ufo_buffer_set_host_array (UfoBuffer *buffer, gfloat *array, gboolean free_data)
     g_return_if_fail (UFO_IS_BUFFER (buffer));
 
     priv = buffer->priv;
+    wait_for_upload (priv);
 
     if (priv->free)
         g_free (priv->host_array);
@@ -768,15 +1954,31 @@ ufo_buffer_get_host_array (UfoBuffer *buffer, gpointer cmd_queue)
     priv = buffer->priv;
 
     update_last_queue (priv, cmd_queue);
+    wait_for_upload (priv);
 
-    if (priv->host_array == NULL)
-        alloc_host_mem (priv);
+    if (priv->parent != NULL) {
+        sync_view_host (priv);
+
+        if (priv->view_alias)
+            return priv->host_array;
+    }
+
+    if (priv->host_array == NULL) {
+        if (priv->mapped != NULL && priv->location == UFO_BUFFER_LOCATION_HOST)
+            transfer_mapped_to_host (priv);
+        else
+            alloc_host_mem (priv);
+    }
 
-    if (priv->location == UFO_BUFFER_LOCATION_DEVICE && priv->device_array)
-        transfer_device_to_host (priv, priv, priv->last_queue);
+    if (priv->location == UFO_BUFFER_LOCATION_DEVICE && priv->device_array) {
+        download_device_array (priv, get_device_queue (priv));
+        sync_mapped (priv, MS_ASYNC);
+    }
 
-    if (priv->location == UFO_BUFFER_LOCATION_DEVICE_IMAGE && priv->device_image)
-        transfer_image_to_host (priv, priv, priv->last_queue);
+    if (priv->location == UFO_BUFFER_LOCATION_DEVICE_IMAGE && priv->device_image) {
+        transfer_image_to_host (priv, priv, get_device_queue (priv));
+        sync_mapped (priv, MS_ASYNC);
+    }
 
     update_location (priv, UFO_BUFFER_LOCATION_HOST);
 
@@ -804,16 +2006,31 @@ ufo_buffer_get_device_array (UfoBuffer *buffer, gpointer cmd_queue)
 
     update_last_queue (priv, cmd_queue);
 
+    if (priv->parent != NULL) {
+        sync_view_device (priv);
+
+        if (priv->view_alias)
+            return priv->device_array;
+    }
+
     if (priv->device_array == NULL)
         alloc_device_array (priv);
 
-    if (priv->location == UFO_BUFFER_LOCATION_HOST && priv->host_array)
-        transfer_host_to_device (priv, priv, priv->last_queue);
+    if (priv->location == UFO_BUFFER_LOCATION_DEVICE)
+        migrate_to_queue (priv, priv->device_array, priv->last_queue);
 
-    if (priv->location == UFO_BUFFER_LOCATION_DEVICE_IMAGE && priv->device_array)
+    if (priv->location == UFO_BUFFER_LOCATION_HOST && is_mapped_on_host (priv))
+        transfer_mapped_to_device (priv, priv->device_array, priv->last_queue);
+    else if (priv->location == UFO_BUFFER_LOCATION_HOST && priv->host_array)
+        upload_host_array (priv, priv->last_queue);
+
+    if (priv->location == UFO_BUFFER_LOCATION_DEVICE_IMAGE && priv->device_array) {
+        migrate_to_queue (priv, priv->device_image, priv->last_queue);
         transfer_image_to_device (priv, priv, priv->last_queue);
+    }
 
     update_location (priv, UFO_BUFFER_LOCATION_DEVICE);
+    update_device (priv, priv->last_queue);
 
     return priv->device_array;
 }
@@ -837,9 +2054,6 @@ ufo_buffer_get_device_array_with_offset (UfoBuffer *buffer,
     UfoBufferPrivate *priv;
     cl_mem device_array;
     cl_mem sub_buffer;
-    cl_mem_flags mem_flags;
-    cl_buffer_region region;
-    cl_int errcode;
     size_t size;
 
     g_return_val_if_fail (UFO_IS_BUFFER (buffer), NULL);
@@ -847,21 +2061,11 @@ ufo_buffer_get_device_array_with_offset (UfoBuffer *buffer,
 
     device_array = ufo_buffer_get_device_array (buffer, cmd_queue);
 
-    UFO_RESOURCES_CHECK_CLERR (clGetMemObjectInfo (device_array, CL_MEM_FLAGS,
-                                                   sizeof (cl_mem_flags),
-                                                   &mem_flags, NULL));
-
     UFO_RESOURCES_CHECK_CLERR (clGetMemObjectInfo (device_array, CL_MEM_SIZE,
                                                    sizeof (size_t),
                                                    &size, NULL));
 
-    region.origin = offset;
-    region.size = size - offset;
-
-    sub_buffer = clCreateSubBuffer (device_array, mem_flags, CL_BUFFER_CREATE_TYPE_REGION,
-                                    &region, &errcode);
-
-    UFO_RESOURCES_CHECK_CLERR (errcode);
+    sub_buffer = create_sub_buffer (device_array, offset, size - offset);
     priv->sub_device_arrays = g_list_append (priv->sub_device_arrays, sub_buffer);
     return sub_buffer;
 }
@@ -873,7 +2077,8 @@ ufo_buffer_get_device_array_with_offset (UfoBuffer *buffer,
  * @region: A #UfoRegion specifying the view of the sub buffer
  *
  * This method creates a new memory buffer that must be freed by the user.
- * Moreover, the original @buffer is kept intact.
+ * Moreover, the original @buffer is kept intact. Use ufo_buffer_new_view() to
+ * reference a region without copying it.
  *
  * Returns: (transfer full): A newly allocated cl_mem that the user must release
  * himself with clReleaseMemObject().
@@ -884,89 +2089,58 @@ ufo_buffer_get_device_array_view (UfoBuffer *buffer,
                                   UfoRegion *region)
 {
     UfoBufferPrivate *priv;
+    UfoRegion normalized;
     gsize size;
     gsize src_row_pitch;
     gsize src_slice_pitch;
     gsize dst_row_pitch;
     gsize dst_slice_pitch;
+    size_t src_origin[3];
+    size_t rect[3];
+    size_t dst_origin[] = { 0, 0, 0 };
     cl_mem mem;
     cl_int errcode;
-    gsize dst_origin[] = {0, 0, 0};
 
     g_return_val_if_fail (UFO_IS_BUFFER (buffer), NULL);
     priv = buffer->priv;
 
-    if (region->origin[0] + region->size[0] > priv->requisition.dims[0] ||
-        (priv->requisition.n_dims == 2 && region->origin[1] + region->size[1] > priv->requisition.dims[1]) ||
-        (priv->requisition.n_dims == 3 && region->origin[2] + region->size[2] > priv->requisition.dims[2])) {
+    normalize_region (&priv->requisition, region, &normalized);
+
+    if (!region_fits (&priv->requisition, &normalized)) {
         g_error ("Requested view exceeds buffer size");
         return NULL;
     }
 
     update_last_queue (priv, cmd_queue);
 
-    size = region->size[0] * region->size[1] * region->size[2] * sizeof(float);
-    src_row_pitch = sizeof(float) * priv->requisition.dims[0];
-    src_slice_pitch = sizeof(float) * priv->requisition.dims[1];
-    dst_row_pitch = sizeof(float) * region->size[0];
-    dst_slice_pitch = sizeof(float) * region->size[1];
+    if (priv->location == UFO_BUFFER_LOCATION_DEVICE_IMAGE)
+        ufo_buffer_get_device_array (buffer, cmd_queue);
+
+    get_pitches (&priv->requisition, &src_row_pitch, &src_slice_pitch);
+    get_rect_region (&normalized, src_origin, rect);
+
+    size = rect[0] * rect[1] * rect[2];
+    dst_row_pitch = rect[0];
+    dst_slice_pitch = rect[0] * rect[1];
 
     mem = clCreateBuffer (priv->context, CL_MEM_READ_WRITE, size, NULL, &errcode);
     UFO_RESOURCES_CHECK_CLERR (errcode);
 
     if (priv->location == UFO_BUFFER_LOCATION_HOST && priv->host_array) {
-        if (priv->requisition.n_dims == 1) {
-            UFO_RESOURCES_CHECK_CLERR (clEnqueueWriteBuffer (cmd_queue, mem, CL_TRUE,
-                                                             region->origin[0] * sizeof (float), size,
+        UFO_RESOURCES_CHECK_CLERR (clEnqueueWriteBufferRect (cmd_queue, mem, CL_TRUE,
+                                                             dst_origin, src_origin, rect,
+                                                             dst_row_pitch, dst_slice_pitch,
+                                                             src_row_pitch, src_slice_pitch,
                                                              priv->host_array,
                                                              0, NULL, NULL));
-        }
-        else if (priv->requisition.n_dims == 2) {
-            if (region->size[0] == priv->requisition.dims[0]) {
-                /* If our region is as wide as our buffer, we can simply copy
-                 * with a fixed offset */
-                gsize offset;
-
-                offset = region->origin[1] * src_row_pitch;
-                UFO_RESOURCES_CHECK_CLERR (clEnqueueWriteBuffer (cmd_queue, mem, CL_TRUE,
-                                                                 0, size,
-                                                                 ((gchar *) priv->host_array) + offset,
-                                                                 0, NULL, NULL));
-            }
-            else {
-                gchar *tmp;
-                gchar *dst;
-                gchar *src;
-                guint n_rows;
-
-                n_rows = region->size[1];
-                tmp = dst = g_malloc0 (size);
-                src = ((gchar *) priv->host_array) + region->origin[1] * src_row_pitch + region->origin[0] * sizeof (float);
-
-                for (guint y = 0; y < n_rows; y++) {
-                    memcpy (dst, src , dst_row_pitch);
-                    dst += dst_row_pitch;
-                    src += src_row_pitch;
-                }
-
-                UFO_RESOURCES_CHECK_CLERR (clEnqueueWriteBuffer (cmd_queue, mem, CL_TRUE,
-                                                                 0, size, tmp,
-                                                                 0, NULL, NULL));
-                g_free (tmp);
-            }
-        }
-        else {
-            g_warning ("Dimensions >= 3 not supported yet");
-        }
     }
 
-    if (priv->location == UFO_BUFFER_LOCATION_DEVICE_IMAGE && priv->device_array) {
+    if (priv->location == UFO_BUFFER_LOCATION_DEVICE && priv->device_array) {
         cl_event event;
 
         UFO_RESOURCES_CHECK_CLERR (clEnqueueCopyBufferRect (cmd_queue,
                                                             priv->device_array, mem,
-                                                            region->origin, dst_origin,
-                                                            region->size,
+                                                            src_origin, dst_origin, rect,
                                                             src_row_pitch, src_slice_pitch,
                                                             dst_row_pitch, dst_slice_pitch,
                                                             0, NULL, &event));
@@ -998,17 +2172,27 @@ ufo_buffer_get_device_image (UfoBuffer *buffer,
     priv = buffer->priv;
 
     update_last_queue (priv, cmd_queue);
+    sync_view (priv);
+
+    if (priv->location == UFO_BUFFER_LOCATION_HOST && priv->mapped != NULL && priv->host_array == NULL)
+        transfer_mapped_to_host (priv);
 
     if (priv->device_image == NULL)
         alloc_device_image (priv);
 
+    if (priv->location == UFO_BUFFER_LOCATION_DEVICE_IMAGE)
+        migrate_to_queue (priv, priv->device_image, priv->last_queue);
+
     if (priv->location == UFO_BUFFER_LOCATION_HOST && priv->host_array)
         transfer_host_to_image (priv, priv, priv->last_queue);
 
-    if (priv->location == UFO_BUFFER_LOCATION_DEVICE && priv->device_array)
+    if (priv->location == UFO_BUFFER_LOCATION_DEVICE && priv->device_array) {
+        migrate_to_queue (priv, priv->device_array, priv->last_queue);
         transfer_device_to_image (priv, priv, priv->last_queue);
+    }
 
     update_location (priv, UFO_BUFFER_LOCATION_DEVICE_IMAGE);
+    update_device (priv, priv->last_queue);
 
     return priv->device_image;
 }
@@ -1044,46 +2228,8 @@ convert_data (UfoBufferPrivate *priv,
               gconstpointer data,
               UfoBufferDepth depth)
 {
-    gint n_pixels;
-    gfloat *dst;
-
-    n_pixels = (gint) (priv->size / 4);
-    dst = priv->host_array;
-
-    /* To save a memory allocation and several copies, we process data from back
-     * to front. This is possible if src bit depth is at most half as wide as
-     * the 32-bit target buffer. The processor cache should not be a
-     * problem. */
-    if (depth == UFO_BUFFER_DEPTH_8U) {
-        const guint8 *src = (const guint8 *) data;
-
-        for (gint i = (n_pixels - 1); i >= 0; i--)
-            dst[i] = ((gfloat) src[i]);
-    }
-    else if (depth == UFO_BUFFER_DEPTH_16U) {
-        const guint16 *src = (const guint16 *) data;
-
-        for (gint i = (n_pixels - 1); i >= 0; i--)
-            dst[i] = ((gfloat) src[i]);
-    }
-    else if (depth == UFO_BUFFER_DEPTH_16S) {
-        const gint16 *src = (const gint16 *) data;
-
-        for (gint i = (n_pixels - 1); i >= 0; i--)
-            dst[i] = ((gfloat) src[i]);
-    }
-    else if (depth == UFO_BUFFER_DEPTH_32S) {
-        const gint32 *src = (const gint32 *) data;
-
-        for (gint i = (n_pixels - 1); i >= 0; i--)
-            dst[i] = ((gfloat) src[i]);
-    }
-    else if (depth == UFO_BUFFER_DEPTH_32U) {
-        const guint32 *src = (const guint32 *) data;
-
-        for (gint i = (n_pixels - 1); i >= 0; i--)
-            dst[i] = ((gfloat) src[i]);
-    }
+    wait_for_upload (priv);
+    convert_elements (priv->host_array, data, (gint) (priv->size / 4), depth);
 }
 
 /**
@@ -1134,12 +2280,165 @@ ufo_buffer_convert_from_data (UfoBuffer *buffer,
     convert_data (priv, data, depth);
 }
 
+static MetadataValue *
+metadata_value_new (const GValue *value)
+{
+    MetadataValue *copy;
+
+    copy = g_new0 (MetadataValue, 1);
+    copy->ref_count = 1;
+    g_value_init (&copy->value, G_VALUE_TYPE (value));
+    g_value_copy (value, &copy->value);
+    return copy;
+}
+
+static MetadataValue *
+metadata_value_ref (MetadataValue *value)
+{
+    g_atomic_int_inc (&value->ref_count);
+    return value;
+}
+
+static void
+metadata_value_unref (MetadataValue *value)
+{
+    if (!g_atomic_int_dec_and_test (&value->ref_count))
+        return;
+
+    g_value_unset (&value->value);
+    g_free (value);
+}
+
+static MetadataTable *
+metadata_table_new (guint n_entries)
+{
+    MetadataTable *table;
+
+    table = g_new0 (MetadataTable, 1);
+    table->ref_count = 1;
+    table->n_entries = n_entries;
+    table->entries = g_new0 (MetadataEntry, n_entries);
+    return table;
+}
+
+static MetadataTable *
+metadata_table_ref (MetadataTable *table)
+{
+    if (table != NULL)
+        g_atomic_int_inc (&table->ref_count);
+
+    return table;
+}
+
+static void
+metadata_table_unref (MetadataTable *table)
+{
+    if (table == NULL || !g_atomic_int_dec_and_test (&table->ref_count))
+        return;
+
+    for (guint i = 0; i < table->n_entries; i++)
+        metadata_value_unref (table->entries[i].value);
+
+    g_free (table->entries);
+    g_free (table);
+}
+
+static MetadataEntry *
+metadata_table_lookup (MetadataTable *table,
+                       GQuark key)
+{
+    if (table == NULL)
+        return NULL;
+
+    for (guint i = 0; i < table->n_entries; i++) {
+        if (table->entries[i].key == key)
+            return &table->entries[i];
+    }
+
+    return NULL;
+}
+
+static MetadataTable *
+metadata_table_copy (MetadataTable *table)
+{
+    MetadataTable *copy;
+
+    copy = metadata_table_new (table->n_entries);
+
+    for (guint i = 0; i < table->n_entries; i++) {
+        copy->entries[i].key = table->entries[i].key;
+        copy->entries[i].value = metadata_value_ref (table->entries[i].value);
+    }
+
+    return copy;
+}
+
+static void
+clear_item_metadata (UfoBufferPrivate *priv)
+{
+    if (priv->item_metadata == NULL)
+        return;
+
+    for (guint i = 0; i < priv->item_metadata->len; i++)
+        metadata_table_unref (g_ptr_array_index (priv->item_metadata, i));
+
+    g_ptr_array_set_size (priv->item_metadata, 0);
+}
+
+static void
+set_item_metadata (UfoBufferPrivate *priv,
+                   guint index,
+                   MetadataTable *table)
+{
+    if (priv->item_metadata == NULL)
+        priv->item_metadata = g_ptr_array_new ();
+
+    if (index >= priv->item_metadata->len)
+        g_ptr_array_set_size (priv->item_metadata, index + 1);
+
+    metadata_table_unref (g_ptr_array_index (priv->item_metadata, index));
+    g_ptr_array_index (priv->item_metadata, index) = metadata_table_ref (table);
+}
+
+/*
+ * Items of a batch stay in the same order through a batch-capable task, so the
+ * items of an output batch inherit the metadata of the input items.
+ */
+static void
+copy_item_metadata (UfoBufferPrivate *src,
+                    UfoBufferPrivate *dst)
+{
+    guint n_items;
+
+    if (src->item_metadata == NULL || src == dst)
+        return;
+
+    n_items = MIN (src->item_metadata->len, dst->batch_size);
+
+    for (guint i = 0; i < n_items; i++)
+        set_item_metadata (dst, i, g_ptr_array_index (src->item_metadata, i));
+}
+
+/*
+ * Record the metadata of @item as that of the @index-th item of @batch.
+ */
+void
+ufo_buffer_set_item_metadata (UfoBuffer *batch,
+                              guint index,
+                              UfoBuffer *item)
+{
+    g_return_if_fail (UFO_IS_BUFFER (batch) && UFO_IS_BUFFER (item));
+    set_item_metadata (batch->priv, index, item->priv->metadata);
+}
+
 /**
  * ufo_buffer_get_metadata:
  * @buffer: A #UfoBuffer
  * @name: Name of the associated meta data
  *
- * Retrieve meta data.
+ * Retrieve meta data. The returned value may be shared with other buffers and
+ * must not be modified. It stays valid until @name is set again on @buffer or
+ * @buffer is destroyed, setting other keys does not invalidate it.
  *
  * Returns: previously defined metadata #GValue for this buffer.
  */
@@ -1147,8 +2446,15 @@ GValue *
 ufo_buffer_get_metadata (UfoBuffer *buffer,
                          const gchar *name)
 {
+    MetadataEntry *entry;
+    GQuark key;
+
     g_return_val_if_fail (UFO_IS_BUFFER (buffer), NULL);
-    return g_hash_table_lookup (buffer->priv->metadata, name);
+
+    /* A name that was never interned cannot be a key */
+    key = g_quark_try_string (name);
+    entry = key != 0 ? metadata_table_lookup (buffer->priv->metadata, key) : NULL;
+    return entry != NULL ? &entry->value->value : NULL;
 }
 
 /**
@@ -1165,23 +2471,75 @@ ufo_buffer_set_metadata (UfoBuffer *buffer,
                          GValue *value)
 {
     UfoBufferPrivate *priv;
-    GValue *old;
-    GValue *new;
+    MetadataTable *table;
+    MetadataEntry *entry;
+    GQuark key;
 
     g_return_if_fail (UFO_IS_BUFFER (buffer));
     priv = buffer->priv;
+    key = g_quark_from_string (name);
+    table = priv->metadata;
+
+    if (table == NULL) {
+        table = priv->metadata = metadata_table_new (0);
+    }
+    else if (g_atomic_int_get (&table->ref_count) > 1) {
+        /* The table is shared with other buffers, copy before writing */
+        priv->metadata = metadata_table_copy (table);
+        metadata_table_unref (table);
+        table = priv->metadata;
+    }
 
-    old = g_hash_table_lookup (priv->metadata, name);
+    entry = metadata_table_lookup (table, key);
 
-    if (old != NULL) {
-        g_value_unset (old);
+    if (entry == NULL) {
+        table->entries = g_renew (MetadataEntry, table->entries, table->n_entries + 1);
+        entry = &table->entries[table->n_entries++];
+        entry->key = key;
+        entry->value = metadata_value_new (value);
     }
+    else if (g_atomic_int_get (&entry->value->ref_count) > 1) {
+        /* Other tables still use the old value */
+        metadata_value_unref (entry->value);
+        entry->value = metadata_value_new (value);
+    }
+    else {
+        g_value_unset (&entry->value->value);
+        g_value_init (&entry->value->value, G_VALUE_TYPE (value));
+        g_value_copy (value, &entry->value->value);
+    }
+}
 
-    new = g_malloc0 (sizeof (GValue));
-    g_value_init (new, G_VALUE_TYPE ((GValue *) value));
-    g_value_copy (value, new);
+/*
+ * Remove the meta data @name from @buffer.
+ */
+void
+ufo_buffer_remove_metadata (UfoBuffer *buffer,
+                            const gchar *name)
+{
+    UfoBufferPrivate *priv;
+    MetadataTable *table;
+    MetadataEntry *entry;
+    GQuark key;
+
+    g_return_if_fail (UFO_IS_BUFFER (buffer));
+    priv = buffer->priv;
+    key = g_quark_try_string (name);
 
-    g_hash_table_replace (priv->metadata, g_strdup (name), new);
+    if (key == 0 || metadata_table_lookup (priv->metadata, key) == NULL)
+        return;
+
+    table = priv->metadata;
+
+    if (g_atomic_int_get (&table->ref_count) > 1) {
+        priv->metadata = metadata_table_copy (table);
+        metadata_table_unref (table);
+        table = priv->metadata;
+    }
+
+    entry = metadata_table_lookup (table, key);
+    metadata_value_unref (entry->value);
+    *entry = table->entries[--table->n_entries];
 }
 
 /**
@@ -1189,29 +2547,42 @@ ufo_buffer_set_metadata (UfoBuffer *buffer,
  * @src: Source buffer
  * @dst: Destination buffer
  *
- * Copies meta data content from @src to @dst.
+ * Copies meta data content from @src to @dst. Unless @dst has keys that @src
+ * does not have, the meta data is shared instead of copied.
  */
 void
 ufo_buffer_copy_metadata (UfoBuffer *src,
                           UfoBuffer *dst)
 {
-    UfoBufferPrivate *priv;
-    GList *keys;
-    GList *it;
+    MetadataTable *src_table;
+    MetadataTable *dst_table;
 
     g_return_if_fail (UFO_IS_BUFFER (src) && UFO_IS_BUFFER (dst));
-    priv = src->priv;
-    keys = g_hash_table_get_keys (priv->metadata);
+    copy_item_metadata (src->priv, dst->priv);
+
+    src_table = src->priv->metadata;
+    dst_table = dst->priv->metadata;
 
-    g_list_for (keys, it) {
-        GValue *value;
-        const gchar *name = (const gchar *) it->data;
+    if (src_table == NULL || src_table == dst_table)
+        return;
+
+    if (dst_table != NULL) {
+        for (guint i = 0; i < dst_table->n_entries; i++) {
+            if (metadata_table_lookup (src_table, dst_table->entries[i].key) == NULL) {
+                /* dst has additional keys, merge them the slow way */
+                for (guint j = 0; j < src_table->n_entries; j++) {
+                    ufo_buffer_set_metadata (dst,
+                                             g_quark_to_string (src_table->entries[j].key),
+                                             &src_table->entries[j].value->value);
+                }
 
-        value = ufo_buffer_get_metadata (src, name);
-        ufo_buffer_set_metadata (dst, name, value);
+                return;
+            }
+        }
     }
 
-    g_list_free (keys);
+    dst->priv->metadata = metadata_table_ref (src_table);
+    metadata_table_unref (dst_table);
 }
 
 /**
@@ -1227,8 +2598,19 @@ ufo_buffer_copy_metadata (UfoBuffer *src,
 GList *
 ufo_buffer_get_metadata_keys (UfoBuffer *buffer)
 {
+    MetadataTable *table;
+    GList *keys = NULL;
+
     g_return_val_if_fail (UFO_IS_BUFFER (buffer), NULL);
-    return g_hash_table_get_keys (buffer->priv->metadata);
+    table = buffer->priv->metadata;
+
+    if (table == NULL)
+        return NULL;
+
+    for (guint i = table->n_entries; i > 0; i--)
+        keys = g_list_prepend (keys, (gpointer) g_quark_to_string (table->entries[i - 1].key));
+
+    return keys;
 }
 
 /**
@@ -1347,6 +2729,12 @@ ufo_buffer_finalize (GObject *gobject)
     UfoBuffer *buffer = UFO_BUFFER (gobject);
     UfoBufferPrivate *priv = UFO_BUFFER_GET_PRIVATE (buffer);
 
+    wait_for_upload (priv);
+    unmap (priv);
+
+    if (priv->view_staged)
+        write_back_view (priv);
+
     if (priv->free)
         g_free (priv->host_array);
 
@@ -1359,7 +2747,19 @@ ufo_buffer_finalize (GObject *gobject)
     free_cl_mem (&priv->device_array);
     free_cl_mem (&priv->device_image);
 
-    g_hash_table_destroy (priv->metadata);
+    metadata_table_unref (priv->metadata);
+    priv->metadata = NULL;
+
+    if (priv->item_metadata != NULL) {
+        clear_item_metadata (priv);
+        g_ptr_array_free (priv->item_metadata, TRUE);
+        priv->item_metadata = NULL;
+    }
+
+    if (priv->parent != NULL) {
+        g_object_unref (priv->parent);
+        priv->parent = NULL;
+    }
 
     G_OBJECT_CLASS(ufo_buffer_parent_class)->finalize(gobject);
 }
@@ -1379,6 +2779,8 @@ ufo_buffer_init (UfoBuffer *buffer)
     UfoBufferPrivate *priv;
     buffer->priv = priv = UFO_BUFFER_GET_PRIVATE(buffer);
     priv->last_queue = NULL;
+    priv->device_queue = NULL;
+    priv->device = NULL;
     priv->device_array = NULL;
     priv->device_image = NULL;
     priv->host_array = NULL;
@@ -1387,8 +2789,17 @@ ufo_buffer_init (UfoBuffer *buffer)
     priv->location = UFO_BUFFER_LOCATION_INVALID;
     priv->last_location = UFO_BUFFER_LOCATION_INVALID;
     priv->requisition.n_dims = 0;
-    priv->metadata = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+    priv->metadata = NULL;
+    priv->batch_size = 0;
+    priv->item_metadata = NULL;
     priv->sub_device_arrays = NULL;
+    priv->parent = NULL;
+    priv->view_alias = FALSE;
+    priv->view_valid = FALSE;
+    priv->mapped = NULL;
+    priv->mapped_data = NULL;
+    priv->mapped_size = 0;
+    priv->mapped_writable = FALSE;
 }
 
 static void
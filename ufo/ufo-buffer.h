@@ -116,6 +116,16 @@ UfoBuffer*  ufo_buffer_new_with_size        (GList          *dims,
 UfoBuffer*  ufo_buffer_new_with_data        (UfoRequisition *requisition,
                                              gpointer        data,
                                              gpointer        context);
+UfoBuffer*  ufo_buffer_new_view             (UfoBuffer      *parent,
+                                             UfoRegion      *region);
+UfoBuffer*  ufo_buffer_new_slice            (UfoBuffer      *buffer,
+                                             guint           index);
+UfoBuffer*  ufo_buffer_new_mapped           (const gchar    *path,
+                                             UfoRequisition *requisition,
+                                             UfoBufferDepth  depth,
+                                             gsize           offset,
+                                             gpointer        context,
+                                             GError        **error);
 void        ufo_buffer_resize               (UfoBuffer      *buffer,
                                              UfoRequisition *requisition);
 gint        ufo_buffer_cmp_dimensions       (UfoBuffer      *buffer,
@@ -123,6 +133,9 @@ gint        ufo_buffer_cmp_dimensions       (UfoBuffer      *buffer,
 void        ufo_buffer_get_requisition      (UfoBuffer      *buffer,
                                              UfoRequisition *requisition);
 gsize       ufo_buffer_get_size             (UfoBuffer      *buffer);
+void        ufo_buffer_set_batch_size       (UfoBuffer      *buffer,
+                                             guint           batch_size);
+guint       ufo_buffer_get_batch_size       (UfoBuffer      *buffer);
 void        ufo_buffer_copy                 (UfoBuffer      *src,
                                              UfoBuffer      *dst);
 UfoBuffer  *ufo_buffer_dup                  (UfoBuffer      *buffer);
@@ -82,7 +82,7 @@ ufo_copy_task_get_num_dimensions (UfoTask *task,
 static UfoTaskMode
 ufo_copy_task_get_mode (UfoTask *task)
 {
-    return UFO_TASK_MODE_PROCESSOR | UFO_TASK_MODE_CPU;
+    return UFO_TASK_MODE_PROCESSOR | UFO_TASK_MODE_CPU | UFO_TASK_MODE_STATIC_REQUISITION;
 }
 
 static void
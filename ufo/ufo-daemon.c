@@ -49,7 +49,7 @@ struct _UfoDaemonPrivate {
     gpointer socket;
     UfoNode *input_task;
     UfoNode *output_task;
-    UfoBuffer *input;
+    volatile gint stopping;
     gchar *listen_address;
     GThread *thread;
     GMutex *startstop_lock;
@@ -306,11 +306,24 @@ handle_get_structure (UfoDaemon *daemon, UfoMessage *request)
     ufo_message_free (reply);
 }
 
+static void
+join_scheduler (UfoDaemonPrivate *priv)
+{
+    if (priv->scheduler_thread != NULL) {
+        g_message ("Waiting for scheduler to finish ...");
+        g_thread_join (priv->scheduler_thread);
+        priv->scheduler_thread = NULL;
+        g_message ("Done.");
+    }
+}
+
 static void
 handle_send_inputs (UfoDaemon *daemon, UfoMessage *request)
 {
     UfoDaemonPrivate *priv;
     UfoRequisition requisition;
+    UfoBuffer *wrapper;
+    UfoBuffer *consumed;
     gpointer context;
 
     priv = UFO_DAEMON_GET_PRIVATE (daemon);
@@ -327,23 +340,37 @@ handle_send_inputs (UfoDaemon *daemon, UfoMessage *request)
     /* Receive buffer size */
     requisition = header->requisition;
 
-    if (priv->input == NULL) {
-        priv->input = ufo_buffer_new (&requisition, context);
-    }
-    else {
-        if (ufo_buffer_cmp_dimensions (priv->input, &requisition))
-            ufo_buffer_resize (priv->input, &requisition);
-    }
-
-    memcpy (ufo_buffer_get_host_array (priv->input, NULL),
-            base + sizeof (struct Header),
-            ufo_buffer_get_size (priv->input));
-
-    ufo_input_task_release_input_buffer (UFO_INPUT_TASK (priv->input_task), priv->input);
+    /*
+     * Instead of copying the data into a buffer of our own, hand the request
+     * payload to the input task directly. With the shared memory messenger the
+     * payload is the slot the client wrote to, so the data is not copied at
+     * all until the input task copies it into its output.
+     */
+    wrapper = ufo_buffer_new (&requisition, context);
+    ufo_buffer_set_host_array (wrapper, (gfloat *) (base + sizeof (struct Header)), FALSE);
+    ufo_input_task_release_input_buffer (UFO_INPUT_TASK (priv->input_task), wrapper);
 
     UfoMessage *reply = ufo_message_new (UFO_MESSAGE_ACK, 0);
     retry_send_n_times (3, priv->messenger, reply, "inputs reply");
     ufo_message_free (reply);
+
+    /*
+     * The request is freed on return, so wait until the payload was consumed.
+     * If ufo_daemon_stop() is called meanwhile, the TERMINATE request cannot
+     * be handled before we return, so stop the graph and wait for it instead.
+     */
+    do {
+        consumed = ufo_input_task_try_get_input_buffer (UFO_INPUT_TASK (priv->input_task),
+                                                        G_USEC_PER_SEC / 10);
+
+        if (consumed == NULL && g_atomic_int_get (&priv->stopping)) {
+            ufo_input_task_stop (UFO_INPUT_TASK (priv->input_task));
+            join_scheduler (priv);
+            break;
+        }
+    } while (consumed != wrapper);
+
+    g_object_unref (wrapper);
 }
 
 static void
@@ -401,16 +428,11 @@ void handle_cleanup (UfoDaemon *daemon, UfoMessage *request)
     retry_send_n_times (3, priv->messenger, reply, "cleanup ACK");
     ufo_message_free (reply);
 
-    /* TODO: check that we don't need to execute this branch wen priv->input is null */
-    if (priv->input_task && priv->input) {
+    /* The input task polls its queue, so stopping is enough to end it */
+    if (priv->input_task) {
         ufo_input_task_stop (UFO_INPUT_TASK (priv->input_task));
-
-        ufo_input_task_release_input_buffer (UFO_INPUT_TASK (priv->input_task),
-                                             priv->input);
-
         g_usleep (1.5 * G_USEC_PER_SEC);
         unref_and_free ((GObject **) &priv->input_task);
-        unref_and_free ((GObject **) &priv->input);
     }
 
     unref_and_free ((GObject **) &priv->output_task);
@@ -426,12 +448,7 @@ handle_terminate (UfoDaemon *daemon, UfoMessage *request)
     retry_send_n_times (3, priv->messenger, reply, "terminate ACK");
     ufo_message_free (reply);
 
-    if (priv->scheduler_thread != NULL) {
-        g_message ("Waiting for scheduler to finish ...");
-        g_thread_join (priv->scheduler_thread);
-        g_message ("Done.");
-    }
-
+    join_scheduler (priv);
     ufo_messenger_disconnect (priv->messenger);
 }
 
@@ -564,6 +581,9 @@ ufo_daemon_stop (UfoDaemon *daemon, GError **error)
         goto daemon_stop_unlock;
     }
 
+    /* Wake up a daemon thread that waits for its input task to take data */
+    g_atomic_int_set (&priv->stopping, 1);
+
     UfoMessage *request = ufo_message_new (UFO_MESSAGE_TERMINATE, 0);
     if (!retry_send_n_times (3, priv->messenger, request, "terminate request")) {
         g_set_error (&tmp_error, UFO_MESSENGER_ERROR, UFO_MESSENGER_CONNECTION_PROBLEM,
@@ -651,4 +671,5 @@ ufo_daemon_init (UfoDaemon *self)
     priv->stopped_cond = g_cond_new ();
     priv->has_started = FALSE;
     priv->has_stopped = FALSE;
+    priv->stopping = 0;
 }
@@ -57,6 +57,7 @@ typedef struct {
     UfoTask *from;
     UfoTask *to;
     guint port;
+    guint depth;
     UfoTwoWayQueue *queue;
 } Connection;
 
@@ -70,6 +71,7 @@ typedef struct {
     UfoTask *task;
     GList *connections;
     cl_context context;
+    gboolean static_requisition;
 } TaskData;
 
 enum {
@@ -79,6 +81,9 @@ enum {
 
 static UfoBuffer *POISON_PILL = (UfoBuffer *) 0x1;
 
+/* Buffers per connection unless the edge sets its own depth */
+#define DEFAULT_DEPTH   2
+
 /**
  * UfoFixedSchedulerError:
  * @UFO_FIXED_SCHEDULER_ERROR_SETUP: Could not start scheduler due to error
@@ -139,11 +144,12 @@ release_input_data (UfoTwoWayQueue **in_queues, UfoBuffer **inputs, guint n_inpu
 }
 
 static UfoBuffer *
-pop_output_data (UfoTwoWayQueue *queue, UfoRequisition *requisition, cl_context context)
+pop_output_data (Connection *connection, UfoRequisition *requisition, cl_context context)
 {
+    UfoTwoWayQueue *queue = connection->queue;
     UfoBuffer *buffer;
 
-    if (ufo_two_way_queue_get_capacity (queue) < 2) {
+    if (ufo_two_way_queue_get_capacity (queue) < connection->depth) {
         buffer = ufo_buffer_new (requisition, context);
         ufo_two_way_queue_insert (queue, buffer);
     }
@@ -156,8 +162,17 @@ pop_output_data (UfoTwoWayQueue *queue, UfoRequisition *requisition, cl_context
     return buffer;
 }
 
+static void
+get_requisition (TaskData *data, UfoBuffer **inputs, guint n_inputs, UfoRequisition *requisition)
+{
+    if (data->static_requisition)
+        ufo_task_node_lookup_requisition (UFO_TASK_NODE (data->task), inputs, n_inputs, requisition);
+    else
+        ufo_task_get_requisition (data->task, inputs, requisition);
+}
+
 static GList *
-get_output_queue_list (TaskData *data)
+get_output_connections (TaskData *data)
 {
     GList *result = NULL;
     GList *it;
@@ -166,7 +181,7 @@ get_output_queue_list (TaskData *data)
         Connection *connection = (Connection *) it->data;
 
         if (connection->from == data->task)
-            result = g_list_append (result, connection->queue);
+            result = g_list_append (result, connection);
     }
 
     return result;
@@ -192,44 +207,55 @@ get_input_queues (TaskData *data, guint *n_inputs)
 }
 
 static void
-finish_successors (GList *out_queues)
+finish_successors (GList *out_connections)
 {
     GList *it;
 
-    g_list_for (out_queues, it) {
-        UfoTwoWayQueue *out_queue = (UfoTwoWayQueue *) it->data;
-        ufo_two_way_queue_producer_push (out_queue, POISON_PILL);
+    g_list_for (out_connections, it) {
+        Connection *connection = (Connection *) it->data;
+        ufo_two_way_queue_producer_push (connection->queue, POISON_PILL);
     }
 }
 
+static void
+push_or_recycle (TaskData *data,
+                 UfoTwoWayQueue *out_queue,
+                 UfoBuffer *output)
+{
+    if (ufo_task_node_output_skipped (UFO_TASK_NODE (data->task)))
+        ufo_two_way_queue_consumer_push (out_queue, output);
+    else
+        ufo_two_way_queue_producer_push (out_queue, output);
+}
+
 static void
 generate_loop (TaskData *data)
 {
     UfoRequisition requisition;
     UfoBuffer *output;
-    GList *out_queues;
+    GList *out_connections;
     GList *it;
     gboolean active = TRUE;
 
-    out_queues = get_output_queue_list (data);
+    out_connections = get_output_connections (data);
 
     while (active) {
-        g_list_for (out_queues, it) {
-            UfoTwoWayQueue *out_queue = (UfoTwoWayQueue *) it->data;
+        g_list_for (out_connections, it) {
+            Connection *connection = (Connection *) it->data;
 
-            ufo_task_get_requisition (data->task, NULL, &requisition);
-            output = pop_output_data (out_queue, &requisition, data->context);
+            get_requisition (data, NULL, 0, &requisition);
+            output = pop_output_data (connection, &requisition, data->context);
             active = ufo_task_generate (data->task, output, &requisition);
 
             if (!active)
                 break;
 
-            ufo_two_way_queue_producer_push (out_queue, output);
+            push_or_recycle (data, connection->queue, output);
         }
     }
 
-    finish_successors (out_queues);
-    g_list_free (out_queues);
+    finish_successors (out_connections);
+    g_list_free (out_connections);
 }
 
 static void
@@ -240,17 +266,17 @@ process_loop (TaskData *data)
     UfoBuffer *output;
     UfoTwoWayQueue **in_queues;
     gboolean *finished;
-    GList *out_queues;
+    GList *out_connections;
     GList *it;
     guint n_inputs;
     gboolean active = TRUE;
     gboolean is_sink;
 
     in_queues = get_input_queues (data, &n_inputs);
-    out_queues = get_output_queue_list (data);
+    out_connections = get_output_connections (data);
     inputs = g_new0 (UfoBuffer *, n_inputs);
     finished = g_new0 (gboolean, n_inputs);
-    is_sink = g_list_length (out_queues) == 0;
+    is_sink = g_list_length (out_connections) == 0;
 
     while (active) {
         active = pop_input_data (in_queues, finished, inputs, n_inputs);
@@ -258,16 +284,16 @@ process_loop (TaskData *data)
         if (!active)
             break;
 
-        ufo_task_get_requisition (data->task, inputs, &requisition);
+        get_requisition (data, inputs, n_inputs, &requisition);
 
         if (is_sink) {
             active = ufo_task_process (data->task, inputs, NULL, &requisition);
         }
         else {
-            g_list_for (out_queues, it) {
-                UfoTwoWayQueue *out_queue = (UfoTwoWayQueue *) it->data;
+            g_list_for (out_connections, it) {
+                Connection *connection = (Connection *) it->data;
 
-                output = pop_output_data (out_queue, &requisition, data->context);
+                output = pop_output_data (connection, &requisition, data->context);
 
                 for (guint i = 0; i < n_inputs; i++)
                     ufo_buffer_copy_metadata (inputs[i], output);
@@ -277,19 +303,19 @@ process_loop (TaskData *data)
                 if (!active)
                     break;
 
-                ufo_two_way_queue_producer_push (out_queue, output);
+                push_or_recycle (data, connection->queue, output);
             }
         }
 
         release_input_data (in_queues, inputs, n_inputs);
     }
 
-    finish_successors (out_queues);
+    finish_successors (out_connections);
 
     g_free (in_queues);
     g_free (inputs);
     g_free (finished);
-    g_list_free (out_queues);
+    g_list_free (out_connections);
 }
 
 static void
@@ -297,39 +323,39 @@ reduce_loop (TaskData *data)
 {
     UfoRequisition requisition;
     UfoTwoWayQueue **in_queues;
-    UfoTwoWayQueue **output_queues;
+    Connection **out_connections;
     UfoBuffer **inputs;
     UfoBuffer **outputs;
     gboolean *finished;
     GList *it;
-    GList *out_queues;
+    GList *connections;
     guint n_inputs;
     guint n_outputs;
     gboolean active = TRUE;
 
     in_queues = get_input_queues (data, &n_inputs);
-    out_queues = get_output_queue_list (data);
+    connections = get_output_connections (data);
     inputs = g_new0 (UfoBuffer *, n_inputs);
     finished = g_new0 (gboolean, n_inputs);
 
-    n_outputs = g_list_length (out_queues);
+    n_outputs = g_list_length (connections);
     outputs = g_new0 (UfoBuffer *, n_outputs);
-    output_queues = g_new0 (UfoTwoWayQueue *, n_outputs);
-    it = g_list_first (out_queues);
+    out_connections = g_new0 (Connection *, n_outputs);
+    it = g_list_first (connections);
 
     for (guint i = 0; it != NULL; it = g_list_next (it)) {
-        output_queues[i] = (UfoTwoWayQueue *) it->data;
+        out_connections[i] = (Connection *) it->data;
     }
 
     /* Read first input item */
     if (!pop_input_data (in_queues, finished, inputs, n_inputs))
         return;
 
-    ufo_task_get_requisition (data->task, inputs, &requisition);
+    get_requisition (data, inputs, n_inputs, &requisition);
 
     /* Get the scratchpad output buffers from all successors */
     for (guint i = 0; i < n_outputs; i++) {
-        outputs[i] = pop_output_data (output_queues[i], &requisition, data->context);
+        outputs[i] = pop_output_data (out_connections[i], &requisition, data->context);
     }
 
     /* Process all inputs. Note that we already fetched the first input. */
@@ -349,22 +375,23 @@ reduce_loop (TaskData *data)
         for (guint i = 0; i < n_outputs; i++) {
             active = ufo_task_generate (data->task, outputs[i], &requisition);
 
-            if (active) {
-                ufo_two_way_queue_producer_push (output_queues[i], outputs[i]);
-                outputs[i] = ufo_two_way_queue_producer_pop (output_queues[i]);
+            /* a skipped item keeps its buffer for the next one */
+            if (active && !ufo_task_node_output_skipped (UFO_TASK_NODE (data->task))) {
+                ufo_two_way_queue_producer_push (out_connections[i]->queue, outputs[i]);
+                outputs[i] = ufo_two_way_queue_producer_pop (out_connections[i]->queue);
             }
         }
     } while (active);
 
-    finish_successors (out_queues);
+    finish_successors (connections);
 
     g_free (inputs);
     g_free (in_queues);
 
     g_free (outputs);
-    g_free (output_queues);
+    g_free (out_connections);
     g_free (finished);
-    g_list_free (out_queues);
+    g_list_free (connections);
 }
 
 static gpointer
@@ -459,9 +486,14 @@ setup_tasks (UfoGraph *graph,
             connection = g_new0 (Connection, 1);
             connection->from = source_task;
             connection->to = dest_task;
-            connection->port = (guint) GPOINTER_TO_INT (ufo_graph_get_edge_label (graph, source_node, dest_node));
+            connection->port = UFO_EDGE_INPUT (ufo_graph_get_edge_label (graph, source_node, dest_node));
+            connection->depth = ufo_task_node_get_queue_depth (UFO_TASK_NODE (dest_task), connection->port);
             connection->queue = ufo_two_way_queue_new (NULL);
 
+            /* this scheduler does not tune depths */
+            if (connection->depth == 0 || connection->depth == UFO_QUEUE_DEPTH_AUTO)
+                connection->depth = DEFAULT_DEPTH;
+
             data->connections = g_list_append (data->connections, connection);
             data->tasks = append_if_not_existing (data->tasks, dest_task);
         }
@@ -532,6 +564,7 @@ ufo_fixed_scheduler_run (UfoBaseScheduler *scheduler,
         tdata->task = UFO_TASK (it->data);
         tdata->connections = pdata->connections;
         tdata->context = ufo_resources_get_context (resources);
+        tdata->static_requisition = ufo_task_get_mode (tdata->task) & UFO_TASK_MODE_STATIC_REQUISITION;
         thread = g_thread_create ((GThreadFunc) run_local, tdata, TRUE, error);
         threads = g_list_append (threads, thread);
     }
@@ -21,35 +21,161 @@
 #include <string.h>
 #include <ufo/ufo-resources.h>
 #include <ufo/ufo-gpu-node.h>
+#include "ufo-priv.h"
 
 G_DEFINE_TYPE (UfoGpuNode, ufo_gpu_node, UFO_TYPE_NODE)
 
 #define UFO_GPU_NODE_GET_PRIVATE(obj) (G_TYPE_INSTANCE_GET_PRIVATE((obj), UFO_TYPE_GPU_NODE, UfoGpuNodePrivate))
 
+#define DEFAULT_N_COMPUTE_QUEUES    2
+#define MAX_N_COMPUTE_QUEUES        16
+
+typedef struct {
+    cl_command_queue upload;
+    cl_command_queue download;
+    cl_command_queue priority;  /* reserved for latency-sensitive tasks */
+    cl_command_queue compute[MAX_N_COMPUTE_QUEUES];
+    guint n_compute;            /* number of created compute queues */
+    gboolean profiling;
+} QueueSet;
 
 struct _UfoGpuNodePrivate {
     cl_context context;
     cl_device_id device;
-    cl_command_queue cmd_queue;
+    QueueSet *queues[2];        /* without and with profiling */
+    gboolean profiling;
+    guint n_compute;
+};
+
+enum {
+    PROP_0,
+    PROP_NUM_COMPUTE_QUEUES,
+    N_PROPERTIES
 };
 
+static GParamSpec *properties[N_PROPERTIES] = { NULL, };
+
+/* Maps each queue of any node to its queue set to find copy queues */
+G_LOCK_DEFINE_STATIC (registry);
+static GHashTable *registry = NULL;
+
+static cl_command_queue
+create_queue (cl_context context,
+              cl_device_id device,
+              gboolean profiling)
+{
+    cl_command_queue queue;
+    cl_int errcode;
+
+    queue = clCreateCommandQueue (context, device, profiling ? CL_QUEUE_PROFILING_ENABLE : 0, &errcode);
+    UFO_RESOURCES_CHECK_CLERR (errcode);
+    return queue;
+}
+
+static void
+register_queue (cl_command_queue queue,
+                QueueSet *set)
+{
+    G_LOCK (registry);
+
+    if (registry == NULL)
+        registry = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+    g_hash_table_insert (registry, queue, set);
+    G_UNLOCK (registry);
+}
+
+static void
+queue_set_add_compute (QueueSet *set,
+                       cl_context context,
+                       cl_device_id device,
+                       guint n_compute)
+{
+    for (guint i = set->n_compute; i < n_compute; i++) {
+        set->compute[i] = create_queue (context, device, set->profiling);
+        register_queue (set->compute[i], set);
+    }
+
+    set->n_compute = MAX (set->n_compute, n_compute);
+}
+
+static QueueSet *
+queue_set_new (cl_context context,
+               cl_device_id device,
+               gboolean profiling,
+               guint n_compute)
+{
+    QueueSet *set;
+
+    set = g_new0 (QueueSet, 1);
+    set->profiling = profiling;
+    set->upload = create_queue (context, device, profiling);
+    set->download = create_queue (context, device, profiling);
+    set->priority = create_queue (context, device, profiling);
+    register_queue (set->upload, set);
+    register_queue (set->download, set);
+    register_queue (set->priority, set);
+    queue_set_add_compute (set, context, device, n_compute);
+
+    return set;
+}
+
+static void
+release_queue (cl_command_queue queue)
+{
+    G_LOCK (registry);
+    g_hash_table_remove (registry, queue);
+    G_UNLOCK (registry);
+
+    g_debug ("Release cmd_queue=%p", (gpointer) queue);
+    UFO_RESOURCES_CHECK_CLERR (clReleaseCommandQueue (queue));
+}
+
+static void
+queue_set_free (QueueSet *set)
+{
+    release_queue (set->upload);
+    release_queue (set->download);
+    release_queue (set->priority);
+
+    for (guint i = 0; i < set->n_compute; i++)
+        release_queue (set->compute[i]);
+
+    g_free (set);
+}
+
+static QueueSet *
+lookup_queue_set (cl_command_queue queue)
+{
+    QueueSet *set = NULL;
+
+    G_LOCK (registry);
+
+    if (registry != NULL)
+        set = g_hash_table_lookup (registry, queue);
+
+    G_UNLOCK (registry);
+    return set;
+}
+
+static QueueSet *
+get_queue_set (UfoGpuNodePrivate *priv)
+{
+    return priv->queues[priv->profiling ? 1 : 0];
+}
+
 UfoNode *
 ufo_gpu_node_new (gpointer context, gpointer device)
 {
     UfoGpuNode *node;
-    cl_int errcode;
-    cl_command_queue_properties queue_properties;
 
     g_return_val_if_fail (context != NULL && device != NULL, NULL);
 
-    queue_properties = CL_QUEUE_PROFILING_ENABLE;
-
     node = UFO_GPU_NODE (g_object_new (UFO_TYPE_GPU_NODE, NULL));
     node->priv->context = context;
     node->priv->device = device;
-    node->priv->cmd_queue = clCreateCommandQueue (context, device, queue_properties, &errcode);
+    node->priv->queues[0] = queue_set_new (context, device, FALSE, node->priv->n_compute);
 
-    UFO_RESOURCES_CHECK_CLERR (errcode);
     UFO_RESOURCES_CHECK_CLERR (clRetainContext (context));
 
     return UFO_NODE (node);
@@ -59,7 +185,10 @@ ufo_gpu_node_new (gpointer context, gpointer device)
  * ufo_gpu_node_get_cmd_queue:
  * @node: A #UfoGpuNode
  *
- * Get command queue associated with @node.
+ * Get the default compute command queue of @node. This is always the same
+ * queue, regardless of the calling thread. Tasks should prefer the queue that
+ * the scheduler assigned to them with ufo_task_node_get_cmd_queue(), so that
+ * the kernels of different tasks on the same device can overlap.
  *
  * Returns: (transfer none): A cl_command_queue object for @node.
  */
@@ -67,7 +196,184 @@ gpointer
 ufo_gpu_node_get_cmd_queue (UfoGpuNode *node)
 {
     g_return_val_if_fail (UFO_IS_GPU_NODE (node), NULL);
-    return node->priv->cmd_queue;
+    return get_queue_set (node->priv)->compute[0];
+}
+
+/**
+ * ufo_gpu_node_get_cmd_queue_for:
+ * @node: A #UfoGpuNode
+ * @index: Index of a task among those running on @node
+ *
+ * Get the compute command queue of @node for the @index-th task running on
+ * it. Tasks are spread round-robin over the #UfoGpuNode:num-compute-queues
+ * compute queues, each task uses the same queue for all of its commands.
+ *
+ * Returns: (transfer none): A cl_command_queue object for @node.
+ *
+ * Since: 0.8
+ */
+gpointer
+ufo_gpu_node_get_cmd_queue_for (UfoGpuNode *node,
+                                guint index)
+{
+    g_return_val_if_fail (UFO_IS_GPU_NODE (node), NULL);
+    return get_queue_set (node->priv)->compute[index % node->priv->n_compute];
+}
+
+/**
+ * ufo_gpu_node_get_priority_queue:
+ * @node: A #UfoGpuNode
+ *
+ * Get the compute command queue of @node that is reserved for latency-sensitive
+ * tasks, so that their kernels do not wait behind the commands of other tasks.
+ *
+ * Returns: (transfer none): A cl_command_queue object for @node.
+ *
+ * Since: 0.8
+ */
+gpointer
+ufo_gpu_node_get_priority_queue (UfoGpuNode *node)
+{
+    g_return_val_if_fail (UFO_IS_GPU_NODE (node), NULL);
+    return get_queue_set (node->priv)->priority;
+}
+
+/**
+ * ufo_gpu_node_get_compute_queue:
+ * @node: A #UfoGpuNode
+ * @index: Index of the compute queue
+ *
+ * Get one of the compute command queues of @node.
+ *
+ * Returns: (transfer none): A cl_command_queue object.
+ *
+ * Since: 0.8
+ */
+gpointer
+ufo_gpu_node_get_compute_queue (UfoGpuNode *node,
+                                guint index)
+{
+    g_return_val_if_fail (UFO_IS_GPU_NODE (node), NULL);
+    g_return_val_if_fail (index < node->priv->n_compute, NULL);
+    return get_queue_set (node->priv)->compute[index];
+}
+
+/**
+ * ufo_gpu_node_get_num_compute_queues:
+ * @node: A #UfoGpuNode
+ *
+ * Get the number of compute command queues of @node.
+ *
+ * Returns: Number of compute queues.
+ *
+ * Since: 0.8
+ */
+guint
+ufo_gpu_node_get_num_compute_queues (UfoGpuNode *node)
+{
+    g_return_val_if_fail (UFO_IS_GPU_NODE (node), 0);
+    return node->priv->n_compute;
+}
+
+/**
+ * ufo_gpu_node_get_upload_queue:
+ * @node: A #UfoGpuNode
+ *
+ * Get the command queue of @node that is used for host to device transfers.
+ *
+ * Returns: (transfer none): A cl_command_queue object.
+ *
+ * Since: 0.8
+ */
+gpointer
+ufo_gpu_node_get_upload_queue (UfoGpuNode *node)
+{
+    g_return_val_if_fail (UFO_IS_GPU_NODE (node), NULL);
+    return get_queue_set (node->priv)->upload;
+}
+
+/**
+ * ufo_gpu_node_get_download_queue:
+ * @node: A #UfoGpuNode
+ *
+ * Get the command queue of @node that is used for device to host transfers.
+ *
+ * Returns: (transfer none): A cl_command_queue object.
+ *
+ * Since: 0.8
+ */
+gpointer
+ufo_gpu_node_get_download_queue (UfoGpuNode *node)
+{
+    g_return_val_if_fail (UFO_IS_GPU_NODE (node), NULL);
+    return get_queue_set (node->priv)->download;
+}
+
+/**
+ * ufo_gpu_node_set_profiling:
+ * @node: A #UfoGpuNode
+ * @enable: %TRUE if commands should be profiled
+ *
+ * Switch @node to command queues with or without profiling support. Profiling
+ * adds overhead to each command and should only be enabled for tracing. This
+ * must not be called while tasks are running, because tasks keep using the
+ * queues they were assigned.
+ *
+ * Since: 0.8
+ */
+void
+ufo_gpu_node_set_profiling (UfoGpuNode *node,
+                            gboolean enable)
+{
+    UfoGpuNodePrivate *priv;
+
+    g_return_if_fail (UFO_IS_GPU_NODE (node));
+    priv = node->priv;
+
+    /* keep the other set alive, buffers may still reference its queues */
+    if (priv->queues[enable ? 1 : 0] == NULL)
+        priv->queues[enable ? 1 : 0] = queue_set_new (priv->context, priv->device, enable, priv->n_compute);
+
+    priv->profiling = enable;
+}
+
+/**
+ * ufo_gpu_node_get_profiling:
+ * @node: A #UfoGpuNode
+ *
+ * Check if the command queues of @node profile their commands.
+ *
+ * Returns: %TRUE if profiling is enabled.
+ *
+ * Since: 0.8
+ */
+gboolean
+ufo_gpu_node_get_profiling (UfoGpuNode *node)
+{
+    g_return_val_if_fail (UFO_IS_GPU_NODE (node), FALSE);
+    return node->priv->profiling;
+}
+
+/*
+ * Find the upload queue of the node that owns @cmd_queue. Returns %NULL if
+ * @cmd_queue does not belong to any node.
+ */
+gpointer
+ufo_gpu_node_lookup_upload_queue (gpointer cmd_queue)
+{
+    QueueSet *set = lookup_queue_set (cmd_queue);
+    return set != NULL ? set->upload : NULL;
+}
+
+/*
+ * Find the download queue of the node that owns @cmd_queue. Returns %NULL if
+ * @cmd_queue does not belong to any node.
+ */
+gpointer
+ufo_gpu_node_lookup_download_queue (gpointer cmd_queue)
+{
+    QueueSet *set = lookup_queue_set (cmd_queue);
+    return set != NULL ? set->download : NULL;
 }
 
 /**
@@ -101,20 +407,46 @@ ufo_gpu_node_get_info (UfoGpuNode *node,
         case UFO_GPU_NODE_INFO_LOCAL_MEM_SIZE:
             UFO_RESOURCES_CHECK_CLERR (clGetDeviceInfo (priv->device, CL_DEVICE_LOCAL_MEM_SIZE, sizeof (cl_ulong), &ulong_value, NULL));
             break;
+
+        case UFO_GPU_NODE_INFO_DEVICE_TYPE:
+            UFO_RESOURCES_CHECK_CLERR (clGetDeviceInfo (priv->device, CL_DEVICE_TYPE, sizeof (cl_ulong), &ulong_value, NULL));
+            break;
     }
 
     g_value_set_ulong (value, ulong_value);
     return value;
 }
 
+/*
+ * CPU devices are slower than the GPUs next to them and only take work that
+ * the GPUs cannot keep up with.
+ */
+gboolean
+ufo_gpu_node_is_cpu_device (UfoGpuNode *node)
+{
+    cl_device_type type;
+
+    g_return_val_if_fail (UFO_IS_GPU_NODE (node), FALSE);
+    UFO_RESOURCES_CHECK_CLERR (clGetDeviceInfo (node->priv->device, CL_DEVICE_TYPE,
+                                                sizeof (cl_device_type), &type, NULL));
+    return (type & CL_DEVICE_TYPE_CPU) != 0;
+}
+
 static UfoNode *
 ufo_gpu_node_copy_real (UfoNode *node,
                         GError **error)
 {
     UfoGpuNode *orig;
+    UfoNode *copy;
 
     orig = UFO_GPU_NODE (node);
-    return ufo_gpu_node_new (orig->priv->context, orig->priv->device);
+    copy = ufo_gpu_node_new (orig->priv->context, orig->priv->device);
+    g_object_set (copy, "num-compute-queues", orig->priv->n_compute, NULL);
+
+    if (orig->priv->profiling)
+        ufo_gpu_node_set_profiling (UFO_GPU_NODE (copy), TRUE);
+
+    return copy;
 }
 
 static gboolean
@@ -122,7 +454,7 @@ ufo_gpu_node_equal_real (UfoNode *n1,
                          UfoNode *n2)
 {
     g_return_val_if_fail (UFO_IS_GPU_NODE (n1) && UFO_IS_GPU_NODE (n2), FALSE);
-    return UFO_GPU_NODE (n1)->priv->cmd_queue == UFO_GPU_NODE (n2)->priv->cmd_queue;
+    return UFO_GPU_NODE (n1)->priv->queues[0] == UFO_GPU_NODE (n2)->priv->queues[0];
 }
 
 static void
@@ -132,10 +464,13 @@ ufo_gpu_node_finalize (GObject *object)
 
     priv = UFO_GPU_NODE_GET_PRIVATE (object);
 
-    if (priv->cmd_queue != NULL) {
-        g_debug ("Release cmd_queue=%p", (gpointer) priv->cmd_queue);
-        UFO_RESOURCES_CHECK_CLERR (clReleaseCommandQueue (priv->cmd_queue));
-        priv->cmd_queue = NULL;
+    if (priv->queues[0] != NULL) {
+        for (guint i = 0; i < 2; i++) {
+            if (priv->queues[i] != NULL) {
+                queue_set_free (priv->queues[i]);
+                priv->queues[i] = NULL;
+            }
+        }
 
         UFO_RESOURCES_CHECK_CLERR (clReleaseContext (priv->context));
     }
@@ -143,6 +478,48 @@ ufo_gpu_node_finalize (GObject *object)
     G_OBJECT_CLASS (ufo_gpu_node_parent_class)->finalize (object);
 }
 
+static void
+ufo_gpu_node_set_property (GObject *object,
+                           guint property_id,
+                           const GValue *value,
+                           GParamSpec *pspec)
+{
+    UfoGpuNodePrivate *priv = UFO_GPU_NODE_GET_PRIVATE (object);
+
+    switch (property_id) {
+        case PROP_NUM_COMPUTE_QUEUES:
+            priv->n_compute = g_value_get_uint (value);
+
+            /* queues of a smaller number are kept, buffers may reference them */
+            for (guint i = 0; i < 2; i++) {
+                if (priv->queues[i] != NULL)
+                    queue_set_add_compute (priv->queues[i], priv->context, priv->device, priv->n_compute);
+            }
+            break;
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+            break;
+    }
+}
+
+static void
+ufo_gpu_node_get_property (GObject *object,
+                           guint property_id,
+                           GValue *value,
+                           GParamSpec *pspec)
+{
+    UfoGpuNodePrivate *priv = UFO_GPU_NODE_GET_PRIVATE (object);
+
+    switch (property_id) {
+        case PROP_NUM_COMPUTE_QUEUES:
+            g_value_set_uint (value, priv->n_compute);
+            break;
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+            break;
+    }
+}
+
 static void
 ufo_gpu_node_class_init (UfoGpuNodeClass *klass)
 {
@@ -150,9 +527,30 @@ ufo_gpu_node_class_init (UfoGpuNodeClass *klass)
     UfoNodeClass *node_class = UFO_NODE_CLASS (klass);
 
     oclass->finalize = ufo_gpu_node_finalize;
+    oclass->set_property = ufo_gpu_node_set_property;
+    oclass->get_property = ufo_gpu_node_get_property;
     node_class->copy = ufo_gpu_node_copy_real;
     node_class->equal = ufo_gpu_node_equal_real;
 
+    /**
+     * UfoGpuNode:num-compute-queues:
+     *
+     * Number of compute command queues that tasks running on this node are
+     * spread over. More queues let kernels of independent tasks overlap,
+     * which only pays off if the device can execute them concurrently.
+     *
+     * Since: 0.8
+     */
+    properties[PROP_NUM_COMPUTE_QUEUES] =
+        g_param_spec_uint ("num-compute-queues",
+                           "Number of compute queues",
+                           "Number of compute queues",
+                           1, MAX_N_COMPUTE_QUEUES, DEFAULT_N_COMPUTE_QUEUES,
+                           G_PARAM_READWRITE);
+
+    for (guint i = PROP_0 + 1; i < N_PROPERTIES; i++)
+        g_object_class_install_property (oclass, i, properties[i]);
+
     g_type_class_add_private (klass, sizeof (UfoGpuNodePrivate));
 }
 
@@ -161,5 +559,8 @@ ufo_gpu_node_init (UfoGpuNode *self)
 {
     UfoGpuNodePrivate *priv;
     self->priv = priv = UFO_GPU_NODE_GET_PRIVATE (self);
-    priv->cmd_queue = NULL;
+    priv->queues[0] = NULL;
+    priv->queues[1] = NULL;
+    priv->profiling = FALSE;
+    priv->n_compute = DEFAULT_N_COMPUTE_QUEUES;
 }
@@ -66,18 +66,36 @@ struct _UfoGpuNodeClass {
  * UfoGpuNodeInfo:
  * @UFO_GPU_NODE_INFO_GLOBAL_MEM_SIZE: Global memory size
  * @UFO_GPU_NODE_INFO_LOCAL_MEM_SIZE: Local memory size
+ * @UFO_GPU_NODE_INFO_DEVICE_TYPE: OpenCL device type bit field
  *
  * OpenCL device info types. Refer to the OpenCL standard for complete details
  * about each information.
  */
 typedef enum {
     UFO_GPU_NODE_INFO_GLOBAL_MEM_SIZE = 0,
-    UFO_GPU_NODE_INFO_LOCAL_MEM_SIZE
+    UFO_GPU_NODE_INFO_LOCAL_MEM_SIZE,
+    UFO_GPU_NODE_INFO_DEVICE_TYPE
 } UfoGpuNodeInfo;
 
 UfoNode  *ufo_gpu_node_new              (gpointer        context,
                                          gpointer        device);
 gpointer  ufo_gpu_node_get_cmd_queue    (UfoGpuNode     *node);
+gpointer  ufo_gpu_node_get_cmd_queue_for
+                                        (UfoGpuNode     *node,
+                                         guint           index);
+gpointer  ufo_gpu_node_get_priority_queue
+                                        (UfoGpuNode     *node);
+gpointer  ufo_gpu_node_get_compute_queue
+                                        (UfoGpuNode     *node,
+                                         guint           index);
+guint     ufo_gpu_node_get_num_compute_queues
+                                        (UfoGpuNode     *node);
+gpointer  ufo_gpu_node_get_upload_queue (UfoGpuNode     *node);
+gpointer  ufo_gpu_node_get_download_queue
+                                        (UfoGpuNode     *node);
+void      ufo_gpu_node_set_profiling    (UfoGpuNode     *node,
+                                         gboolean        enable);
+gboolean  ufo_gpu_node_get_profiling    (UfoGpuNode     *node);
 GValue   *ufo_gpu_node_get_info         (UfoGpuNode     *node,
                                          UfoGpuNodeInfo  info);
 GType     ufo_gpu_node_get_type         (void);
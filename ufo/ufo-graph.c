@@ -32,10 +32,24 @@ G_DEFINE_TYPE (UfoGraph, ufo_graph, G_TYPE_OBJECT)
 
 #define UFO_GRAPH_GET_PRIVATE(obj) (G_TYPE_INSTANCE_GET_PRIVATE((obj), UFO_TYPE_GRAPH, UfoGraphPrivate))
 
+/*
+ * Edges from and to a node, most recently added first, and the link of the
+ * node in the node queue. A node that ufo_graph_remove_edge() dropped from the
+ * queue keeps its entry as long as edges refer to it.
+ */
+typedef struct {
+    GList *link;
+    GList *inputs;
+    GList *outputs;
+} Adjacency;
+
 struct _UfoGraphPrivate {
-    GList *nodes;
-    GList *edges;
+    GQueue *nodes;
+    GQueue *edges;
     GList *copies;
+    GHashTable *adjacency;      /* maps UfoNode to Adjacency */
+    GHashTable *edge_index;     /* maps source and target to the first edge */
+    GHashTable *edge_links;     /* maps UfoEdge to its link in edges */
 };
 
 enum {
@@ -43,11 +57,7 @@ enum {
     N_PROPERTIES
 };
 
-static gint cmp_edge (gconstpointer a, gconstpointer b);
-static gint cmp_edge_source (gconstpointer a, gconstpointer b);
-static gint cmp_edge_target (gconstpointer a, gconstpointer b);
-static UfoEdge *find_edge (GList *edges, UfoNode *source, UfoNode *target);
-static GList *g_list_find_all_data (GList *list, gconstpointer data, GCompareFunc func);
+static UfoEdge *find_edge (UfoGraphPrivate *priv, UfoNode *source, UfoNode *target);
 
 /**
  * ufo_graph_new:
@@ -82,20 +92,147 @@ ufo_graph_is_connected (UfoGraph *graph,
 
     g_return_val_if_fail (UFO_IS_GRAPH (graph), FALSE);
     priv = graph->priv;
-    edge = find_edge (priv->edges, from, to);
+    edge = find_edge (priv, from, to);
     return edge != NULL;
 }
 
+static void
+free_adjacency (Adjacency *adjacency)
+{
+    g_list_free (adjacency->inputs);
+    g_list_free (adjacency->outputs);
+    g_free (adjacency);
+}
+
+static Adjacency *
+lookup_adjacency (UfoGraphPrivate *priv,
+                  UfoNode *node)
+{
+    Adjacency *adjacency;
+
+    adjacency = g_hash_table_lookup (priv->adjacency, node);
+
+    if (adjacency == NULL) {
+        adjacency = g_new0 (Adjacency, 1);
+        g_hash_table_insert (priv->adjacency, node, adjacency);
+    }
+
+    return adjacency;
+}
+
+static void
+release_adjacency (UfoGraphPrivate *priv,
+                   UfoNode *node,
+                   Adjacency *adjacency)
+{
+    if (adjacency->link == NULL && adjacency->inputs == NULL && adjacency->outputs == NULL)
+        g_hash_table_remove (priv->adjacency, node);
+}
+
+static gboolean
+contains_node (UfoGraphPrivate *priv,
+               UfoNode *node)
+{
+    Adjacency *adjacency;
+
+    adjacency = g_hash_table_lookup (priv->adjacency, node);
+    return adjacency != NULL && adjacency->link != NULL;
+}
+
 static void
 add_node_if_not_found (UfoGraphPrivate *priv,
                        UfoNode *node)
 {
-    if (!g_list_find (priv->nodes, node)) {
-        priv->nodes = g_list_append (priv->nodes, node);
+    Adjacency *adjacency;
+
+    adjacency = lookup_adjacency (priv, node);
+
+    if (adjacency->link == NULL) {
+        g_queue_push_tail (priv->nodes, node);
+        adjacency->link = g_queue_peek_tail_link (priv->nodes);
         g_object_ref (node);
     }
 }
 
+/* Drop @node from the node queue but keep the edges that refer to it */
+static gboolean
+unlink_node (UfoGraphPrivate *priv,
+             UfoNode *node)
+{
+    Adjacency *adjacency;
+
+    adjacency = g_hash_table_lookup (priv->adjacency, node);
+
+    if (adjacency == NULL || adjacency->link == NULL)
+        return FALSE;
+
+    g_queue_delete_link (priv->nodes, adjacency->link);
+    adjacency->link = NULL;
+    release_adjacency (priv, node, adjacency);
+    return TRUE;
+}
+
+static void
+add_edge (UfoGraphPrivate *priv,
+          UfoEdge *edge)
+{
+    Adjacency *source;
+    Adjacency *target;
+
+    g_queue_push_tail (priv->edges, edge);
+    g_hash_table_insert (priv->edge_links, edge, g_queue_peek_tail_link (priv->edges));
+
+    /* Like a linear search, lookups find the first edge between two nodes */
+    if (g_hash_table_lookup (priv->edge_index, edge) == NULL)
+        g_hash_table_insert (priv->edge_index, edge, edge);
+
+    source = lookup_adjacency (priv, edge->source);
+    source->outputs = g_list_prepend (source->outputs, edge);
+
+    target = lookup_adjacency (priv, edge->target);
+    target->inputs = g_list_prepend (target->inputs, edge);
+}
+
+static void
+remove_edge (UfoGraphPrivate *priv,
+             UfoEdge *edge)
+{
+    Adjacency *source;
+    Adjacency *target;
+
+    source = g_hash_table_lookup (priv->adjacency, edge->source);
+    target = g_hash_table_lookup (priv->adjacency, edge->target);
+    source->outputs = g_list_remove (source->outputs, edge);
+    target->inputs = g_list_remove (target->inputs, edge);
+
+    if (g_hash_table_lookup (priv->edge_index, edge) == edge) {
+        UfoEdge *oldest = NULL;
+        GList *it;
+
+        g_hash_table_remove (priv->edge_index, edge);
+
+        g_list_for (source->outputs, it) {
+            UfoEdge *other = (UfoEdge *) it->data;
+
+            if (other->target == edge->target)
+                oldest = other;
+        }
+
+        if (oldest != NULL)
+            g_hash_table_insert (priv->edge_index, oldest, oldest);
+    }
+
+    g_queue_delete_link (priv->edges, g_hash_table_lookup (priv->edge_links, edge));
+    g_hash_table_remove (priv->edge_links, edge);
+
+    release_adjacency (priv, edge->source, source);
+
+    if (edge->target != edge->source)
+        release_adjacency (priv, edge->target, target);
+
+    g_free (edge);
+}
+
 /**
  * ufo_graph_connect_nodes:
  * @graph: A #UfoGraph
@@ -128,8 +265,7 @@ ufo_graph_connect_nodes (UfoGraph *graph,
     edge->target = target;
     edge->label = label;
 
-    priv->edges = g_list_append (priv->edges, edge);
-
+    add_edge (priv, edge);
     add_node_if_not_found (priv, source);
     add_node_if_not_found (priv, target);
 }
@@ -146,7 +282,7 @@ guint
 ufo_graph_get_num_nodes (UfoGraph *graph)
 {
     g_return_val_if_fail (UFO_IS_GRAPH (graph), 0);
-    return g_list_length (graph->priv->nodes);
+    return g_queue_get_length (graph->priv->nodes);
 }
 
 /**
@@ -161,7 +297,7 @@ guint
 ufo_graph_get_num_edges (UfoGraph *graph)
 {
     g_return_val_if_fail (UFO_IS_GRAPH (graph), 0);
-    return g_list_length (graph->priv->edges);
+    return g_queue_get_length (graph->priv->edges);
 }
 
 /**
@@ -177,7 +313,7 @@ GList *
 ufo_graph_get_edges (UfoGraph *graph)
 {
     g_return_val_if_fail (UFO_IS_GRAPH (graph), NULL);
-    return g_list_copy (graph->priv->edges);
+    return g_list_copy (graph->priv->edges->head);
 }
 
 /**
@@ -191,7 +327,7 @@ GList *
 ufo_graph_get_nodes (UfoGraph *graph)
 {
     g_return_val_if_fail (UFO_IS_GRAPH (graph), NULL);
-    return g_list_copy (graph->priv->nodes);
+    return g_list_copy (graph->priv->nodes->head);
 }
 
 /**
@@ -217,14 +353,14 @@ ufo_graph_get_nodes_filtered (UfoGraph *graph,
     g_return_val_if_fail (UFO_IS_GRAPH (graph), NULL);
     priv = graph->priv;
 
-    g_list_for (priv->nodes, it) {
+    g_list_for (priv->nodes->head, it) {
         UfoNode *node = UFO_NODE (it->data);
 
         if (func (node, user_data)) 
-            result = g_list_append (result, node);
+            result = g_list_prepend (result, node);
     }
 
-    return result;
+    return g_list_reverse (result);
 }
 
 /**
@@ -245,17 +381,56 @@ ufo_graph_remove_edge (UfoGraph *graph,
 
     g_return_if_fail (UFO_IS_GRAPH (graph));
     priv = graph->priv;
-    edge = find_edge (priv->edges, source, target);
+    edge = find_edge (priv, source, target);
 
     if (edge != NULL) {
-        priv->nodes = g_list_remove (priv->nodes, source);
+        unlink_node (priv, source);
         g_object_unref (source);
 
-        priv->nodes = g_list_remove (priv->nodes, target);
+        unlink_node (priv, target);
         g_object_unref (target);
 
-        priv->edges = g_list_remove (priv->edges, edge);
+        remove_edge (priv, edge);
+    }
+}
+
+/**
+ * ufo_graph_remove_node:
+ * @graph: A #UfoGraph
+ * @node: A node of @graph
+ *
+ * Remove @node and all edges from and to it. Unlike ufo_graph_remove_edge(),
+ * this leaves the neighbours of @node in @graph.
+ *
+ * Since: 0.8
+ */
+void
+ufo_graph_remove_node (UfoGraph *graph,
+                       UfoNode *node)
+{
+    UfoGraphPrivate *priv;
+    Adjacency *adjacency;
+
+    g_return_if_fail (UFO_IS_GRAPH (graph));
+    priv = graph->priv;
+    adjacency = g_hash_table_lookup (priv->adjacency, node);
+
+    if (adjacency == NULL)
+        return;
+
+    while (adjacency->inputs != NULL || adjacency->outputs != NULL) {
+        if (adjacency->inputs != NULL)
+            remove_edge (priv, (UfoEdge *) adjacency->inputs->data);
+        else
+            remove_edge (priv, (UfoEdge *) adjacency->outputs->data);
+
+        adjacency = lookup_adjacency (priv, node);
     }
+
+    if (unlink_node (priv, node))
+        g_object_unref (node);
+    else
+        release_adjacency (priv, node, adjacency);
 }
 
 /**
@@ -278,7 +453,7 @@ ufo_graph_get_edge_label (UfoGraph *graph,
 
     g_return_val_if_fail (UFO_IS_GRAPH (graph), NULL);
     priv = graph->priv;
-    edge = find_edge (priv->edges, source, target);
+    edge = find_edge (priv, source, target);
 
     if (edge != NULL)
         return edge->label;
@@ -291,12 +466,13 @@ static gboolean
 has_no_predecessor (UfoNode *node,
                     UfoGraph *graph)
 {
+    Adjacency *adjacency;
     GList *it;
 
-    g_list_for (graph->priv->nodes, it) {
-        UfoNode *source = (UfoNode *) it->data;
+    adjacency = g_hash_table_lookup (graph->priv->adjacency, node);
 
-        if (ufo_graph_is_connected (graph, source, node))
+    g_list_for (adjacency->inputs, it) {
+        if (contains_node (graph->priv, ((UfoEdge *) it->data)->source))
             return FALSE;
     }
 
@@ -323,12 +499,13 @@ static gboolean
 has_no_successor (UfoNode *node,
                   UfoGraph *graph)
 {
+    Adjacency *adjacency;
     GList *it;
 
-    g_list_for (graph->priv->nodes, it) {
-        UfoNode *target = (UfoNode *) it->data;
+    adjacency = g_hash_table_lookup (graph->priv->adjacency, node);
 
-        if (ufo_graph_is_connected (graph, node, target))
+    g_list_for (adjacency->outputs, it) {
+        if (contains_node (graph->priv, ((UfoEdge *) it->data)->target))
             return FALSE;
     }
 
@@ -352,23 +529,23 @@ ufo_graph_get_leaves (UfoGraph *graph)
 }
 
 static GList *
-get_target_edges (GList *edges,
+get_target_edges (UfoGraphPrivate *priv,
                   UfoNode *target)
 {
-    UfoEdge match;
+    Adjacency *adjacency;
 
-    match.target = target;
-    return g_list_find_all_data (edges, &match, cmp_edge_target);
+    adjacency = g_hash_table_lookup (priv->adjacency, target);
+    return adjacency != NULL ? adjacency->inputs : NULL;
 }
 
 static GList *
-get_source_edges (GList *edges,
+get_source_edges (UfoGraphPrivate *priv,
                   UfoNode *source)
 {
-    UfoEdge match;
+    Adjacency *adjacency;
 
-    match.source = source;
-    return g_list_find_all_data (edges, &match, cmp_edge_source);
+    adjacency = g_hash_table_lookup (priv->adjacency, source);
+    return adjacency != NULL ? adjacency->outputs : NULL;
 }
 
 /**
@@ -392,7 +569,7 @@ ufo_graph_get_predecessors (UfoGraph *graph,
 
     g_return_val_if_fail (UFO_IS_GRAPH (graph), NULL);
     priv = graph->priv;
-    edges = get_target_edges (priv->edges, node);
+    edges = get_target_edges (priv, node);
     result = NULL;
 
     g_list_for (edges, it) {
@@ -400,7 +577,6 @@ ufo_graph_get_predecessors (UfoGraph *graph,
         result = g_list_prepend (result, edge->source);
     }
 
-    g_list_free (edges);
     return result;
 }
 
@@ -409,15 +585,10 @@ ufo_graph_get_num_predecessors (UfoGraph *graph,
                                 UfoNode *node)
 {
     UfoGraphPrivate *priv;
-    GList *edges;
-    guint n_predecessors;
 
     g_return_val_if_fail (UFO_IS_GRAPH (graph), 0);
     priv = graph->priv;
-    edges = get_target_edges (priv->edges, node);
-    n_predecessors = g_list_length (edges);
-    g_list_free (edges);
-    return n_predecessors;
+    return g_list_length (get_target_edges (priv, node));
 }
 
 /**
@@ -441,16 +612,16 @@ ufo_graph_get_successors (UfoGraph *graph,
 
     g_return_val_if_fail (UFO_IS_GRAPH (graph), NULL);
     priv = graph->priv;
-    edges = get_source_edges (priv->edges, node);
+    edges = get_source_edges (priv, node);
     result = NULL;
 
+    /* Most recently connected successors come first */
     g_list_for (edges, it) {
         UfoEdge *edge = (UfoEdge *) it->data;
-        result = g_list_append (result, edge->target);
+        result = g_list_prepend (result, edge->target);
     }
 
-    g_list_free (edges);
-    return result;
+    return g_list_reverse (result);
 }
 
 guint
@@ -458,15 +629,10 @@ ufo_graph_get_num_successors (UfoGraph *graph,
                               UfoNode *node)
 {
     UfoGraphPrivate *priv;
-    GList *edges;
-    guint n_successors;
 
     g_return_val_if_fail (UFO_IS_GRAPH (graph), 0);
     priv = graph->priv;
-    edges = get_source_edges (priv->edges, node);
-    n_successors = g_list_length (edges);
-    g_list_free (edges);
-    return n_successors;
+    return g_list_length (get_source_edges (priv, node));
 }
 
 static void
@@ -686,8 +852,10 @@ append_level (UfoGraph *graph,
 {
     GList *it;
     GList *next_level = NULL;
+    GHashTable *seen;
 
     result = g_list_append (result, current_level);
+    seen = g_hash_table_new (g_direct_hash, g_direct_equal);
 
     g_list_for (current_level, it) {
         GList *successors;
@@ -702,14 +870,22 @@ append_level (UfoGraph *graph,
 
             succ = UFO_NODE (jt->data);
 
-            if (g_list_find (next_level, succ) == NULL)
-                next_level = g_list_append (next_level, succ);
+            if (g_hash_table_lookup (seen, succ) == NULL) {
+                g_hash_table_insert (seen, succ, succ);
+                next_level = g_list_prepend (next_level, succ);
+            }
         }
+
+        g_list_free (successors);
     }
 
+    g_hash_table_destroy (seen);
+
     if (next_level == NULL)
         return result;
 
+    next_level = g_list_reverse (next_level);
+
     return append_level (graph, next_level, result);
 }
 
@@ -731,13 +907,87 @@ ufo_graph_flatten (UfoGraph *graph)
     return append_level (graph, roots, result);
 }
 
+/*
+ * Connect the predecessors of @orig that are not on the expanded path to its
+ * @copy. A chain of single-input nodes branching off a node that has already
+ * been copied is copied as well, so that both inputs of @copy see the same
+ * items. Any other predecessor is shared by @orig and all of its copies.
+ */
+static void
+connect_side_inputs (UfoGraph *graph,
+                     UfoNode *orig,
+                     UfoNode *path_predecessor,
+                     UfoNode *copy,
+                     GHashTable *copies)
+{
+    GList *predecessors;
+    GList *it;
+    GError *error = NULL;
+
+    predecessors = ufo_graph_get_predecessors (graph, orig);
+
+    g_list_for (predecessors, it) {
+        UfoNode *source;
+        UfoNode *root;
+        UfoNode *from;
+        GList *chain = NULL;
+        GList *jt;
+
+        source = UFO_NODE (it->data);
+
+        if (source == path_predecessor)
+            continue;
+
+        root = source;
+
+        while (g_hash_table_lookup (copies, root) == NULL &&
+               ufo_graph_get_num_predecessors (graph, root) == 1 &&
+               ufo_graph_get_num_successors (graph, root) == 1) {
+            GList *sources;
+
+            chain = g_list_prepend (chain, root);
+            sources = ufo_graph_get_predecessors (graph, root);
+            root = UFO_NODE (sources->data);
+            g_list_free (sources);
+        }
+
+        from = g_hash_table_lookup (copies, root);
+
+        if (from != NULL) {
+            UfoNode *prev = root;
+
+            g_list_for (chain, jt) {
+                UfoNode *node_copy;
+
+                node_copy = ufo_node_copy (UFO_NODE (jt->data), &error);
+                ufo_graph_connect_nodes (graph, from, node_copy,
+                                         ufo_graph_get_edge_label (graph, prev, UFO_NODE (jt->data)));
+                graph->priv->copies = g_list_prepend (graph->priv->copies, node_copy);
+                from = node_copy;
+                prev = UFO_NODE (jt->data);
+            }
+        }
+        else {
+            from = source;
+        }
+
+        ufo_graph_connect_nodes (graph, from, copy,
+                                 ufo_graph_get_edge_label (graph, source, orig));
+        g_list_free (chain);
+    }
+
+    g_list_free (predecessors);
+}
+
 /**
  * ufo_graph_expand:
  * @graph: A #UfoGraph
  * @path: (element-type UfoNode): A path of nodes.
  *
  * Duplicate nodes between head and tail of path and insert at the exact the
- * position of where path started and ended.
+ * position of where path started and ended. If a node on the path has further
+ * predecessors, they are connected to its copy as well. Chains of single-input
+ * nodes that branch off the path are duplicated along with it.
  */
 void
 ufo_graph_expand (UfoGraph *graph,
@@ -747,6 +997,7 @@ ufo_graph_expand (UfoGraph *graph,
     GList *tail;
     UfoNode *orig;
     UfoNode *current;
+    GHashTable *copies;
     GError *error = NULL;
 
     g_return_if_fail (UFO_IS_GRAPH (graph));
@@ -762,6 +1013,10 @@ ufo_graph_expand (UfoGraph *graph,
     /* The first link goes from the original head */
     current = orig;
 
+    /* Maps each node of the path to the node that replaces it in the copy */
+    copies = g_hash_table_new (g_direct_hash, g_direct_equal);
+    g_hash_table_insert (copies, orig, orig);
+
     /*
      * Fix for #33: In case we duplicate a single node we have to reference the
      * to-be-copied object a second time. It is still not clear _why_ it is
@@ -777,24 +1032,16 @@ ufo_graph_expand (UfoGraph *graph,
         gpointer label;
 
         next = UFO_NODE (it->data);
+        copy = ufo_node_copy (next, &error);
+        label = ufo_graph_get_edge_label (graph, orig, next);
+        ufo_graph_connect_nodes (graph, current, copy, label);
+        graph->priv->copies = g_list_prepend (graph->priv->copies, copy);
 
-        /*
-         * Do not copy node if it has more than one input because input data
-         * cannot be reliably associated
-         */
-        if (ufo_graph_get_num_predecessors (graph, next) <= 1) {
-            copy = ufo_node_copy (next, &error);
-            label = ufo_graph_get_edge_label (graph, orig, next);
-            ufo_graph_connect_nodes (graph, current, copy, label);
-            graph->priv->copies = g_list_append (graph->priv->copies, copy);
-            current = copy;
-        }
-        else {
-            label = ufo_graph_get_edge_label (graph, orig, next);
-            ufo_graph_connect_nodes (graph, current, next, label);
-            current = next;
-        }
+        if (ufo_graph_get_num_predecessors (graph, next) > 1)
+            connect_side_inputs (graph, next, orig, copy, copies);
 
+        g_hash_table_insert (copies, next, copy);
+        current = copy;
         orig = next;
     }
 
@@ -802,6 +1049,8 @@ ufo_graph_expand (UfoGraph *graph,
         ufo_graph_connect_nodes (graph, current, UFO_NODE (tail->data),
                                  ufo_graph_get_edge_label (graph, orig, UFO_NODE (tail->data)));
     }
+
+    g_hash_table_destroy (copies);
 }
 
 /**
@@ -821,50 +1070,88 @@ ufo_graph_find_longest_path (UfoGraph *graph,
                              UfoFilterPredicate pred,
                              gpointer user_data)
 {
-    UfoGraph *subgraph;
+    UfoGraphPrivate *priv;
+    GList *nodes;
     GList *it;
     UfoNode *last = NULL;
-    GList *sorted = NULL;
-    GList *no_incoming = NULL;
+    GQueue sorted = G_QUEUE_INIT;
+    GQueue no_incoming = G_QUEUE_INIT;
     GList *result = NULL;
+    GHashTable *degrees;
+    GHashTable *connected;
     GHashTable *lengths;
 
-    subgraph = ufo_graph_shallow_subgraph (graph, pred, user_data);
-    no_incoming = ufo_graph_get_roots (subgraph);
+    g_return_val_if_fail (UFO_IS_GRAPH (graph), NULL);
+    priv = graph->priv;
+    nodes = ufo_graph_get_nodes_filtered (graph, pred, user_data);
+
+    /*
+     * Count the edges between nodes that satisfy @pred. The in-degree is
+     * stored off by one to tell members from other nodes, members without any
+     * such edge are not part of a path.
+     */
+    degrees = g_hash_table_new (g_direct_hash, g_direct_equal);
+    connected = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+    g_list_for (nodes, it)
+        g_hash_table_insert (degrees, it->data, GUINT_TO_POINTER (1));
+
+    g_list_for (nodes, it) {
+        GList *jt;
+
+        g_list_for (get_source_edges (priv, UFO_NODE (it->data)), jt) {
+            UfoEdge *edge = (UfoEdge *) jt->data;
+            guint degree;
+
+            degree = GPOINTER_TO_UINT (g_hash_table_lookup (degrees, edge->target));
+
+            if (degree > 0) {
+                g_hash_table_insert (degrees, edge->target, GUINT_TO_POINTER (degree + 1));
+                g_hash_table_insert (connected, edge->source, edge->source);
+                g_hash_table_insert (connected, edge->target, edge->target);
+            }
+        }
+    }
 
     /* Topologically sort, see Kahn (1962) */
 
-    while (g_list_length (no_incoming) > 0) {
+    g_list_for (nodes, it) {
+        if (g_hash_table_lookup (connected, it->data) != NULL &&
+            GPOINTER_TO_UINT (g_hash_table_lookup (degrees, it->data)) == 1)
+            g_queue_push_tail (&no_incoming, it->data);
+    }
+
+    while (!g_queue_is_empty (&no_incoming)) {
         UfoNode *current;
-        GList *current_link;
-        GList *targets;
         GList *jt;
 
-        current_link = g_list_first (no_incoming);
-        current = UFO_NODE (current_link->data);
-        no_incoming = g_list_delete_link (no_incoming, current_link);
+        current = UFO_NODE (g_queue_pop_head (&no_incoming));
+        g_queue_push_tail (&sorted, current);
 
-        sorted = g_list_append (sorted, current);
-        targets = ufo_graph_get_successors (subgraph, current);
+        g_list_for (get_source_edges (priv, current), jt) {
+            UfoEdge *edge = (UfoEdge *) jt->data;
+            guint degree;
 
-        g_list_for (targets, jt) {
-            UfoNode *target;
+            degree = GPOINTER_TO_UINT (g_hash_table_lookup (degrees, edge->target));
 
-            target = UFO_NODE (jt->data);
-            ufo_graph_remove_edge (subgraph, current, target);
+            if (degree == 0)
+                continue;
 
-            if (ufo_graph_get_num_predecessors (subgraph, target) == 0)
-                no_incoming = g_list_append (no_incoming, target);
-        }
+            g_hash_table_insert (degrees, edge->target, GUINT_TO_POINTER (degree - 1));
 
-        g_list_free (targets);
+            if (degree == 2)
+                g_queue_push_tail (&no_incoming, edge->target);
+        }
     }
 
+    g_hash_table_destroy (connected);
+    g_hash_table_destroy (degrees);
+
     lengths = g_hash_table_new (g_direct_hash, g_direct_equal);
 
     /* Record path lengths for each node */
 
-    g_list_for (sorted, it) {
+    g_list_for (sorted.head, it) {
         UfoNode *current;
         GList *predecessors;
 
@@ -922,24 +1209,14 @@ ufo_graph_find_longest_path (UfoGraph *graph,
         g_list_free (predecessors);
     }
 
-    g_list_free (sorted);
-    g_list_free (no_incoming);
-
-    g_object_unref (subgraph);
+    g_queue_clear (&sorted);
     g_hash_table_destroy (lengths);
 
     /* Last resort: try to find a single node */
-    if (result == NULL) {
-        GList *nodes = NULL;
-
-        nodes = ufo_graph_get_nodes_filtered (graph, pred, user_data);
-
-        if (nodes != NULL) {
-            result = g_list_append (result, g_list_nth_data (nodes, 0));
-            g_list_free (nodes);
-        }
-    }
+    if (result == NULL && nodes != NULL)
+        result = g_list_append (result, nodes->data);
 
+    g_list_free (nodes);
     return result;
 }
 
@@ -989,74 +1266,33 @@ ufo_graph_dump_dot (UfoGraph *graph,
     fclose (fp);
 }
 
-static gint
-cmp_edge (gconstpointer a, gconstpointer b)
+static guint
+edge_hash (gconstpointer key)
 {
-    const UfoEdge *edge_a = a;
-    const UfoEdge *edge_b = b;
-
-    if ((edge_a->source == edge_b->source) &&
-        (edge_a->target == edge_b->target)) {
-        return 0;
-    }
+    const UfoEdge *edge = key;
 
-    return -1;
+    return g_direct_hash (edge->source) * 31 + g_direct_hash (edge->target);
 }
 
-static gint
-cmp_edge_source (gconstpointer a, gconstpointer b)
-{
-    const UfoEdge *edge_a = a;
-    const UfoEdge *edge_b = b;
-
-    if (edge_a->source == edge_b->source)
-        return 0;
-
-    return -1;
-}
-
-static gint
-cmp_edge_target (gconstpointer a, gconstpointer b)
+static gboolean
+edge_equal (gconstpointer a, gconstpointer b)
 {
     const UfoEdge *edge_a = a;
     const UfoEdge *edge_b = b;
 
-    if (edge_a->target == edge_b->target)
-        return 0;
-
-    return -1;
-}
-
-static GList *
-g_list_find_all_data (GList *list,
-                      gconstpointer data,
-                      GCompareFunc func)
-{
-    GList *it;
-    GList *result = NULL;
-
-    g_list_for (list, it) {
-        if (func (data, it->data) == 0)
-            result = g_list_prepend (result, it->data);
-    }
-
-    return result;
+    return edge_a->source == edge_b->source && edge_a->target == edge_b->target;
 }
 
 static UfoEdge *
-find_edge (GList *edges,
+find_edge (UfoGraphPrivate *priv,
            UfoNode *source,
            UfoNode *target)
 {
     UfoEdge search_edge;
-    UfoEdge *edge;
-    GList *result;
 
     search_edge.source = source;
     search_edge.target = target;
-    result = g_list_find_custom (edges, &search_edge, cmp_edge);
-    edge = result != NULL ? g_list_nth_data (result, 0) : NULL;
-    return edge;
+    return g_hash_table_lookup (priv->edge_index, &search_edge);
 }
 
 static void
@@ -1066,17 +1302,15 @@ ufo_graph_dispose (GObject *object)
 
     priv = UFO_GRAPH_GET_PRIVATE (object);
 
-    if (priv->edges != NULL) {
-        g_list_foreach (priv->edges, (GFunc) g_free, NULL);
-        g_list_free (priv->edges);
-        priv->edges = NULL;
-    }
+    g_hash_table_remove_all (priv->edge_index);
+    g_hash_table_remove_all (priv->edge_links);
+    g_hash_table_remove_all (priv->adjacency);
 
-    if (priv->nodes != NULL) {
-        g_list_foreach (priv->nodes, (GFunc) g_object_unref, NULL);
-        g_list_free (priv->nodes);
-        priv->nodes = NULL;
-    }
+    g_queue_foreach (priv->edges, (GFunc) g_free, NULL);
+    g_queue_clear (priv->edges);
+
+    g_queue_foreach (priv->nodes, (GFunc) g_object_unref, NULL);
+    g_queue_clear (priv->nodes);
 
     if (priv->copies != NULL) {
         g_list_foreach (priv->copies, (GFunc) g_object_unref, NULL);
@@ -1090,6 +1324,16 @@ ufo_graph_dispose (GObject *object)
 static void
 ufo_graph_finalize (GObject *object)
 {
+    UfoGraphPrivate *priv;
+
+    priv = UFO_GRAPH_GET_PRIVATE (object);
+
+    g_hash_table_destroy (priv->edge_index);
+    g_hash_table_destroy (priv->edge_links);
+    g_hash_table_destroy (priv->adjacency);
+    g_queue_free (priv->edges);
+    g_queue_free (priv->nodes);
+
     G_OBJECT_CLASS (ufo_graph_parent_class)->finalize (object);
 }
 
@@ -1109,6 +1353,11 @@ ufo_graph_init (UfoGraph *self)
 {
     UfoGraphPrivate *priv;
     self->priv = priv = UFO_GRAPH_GET_PRIVATE (self);
-    priv->nodes = NULL;
+    priv->nodes = g_queue_new ();
+    priv->edges = g_queue_new ();
     priv->copies = NULL;
+    priv->adjacency = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                             NULL, (GDestroyNotify) free_adjacency);
+    priv->edge_index = g_hash_table_new (edge_hash, edge_equal);
+    priv->edge_links = g_hash_table_new (g_direct_hash, g_direct_equal);
 }
@@ -48,6 +48,10 @@
  * Unlike the #UfoLocalScheduler, the #UfoGroupScheduler groups the same node
  * types together and assigns resources in a user-defined fashion. It is not
  * recommended to use this scheduler in production.
+ *
+ * Tasks that use the GPU are copied once per GPU. Each copy of a processor or
+ * sink runs in its own thread and takes the next item from the predecessors,
+ * and results are passed on in the order of their inputs.
  */
 
 G_DEFINE_TYPE (UfoGroupScheduler, ufo_group_scheduler, UFO_TYPE_BASE_SCHEDULER)
@@ -55,19 +59,33 @@ G_DEFINE_TYPE (UfoGroupScheduler, ufo_group_scheduler, UFO_TYPE_BASE_SCHEDULER)
 #define UFO_GROUP_SCHEDULER_GET_PRIVATE(obj) (G_TYPE_INSTANCE_GET_PRIVATE((obj), UFO_TYPE_GROUP_SCHEDULER, UfoGroupSchedulerPrivate))
 
 
+/*
+ * Copies of the same task, one per GPU. Each copy of a processing group runs
+ * in its own worker that pulls items from the parent groups, so that all
+ * devices work at the same time. Outputs are pushed in the order in which the
+ * inputs were popped, which holds back at most one item per worker.
+ */
 typedef struct {
     GList *parents;
     GList *tasks;
     gboolean is_leaf;
     gpointer context;
     UfoTwoWayQueue *queue;
-    enum {
-        TASK_GROUP_ROUND_ROBIN,
-        TASK_GROUP_SHARED,
-        TASK_GROUP_RANDOM
-    } mode;
+    guint depth;                /* buffers requested by the successors */
+    GMutex *input_lock;         /* protects drained and n_popped */
+    gboolean drained;
+    guint64 n_popped;           /* sequence number of the next input */
+    GMutex *output_lock;        /* protects the following fields */
+    GCond *output_cond;
+    guint64 n_pushed;           /* sequence number of the next output */
+    guint n_running;
 } TaskGroup;
 
+typedef struct {
+    TaskGroup *group;
+    UfoTask *task;
+} GroupWorker;
+
 
 enum {
     PROP_0,
@@ -146,6 +164,34 @@ cleanup:
     return success;
 }
 
+/*
+ * Successors share the queue of a group, so it gets the largest depth set on
+ * any outgoing edge. Depths are not tuned by this scheduler.
+ */
+static guint
+get_depth (UfoTaskGraph *graph, UfoNode *task)
+{
+    GList *successors;
+    GList *it;
+    guint depth = 0;
+
+    successors = ufo_graph_get_successors (UFO_GRAPH (graph), task);
+
+    g_list_for (successors, it) {
+        gpointer label;
+        guint edge_depth;
+
+        label = ufo_graph_get_edge_label (UFO_GRAPH (graph), task, UFO_NODE (it->data));
+        edge_depth = ufo_task_node_get_queue_depth (UFO_TASK_NODE (it->data), UFO_EDGE_INPUT (label));
+
+        if (edge_depth != UFO_QUEUE_DEPTH_AUTO)
+            depth = MAX (depth, edge_depth);
+    }
+
+    g_list_free (successors);
+    return depth;
+}
+
 static GHashTable *
 build_task_groups (UfoBaseScheduler *scheduler, UfoTaskGraph *graph, UfoResources *resources, GList *nodes)
 {
@@ -167,13 +213,10 @@ build_task_groups (UfoBaseScheduler *scheduler, UfoTaskGraph *graph, UfoResource
         group->tasks = g_list_append (NULL, it->data);
         group->queue = ufo_two_way_queue_new (NULL);
         group->is_leaf = ufo_graph_get_num_successors (UFO_GRAPH (graph), task) == 0;
-
-        if (ufo_task_get_mode (UFO_TASK (task)) & UFO_TASK_MODE_SHARE_DATA) {
-            group->mode = TASK_GROUP_SHARED;
-        }
-        else {
-            group->mode = TASK_GROUP_ROUND_ROBIN;
-        }
+        group->depth = get_depth (graph, task);
+        group->input_lock = g_mutex_new ();
+        group->output_lock = g_mutex_new ();
+        group->output_cond = g_cond_new ();
 
         node = ufo_node_new (group);
         g_hash_table_insert (tasks_to_groups, it->data, node);
@@ -182,6 +225,20 @@ build_task_groups (UfoBaseScheduler *scheduler, UfoTaskGraph *graph, UfoResource
     return tasks_to_groups;
 }
 
+static void
+free_task_group (TaskGroup *group)
+{
+    /* the first task belongs to the task graph, the others are copies */
+    g_list_foreach (group->tasks->next, (GFunc) g_object_unref, NULL);
+    g_list_free (group->tasks);
+    g_list_free (group->parents);
+    ufo_two_way_queue_free (group->queue);
+    g_mutex_free (group->input_lock);
+    g_mutex_free (group->output_lock);
+    g_cond_free (group->output_cond);
+    g_free (group);
+}
+
 static UfoGraph *
 build_group_graph (UfoBaseScheduler *scheduler, UfoTaskGraph *graph, UfoResources *resources, GError **error)
 {
@@ -225,6 +282,13 @@ build_group_graph (UfoBaseScheduler *scheduler, UfoTaskGraph *graph, UfoResource
     g_hash_table_destroy (tasks_to_groups);
 
     if (!expand_group_graph (resources, result, error)) {
+        nodes = ufo_graph_get_nodes (result);
+
+        g_list_for (nodes, it) {
+            free_task_group (ufo_node_get_label (UFO_NODE (it->data)));
+        }
+
+        g_list_free (nodes);
         g_object_unref (result);
         return NULL;
     }
@@ -232,25 +296,85 @@ build_group_graph (UfoBaseScheduler *scheduler, UfoTaskGraph *graph, UfoResource
     return result;
 }
 
+/*
+ * Parent @ended of @group sent its end-of-stream marker after @inputs were
+ * popped from the parents before it. Give those back and drop everything the
+ * other parents still send, so that they do not wait for free buffers
+ * forever. The marker is pushed again for other groups sharing a queue.
+ */
+static void
+drain_parents (TaskGroup *group, UfoBuffer **inputs, guint ended)
+{
+    GList *it;
+    guint i = 0;
+
+    g_list_for (group->parents, it) {
+        UfoTwoWayQueue *queue;
+        UfoBuffer *input;
+
+        queue = ((TaskGroup *) it->data)->queue;
+
+        if (i < ended)
+            ufo_two_way_queue_consumer_push (queue, inputs[i]);
+
+        if (i != ended) {
+            while ((input = ufo_two_way_queue_consumer_pop (queue)) != POISON_PILL)
+                ufo_two_way_queue_consumer_push (queue, input);
+        }
+
+        ufo_two_way_queue_producer_push (queue, POISON_PILL);
+        i++;
+    }
+}
+
+/*
+ * Pop the next input of each parent for one of the workers of @group. Workers
+ * pop one after another, so that inputs of different parents stay together.
+ */
 static gboolean
-pop_input_data (GList *parents, UfoBuffer **inputs)
+pop_input_data (TaskGroup *group, UfoBuffer **inputs, guint64 *sequence)
 {
     GList *it;
     guint i = 0;
+    gboolean active = TRUE;
 
-    g_list_for (parents, it) {
+    g_mutex_lock (group->input_lock);
+
+    if (group->drained) {
+        g_mutex_unlock (group->input_lock);
+        return FALSE;
+    }
+
+    g_list_for (group->parents, it) {
         UfoTwoWayQueue *queue;
 
         queue = ((TaskGroup *) it->data)->queue;
         inputs[i] = ufo_two_way_queue_consumer_pop (queue);
 
-        if (inputs[i] == POISON_PILL)
-            return FALSE;
+        if (inputs[i] == POISON_PILL) {
+            /* the pill is only sent once, so stop the other workers too */
+            drain_parents (group, inputs, i);
+            group->drained = TRUE;
+            active = FALSE;
+            break;
+        }
 
         i++;
     }
 
-    return TRUE;
+    if (active)
+        *sequence = group->n_popped++;
+
+    g_mutex_unlock (group->input_lock);
+    return active;
+}
+
+static void
+stop_input (TaskGroup *group)
+{
+    g_mutex_lock (group->input_lock);
+    group->drained = TRUE;
+    g_mutex_unlock (group->input_lock);
 }
 
 static void
@@ -267,31 +391,48 @@ release_input_data (GList *parents, UfoBuffer **inputs)
     }
 }
 
-static GList *
-schedule_next (TaskGroup *group, GList *current)
+static UfoBuffer *
+pop_output_buffer (TaskGroup *group, UfoRequisition *requisition)
 {
-    GList *next = NULL;
+    g_mutex_lock (group->output_lock);
 
-    switch (group->mode) {
-        case TASK_GROUP_ROUND_ROBIN:
-            next = g_list_next (current);
+    /*
+     * Insert output buffers as requested, but at least one per worker plus
+     * one, because workers hold their buffer until it is their turn.
+     */
+    if (ufo_two_way_queue_get_capacity (group->queue) < MAX (group->depth, g_list_length (group->tasks) + 1)) {
+        UfoBuffer *buffer;
 
-            if (next == NULL)
-                next = g_list_first (group->tasks);
+        buffer = ufo_buffer_new (requisition, group->context);
+        ufo_two_way_queue_insert (group->queue, buffer);
+    }
 
-            break;
+    g_mutex_unlock (group->output_lock);
+    return ufo_two_way_queue_producer_pop (group->queue);
+}
 
-        case TASK_GROUP_RANDOM:
-            next = g_list_nth (group->tasks,
-                               g_random_int_range (0, g_list_length (group->tasks)));
-            break;
+/*
+ * Wait until the outputs of all earlier inputs are passed on, then pass
+ * @output on if it was @produced or give it back otherwise.
+ */
+static void
+push_output_buffer (TaskGroup *group, UfoBuffer *output, gboolean produced, guint64 sequence)
+{
+    g_mutex_lock (group->output_lock);
 
-        case TASK_GROUP_SHARED:
-            next = g_list_first (group->tasks);
-            break;
+    while (group->n_pushed != sequence)
+        g_cond_wait (group->output_cond, group->output_lock);
+
+    if (output != NULL) {
+        if (produced)
+            ufo_two_way_queue_producer_push (group->queue, output);
+        else
+            ufo_two_way_queue_consumer_push (group->queue, output);
     }
 
-    return next;
+    group->n_pushed++;
+    g_cond_broadcast (group->output_cond);
+    g_mutex_unlock (group->output_lock);
 }
 
 static gboolean
@@ -308,6 +449,7 @@ run_generator_or_processor (UfoTask *task,
 
     switch (mode) {
         case UFO_TASK_MODE_PROCESSOR:
+        case UFO_TASK_MODE_SINK:
             ufo_profiler_trace_event (profiler, UFO_TRACE_EVENT_BEGIN | UFO_TRACE_EVENT_PROCESS);
             active = ufo_task_process (task, inputs, output, requisition);
             ufo_profiler_trace_event (profiler, UFO_TRACE_EVENT_END | UFO_TRACE_EVENT_PROCESS);
@@ -328,78 +470,60 @@ run_generator_or_processor (UfoTask *task,
 }
 
 static GError *
-run_group (TaskGroup *group)
+run_worker (GroupWorker *worker)
 {
+    TaskGroup *group;
     guint n_inputs;
     UfoBuffer **inputs;
     UfoBuffer *output;
     UfoRequisition requisition;
     UfoTask *task;
     UfoTaskMode mode;
-    gboolean shared;
+    UfoProfiler *profiler;
+    gboolean is_static;
     gboolean active = TRUE;
-    GList *current = NULL;  /* current task */
+    guint64 sequence = 0;
 
     /* We should use get_structure to assert constraints ... */
+    group = worker->group;
+    task = worker->task;
     n_inputs = g_list_length (group->parents);
     inputs = g_new0 (UfoBuffer *, n_inputs);
-    task = UFO_TASK (g_list_nth_data (group->tasks, 0));
     mode = ufo_task_get_mode (task) & UFO_TASK_MODE_TYPE_MASK;
-    shared = ufo_task_get_mode (task) & UFO_TASK_MODE_SHARE_DATA;
+    is_static = ufo_task_get_mode (task) & UFO_TASK_MODE_STATIC_REQUISITION;
+    profiler = ufo_task_node_get_profiler (UFO_TASK_NODE (task));
 
     output = NULL;
     requisition.n_dims = 0;
 
     while (active) {
-        UfoProfiler *profiler;
-
         /* Fetch data from parent groups */
-        active = pop_input_data (group->parents, inputs);
+        active = pop_input_data (group, inputs, &sequence);
 
         if (!active)
             break;
 
-        /* Choose next task of the group */
-        current = schedule_next (group, current);
-
-        task = UFO_TASK (current->data);
-        profiler = ufo_task_node_get_profiler (UFO_TASK_NODE (task));
+        /* Ask the task about size requirements */
+        if (is_static)
+            ufo_task_node_lookup_requisition (UFO_TASK_NODE (task), inputs, n_inputs, &requisition);
+        else
+            ufo_task_get_requisition (task, inputs, &requisition);
 
-        /* Ask current task about size requirements */
-        ufo_task_get_requisition (task, inputs, &requisition);
-
-        /* Insert output buffers as longs as capacity is not filled */
-        if (!group->is_leaf) {
-            if (ufo_two_way_queue_get_capacity (group->queue) < 2) {
-                UfoBuffer *buffer;
-
-                buffer = ufo_buffer_new (&requisition, group->context);
-                ufo_two_way_queue_insert (group->queue, buffer);
-            }
-
-            output = ufo_two_way_queue_producer_pop (group->queue);
-        }
+        if (!group->is_leaf)
+            output = pop_output_buffer (group, &requisition);
 
         /* Generate/process the data. Because the functions return active state,
          * we negate it for the finished flag. */
 
         if (mode != UFO_TASK_MODE_REDUCTOR) {
-            if (!shared) {
-                active = run_generator_or_processor (task, mode, &requisition, inputs, output);
-            }
-            else {
-                GList *it;
-
-                g_list_for (group->tasks, it) {
-                    task = UFO_TASK (it->data);
-                    active = run_generator_or_processor (task, mode, &requisition, inputs, output);
-                }
-            }
+            active = run_generator_or_processor (task, mode, &requisition, inputs, output);
 
-            if (output != NULL && active) {
-                ufo_two_way_queue_producer_push (group->queue, output);
-            }
+            if (!active)
+                stop_input (group);
 
+            push_output_buffer (group, output,
+                                active && !ufo_task_node_output_skipped (UFO_TASK_NODE (task)),
+                                sequence);
             release_input_data (group->parents, inputs);
         }
         else {
@@ -410,7 +534,7 @@ run_group (TaskGroup *group)
                 active = ufo_task_process (task, inputs, output, &requisition);
                 ufo_profiler_trace_event (profiler, UFO_TRACE_EVENT_END | UFO_TRACE_EVENT_PROCESS);
                 release_input_data (group->parents, inputs);
-                active = pop_input_data (group->parents, inputs);
+                active = pop_input_data (group, inputs, &sequence);
             } while (active);
 
             /* Generate and forward as long as reductor produces data */
@@ -419,7 +543,8 @@ run_group (TaskGroup *group)
                 active = ufo_task_generate (task, output, &requisition);
                 ufo_profiler_trace_event (profiler, UFO_TRACE_EVENT_END | UFO_TRACE_EVENT_GENERATE);
 
-                if (active) {
+                /* a skipped item keeps its buffer for the next one */
+                if (active && !ufo_task_node_output_skipped (UFO_TASK_NODE (task))) {
                     ufo_two_way_queue_producer_push (group->queue, output);
                     output = ufo_two_way_queue_producer_pop (group->queue);
                 }
@@ -427,12 +552,37 @@ run_group (TaskGroup *group)
         }
     }
 
-    if (!group->is_leaf)
+    g_mutex_lock (group->output_lock);
+    group->n_running--;
+
+    /* the last worker tells the children that the stream ended */
+    if (group->n_running == 0 && !group->is_leaf)
         ufo_two_way_queue_producer_push (group->queue, POISON_PILL);
 
+    g_mutex_unlock (group->output_lock);
+
+    g_free (inputs);
+    g_free (worker);
     return NULL;
 }
 
+/*
+ * Only processors and sinks can work on several items at once, generators and
+ * reductors keep their state in the first copy.
+ */
+static guint
+get_num_workers (TaskGroup *group)
+{
+    UfoTaskMode mode;
+
+    mode = ufo_task_get_mode (UFO_TASK (group->tasks->data)) & UFO_TASK_MODE_TYPE_MASK;
+
+    if (mode == UFO_TASK_MODE_PROCESSOR || mode == UFO_TASK_MODE_SINK)
+        return g_list_length (group->tasks);
+
+    return 1;
+}
+
 static void
 join_threads (GList *threads)
 {
@@ -454,9 +604,11 @@ ufo_group_scheduler_run (UfoBaseScheduler *scheduler,
     GList *groups;
     GList *tasks;
     GList *it;
+    gboolean trace;
 
     g_return_if_fail (UFO_IS_GROUP_SCHEDULER (scheduler));
 
+    g_object_get (scheduler, "enable-tracing", &trace, NULL);
     resources = ufo_base_scheduler_get_resources (scheduler);
     group_graph = build_group_graph (scheduler, task_graph, resources, error);
 
@@ -467,18 +619,17 @@ ufo_group_scheduler_run (UfoBaseScheduler *scheduler,
     threads = NULL;
     tasks = NULL;
 
+    /* Setup all tasks before any worker waits for data */
     g_list_for (groups, it) {
-        GThread *thread;
         GList *jt;
         TaskGroup *group;
 
         group = ufo_node_get_label (UFO_NODE (it->data));
 
-        /* Setup each task in a group */
         g_list_for (group->tasks, jt) {
             UfoTaskNode *task = UFO_TASK_NODE (jt->data);
 
-            ufo_profiler_enable_tracing (ufo_task_node_get_profiler (task), TRUE);
+            ufo_profiler_enable_tracing (ufo_task_node_get_profiler (task), trace);
             ufo_task_setup (UFO_TASK (task), resources, error);
 
             tasks = g_list_append (tasks, task);
@@ -486,10 +637,27 @@ ufo_group_scheduler_run (UfoBaseScheduler *scheduler,
             if (error && *error)
                 goto cleanup_run;
         }
+    }
+
+    g_list_for (groups, it) {
+        TaskGroup *group;
+
+        group = ufo_node_get_label (UFO_NODE (it->data));
+
+        /* Run each copy of this group in its own worker */
+        group->n_running = get_num_workers (group);
 
-        /* Run this group */
-        thread = g_thread_create ((GThreadFunc) run_group, group, TRUE, error);
-        threads = g_list_append (threads, thread);
+        for (guint i = 0; i < group->n_running; i++) {
+            GroupWorker *worker;
+            GThread *thread;
+
+            worker = g_new0 (GroupWorker, 1);
+            worker->group = group;
+            worker->task = UFO_TASK (g_list_nth_data (group->tasks, i));
+
+            thread = g_thread_create ((GThreadFunc) run_worker, worker, TRUE, error);
+            threads = g_list_append (threads, thread);
+        }
     }
 
 #ifdef WITH_PYTHON
@@ -507,10 +675,16 @@ ufo_group_scheduler_run (UfoBaseScheduler *scheduler,
     join_threads (threads);
 #endif
 
-    ufo_write_profile_events (tasks);
-    ufo_write_opencl_events (tasks);
+    if (trace) {
+        ufo_write_profile_events (tasks);
+        ufo_write_opencl_events (tasks);
+    }
 
 cleanup_run:
+    g_list_for (groups, it) {
+        free_task_group (ufo_node_get_label (UFO_NODE (it->data)));
+    }
+
     g_list_free (tasks);
     g_list_free (groups);
 
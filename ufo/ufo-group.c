@@ -21,6 +21,8 @@
 #include <ufo/ufo-group.h>
 #include <ufo/ufo-task-node.h>
 #include <ufo/ufo-two-way-queue.h>
+#include "ufo-priv.h"
+#include "compat.h"
 
 G_DEFINE_TYPE (UfoGroup, ufo_group, G_TYPE_OBJECT)
 
@@ -32,13 +34,47 @@ struct _UfoGroupPrivate {
     UfoTwoWayQueue  **queues;
     gint            *n_expected;
     gint             n_received;
-    gboolean        *ready;
+    gboolean        *fallback;
+    gboolean        *drop_oldest;
     UfoSendPattern   pattern;
     guint            current;
+    guint64          sequence;
     cl_context       context;
     GList           *buffers;
+    guint           *depth;             /* buffers per target */
+    gboolean        *auto_depth;
+    UfoMemoryBudget *budget;
+    gboolean         over_budget;
+
+    /* Dispatch statistics, protected by lock */
+    GMutex          *lock;
+    guint           *n_sent;
+    gint64          *popped_at;
+    gdouble         *service_time;      /* EWMA of seconds per item */
+    gdouble         *busy_time;
+
+    /* Queue wait statistics of auto-tuned targets, protected by lock */
+    guint           *n_tuned;           /* items since the last tuning */
+    gint64          *tuned_at;
+    gdouble         *producer_wait;     /* seconds waited for a buffer */
+    gdouble         *consumer_wait;     /* seconds waited for an item */
 };
 
+/* Fewest buffers per target before allocations exceed the memory budget */
+#define MIN_DEPTH       2
+
+/* Weight of the most recent sample in the service time average */
+#define EWMA_WEIGHT     0.2
+
+/* Items between two depth decisions of an auto-tuned target */
+#define TUNE_PERIOD     16
+
+/* Share of a period both sides must wait before the depth grows */
+#define TUNE_THRESHOLD  0.1
+
+/* Deepest queue that auto-tuning creates */
+#define MAX_AUTO_DEPTH  64
+
 enum {
     PROP_0,
     N_PROPERTIES
@@ -70,13 +106,28 @@ ufo_group_new (GList *targets,
     priv->n_targets = g_list_length (targets);
     priv->queues = g_new0 (UfoTwoWayQueue *, priv->n_targets);
     priv->n_expected = g_new0 (gint, priv->n_targets);
+    priv->fallback = g_new0 (gboolean, priv->n_targets);
+    priv->drop_oldest = g_new0 (gboolean, priv->n_targets);
     priv->pattern = pattern;
     priv->current = 0;
+    priv->sequence = 0;
     priv->context = context;
+    priv->depth = g_new0 (guint, priv->n_targets);
+    priv->auto_depth = g_new0 (gboolean, priv->n_targets);
     priv->n_received = 0;
+    priv->n_sent = g_new0 (guint, priv->n_targets);
+    priv->popped_at = g_new0 (gint64, priv->n_targets);
+    priv->service_time = g_new0 (gdouble, priv->n_targets);
+    priv->busy_time = g_new0 (gdouble, priv->n_targets);
+    priv->n_tuned = g_new0 (guint, priv->n_targets);
+    priv->tuned_at = g_new0 (gint64, priv->n_targets);
+    priv->producer_wait = g_new0 (gdouble, priv->n_targets);
+    priv->consumer_wait = g_new0 (gdouble, priv->n_targets);
 
-    for (guint i = 0; i < priv->n_targets; i++)
+    for (guint i = 0; i < priv->n_targets; i++) {
         priv->queues[i] = ufo_two_way_queue_new (NULL);
+        priv->depth[i] = priv->n_targets + 1;
+    }
 
     return group;
 }
@@ -88,27 +139,459 @@ ufo_group_get_num_targets (UfoGroup *group)
     return group->priv->n_targets;
 }
 
+/*
+ * Buffers remember the queue they were allocated for, so that a buffer which a
+ * task passed on in place of an output goes back to its owner.
+ */
+static GQuark
+get_owner_quark (void)
+{
+    return g_quark_from_static_string ("ufo-group-owner");
+}
+
+static UfoTwoWayQueue *
+get_owner_queue (UfoGroupPrivate *priv,
+                 guint pos,
+                 UfoBuffer *buffer)
+{
+    UfoTwoWayQueue *owner;
+
+    owner = g_object_get_qdata (G_OBJECT (buffer), get_owner_quark ());
+    return owner != NULL ? owner : priv->queues[pos];
+}
+
+static gsize
+get_required_size (UfoRequisition *requisition)
+{
+    gsize size = sizeof (gfloat);
+
+    for (guint i = 0; i < requisition->n_dims; i++)
+        size *= requisition->dims[i];
+
+    return size;
+}
+
+/*
+ * Add a buffer to the queue of target @pos unless it holds all its buffers.
+ * If the memory budget is exhausted, the queue depth is reduced instead, but
+ * not below MIN_DEPTH.
+ */
+static gboolean
+add_buffer (UfoGroupPrivate *priv,
+            guint pos,
+            UfoRequisition *requisition)
+{
+    UfoBuffer *buffer;
+    guint capacity;
+    guint depth;
+
+    /* the depth of auto-tuned targets changes under the lock */
+    g_mutex_lock (priv->lock);
+    depth = priv->depth[pos];
+    g_mutex_unlock (priv->lock);
+
+    capacity = ufo_two_way_queue_get_capacity (priv->queues[pos]);
+
+    if (capacity >= depth)
+        return FALSE;
+
+    if (priv->budget != NULL) {
+        gboolean force = capacity < MIN_DEPTH;
+
+        if (!ufo_memory_budget_reserve (priv->budget, get_required_size (requisition), force)) {
+            if (!force) {
+                g_debug ("Reduce queue depth of target %u from %u to %u to fit memory budget",
+                         pos, depth, capacity);
+                g_mutex_lock (priv->lock);
+                priv->depth[pos] = capacity;
+                priv->auto_depth[pos] = FALSE;
+                g_mutex_unlock (priv->lock);
+                return FALSE;
+            }
+
+            if (!priv->over_budget) {
+                g_warning ("Memory budget of %" G_GSIZE_FORMAT " bytes is too small for %u buffers per target",
+                           ufo_memory_budget_get_limit (priv->budget), MIN_DEPTH);
+                priv->over_budget = TRUE;
+            }
+        }
+    }
+
+    buffer = ufo_buffer_new (requisition, priv->context);
+    g_object_set_qdata (G_OBJECT (buffer), get_owner_quark (), priv->queues[pos]);
+    priv->buffers = g_list_append (priv->buffers, buffer);
+    ufo_two_way_queue_insert (priv->queues[pos], buffer);
+    return TRUE;
+}
+
+/*
+ * Resize @buffer and account the difference in the memory budget. A buffer
+ * must grow even if that exceeds the budget, further buffers are then limited
+ * by add_buffer().
+ */
+static void
+resize_buffer (UfoGroupPrivate *priv,
+               UfoBuffer *buffer,
+               UfoRequisition *requisition)
+{
+    gsize old_size;
+    gsize new_size;
+
+    if (priv->budget != NULL) {
+        old_size = ufo_buffer_get_size (buffer);
+        new_size = get_required_size (requisition);
+
+        if (new_size > old_size) {
+            if (!ufo_memory_budget_reserve (priv->budget, new_size - old_size, TRUE))
+                g_debug ("Resizing a buffer to %" G_GSIZE_FORMAT " bytes exceeds the memory budget", new_size);
+        }
+        else {
+            ufo_memory_budget_release (priv->budget, old_size - new_size);
+        }
+    }
+
+    ufo_buffer_resize (buffer, requisition);
+}
+
+static void
+free_buffers (UfoGroupPrivate *priv)
+{
+    GList *it;
+
+    g_list_for (priv->buffers, it) {
+        if (priv->budget != NULL)
+            ufo_memory_budget_release (priv->budget, ufo_buffer_get_size (UFO_BUFFER (it->data)));
+
+        g_object_unref (it->data);
+    }
+
+    g_list_free (priv->buffers);
+    priv->buffers = NULL;
+}
+
+/*
+ * Deepen the queue of target @pos if it is too shallow for a bursty producer,
+ * i.e. if both the producer waited for free buffers and the target waited for
+ * items during a good share of the last period.
+ */
+static void
+tune_depth (UfoGroupPrivate *priv,
+            guint pos)
+{
+    gint64 now;
+
+    if (!priv->auto_depth[pos])
+        return;
+
+    g_mutex_lock (priv->lock);
+    now = g_get_monotonic_time ();
+
+    if (priv->tuned_at[pos] == 0)
+        priv->tuned_at[pos] = now;
+
+    if (++priv->n_tuned[pos] >= TUNE_PERIOD) {
+        gdouble elapsed;
+
+        elapsed = (now - priv->tuned_at[pos]) / 1e6;
+
+        /* the budget may have fixed the depth since the check above */
+        if (priv->auto_depth[pos] &&
+            priv->producer_wait[pos] > TUNE_THRESHOLD * elapsed &&
+            priv->consumer_wait[pos] > TUNE_THRESHOLD * elapsed &&
+            priv->depth[pos] < MAX_AUTO_DEPTH) {
+            priv->depth[pos]++;
+            g_debug ("Increase queue depth of target %u to %u", pos, priv->depth[pos]);
+        }
+
+        priv->n_tuned[pos] = 0;
+        priv->tuned_at[pos] = now;
+        priv->producer_wait[pos] = 0.0;
+        priv->consumer_wait[pos] = 0.0;
+    }
+
+    g_mutex_unlock (priv->lock);
+}
+
 static UfoBuffer *
 pop_or_alloc_buffer (UfoGroupPrivate *priv,
                      guint pos,
                      UfoRequisition *requisition)
 {
-    UfoBuffer *buffer;
+    UfoBuffer *buffer = NULL;
+
+    tune_depth (priv, pos);
+
+    /* a target that drops its oldest items never blocks the producer */
+    if (!add_buffer (priv, pos, requisition) && priv->drop_oldest[pos] &&
+        ufo_two_way_queue_get_num_available (priv->queues[pos]) == 0) {
+        buffer = ufo_two_way_queue_producer_steal (priv->queues[pos]);
 
-    if (ufo_two_way_queue_get_capacity (priv->queues[pos]) < (priv->n_targets + 1)) {
-        buffer = ufo_buffer_new (requisition, priv->context);
-        priv->buffers = g_list_append (priv->buffers, buffer);
-        ufo_two_way_queue_insert (priv->queues[pos], buffer);
+        if (buffer != NULL)
+            g_debug ("Dropped oldest item of target %u", pos);
     }
 
-    buffer = ufo_two_way_queue_producer_pop (priv->queues[pos]);
+    if (buffer == NULL && priv->auto_depth[pos]) {
+        gint64 start = g_get_monotonic_time ();
+
+        buffer = ufo_two_way_queue_producer_pop (priv->queues[pos]);
+
+        g_mutex_lock (priv->lock);
+        priv->producer_wait[pos] += (g_get_monotonic_time () - start) / 1e6;
+        g_mutex_unlock (priv->lock);
+    }
+
+    if (buffer == NULL)
+        buffer = ufo_two_way_queue_producer_pop (priv->queues[pos]);
 
     if (ufo_buffer_cmp_dimensions (buffer, requisition))
-        ufo_buffer_resize (buffer, requisition);
+        resize_buffer (priv, buffer, requisition);
 
     return buffer;
 }
 
+/*
+ * Account all buffers allocated by @group in @budget, which must outlive
+ * @group. The buffers are given back to @budget when @group is disposed.
+ */
+void
+ufo_group_set_memory_budget (UfoGroup *group,
+                             UfoMemoryBudget *budget)
+{
+    g_return_if_fail (UFO_IS_GROUP (group));
+    group->priv->budget = budget;
+}
+
+/**
+ * ufo_group_allocate_buffers:
+ * @group: A #UfoGroup
+ * @requisition: Size of the buffers
+ *
+ * Allocate all buffers of @group with @requisition at once instead of one by
+ * one in ufo_group_pop_output_buffer(). Used for tasks whose output size does
+ * not change during a stream.
+ *
+ * Since: 0.8
+ */
+void
+ufo_group_allocate_buffers (UfoGroup *group,
+                            UfoRequisition *requisition)
+{
+    UfoGroupPrivate *priv;
+
+    g_return_if_fail (UFO_IS_GROUP (group));
+    priv = group->priv;
+
+    for (guint i = 0; i < priv->n_targets; i++) {
+        while (add_buffer (priv, i, requisition))
+            ;
+    }
+}
+
+static guint
+get_min_depth (UfoGroupPrivate *priv,
+               guint pos)
+{
+    guint depth;
+
+    g_mutex_lock (priv->lock);
+    depth = MIN (priv->depth[pos], MIN_DEPTH);
+    g_mutex_unlock (priv->lock);
+    return depth;
+}
+
+/*
+ * Bytes that the fewest buffers of @requisition for all targets take, i.e.
+ * MIN_DEPTH buffers per target or its depth if that is smaller.
+ */
+gsize
+ufo_group_get_min_size (UfoGroup *group,
+                        UfoRequisition *requisition)
+{
+    UfoGroupPrivate *priv;
+    gsize n_buffers = 0;
+
+    priv = group->priv;
+
+    for (guint i = 0; i < priv->n_targets; i++)
+        n_buffers += get_min_depth (priv, i);
+
+    return n_buffers * get_required_size (requisition);
+}
+
+/*
+ * Allocate the buffers counted by ufo_group_get_min_size(), so that later
+ * allocations of other groups cannot take their share of the budget.
+ */
+void
+ufo_group_allocate_min_buffers (UfoGroup *group,
+                                UfoRequisition *requisition)
+{
+    UfoGroupPrivate *priv;
+
+    priv = group->priv;
+
+    for (guint i = 0; i < priv->n_targets; i++) {
+        while (ufo_two_way_queue_get_capacity (priv->queues[i]) < get_min_depth (priv, i) &&
+               add_buffer (priv, i, requisition))
+            ;
+    }
+}
+
+static guint
+get_num_in_flight (UfoGroupPrivate *priv,
+                   guint pos)
+{
+    UfoTwoWayQueue *queue = priv->queues[pos];
+    return ufo_two_way_queue_get_capacity (queue) - ufo_two_way_queue_get_num_available (queue);
+}
+
+/*
+ * Pick the target that is expected to be done first with all the items it
+ * holds plus a new one. Targets without measurements yet are preferred and
+ * ties are resolved round-robin. Fallback targets are only considered if all
+ * other targets hold all their buffers.
+ */
+static guint
+get_least_loaded_target (UfoGroupPrivate *priv)
+{
+    guint best;
+    gdouble best_cost;
+
+    best = priv->current;
+    best_cost = G_MAXDOUBLE;
+
+    g_mutex_lock (priv->lock);
+
+    for (guint pass = 0; pass < 2; pass++) {
+        for (guint i = 1; i <= priv->n_targets; i++) {
+            guint pos = (priv->current + i) % priv->n_targets;
+            guint in_flight;
+            gdouble cost;
+
+            if (priv->fallback[pos] != (pass == 1))
+                continue;
+
+            in_flight = get_num_in_flight (priv, pos);
+            cost = (in_flight + 1) * priv->service_time[pos];
+
+            /* avoid blocking on a target that holds all its buffers */
+            if (in_flight >= priv->depth[pos])
+                cost += G_MAXDOUBLE / 2;
+
+            if (cost < best_cost) {
+                best = pos;
+                best_cost = cost;
+            }
+        }
+
+        if (best_cost < G_MAXDOUBLE / 2)
+            break;
+    }
+
+    g_mutex_unlock (priv->lock);
+    return best;
+}
+
+/*
+ * Items of nested scatters carry one sequence number per scatter. The
+ * outermost uses UFO_SEQUENCE_METADATA, the one nested at @level a numbered
+ * key, so that inner joins do not overwrite the numbers of outer ones.
+ */
+static const gchar *
+get_sequence_key (guint level)
+{
+    const gchar *key;
+    gchar *name;
+
+    if (level == 0)
+        return UFO_SEQUENCE_METADATA;
+
+    name = g_strdup_printf (UFO_SEQUENCE_METADATA "-%u", level);
+    key = g_intern_string (name);
+    g_free (name);
+    return key;
+}
+
+static guint
+get_sequence_level (UfoBuffer *buffer)
+{
+    guint level = 0;
+
+    while (ufo_buffer_get_metadata (buffer, get_sequence_key (level)) != NULL)
+        level++;
+
+    return level;
+}
+
+static gboolean
+is_stamping (UfoGroupPrivate *priv)
+{
+    return priv->n_targets > 1 &&
+           (priv->pattern == UFO_SEND_SCATTER || priv->pattern == UFO_SEND_LEAST_LOADED);
+}
+
+/*
+ * Drop the sequence numbers a re-used buffer carries from its last trip, the
+ * producer copies the numbers of the current item from its inputs.
+ */
+static void
+clear_sequence (UfoGroupPrivate *priv,
+                UfoBuffer *buffer)
+{
+    guint level;
+
+    if (!is_stamping (priv))
+        return;
+
+    level = get_sequence_level (buffer);
+
+    while (level > 0)
+        ufo_buffer_remove_metadata (buffer, get_sequence_key (--level));
+}
+
+static void
+stamp_sequence (UfoGroupPrivate *priv,
+                UfoBuffer *buffer)
+{
+    GValue value = {0};
+
+    if (!is_stamping (priv))
+        return;
+
+    g_value_init (&value, G_TYPE_UINT64);
+    g_value_set_uint64 (&value, priv->sequence++);
+    ufo_buffer_set_metadata (buffer, get_sequence_key (get_sequence_level (buffer)), &value);
+    g_value_unset (&value);
+}
+
+/*
+ * Get the sequence number of the innermost scatter that @buffer went through
+ * and remove it, so that the join of the enclosing scatter sees its own.
+ */
+gboolean
+ufo_group_take_sequence (UfoBuffer *buffer,
+                         guint64 *sequence)
+{
+    const gchar *key;
+    GValue *value;
+    guint level;
+
+    level = get_sequence_level (buffer);
+
+    if (level == 0)
+        return FALSE;
+
+    key = get_sequence_key (level - 1);
+    value = ufo_buffer_get_metadata (buffer, key);
+
+    if (!G_VALUE_HOLDS_UINT64 (value))
+        return FALSE;
+
+    *sequence = g_value_get_uint64 (value);
+    ufo_buffer_remove_metadata (buffer, key);
+    return TRUE;
+}
+
 /**
  * ufo_group_pop_output_buffer:
  * @group: A #UfoGroup
@@ -122,14 +605,30 @@ ufo_group_pop_output_buffer (UfoGroup *group,
                              UfoRequisition *requisition)
 {
     UfoGroupPrivate *priv;
+    UfoBuffer *buffer;
     guint pos = 0;
 
     priv = group->priv;
 
-    if ((priv->pattern == UFO_SEND_SCATTER) || (priv->pattern == UFO_SEND_SEQUENTIAL))
+    if (priv->pattern == UFO_SEND_LEAST_LOADED)
+        priv->current = get_least_loaded_target (priv);
+
+    if ((priv->pattern == UFO_SEND_SCATTER) || (priv->pattern == UFO_SEND_SEQUENTIAL) ||
+        (priv->pattern == UFO_SEND_LEAST_LOADED))
         pos = priv->current;
 
-    return pop_or_alloc_buffer (priv, pos, requisition);
+    buffer = pop_or_alloc_buffer (priv, pos, requisition);
+    clear_sequence (priv, buffer);
+    return buffer;
+}
+
+static void
+count_sent (UfoGroupPrivate *priv,
+            guint pos)
+{
+    g_mutex_lock (priv->lock);
+    priv->n_sent[pos]++;
+    g_mutex_unlock (priv->lock);
 }
 
 void
@@ -143,9 +642,17 @@ ufo_group_push_output_buffer (UfoGroup *group,
 
     /* Copy or not depending on the send pattern */
     if (priv->pattern == UFO_SEND_SCATTER) {
+        stamp_sequence (priv, buffer);
+        count_sent (priv, priv->current);
         ufo_two_way_queue_producer_push (priv->queues[priv->current], buffer);
         priv->current = (priv->current + 1) % priv->n_targets;
     }
+    else if (priv->pattern == UFO_SEND_LEAST_LOADED) {
+        /* target was chosen when the buffer was popped */
+        stamp_sequence (priv, buffer);
+        count_sent (priv, priv->current);
+        ufo_two_way_queue_producer_push (priv->queues[priv->current], buffer);
+    }
     else if (priv->pattern == UFO_SEND_BROADCAST) {
         UfoRequisition requisition;
 
@@ -156,12 +663,15 @@ ufo_group_push_output_buffer (UfoGroup *group,
 
             copy = pop_or_alloc_buffer (priv, pos, &requisition);
             ufo_buffer_copy (buffer, copy);
+            count_sent (priv, pos);
             ufo_two_way_queue_producer_push (priv->queues[pos], copy);
         }
 
+        count_sent (priv, 0);
         ufo_two_way_queue_producer_push (priv->queues[0], buffer);
     }
     else if (priv->pattern == UFO_SEND_SEQUENTIAL) {
+        count_sent (priv, priv->current);
         ufo_two_way_queue_producer_push (priv->queues[priv->current], buffer);
 
         if (priv->n_expected[priv->current] == priv->n_received) {
@@ -174,6 +684,145 @@ ufo_group_push_output_buffer (UfoGroup *group,
     }
 }
 
+/**
+ * ufo_group_return_output_buffer:
+ * @group: A #UfoGroup
+ * @buffer: A buffer obtained with ufo_group_pop_output_buffer()
+ *
+ * Give @buffer back without sending it to any target, e.g. because the
+ * producer skipped the item. The next call to ufo_group_pop_output_buffer()
+ * may return @buffer again.
+ *
+ * Since: 0.8
+ */
+void
+ufo_group_return_output_buffer (UfoGroup *group,
+                                UfoBuffer *buffer)
+{
+    UfoGroupPrivate *priv;
+    guint pos = 0;
+
+    priv = group->priv;
+
+    /* the same queue ufo_group_pop_output_buffer() took the buffer from */
+    if (priv->pattern != UFO_SEND_BROADCAST)
+        pos = priv->current;
+
+    ufo_two_way_queue_consumer_push (priv->queues[pos], buffer);
+}
+
+/**
+ * ufo_group_set_fallback:
+ * @group: A #UfoGroup
+ * @target: The #UfoTask that is a target in @group
+ * @fallback: %TRUE if @target should only receive data when all other targets
+ *  are saturated
+ *
+ * Mark @target as fallback, e.g. because it runs on a slower CPU device. This
+ * only has an effect on groups using %UFO_SEND_LEAST_LOADED.
+ *
+ * Since: 0.8
+ */
+void
+ufo_group_set_fallback (UfoGroup *group,
+                        UfoTask *target,
+                        gboolean fallback)
+{
+    UfoGroupPrivate *priv;
+    gint pos;
+
+    g_return_if_fail (UFO_IS_GROUP (group));
+    priv = group->priv;
+    pos = g_list_index (priv->targets, target);
+
+    if (pos >= 0)
+        priv->fallback[pos] = fallback;
+}
+
+/**
+ * ufo_group_set_drop_oldest:
+ * @group: A #UfoGroup
+ * @target: The #UfoTask that is a target in @group
+ * @drop_oldest: %TRUE if the oldest item that @target did not fetch yet should
+ *  be dropped instead of waiting for @target
+ *
+ * Keep the latency of a slow @target bounded by dropping its oldest pending
+ * item when all buffers for @target are in use.
+ *
+ * Since: 0.8
+ */
+void
+ufo_group_set_drop_oldest (UfoGroup *group,
+                           UfoTask *target,
+                           gboolean drop_oldest)
+{
+    UfoGroupPrivate *priv;
+    gint pos;
+
+    g_return_if_fail (UFO_IS_GROUP (group));
+    priv = group->priv;
+    pos = g_list_index (priv->targets, target);
+
+    if (pos >= 0)
+        priv->drop_oldest[pos] = drop_oldest;
+}
+
+/*
+ * Whether a producer may push buffers it did not pop from @group, e.g. an
+ * input that it processed in place. Such buffers do not count as in flight,
+ * so least-loaded dispatch and dropping of old items would not see them.
+ */
+gboolean
+ufo_group_can_forward (UfoGroup *group)
+{
+    UfoGroupPrivate *priv;
+
+    priv = group->priv;
+
+    if (priv->n_targets == 0 || priv->pattern == UFO_SEND_LEAST_LOADED)
+        return FALSE;
+
+    for (guint i = 0; i < priv->n_targets; i++) {
+        if (priv->drop_oldest[i])
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ * ufo_group_set_depth:
+ * @group: A #UfoGroup
+ * @target: The #UfoTask that is a target in @group
+ * @depth: Number of buffers for @target, 0 for the default or
+ *  #UFO_QUEUE_DEPTH_AUTO
+ *
+ * Set how many buffers the producer can fill for @target before it waits.
+ * Depths are reduced if they exceed the memory budget.
+ *
+ * Since: 0.8
+ */
+void
+ufo_group_set_depth (UfoGroup *group,
+                     UfoTask *target,
+                     guint depth)
+{
+    UfoGroupPrivate *priv;
+    gint pos;
+
+    g_return_if_fail (UFO_IS_GROUP (group));
+    priv = group->priv;
+    pos = g_list_index (priv->targets, target);
+
+    if (pos < 0 || depth == 0)
+        return;
+
+    priv->auto_depth[pos] = depth == UFO_QUEUE_DEPTH_AUTO;
+
+    if (!priv->auto_depth[pos])
+        priv->depth[pos] = MAX (depth, 1);
+}
+
 void
 ufo_group_set_num_expected (UfoGroup *group,
                             UfoTask *target,
@@ -188,6 +837,42 @@ ufo_group_set_num_expected (UfoGroup *group,
     priv->n_expected[pos] = n_expected;
 }
 
+/*
+ * Fetch the next item for the target at @pos. A negative @timeout waits
+ * until one arrives, otherwise %NULL is returned after @timeout microseconds.
+ */
+static UfoBuffer *
+pop_input (UfoGroupPrivate *priv,
+           guint pos,
+           gint64 timeout)
+{
+    UfoTwoWayQueue *queue = priv->queues[pos];
+    UfoBuffer *input;
+    gint64 start = 0;
+
+    if (priv->auto_depth[pos])
+        start = g_get_monotonic_time ();
+
+    if (timeout < 0)
+        input = ufo_two_way_queue_consumer_pop (queue);
+    else
+        input = ufo_two_way_queue_consumer_timeout_pop (queue, (guint64) timeout);
+
+    if (priv->auto_depth[pos]) {
+        g_mutex_lock (priv->lock);
+        priv->consumer_wait[pos] += (g_get_monotonic_time () - start) / 1e6;
+        g_mutex_unlock (priv->lock);
+    }
+
+    if (input != NULL && input != UFO_END_OF_STREAM) {
+        g_mutex_lock (priv->lock);
+        priv->popped_at[pos] = g_get_monotonic_time ();
+        g_mutex_unlock (priv->lock);
+    }
+
+    return input;
+}
+
 /**
  * ufo_group_pop_input_buffer:
  * @group: A #UfoGroup
@@ -200,15 +885,33 @@ UfoBuffer *
 ufo_group_pop_input_buffer (UfoGroup *group,
                             UfoTask *target)
 {
-    UfoGroupPrivate *priv;
-    UfoBuffer *input;
     gint pos;
 
-    priv = group->priv;
-    pos = g_list_index (priv->targets, target);
-    input = pos >= 0 ? ufo_two_way_queue_consumer_pop (priv->queues[pos]) : NULL;
+    pos = g_list_index (group->priv->targets, target);
 
-    return input;
+    if (pos < 0)
+        return NULL;
+
+    return pop_input (group->priv, pos, -1);
+}
+
+/*
+ * Like ufo_group_pop_input_buffer() but return %NULL if no item arrived
+ * within @timeout microseconds.
+ */
+UfoBuffer *
+ufo_group_timeout_pop_input_buffer (UfoGroup *group,
+                                    UfoTask *target,
+                                    guint64 timeout)
+{
+    gint pos;
+
+    pos = g_list_index (group->priv->targets, target);
+
+    if (pos < 0)
+        return NULL;
+
+    return pop_input (group->priv, pos, (gint64) MIN (timeout, G_MAXINT64));
 }
 
 void
@@ -222,8 +925,27 @@ ufo_group_push_input_buffer (UfoGroup *group,
     priv = group->priv;
     pos = g_list_index (priv->targets, target);
 
-    if (pos >= 0)
-        ufo_two_way_queue_consumer_push (priv->queues[pos], input);
+    if (pos < 0)
+        return;
+
+    g_mutex_lock (priv->lock);
+
+    if (priv->popped_at[pos] > 0) {
+        gdouble elapsed;
+
+        elapsed = (g_get_monotonic_time () - priv->popped_at[pos]) / 1e6;
+        priv->busy_time[pos] += elapsed;
+        priv->popped_at[pos] = 0;
+
+        if (priv->service_time[pos] == 0.0)
+            priv->service_time[pos] = elapsed;
+        else
+            priv->service_time[pos] = EWMA_WEIGHT * elapsed + (1.0 - EWMA_WEIGHT) * priv->service_time[pos];
+    }
+
+    g_mutex_unlock (priv->lock);
+
+    ufo_two_way_queue_consumer_push (get_owner_queue (priv, pos, input), input);
 }
 
 void
@@ -237,13 +959,129 @@ ufo_group_finish (UfoGroup *group)
         ufo_two_way_queue_producer_push (priv->queues[i], UFO_END_OF_STREAM);
 }
 
+/**
+ * ufo_group_reset:
+ * @group: A #UfoGroup
+ *
+ * Return all buffers that were not consumed to the producers that own them
+ * and remove pending end-of-stream markers, so that @group can carry another
+ * stream. Dispatch statistics are kept.
+ *
+ * Since: 0.8
+ */
+void
+ufo_group_reset (UfoGroup *group)
+{
+    UfoGroupPrivate *priv;
+
+    g_return_if_fail (UFO_IS_GROUP (group));
+    priv = group->priv;
+
+    for (guint i = 0; i < priv->n_targets; i++) {
+        UfoBuffer *buffer;
+
+        while ((buffer = ufo_two_way_queue_producer_steal (priv->queues[i])) != NULL) {
+            if (buffer != UFO_END_OF_STREAM)
+                ufo_two_way_queue_consumer_push (get_owner_queue (priv, i, buffer), buffer);
+        }
+
+        priv->popped_at[i] = 0;
+    }
+
+    priv->n_received = 0;
+    priv->current = 0;
+    priv->sequence = 0;
+}
+
+/**
+ * ufo_group_get_target_stats:
+ * @group: A #UfoGroup
+ * @target: The #UfoTask that is a target in @group
+ * @n_sent: (out) (allow-none): Location for the number of items sent to
+ *  @target
+ * @service_time: (out) (allow-none): Location for the moving average of
+ *  seconds that @target holds an item
+ * @busy_time: (out) (allow-none): Location for the total number of seconds
+ *  @target held items
+ *
+ * Get dispatch statistics of @target.
+ *
+ * Since: 0.8
+ */
+void
+ufo_group_get_target_stats (UfoGroup *group,
+                            UfoTask *target,
+                            guint *n_sent,
+                            gdouble *service_time,
+                            gdouble *busy_time)
+{
+    UfoGroupPrivate *priv;
+    gint pos;
+
+    g_return_if_fail (UFO_IS_GROUP (group));
+
+    priv = group->priv;
+    pos = g_list_index (priv->targets, target);
+    g_return_if_fail (pos >= 0);
+
+    g_mutex_lock (priv->lock);
+
+    if (n_sent != NULL)
+        *n_sent = priv->n_sent[pos];
+
+    if (service_time != NULL)
+        *service_time = priv->service_time[pos];
+
+    if (busy_time != NULL)
+        *busy_time = priv->busy_time[pos];
+
+    g_mutex_unlock (priv->lock);
+}
+
+/**
+ * ufo_group_get_fairness:
+ * @group: A #UfoGroup
+ *
+ * Compute Jain's fairness index of the time the targets of @group spent
+ * processing items. A value of 1.0 means that all targets were kept equally
+ * busy, 1/n means that a single target of n did all the work.
+ *
+ * Returns: The fairness index between 1/n and 1.0.
+ *
+ * Since: 0.8
+ */
+gdouble
+ufo_group_get_fairness (UfoGroup *group)
+{
+    UfoGroupPrivate *priv;
+    gdouble sum = 0.0;
+    gdouble sum_squared = 0.0;
+
+    g_return_val_if_fail (UFO_IS_GROUP (group), 0.0);
+    priv = group->priv;
+
+    g_mutex_lock (priv->lock);
+
+    for (guint i = 0; i < priv->n_targets; i++) {
+        sum += priv->busy_time[i];
+        sum_squared += priv->busy_time[i] * priv->busy_time[i];
+    }
+
+    g_mutex_unlock (priv->lock);
+
+    if (sum_squared == 0.0)
+        return 1.0;
+
+    return (sum * sum) / (priv->n_targets * sum_squared);
+}
+
 static void
 ufo_group_dispose(GObject *object)
 {
     UfoGroupPrivate *priv;
 
     priv = UFO_GROUP_GET_PRIVATE (object);
-    g_list_foreach (priv->buffers, (GFunc) g_object_unref, NULL);
+    free_buffers (priv);
     G_OBJECT_CLASS (ufo_group_parent_class)->dispose (object);
 }
 
@@ -255,13 +1093,23 @@ ufo_group_finalize (GObject *object)
     priv = UFO_GROUP_GET_PRIVATE (object);
 
     g_free (priv->n_expected);
+    g_free (priv->fallback);
+    g_free (priv->drop_oldest);
+    g_free (priv->n_sent);
+    g_free (priv->popped_at);
+    g_free (priv->service_time);
+    g_free (priv->busy_time);
+    g_free (priv->n_tuned);
+    g_free (priv->tuned_at);
+    g_free (priv->producer_wait);
+    g_free (priv->consumer_wait);
+    g_free (priv->depth);
+    g_free (priv->auto_depth);
+    g_mutex_free (priv->lock);
 
     g_list_free (priv->targets);
     priv->targets = NULL;
 
-    g_list_free (priv->buffers);
-    priv->buffers = NULL;
-
     for (guint i = 0; i < priv->n_targets; i++)
         ufo_two_way_queue_free (priv->queues[i]);
 
@@ -288,4 +1136,5 @@ ufo_group_init (UfoGroup *self)
     UfoGroupPrivate *priv;
     self->priv = priv = UFO_GROUP_GET_PRIVATE (self);
     priv->buffers = NULL;
+    priv->lock = g_mutex_new ();
 }
@@ -42,19 +42,35 @@ typedef struct _UfoGroupPrivate    UfoGroupPrivate;
 
 #define UFO_END_OF_STREAM (GINT_TO_POINTER(1))
 
+/**
+ * UFO_SEQUENCE_METADATA:
+ *
+ * Name of the #guint64 meta data that a #UfoGroup scattering among several
+ * targets attaches to each item. It holds the position of the item in the
+ * stream and is used to restore the order where the targets join again. A
+ * scatter nested in the branches of another one uses the key with the nesting
+ * level appended, e.g. "sequence-1", and the join of the inner branches
+ * removes it again.
+ */
+#define UFO_SEQUENCE_METADATA "sequence"
+
 /**
  * UfoSendPattern:
  * @UFO_SEND_BROADCAST: Broadcast data to all connected nodes
  * @UFO_SEND_SCATTER: Scatter data among connected nodes.
  * @UFO_SEND_SEQUENTIAL: Break up a linear input stream and transfer sub streams
  * one by one to connected nodes.
+ * @UFO_SEND_LEAST_LOADED: Scatter data, but send each item to the connected
+ * node that is expected to process it first according to the number of items
+ * it holds and its average processing time.
  *
  * The send pattern describes how results are passed to connected nodes.
  */
 typedef enum {
     UFO_SEND_BROADCAST,
     UFO_SEND_SCATTER,
-    UFO_SEND_SEQUENTIAL
+    UFO_SEND_SEQUENTIAL,
+    UFO_SEND_LEAST_LOADED
 } UfoSendPattern;
 
 /**
@@ -87,16 +103,36 @@ guint       ufo_group_get_num_targets       (UfoGroup       *group);
 void        ufo_group_set_num_expected      (UfoGroup       *group,
                                              UfoTask        *target,
                                              gint            n_expected);
+void        ufo_group_set_fallback          (UfoGroup       *group,
+                                             UfoTask        *target,
+                                             gboolean        fallback);
+void        ufo_group_set_depth             (UfoGroup       *group,
+                                             UfoTask        *target,
+                                             guint           depth);
+void        ufo_group_set_drop_oldest       (UfoGroup       *group,
+                                             UfoTask        *target,
+                                             gboolean        drop_oldest);
+void        ufo_group_allocate_buffers      (UfoGroup       *group,
+                                             UfoRequisition *requisition);
 UfoBuffer * ufo_group_pop_output_buffer     (UfoGroup       *group,
                                              UfoRequisition *requisition);
 void        ufo_group_push_output_buffer    (UfoGroup       *group,
                                              UfoBuffer      *buffer);
+void        ufo_group_return_output_buffer  (UfoGroup       *group,
+                                             UfoBuffer      *buffer);
 UfoBuffer * ufo_group_pop_input_buffer      (UfoGroup       *group,
                                              UfoTask        *target);
 void        ufo_group_push_input_buffer     (UfoGroup       *group,
                                              UfoTask        *target,
                                              UfoBuffer      *input);
 void        ufo_group_finish                (UfoGroup       *group);
+void        ufo_group_reset                 (UfoGroup       *group);
+void        ufo_group_get_target_stats      (UfoGroup       *group,
+                                             UfoTask        *target,
+                                             guint          *n_sent,
+                                             gdouble        *service_time,
+                                             gdouble        *busy_time);
+gdouble     ufo_group_get_fairness          (UfoGroup       *group);
 GType       ufo_group_get_type              (void);
 
 G_END_DECLS
@@ -72,6 +72,23 @@ ufo_input_task_new (void)
     return UFO_NODE (g_object_new (UFO_TYPE_INPUT_TASK, NULL));
 }
 
+/**
+ * ufo_input_task_start:
+ * @task: A #UfoInputTask
+ *
+ * Accept input buffers again after @task was stopped with
+ * ufo_input_task_stop(). Used to feed another stream into a graph that is run
+ * repeatedly.
+ *
+ * Since: 0.8
+ */
+void
+ufo_input_task_start (UfoInputTask *task)
+{
+    g_return_if_fail (UFO_IS_INPUT_TASK (task));
+    task->priv->active = TRUE;
+}
+
 void
 ufo_input_task_stop (UfoInputTask *task)
 {
@@ -126,6 +143,27 @@ ufo_input_task_get_input_buffer (UfoInputTask *task)
     return buffer;
 }
 
+/**
+ * ufo_input_task_try_get_input_buffer:
+ * @task: A #UfoInputTask
+ * @timeout: Microseconds to wait for a buffer
+ *
+ * Like ufo_input_task_get_input_buffer() but give up after @timeout, so that
+ * callers can react to being stopped while @task does not consume any data.
+ *
+ * Return value: (transfer none): A #UfoBuffer for writing input data or %NULL
+ * if @task did not release one within @timeout.
+ *
+ * Since: 0.8
+ */
+UfoBuffer *
+ufo_input_task_try_get_input_buffer (UfoInputTask *task,
+                                     guint64 timeout)
+{
+    g_return_val_if_fail (UFO_IS_INPUT_TASK (task), NULL);
+    return g_async_queue_timeout_pop (task->priv->out_queue, timeout);
+}
+
 static void
 ufo_input_task_setup (UfoTask *task,
                       UfoResources *resources,
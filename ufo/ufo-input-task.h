@@ -63,10 +63,13 @@ struct _UfoInputTaskClass {
 };
 
 UfoNode   * ufo_input_task_new                  (void);
+void        ufo_input_task_start                (UfoInputTask *task);
 void        ufo_input_task_stop                 (UfoInputTask *task);
 void        ufo_input_task_release_input_buffer (UfoInputTask *task,
                                                  UfoBuffer *buffer);
 UfoBuffer * ufo_input_task_get_input_buffer     (UfoInputTask *task);
+UfoBuffer * ufo_input_task_try_get_input_buffer (UfoInputTask *task,
+                                                 guint64       timeout);
 GType       ufo_input_task_get_type             (void);
 
 G_END_DECLS
@@ -56,7 +56,10 @@ G_DEFINE_TYPE (UfoLocalScheduler, ufo_local_scheduler, UFO_TYPE_BASE_SCHEDULER)
 
 
 typedef struct {
-    GQueue *queue;
+    gpointer *nodes;
+    guint *busy;
+    guint n_nodes;
+    guint next;
     GMutex *lock;
 } ProcessorPool;
 
@@ -66,6 +69,7 @@ typedef struct {
     UfoTask *task;
     UfoTwoWayQueue **inputs;
     UfoTwoWayQueue *output;
+    guint depth;                /* buffers in the output queue */
     guint n_inputs;
     gboolean is_leaf;
 } TaskLocal;
@@ -77,6 +81,9 @@ enum {
 
 static UfoBuffer *POISON_PILL = (UfoBuffer *) 0x1;
 
+/* Buffers per output queue unless the edge sets its own depth */
+#define DEFAULT_DEPTH   2
+
 /**
  * UfoLocalSchedulerError:
  * @UFO_LOCAL_SCHEDULER_ERROR_SETUP: Could not start scheduler due to error
@@ -92,13 +99,16 @@ ufo_pp_new (GList *init)
 {
     ProcessorPool *pp;
     GList *jt;
+    guint i = 0;
 
     pp = g_malloc0 (sizeof (ProcessorPool));
-    pp->queue = g_queue_new ();
+    pp->n_nodes = g_list_length (init);
+    pp->nodes = g_new0 (gpointer, pp->n_nodes);
+    pp->busy = g_new0 (guint, pp->n_nodes);
     pp->lock = g_mutex_new ();
 
     g_list_for (init, jt) {
-        g_queue_push_tail (pp->queue, jt->data);
+        pp->nodes[i++] = jt->data;
     }
 
     return pp;
@@ -107,20 +117,55 @@ ufo_pp_new (GList *init)
 static void
 ufo_pp_destroy (ProcessorPool *pp)
 {
-    g_queue_free (pp->queue);
+    g_free (pp->nodes);
+    g_free (pp->busy);
     g_mutex_free (pp->lock);
+    g_free (pp);
 }
 
+/*
+ * Return the processor that is currently used by the fewest tasks. Ties are
+ * resolved round-robin. The processor must be given back with ufo_pp_release().
+ */
 static gpointer
 ufo_pp_next (ProcessorPool *pp)
 {
-    gpointer data;
+    guint best;
+
+    if (pp->n_nodes == 0)
+        return NULL;
 
     g_mutex_lock (pp->lock);
-    data = g_queue_pop_head (pp->queue);
-    g_queue_push_tail (pp->queue, data);
+    best = pp->next % pp->n_nodes;
+
+    for (guint i = 1; i < pp->n_nodes; i++) {
+        guint pos = (pp->next + i) % pp->n_nodes;
+
+        if (pp->busy[pos] < pp->busy[best])
+            best = pos;
+    }
+
+    pp->busy[best]++;
+    pp->next = best + 1;
+    g_mutex_unlock (pp->lock);
+
+    return pp->nodes[best];
+}
+
+static void
+ufo_pp_release (ProcessorPool *pp,
+                gpointer node)
+{
+    g_mutex_lock (pp->lock);
+
+    for (guint i = 0; i < pp->n_nodes; i++) {
+        if (pp->nodes[i] == node && pp->busy[i] > 0) {
+            pp->busy[i]--;
+            break;
+        }
+    }
+
     g_mutex_unlock (pp->lock);
-    return data;
 }
 
 /**
@@ -165,6 +210,8 @@ run_local (TaskLocal *local)
     UfoTask *task;
     UfoTaskMode mode;
     UfoTaskMode pu_mode;
+    gboolean is_static;
+    gpointer proc_node = NULL;
 /*     gboolean shared; */
     gboolean active = TRUE;
 
@@ -172,6 +219,7 @@ run_local (TaskLocal *local)
     inputs = g_new0 (UfoBuffer *, local->n_inputs);
     mode = ufo_task_get_mode (task) & UFO_TASK_MODE_TYPE_MASK;
     pu_mode = ufo_task_get_mode (task) & UFO_TASK_MODE_PROCESSOR_MASK;
+    is_static = ufo_task_get_mode (task) & UFO_TASK_MODE_STATIC_REQUISITION;
 /*     shared = ufo_task_get_mode (task) & UFO_TASK_MODE_SHARE_DATA; */
 /*  */
     output = NULL;
@@ -188,11 +236,14 @@ run_local (TaskLocal *local)
         /* profiler = ufo_task_node_get_profiler (UFO_TASK_NODE (task)); */
 
         /* Ask current task about size requirements */
-        ufo_task_get_requisition (task, inputs, &requisition);
+        if (is_static)
+            ufo_task_node_lookup_requisition (UFO_TASK_NODE (task), inputs, local->n_inputs, &requisition);
+        else
+            ufo_task_get_requisition (task, inputs, &requisition);
 
         /* Insert output buffers as longs as capacity is not filled */
         if (!local->is_leaf) {
-            if (ufo_two_way_queue_get_capacity (local->output) < 2) {
+            if (ufo_two_way_queue_get_capacity (local->output) < local->depth) {
                 UfoBuffer *buffer;
 
                 buffer = ufo_buffer_new (&requisition, local->context);
@@ -203,20 +254,28 @@ run_local (TaskLocal *local)
         }
 
         if (pu_mode == UFO_TASK_MODE_GPU) {
-            ufo_task_node_set_proc_node (UFO_TASK_NODE (task),
-                                         UFO_NODE (ufo_pp_next (local->pp)));
+            proc_node = ufo_pp_next (local->pp);
+            ufo_task_node_set_proc_node (UFO_TASK_NODE (task), UFO_NODE (proc_node));
         }
 
         /* Generate/process the data. Because the functions return active state,
          * we negate it for the finished flag. */
         if (mode != UFO_TASK_MODE_REDUCTOR) {
-            if (mode == UFO_TASK_MODE_PROCESSOR)
-                active = ufo_task_process (task, inputs, output, &requisition);
-            else
+            if (mode == UFO_TASK_MODE_GENERATOR)
                 active = ufo_task_generate (task, output, &requisition);
+            else
+                active = ufo_task_process (task, inputs, output, &requisition);
+
+            if (proc_node != NULL) {
+                ufo_pp_release (local->pp, proc_node);
+                proc_node = NULL;
+            }
 
             if (output != NULL && active) {
-                ufo_two_way_queue_producer_push (local->output, output);
+                if (ufo_task_node_output_skipped (UFO_TASK_NODE (task)))
+                    ufo_two_way_queue_consumer_push (local->output, output);
+                else
+                    ufo_two_way_queue_producer_push (local->output, output);
             }
 
             release_input_data (local, inputs);
@@ -233,11 +292,17 @@ run_local (TaskLocal *local)
             do {
                 active = ufo_task_generate (task, output, &requisition);
 
-                if (active) {
+                /* a skipped item keeps its buffer for the next one */
+                if (active && !ufo_task_node_output_skipped (UFO_TASK_NODE (task))) {
                     ufo_two_way_queue_producer_push (local->output, output);
                     output = ufo_two_way_queue_producer_pop (local->output);
                 }
             } while (active);
+
+            if (proc_node != NULL) {
+                ufo_pp_release (local->pp, proc_node);
+                proc_node = NULL;
+            }
         }
     }
 
@@ -302,7 +367,12 @@ setup_tasks (UfoGraph *graph,
             succ = UFO_NODE (g_list_nth_data (successors, 0));
             succ_data = g_hash_table_lookup (local, succ);
 
-            port = GPOINTER_TO_INT (ufo_graph_get_edge_label (graph, node, succ));
+            port = UFO_EDGE_INPUT (ufo_graph_get_edge_label (graph, node, succ));
+            data->depth = ufo_task_node_get_queue_depth (UFO_TASK_NODE (succ), port);
+
+            /* this scheduler does not tune depths */
+            if (data->depth == 0 || data->depth == UFO_QUEUE_DEPTH_AUTO)
+                data->depth = DEFAULT_DEPTH;
 
             if (succ_data != NULL) {
                 data->output = succ_data->inputs[port];
@@ -324,7 +394,7 @@ setup_tasks (UfoGraph *graph,
 
                 pred = UFO_NODE (jt->data);
                 pred_data = g_hash_table_lookup (local, pred);
-                port = GPOINTER_TO_INT (ufo_graph_get_edge_label (graph, pred, node));
+                port = UFO_EDGE_INPUT (ufo_graph_get_edge_label (graph, pred, node));
 
                 if (pred_data != NULL) {
                     data->inputs[port] = pred_data->output;
@@ -27,6 +27,10 @@
 #include <ufo/ufo-mpi-messenger.h>
 #endif
 
+#ifdef WITH_SHM
+#include <ufo/ufo-shm-messenger.h>
+#endif
+
 #include <ufo/ufo-messenger-iface.h>
 
 typedef UfoMessengerIface UfoMessengerInterface;
@@ -47,6 +51,18 @@ ufo_messenger_create (const gchar *address, GError **error)
 {
     UfoMessenger *msgr_out = NULL;
     GError *error_internal = NULL;
+
+    /* Same-host transports are named rather than bound to a port */
+#ifdef WITH_SHM
+    if (g_str_has_prefix (address, "shm://"))
+        return UFO_MESSENGER (ufo_shm_messenger_new ());
+#endif
+
+#ifdef WITH_ZMQ
+    if (g_str_has_prefix (address, "ipc://"))
+        return UFO_MESSENGER (ufo_zmq_messenger_new ());
+#endif
+
     GRegex *regex = g_regex_new ("^[a-z A-Z]+://[a-z A-Z 0-9 \\.]+:[0-9]{1,5}", \
                                  0, G_REGEX_MATCH_NOTEMPTY, &error_internal);
     if (error_internal) {
@@ -94,7 +110,13 @@ ufo_message_free (UfoMessage *msg)
 {
     if (msg == NULL)
         return;
-    g_free (msg->data);
+
+    /* The payload may belong to the messenger, e.g. a shared-memory slot */
+    if (msg->release != NULL)
+        msg->release (msg->release_data);
+    else
+        g_free (msg->data);
+
     g_free (msg);
 }
 
@@ -108,7 +130,7 @@ ufo_message_free (UfoMessage *msg)
 UfoMessage *
 ufo_message_new (UfoMessageType type, guint64 data_size)
 {
-    UfoMessage *msg = g_malloc (sizeof (UfoMessage));
+    UfoMessage *msg = g_malloc0 (sizeof (UfoMessage));
     msg->type = type;
     msg->data_size = data_size;
 
@@ -196,7 +218,39 @@ ufo_messenger_recv_blocking (UfoMessenger *messenger,
     return UFO_MESSENGER_GET_IFACE (messenger)->recv_blocking (messenger, error);
 }
 
+/**
+ * ufo_messenger_new_message: (skip)
+ * @messenger: The messenger object.
+ * @type: message type
+ * @data_size: total size of the message
+ *
+ * Create a new message like ufo_message_new(), but let @messenger place the
+ * payload where it can be sent from without copying. Only one such message
+ * should be prepared at a time and it must be sent or freed before the next
+ * call to ufo_messenger_send_blocking().
+ *
+ * Returns: A new #UfoMessage that must be freed with ufo_message_free().
+ *
+ * Since: 0.8
+ */
+UfoMessage *
+ufo_messenger_new_message (UfoMessenger *messenger,
+                           UfoMessageType type,
+                           guint64 data_size)
+{
+    return UFO_MESSENGER_GET_IFACE (messenger)->new_message (messenger, type, data_size);
+}
+
+static UfoMessage *
+ufo_messenger_new_message_real (UfoMessenger *messenger,
+                                UfoMessageType type,
+                                guint64 data_size)
+{
+    return ufo_message_new (type, data_size);
+}
+
 static void
 ufo_messenger_default_init (UfoMessengerInterface *iface)
 {
+    iface->new_message = ufo_messenger_new_message_real;
 }
@@ -97,6 +97,10 @@ struct _UfoMessage {
     UfoMessageType type;
     guint64 data_size;
     gpointer data;
+
+    /*< private >*/
+    GDestroyNotify release;
+    gpointer release_data;
 };
 
 void ufo_message_free (UfoMessage *msg);
@@ -141,6 +145,10 @@ struct _UfoMessengerIface {
 
     UfoMessage * (*recv_blocking)           (UfoMessenger       *messenger,
                                              GError            **error);
+
+    UfoMessage * (*new_message)             (UfoMessenger       *messenger,
+                                             UfoMessageType      type,
+                                             guint64             data_size);
 };
 
 
@@ -158,6 +166,10 @@ UfoMessage *ufo_messenger_send_blocking     (UfoMessenger       *messenger,
 UfoMessage *ufo_messenger_recv_blocking     (UfoMessenger       *messenger,
                                              GError            **error);
 
+UfoMessage *ufo_messenger_new_message       (UfoMessenger       *messenger,
+                                             UfoMessageType      type,
+                                             guint64             data_size);
+
 GQuark      ufo_messenger_error_quark       (void);
 GType       ufo_messenger_get_type          (void);
 
@@ -18,6 +18,7 @@
  */
 
 #include <ufo/ufo-node.h>
+#include "ufo-priv.h"
 
 /**
  * SECTION:ufo-node
@@ -169,6 +170,17 @@ ufo_node_get_total (UfoNode *node)
     return node->priv->orig->priv->total;
 }
 
+/*
+ * Get the node that @node was copied from or @node itself if it is an
+ * original.
+ */
+UfoNode *
+ufo_node_get_orig (UfoNode *node)
+{
+    g_return_val_if_fail (UFO_IS_NODE (node), NULL);
+    return node->priv->orig;
+}
+
 gboolean
 ufo_node_equal (UfoNode *n1,
                 UfoNode *n2)
@@ -160,3 +160,82 @@ ufo_write_profile_events (GList *nodes)
     g_list_foreach (sorted, (GFunc) g_free, NULL);
     g_list_free (sorted);
 }
+
+
+struct _UfoMemoryBudget {
+    GMutex *lock;
+    gsize limit;
+    gsize used;
+};
+
+/*
+ * Create a budget of @limit bytes shared by all groups of a graph. A @limit of
+ * 0 accepts all reservations.
+ */
+UfoMemoryBudget *
+ufo_memory_budget_new (gsize limit)
+{
+    UfoMemoryBudget *budget;
+
+    budget = g_new0 (UfoMemoryBudget, 1);
+    budget->lock = g_mutex_new ();
+    budget->limit = limit;
+    return budget;
+}
+
+void
+ufo_memory_budget_free (UfoMemoryBudget *budget)
+{
+    g_mutex_free (budget->lock);
+    g_free (budget);
+}
+
+/*
+ * Reserve @size bytes. Returns FALSE and reserves nothing if the limit would
+ * be exceeded, unless @force is TRUE.
+ */
+gboolean
+ufo_memory_budget_reserve (UfoMemoryBudget *budget,
+                           gsize size,
+                           gboolean force)
+{
+    gboolean fits;
+
+    g_mutex_lock (budget->lock);
+    fits = budget->limit == 0 || budget->used + size <= budget->limit;
+
+    if (fits || force)
+        budget->used += size;
+
+    g_mutex_unlock (budget->lock);
+    return fits;
+}
+
+/*
+ * Give back @size bytes that were reserved before.
+ */
+void
+ufo_memory_budget_release (UfoMemoryBudget *budget,
+                           gsize size)
+{
+    g_mutex_lock (budget->lock);
+    budget->used -= MIN (size, budget->used);
+    g_mutex_unlock (budget->lock);
+}
+
+gsize
+ufo_memory_budget_get_used (UfoMemoryBudget *budget)
+{
+    gsize used;
+
+    g_mutex_lock (budget->lock);
+    used = budget->used;
+    g_mutex_unlock (budget->lock);
+    return used;
+}
+
+gsize
+ufo_memory_budget_get_limit (UfoMemoryBudget *budget)
+{
+    return budget->limit;
+}
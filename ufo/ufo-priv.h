@@ -2,8 +2,79 @@
 #define UFO_PRIV_H
 
 #include <glib.h>
+#include <ufo/ufo-gpu-node.h>
+#include <ufo/ufo-scheduler.h>
+
+/* Edge labels of task graphs hold the output port above the input port */
+#define UFO_EDGE_LABEL(output, input)   GINT_TO_POINTER (((output) << 16) | (input))
+#define UFO_EDGE_INPUT(label)           ((guint) (GPOINTER_TO_INT (label) & 0xffff))
+#define UFO_EDGE_OUTPUT(label)          ((guint) (GPOINTER_TO_INT (label) >> 16))
+
+typedef struct _UfoPreparedGraph UfoPreparedGraph;
+typedef struct _UfoMemoryBudget  UfoMemoryBudget;
+
+UfoNode *ufo_node_get_orig      (UfoNode *node);
 
 void ufo_write_profile_events   (GList *nodes);
 void ufo_write_opencl_events    (GList *nodes);
 
+gpointer ufo_gpu_node_lookup_upload_queue   (gpointer cmd_queue);
+gpointer ufo_gpu_node_lookup_download_queue (gpointer cmd_queue);
+gboolean ufo_gpu_node_is_cpu_device         (UfoGpuNode *node);
+
+UfoMemoryBudget *ufo_memory_budget_new      (gsize limit);
+void     ufo_memory_budget_free             (UfoMemoryBudget *budget);
+gboolean ufo_memory_budget_reserve          (UfoMemoryBudget *budget,
+                                             gsize size,
+                                             gboolean force);
+void     ufo_memory_budget_release          (UfoMemoryBudget *budget,
+                                             gsize size);
+gsize    ufo_memory_budget_get_used         (UfoMemoryBudget *budget);
+gsize    ufo_memory_budget_get_limit        (UfoMemoryBudget *budget);
+void     ufo_group_set_memory_budget        (UfoGroup *group,
+                                             UfoMemoryBudget *budget);
+UfoBuffer *ufo_group_timeout_pop_input_buffer
+                                            (UfoGroup *group,
+                                             UfoTask *target,
+                                             guint64 timeout);
+gboolean ufo_group_take_sequence            (UfoBuffer *buffer,
+                                             guint64 *sequence);
+gboolean ufo_group_can_forward              (UfoGroup *group);
+gsize    ufo_group_get_min_size             (UfoGroup *group,
+                                             UfoRequisition *requisition);
+void     ufo_group_allocate_min_buffers     (UfoGroup *group,
+                                             UfoRequisition *requisition);
+
+void     ufo_buffer_set_item_metadata       (UfoBuffer *batch,
+                                             guint index,
+                                             UfoBuffer *item);
+void     ufo_buffer_remove_metadata         (UfoBuffer *buffer,
+                                             const gchar *name);
+
+gboolean ufo_task_node_lookup_requisition   (UfoTaskNode *node,
+                                             UfoBuffer **inputs,
+                                             guint n_inputs,
+                                             UfoRequisition *requisition);
+
+gboolean ufo_task_node_equal_settings       (UfoTaskNode *a,
+                                             UfoTaskNode *b);
+void     ufo_task_node_clear_skip_output    (UfoTaskNode *node);
+gboolean ufo_task_node_output_skipped       (UfoTaskNode *node);
+
+gboolean ufo_base_scheduler_begin_run       (UfoBaseScheduler *scheduler,
+                                             UfoTaskGraph *graph,
+                                             GError **error);
+gboolean ufo_base_scheduler_end_run         (UfoBaseScheduler *scheduler,
+                                             UfoTaskGraph *graph,
+                                             gdouble elapsed,
+                                             GError **error);
+
+UfoPreparedGraph *ufo_scheduler_prepare     (UfoScheduler *scheduler,
+                                             UfoTaskGraph *graph,
+                                             GError **error);
+gboolean ufo_prepared_graph_start           (UfoPreparedGraph *prepared,
+                                             GError **error);
+void     ufo_prepared_graph_wait            (UfoPreparedGraph *prepared);
+void     ufo_prepared_graph_free            (UfoPreparedGraph *prepared);
+
 #endif
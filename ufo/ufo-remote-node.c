@@ -74,10 +74,14 @@ retry_send_n_times (guint retries, UfoMessenger *msger, UfoMessage *msg, const g
     guint counter = retries;
 
     while (counter) {
+        UfoMessage *reply;
+
+        reply = ufo_messenger_send_blocking (msger, msg, &error);
+
         if (response)
-            *response = ufo_messenger_send_blocking (msger, msg, &error);
+            *response = reply;
         else
-            ufo_messenger_send_blocking (msger, msg, &error);
+            ufo_message_free (reply);
 
         if (error != NULL) {
             if (counter > 1) {
@@ -217,33 +221,32 @@ ufo_remote_node_send_inputs (UfoRemoteNode *node,
     };
 
     // determine our total message size
-    guint64 size = 0;
+    guint64 size = priv->n_inputs * sizeof (struct _Header);
 
     for (guint i = 0; i < priv->n_inputs; i++) {
         guint64 buffer_size = ufo_buffer_get_size (inputs[i]);
         size += buffer_size;
     }
 
-    gpointer buffer = g_malloc (priv->n_inputs * sizeof (struct _Header) + size);
-
-    char *base = buffer;
+    /* Let the messenger decide where the data goes to avoid another copy */
+    request = ufo_messenger_new_message (priv->msger, UFO_MESSAGE_SEND_INPUTS, size);
+    char *base = request->data;
 
     for (guint i = 0; i < priv->n_inputs; i++) {
-        struct _Header *header = g_new0 (struct _Header, 1);
-        ufo_buffer_get_requisition (inputs[i], &header->requisition);
-        header->buffer_size = (guint64) ufo_buffer_get_size (inputs[i]);
+        struct _Header header;
+        ufo_buffer_get_requisition (inputs[i], &header.requisition);
+        header.buffer_size = (guint64) ufo_buffer_get_size (inputs[i]);
 
-        memcpy (base, header, sizeof (struct _Header));
+        /* headers after the first input are not necessarily aligned */
+        memcpy (base, &header, sizeof (struct _Header));
         base += sizeof (struct _Header);
-        memcpy (base, ufo_buffer_get_host_array (inputs[i], NULL), header->buffer_size);
-        base += header->buffer_size;
+        memcpy (base, ufo_buffer_get_host_array (inputs[i], NULL), header.buffer_size);
+        base += header.buffer_size;
     }
 
-    request = ufo_message_new (UFO_MESSAGE_SEND_INPUTS, size);
-    g_free (request->data);
-    request->data = buffer;
     // send as a single message
     retry_send_n_times (3, priv->msger, request, "inputs", NULL);
+    ufo_message_free (request);
 }
 
 void
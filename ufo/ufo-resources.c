@@ -365,6 +365,41 @@ restrict_to_gpu_subset (UfoResourcesPrivate *priv)
     priv->n_devices = 1;
 }
 
+static void
+add_cpu_device (UfoResourcesPrivate *priv)
+{
+    /*
+     * Adds the CPU device of the platform if the UFO_USE_CPU environment
+     * variable is set, so that otherwise idle cores help out when all GPUs are
+     * busy. A CPU device of another platform (e.g. pocl next to a vendor GPU
+     * driver) cannot be used because all buffers share a single context.
+     */
+
+    const gchar *env_cpu = g_getenv ("UFO_USE_CPU");
+    cl_device_id device;
+    cl_uint n_devices = 0;
+    cl_int errcode;
+
+    if (env_cpu == NULL || g_strcmp0 (env_cpu, "") == 0 || g_strcmp0 (env_cpu, "0") == 0)
+        return;
+
+    errcode = clGetDeviceIDs (priv->platform, CL_DEVICE_TYPE_CPU, 1, &device, &n_devices);
+
+    if (errcode != CL_SUCCESS || n_devices == 0) {
+        g_warning ("UFO_USE_CPU is set but platform `%p' has no CPU device", (gpointer) priv->platform);
+        return;
+    }
+
+    for (guint i = 0; i < priv->n_devices; i++) {
+        if (priv->devices[i] == device)
+            return;
+    }
+
+    priv->devices = g_realloc (priv->devices, (priv->n_devices + 1) * sizeof (cl_device_id));
+    priv->devices[priv->n_devices++] = device;
+    g_debug ("Added CPU device `%p' as fallback", (gpointer) device);
+}
+
 static gboolean
 initialize_opencl (UfoResourcesPrivate *priv)
 {
@@ -375,11 +410,24 @@ initialize_opencl (UfoResourcesPrivate *priv)
     add_vendor_to_build_opts (priv->build_opts, priv->platform);
 
     device_type = 0;
-    device_type |= priv->device_type && UFO_DEVICE_CPU ? CL_DEVICE_TYPE_CPU : 0;
-    device_type |= priv->device_type && UFO_DEVICE_GPU ? CL_DEVICE_TYPE_GPU : 0;
-    device_type |= priv->device_type && UFO_DEVICE_ACC ? CL_DEVICE_TYPE_ACCELERATOR : 0;
+    device_type |= priv->device_type & UFO_DEVICE_CPU ? CL_DEVICE_TYPE_CPU : 0;
+    device_type |= priv->device_type & UFO_DEVICE_GPU ? CL_DEVICE_TYPE_GPU : 0;
+    device_type |= priv->device_type & UFO_DEVICE_ACC ? CL_DEVICE_TYPE_ACCELERATOR : 0;
 
     errcode = clGetDeviceIDs (priv->platform, device_type, 0, NULL, &priv->n_devices);
+
+    /*
+     * This runs before the device-type property is set, i.e. with the GPU
+     * default. Platforms without GPUs such as pocl must still work, so use
+     * whatever devices they have.
+     */
+    if (errcode == CL_DEVICE_NOT_FOUND || (errcode == CL_SUCCESS && priv->n_devices == 0)) {
+        g_debug ("Platform `%p' has none of the requested device types, using all devices",
+                 (gpointer) priv->platform);
+        device_type = CL_DEVICE_TYPE_ALL;
+        errcode = clGetDeviceIDs (priv->platform, device_type, 0, NULL, &priv->n_devices);
+    }
+
     UFO_RESOURCES_CHECK_AND_SET (errcode, &priv->construct_error);
 
     g_debug ("Platform `%p' has %i devices", (gpointer) priv->platform, priv->n_devices);
@@ -396,6 +444,7 @@ initialize_opencl (UfoResourcesPrivate *priv)
         return FALSE;
 
     restrict_to_gpu_subset (priv);
+    add_cpu_device (priv);
 
     priv->context = clCreateContext (NULL,
                                      priv->n_devices, priv->devices,
@@ -28,10 +28,19 @@
 #include <CL/cl.h>
 #endif
 #include <gio/gio.h>
+#include <errno.h>
 #include <stdio.h>
 #include <string.h>
 
+#ifdef __linux__
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
 #include <ufo/ufo-buffer.h>
+#include <ufo/ufo-gpu-node.h>
+#include <ufo/ufo-input-task.h>
 #include <ufo/ufo-remote-node.h>
 #include <ufo/ufo-remote-task.h>
 #include <ufo/ufo-resources.h>
@@ -55,15 +64,99 @@ G_DEFINE_TYPE (UfoScheduler, ufo_scheduler, UFO_TYPE_BASE_SCHEDULER)
 
 #define UFO_SCHEDULER_GET_PRIVATE(obj) (G_TYPE_INSTANCE_GET_PRIVATE((obj), UFO_TYPE_SCHEDULER, UfoSchedulerPrivate))
 
+typedef struct {
+    guint            size;          /* items to stack, set per edge */
+    UfoRequisition   requisition;   /* size of a single stacked item */
+    UfoBuffer       *stacked;
+    UfoBuffer       *partial;       /* view on a short last batch */
+    UfoBuffer       *pending;       /* popped item that starts the next batch */
+    gboolean         drained;
+    UfoBuffer       *source;        /* batch split for a non-batch task */
+    UfoBuffer       *item;
+    guint            next;
+} InputBatch;
+
+typedef struct {
+    UfoBuffer       *buffer;
+    guint64          sequence;
+} HeldItem;
+
+typedef struct {
+    guint            window;        /* maximum number of held items, set per edge */
+    guint            n_groups;
+    UfoGroup       **groups;
+    GQueue         **held;          /* HeldItems of each group not yet passed on */
+    guint            n_held;
+    gboolean        *finished;
+    guint            current;
+    guint64          next;          /* sequence number expected next */
+    GHashTable      *sources;       /* passed on item -> group it came from */
+} InputOrder;
+
+/*
+ * Copies of a reductor that reduce shares of the same stream. At the end of the
+ * stream, copy i merges the partial state of copy i + step for step = 1, 2,
+ * 4, ... until it hands its own state on, so that the first copy, which is
+ * the task in the graph, holds the merged state.
+ */
+typedef struct {
+    guint            n_copies;
+    UfoTask        **copies;
+    UfoTask        **holders;       /* copy holding the state of a subtree */
+    UfoBuffer      **outputs;
+    gboolean        *merged;
+    GMutex          *lock;
+    GCond           *cond;
+} ReduceTree;
+
+/*
+ * Count or time window of a reductor. Tumbling windows reduce into the output
+ * buffer and start over once it is generated. Sliding windows reduce into a
+ * separate state, from which items leaving the window are removed again, and
+ * generate from a copy of it.
+ */
+typedef struct {
+    guint            size;          /* items per window, 0 for time windows */
+    guint            step;
+    gdouble          duration;      /* seconds per window, 0 for count windows */
+    gdouble          interval;
+    gboolean         sliding;
+    GQueue          *held;          /* HeldInputs of a sliding window, oldest first */
+    GQueue          *spare;         /* evicted HeldInputs to copy new items into */
+    GTimer          *timer;
+    guint            n_added;       /* items since the last window ended */
+    gdouble          next;          /* time at which the current window ends */
+} ItemWindow;
+
+typedef struct {
+    UfoBuffer      **inputs;
+    gdouble          time;
+} HeldInputs;
+
 typedef struct {
     UfoTask         *task;
     UfoTaskMode      mode;
     guint            n_inputs;
+    guint            n_outputs;
+    UfoBuffer      **scratch;       /* outputs without successors */
     guint           *dims;
     gboolean        *finished;
     gboolean         strict;
+    InputBatch      *batches;
+    InputOrder      *orders;
+    gpointer         context;
+    gpointer         queue;
+    ReduceTree      *tree;
+    guint            rank;          /* position of task in tree */
+    ItemWindow       window;
+    UfoPreparedGraph *prepared;
 } TaskLocalData;
 
+typedef struct {
+    UfoRequisition   requisition;
+    gboolean         forwards;      /* passes its first input on as output */
+} StaticOutput;
+
 
 struct _UfoSchedulerPrivate {
     UfoRemoteMode    mode;
@@ -94,251 +187,1434 @@ ufo_scheduler_new (void)
     return UFO_BASE_SCHEDULER (g_object_new (UFO_TYPE_SCHEDULER, NULL));
 }
 
+/* microseconds to wait for a single branch before looking at the others */
+#define ORDER_POLL_INTERVAL 10000
+
+static InputOrder *
+get_order (TaskLocalData *tld,
+           guint pos)
+{
+    InputOrder *order = &tld->orders[pos];
+
+    if (order->n_groups == 0) {
+        GList *groups;
+        GList *it;
+        guint i = 0;
+
+        groups = ufo_task_node_get_in_groups (UFO_TASK_NODE (tld->task), pos);
+        order->n_groups = g_list_length (groups);
+
+        if (order->n_groups < 2)
+            order->window = 0;
+
+        if (order->window == 0)
+            return order;
+
+        order->groups = g_new0 (UfoGroup *, order->n_groups);
+        order->held = g_new0 (GQueue *, order->n_groups);
+        order->finished = g_new0 (gboolean, order->n_groups);
+        order->sources = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+        g_list_for (groups, it) {
+            order->held[i] = g_queue_new ();
+            order->groups[i++] = UFO_GROUP (it->data);
+        }
+    }
+
+    return order;
+}
+
 static gboolean
-get_inputs (TaskLocalData *tld,
-            UfoBuffer **inputs)
+is_ordered (TaskLocalData *tld,
+            guint pos)
 {
-    UfoRequisition req;
-    UfoTaskNode *node = UFO_TASK_NODE (tld->task);
-    guint n_finished = 0;
+    return get_order (tld, pos)->window > 0;
+}
 
-    for (guint i = 0; i < tld->n_inputs; i++) {
-        UfoGroup *group;
+static void
+clear_held_items (InputOrder *order)
+{
+    for (guint i = 0; i < order->n_groups; i++) {
+        g_queue_foreach (order->held[i], (GFunc) g_free, NULL);
+        g_queue_clear (order->held[i]);
+    }
 
-        if (!tld->finished[i]) {
-            UfoBuffer *input;
+    order->n_held = 0;
+}
 
-            group = ufo_task_node_get_current_in_group (node, i);
-            input = ufo_group_pop_input_buffer (group, tld->task);
+/*
+ * Hold back @input that arrived from group @i. Returns @input if it must be
+ * passed on right away because it carries no sequence number.
+ */
+static UfoBuffer *
+hold_input (InputOrder *order,
+            guint i,
+            UfoBuffer *input)
+{
+    HeldItem *item;
+    guint64 sequence;
 
-            if (tld->strict && input != UFO_END_OF_STREAM) {
-                ufo_buffer_get_requisition (input, &req);
+    if (input == UFO_END_OF_STREAM) {
+        order->finished[i] = TRUE;
+        return NULL;
+    }
 
-                if (req.n_dims != tld->dims[i]) {
-                    g_warning ("%s: buffer from input %i provides %i dimensions but expect %i dimensions",
-                               G_OBJECT_TYPE_NAME (tld->task), i, req.n_dims, tld->dims[i]);
-                    return FALSE;
-                }
+    if (!ufo_group_take_sequence (input, &sequence)) {
+        g_hash_table_insert (order->sources, input, order->groups[i]);
+        return input;
+    }
+
+    item = g_new0 (HeldItem, 1);
+    item->buffer = input;
+    item->sequence = sequence;
+    g_queue_push_tail (order->held[i], item);
+    order->n_held++;
+    return NULL;
+}
+
+static UfoBuffer *
+pass_on (TaskLocalData *tld,
+         InputOrder *order,
+         guint i)
+{
+    HeldItem *item;
+    UfoBuffer *input;
+
+    item = g_queue_pop_head (order->held[i]);
+    input = item->buffer;
+    order->n_held--;
+
+    if (item->sequence >= order->next)
+        order->next = item->sequence + 1;
+    else
+        g_debug ("%s: item %" G_GUINT64_FORMAT " passed on out of order",
+                 G_OBJECT_TYPE_NAME (tld->task), item->sequence);
+
+    g_hash_table_insert (order->sources, input, order->groups[i]);
+    g_free (item);
+    return input;
+}
+
+/*
+ * Pass on items of all groups connected to @pos in the order they were
+ * scattered. Each group delivers its items in order, so the oldest held item
+ * of all groups is next if it is the expected one or if every group that has
+ * not finished holds an item. Otherwise it is passed on out of order once
+ * the window is full, e.g. because the expected item was dropped. Groups
+ * never wait for buffers held back here before that, because setup_groups
+ * gives them more buffers than the window.
+ */
+static UfoBuffer *
+pop_ordered (TaskLocalData *tld,
+             guint pos)
+{
+    InputOrder *order = &tld->orders[pos];
+
+    while (TRUE) {
+        UfoBuffer *input;
+        guint64 oldest = G_MAXUINT64;
+        guint n_waiting = 0;
+        guint from = 0;
+        guint i;
+
+        /* take everything that has arrived so far */
+        for (guint j = 0; j < order->n_groups && order->n_held < order->window; j++) {
+            i = (order->current + j) % order->n_groups;
+
+            if (order->finished[i])
+                continue;
+
+            input = ufo_group_timeout_pop_input_buffer (order->groups[i], tld->task, 0);
+
+            if (input != NULL && (input = hold_input (order, i, input)) != NULL)
+                return input;
+        }
+
+        for (i = 0; i < order->n_groups; i++) {
+            HeldItem *head = g_queue_peek_head (order->held[i]);
+
+            if (head == NULL) {
+                if (!order->finished[i])
+                    n_waiting++;
+
+                continue;
             }
 
-            if (input == UFO_END_OF_STREAM) {
-                tld->finished[i] = TRUE;
-                n_finished++;
+            if (head->sequence < oldest) {
+                oldest = head->sequence;
+                from = i;
             }
-            else
-                inputs[i] = input;
         }
-        else
-            n_finished++;
+
+        if (order->n_held == 0 && n_waiting == 0)
+            return UFO_END_OF_STREAM;
+
+        if (order->n_held > 0 &&
+            (oldest <= order->next || n_waiting == 0 || order->n_held >= order->window))
+            return pass_on (tld, order, from);
+
+        /* wait a little for the next group that has nothing held back */
+        i = order->current;
+
+        while (order->finished[i] || !g_queue_is_empty (order->held[i]))
+            i = (i + 1) % order->n_groups;
+
+        order->current = (i + 1) % order->n_groups;
+        input = ufo_group_timeout_pop_input_buffer (order->groups[i], tld->task, ORDER_POLL_INTERVAL);
+
+        if (input != NULL && (input = hold_input (order, i, input)) != NULL)
+            return input;
     }
+}
 
-    return (tld->n_inputs == 0) || (n_finished < tld->n_inputs);
+static UfoBuffer *
+pop_input (TaskLocalData *tld,
+           guint pos)
+{
+    UfoGroup *group;
+    UfoBuffer *input;
+    guint64 sequence;
+
+    if (is_ordered (tld, pos))
+        return pop_ordered (tld, pos);
+
+    group = ufo_task_node_get_current_in_group (UFO_TASK_NODE (tld->task), pos);
+    input = ufo_group_pop_input_buffer (group, tld->task);
+
+    /* branches join here without reordering, which still closes their scatter */
+    if (tld->orders[pos].n_groups > 1 && input != UFO_END_OF_STREAM)
+        ufo_group_take_sequence (input, &sequence);
+
+    return input;
 }
 
 static void
-release_inputs (TaskLocalData *tld,
-                UfoBuffer **inputs)
+push_input (TaskLocalData *tld,
+            guint pos,
+            UfoBuffer *input)
 {
     UfoTaskNode *node = UFO_TASK_NODE (tld->task);
+    UfoGroup *group;
 
-    for (guint i = 0; i < tld->n_inputs; i++) {
-        UfoGroup *group;
+    if (is_ordered (tld, pos)) {
+        group = g_hash_table_lookup (tld->orders[pos].sources, input);
 
-        group = ufo_task_node_get_current_in_group (node, i);
-        ufo_group_push_input_buffer (group, tld->task, inputs[i]);
-        ufo_task_node_switch_in_group (node, i);
+        /* an item that has already been given back is not ours anymore */
+        if (group == NULL)
+            return;
+
+        g_hash_table_remove (tld->orders[pos].sources, input);
+        ufo_group_push_input_buffer (group, tld->task, input);
+        return;
     }
+
+    group = ufo_task_node_get_current_in_group (node, pos);
+    ufo_group_push_input_buffer (group, tld->task, input);
+    ufo_task_node_switch_in_group (node, pos);
 }
 
 static gboolean
-any (gboolean *values,
-     guint n_values)
+same_requisition (UfoRequisition *a,
+                  UfoRequisition *b)
 {
-    gboolean result = FALSE;
+    if (a->n_dims != b->n_dims)
+        return FALSE;
 
-    for (guint i = 0; i < n_values; i++)
-        result = result || values[i];
+    for (guint i = 0; i < a->n_dims; i++) {
+        if (a->dims[i] != b->dims[i])
+            return FALSE;
+    }
 
-    return result;
+    return TRUE;
 }
 
+/*
+ * Forget @input at @pos without giving it back, because it was passed on as
+ * output. Its consumers return it to the group that owns it.
+ */
 static void
-run_remote_task (TaskLocalData *tld)
+forget_input (TaskLocalData *tld,
+              guint pos,
+              UfoBuffer *input)
 {
-    UfoRemoteNode *remote;
-    guint n_remote_gpus;
-    gboolean *alive;
-    gboolean active = TRUE;
+    if (is_ordered (tld, pos))
+        g_hash_table_remove (tld->orders[pos].sources, input);
+    else
+        ufo_task_node_switch_in_group (UFO_TASK_NODE (tld->task), pos);
+}
 
-    remote = UFO_REMOTE_NODE (ufo_task_node_get_proc_node (UFO_TASK_NODE (tld->task)));
-    n_remote_gpus = ufo_remote_node_get_num_gpus (remote);
-    alive = g_new0 (gboolean, n_remote_gpus);
+/*
+ * An in-place task can write into its first input if that input was popped
+ * from a group as is and has the size of the output.
+ */
+static gboolean
+can_process_inplace (TaskLocalData *tld,
+                     UfoBuffer **inputs,
+                     UfoRequisition *requisition)
+{
+    InputBatch *batch;
+    UfoRequisition input_requisition;
 
-    /*
-     * We launch a new thread for each incoming input data set because then we
-     * can send as many items as we have remote GPUs available without waiting
-     * for processing to stop.
-     */
-    while (active) {
-        for (guint i = 0; i < n_remote_gpus; i++) {
-            UfoBuffer *input;
+    if (!(tld->mode & UFO_TASK_MODE_INPLACE) ||
+        (tld->mode & UFO_TASK_MODE_TYPE_MASK) != UFO_TASK_MODE_PROCESSOR ||
+        tld->n_inputs == 0 || tld->finished[0])
+        return FALSE;
 
-            if (get_inputs (tld, &input)) {
-                ufo_remote_node_send_inputs (remote, &input);
-                release_inputs (tld, &input);
-                alive[i] = TRUE;
-            }
-            else {
-                alive[i] = FALSE;
-            }
-        }
+    if (!ufo_group_can_forward (ufo_task_node_get_out_group (UFO_TASK_NODE (tld->task))))
+        return FALSE;
 
-        for (guint i = 0; i < n_remote_gpus; i++) {
-            UfoGroup *group;
-            UfoBuffer *output;
-            UfoRequisition requisition;
+    batch = &tld->batches[0];
 
-            if (!alive[i])
-                continue;
+    /* slices and stacked batches are owned by the scheduler */
+    if (batch->source != NULL || inputs[0] == batch->stacked || inputs[0] == batch->partial)
+        return FALSE;
 
-            ufo_remote_node_get_requisition (remote, &requisition);
-            group = ufo_task_node_get_out_group (UFO_TASK_NODE (tld->task));
-            output = ufo_group_pop_output_buffer (group, &requisition);
-            ufo_remote_node_get_result (remote, output);
-            ufo_group_push_output_buffer (group, output);
-        }
+    ufo_buffer_get_requisition (inputs[0], &input_requisition);
+    return same_requisition (&input_requisition, requisition);
+}
 
-        active = any (alive, n_remote_gpus);
-    }
+static UfoBuffer *
+next_batch_item (InputBatch *batch)
+{
+    if (batch->item != NULL)
+        g_object_unref (batch->item);
 
-    g_free (alive);
-    ufo_group_finish (ufo_task_node_get_out_group (UFO_TASK_NODE (tld->task)));
+    batch->item = ufo_buffer_new_slice (batch->source, batch->next++);
+    return batch->item;
 }
 
-static gpointer
-run_task (TaskLocalData *tld)
+/*
+ * Copy up to batch->size consecutive inputs of the same size as @input into
+ * one buffer. Each item is given back to its producer as soon as it is copied,
+ * its metadata is kept with the batch and handed out again with its slice.
+ */
+static UfoBuffer *
+stack_inputs (TaskLocalData *tld,
+              guint pos,
+              UfoBuffer *input)
 {
-    UfoBuffer *inputs[tld->n_inputs];
-    UfoBuffer *output;
-    UfoTaskNode *node;
-    UfoTaskMode mode;
-    UfoProfiler *profiler;
+    InputBatch *batch = &tld->batches[pos];
     UfoRequisition requisition;
-    gboolean produces;
-    gboolean active;
+    UfoRequisition stacked;
+    UfoRegion region;
+    guint n_items = 0;
 
-    node = UFO_TASK_NODE (tld->task);
-    active = TRUE;
-    output = NULL;
-    profiler = g_object_ref (ufo_task_node_get_profiler (node));
-
-    if (UFO_IS_REMOTE_TASK (tld->task)) {
-        run_remote_task (tld);
-        return NULL;
+    if (batch->partial != NULL) {
+        g_object_unref (batch->partial);
+        batch->partial = NULL;
     }
 
-    /* mode without CPU/GPU flag */
-    mode = tld->mode & UFO_TASK_MODE_TYPE_MASK;
-    produces = mode != UFO_TASK_MODE_SINK;
-
-    while (active) {
-        UfoGroup *group;
+    ufo_buffer_get_requisition (input, &requisition);
+    stacked = requisition;
+    stacked.dims[stacked.n_dims++] = batch->size;
+
+    if (batch->stacked == NULL)
+        batch->stacked = ufo_buffer_new (&stacked, tld->context);
+    else if (!same_requisition (&requisition, &batch->requisition))
+        ufo_buffer_resize (batch->stacked, &stacked);
+
+    batch->requisition = requisition;
+    ufo_buffer_set_batch_size (batch->stacked, batch->size);
+
+    while (TRUE) {
+        gsize item_size = ufo_buffer_get_size (input);
+        gsize offset = n_items * item_size;
+
+        /*
+         * Stack on the side where the item currently is. Slices at offsets
+         * that the device cannot alias are copies, so write into the stacked
+         * buffer itself.
+         */
+        if (tld->queue != NULL && ufo_buffer_get_location (input) != UFO_BUFFER_LOCATION_HOST) {
+            cl_mem src;
+            cl_mem dst;
+            cl_event event;
+
+            dst = ufo_buffer_get_device_array (batch->stacked, tld->queue);
+            src = ufo_buffer_get_device_array (input, tld->queue);
+
+            /* the input is handed back right after, so wait for the copy */
+            UFO_RESOURCES_CHECK_CLERR (clEnqueueCopyBuffer (tld->queue, src, dst, 0, offset, item_size,
+                                                            0, NULL, &event));
+            UFO_RESOURCES_CHECK_CLERR (clWaitForEvents (1, &event));
+            UFO_RESOURCES_CHECK_CLERR (clReleaseEvent (event));
+        }
+        else {
+            gchar *dst;
 
-        group = ufo_task_node_get_out_group (node);
+            dst = (gchar *) ufo_buffer_get_host_array (batch->stacked, tld->queue);
+            memcpy (dst + offset, ufo_buffer_get_host_array (input, tld->queue), item_size);
+        }
 
-        /* Get input buffers */
-        active = get_inputs (tld, inputs);
+        ufo_buffer_copy_metadata (input, batch->stacked);
+        ufo_buffer_set_item_metadata (batch->stacked, n_items, input);
+        push_input (tld, pos, input);
 
-        if (!active) {
-            ufo_group_finish (group);
+        if (++n_items == batch->size)
             break;
-        }
 
-        /* Get output buffers */
-        ufo_task_get_requisition (tld->task, inputs, &requisition);
+        input = pop_input (tld, pos);
 
-        if (produces) {
-            output = ufo_group_pop_output_buffer (group, &requisition);
-            g_assert (output != NULL);
+        if (input == UFO_END_OF_STREAM) {
+            batch->drained = TRUE;
+            break;
         }
 
-        if (output != NULL) {
-            ufo_buffer_discard_location (output);
+        ufo_buffer_get_requisition (input, &stacked);
 
-            for (guint i = 0; i < tld->n_inputs; i++)
-                ufo_buffer_copy_metadata (inputs[i], output);
+        if (ufo_buffer_get_batch_size (input) > 0 || !same_requisition (&requisition, &stacked)) {
+            batch->pending = input;
+            break;
         }
+    }
 
-        switch (mode) {
-            case UFO_TASK_MODE_PROCESSOR:
-            case UFO_TASK_MODE_SINK:
-                ufo_profiler_trace_event (profiler, UFO_TRACE_EVENT_PROCESS | UFO_TRACE_EVENT_BEGIN);
-                active = ufo_task_process (tld->task, inputs, output, &requisition);
-                ufo_profiler_trace_event (profiler, UFO_TRACE_EVENT_PROCESS | UFO_TRACE_EVENT_END);
-                break;
+    if (n_items == batch->size)
+        return batch->stacked;
 
-            case UFO_TASK_MODE_REDUCTOR:
-                do {
-                    gboolean go_on = TRUE;
+    /* short batch at the end of a run, hand out a view on the valid items */
+    for (guint i = 0; i < requisition.n_dims; i++) {
+        region.origin[i] = 0;
+        region.size[i] = requisition.dims[i];
+    }
 
-                    do {
-                        ufo_profiler_trace_event (profiler, UFO_TRACE_EVENT_PROCESS | UFO_TRACE_EVENT_BEGIN);
-                        go_on = ufo_task_process (tld->task, inputs, output, &requisition);
-                        ufo_profiler_trace_event (profiler, UFO_TRACE_EVENT_PROCESS | UFO_TRACE_EVENT_END);
+    region.origin[requisition.n_dims] = 0;
+    region.size[requisition.n_dims] = n_items;
 
-                        release_inputs (tld, inputs);
-                        active = get_inputs (tld, inputs);
-                        go_on = go_on && active;
-                    } while (go_on);
+    batch->partial = ufo_buffer_new_view (batch->stacked, &region);
+    ufo_buffer_set_batch_size (batch->partial, n_items);
+    ufo_buffer_copy_metadata (batch->stacked, batch->partial);
+    return batch->partial;
+}
 
-                    do {
-                        ufo_profiler_trace_event (profiler, UFO_TRACE_EVENT_GENERATE | UFO_TRACE_EVENT_BEGIN);
-                        go_on = ufo_task_generate (tld->task, output, &requisition);
-                        ufo_profiler_trace_event (profiler, UFO_TRACE_EVENT_GENERATE | UFO_TRACE_EVENT_END);
+static UfoBuffer *
+get_input (TaskLocalData *tld,
+           guint pos)
+{
+    InputBatch *batch = &tld->batches[pos];
+    UfoBuffer *input;
 
-                        if (go_on) {
-                            ufo_group_push_output_buffer (group, output);
-                            output = ufo_group_pop_output_buffer (group, &requisition);
-                        }
-                    } while (go_on);
-                } while (active);
+    if (batch->source != NULL)
+        return next_batch_item (batch);
 
-                break;
+    if (batch->pending != NULL) {
+        input = batch->pending;
+        batch->pending = NULL;
+    }
+    else if (batch->drained) {
+        return UFO_END_OF_STREAM;
+    }
+    else {
+        input = pop_input (tld, pos);
+    }
 
-            case UFO_TASK_MODE_GENERATOR:
-                ufo_profiler_trace_event (profiler, UFO_TRACE_EVENT_GENERATE | UFO_TRACE_EVENT_BEGIN);
-                active = ufo_task_generate (tld->task, output, &requisition);
-                ufo_profiler_trace_event (profiler, UFO_TRACE_EVENT_GENERATE | UFO_TRACE_EVENT_END);
-                break;
+    if (input == UFO_END_OF_STREAM)
+        return input;
 
-            default:
-                g_warning ("Invalid task mode: %i\n", mode);
-        }
+    if (ufo_buffer_get_batch_size (input) > 0) {
+        if (tld->mode & UFO_TASK_MODE_BATCH)
+            return input;
 
-        if (active && produces && (mode != UFO_TASK_MODE_REDUCTOR))
-            ufo_group_push_output_buffer (group, output);
+        /* split batches for tasks that cannot handle them */
+        batch->source = input;
+        batch->next = 0;
+        return next_batch_item (batch);
+    }
 
-        /* Release buffers for further consumption */
-        if (active)
-            release_inputs (tld, inputs);
+    if ((tld->mode & UFO_TASK_MODE_BATCH) && batch->size > 1) {
+        UfoRequisition requisition;
 
-        if (!active)
-            ufo_group_finish (group);
+        ufo_buffer_get_requisition (input, &requisition);
+
+        if (requisition.n_dims < UFO_BUFFER_MAX_NDIMS)
+            return stack_inputs (tld, pos, input);
     }
 
-    g_object_unref (profiler);
-    return NULL;
+    return input;
 }
 
+/*
+ * Give back everything that still arrives at inputs that did not end yet, so
+ * that their producers do not wait for a task that stopped.
+ */
 static void
-cleanup_task_local_data (TaskLocalData **tlds,
-                         guint n)
+drain_inputs (TaskLocalData *tld)
 {
-    for (guint i = 0; i < n; i++) {
-        TaskLocalData *tld = tlds[i];
+    for (guint i = 0; i < tld->n_inputs; i++) {
+        UfoBuffer *input;
+
+        if (tld->finished[i])
+            continue;
+
+        while ((input = pop_input (tld, i)) != UFO_END_OF_STREAM)
+            push_input (tld, i, input);
+
+        tld->finished[i] = TRUE;
+    }
+}
+
+/*
+ * Fetch the next item of each input. An input that ended keeps its last item,
+ * which is how reference data is reused for all items of the other inputs.
+ * @inputs must be %NULL-initialized before the first call.
+ */
+static gboolean
+get_inputs (TaskLocalData *tld,
+            UfoBuffer **inputs)
+{
+    UfoRequisition req;
+    guint n_finished = 0;
+    gint empty = -1;
+
+    for (guint i = 0; i < tld->n_inputs; i++) {
+        if (!tld->finished[i]) {
+            UfoBuffer *input;
+
+            input = get_input (tld, i);
+
+            if (tld->strict && input != UFO_END_OF_STREAM) {
+                guint n_dims = tld->dims[i];
+
+                if (ufo_buffer_get_batch_size (input) > 0)
+                    n_dims++;
+
+                ufo_buffer_get_requisition (input, &req);
+
+                if (req.n_dims != n_dims) {
+                    g_warning ("%s: buffer from input %i provides %i dimensions but expect %i dimensions",
+                               G_OBJECT_TYPE_NAME (tld->task), i, req.n_dims, n_dims);
+                    return FALSE;
+                }
+            }
+
+            if (input == UFO_END_OF_STREAM) {
+                tld->finished[i] = TRUE;
+                n_finished++;
+
+                if (inputs[i] == NULL)
+                    empty = (gint) i;
+            }
+            else
+                inputs[i] = input;
+        }
+        else
+            n_finished++;
+    }
+
+    if (empty >= 0 && n_finished < tld->n_inputs) {
+        g_debug ("%s: input %i ended without any data, stopping",
+                   G_OBJECT_TYPE_NAME (tld->task), empty);
+        drain_inputs (tld);
+        return FALSE;
+    }
+
+    return (tld->n_inputs == 0) || (n_finished < tld->n_inputs);
+}
+
+static void
+release_inputs (TaskLocalData *tld,
+                UfoBuffer **inputs)
+{
+    for (guint i = 0; i < tld->n_inputs; i++) {
+        InputBatch *batch = &tld->batches[i];
+
+        if (batch->source != NULL) {
+            /* keep the batch until all of its items are processed */
+            if (batch->next < ufo_buffer_get_batch_size (batch->source))
+                continue;
+
+            g_object_unref (batch->item);
+            batch->item = NULL;
+            push_input (tld, i, batch->source);
+            batch->source = NULL;
+            continue;
+        }
+
+        /* passed on as output */
+        if (inputs[i] == NULL)
+            continue;
+
+        /* stacked items have already been given back */
+        if ((tld->mode & UFO_TASK_MODE_BATCH) &&
+            (tld->finished[i] || inputs[i] == batch->stacked || inputs[i] == batch->partial))
+            continue;
+
+        push_input (tld, i, inputs[i]);
+    }
+}
+
+/*
+ * A processor that accepts batches produces one output item for each input
+ * item, so its output is a batch of the same size as its first batched input.
+ */
+static guint
+get_output_batch_size (TaskLocalData *tld,
+                       UfoBuffer **inputs,
+                       UfoRequisition *requisition)
+{
+    if (!(tld->mode & UFO_TASK_MODE_BATCH) ||
+        (tld->mode & UFO_TASK_MODE_TYPE_MASK) != UFO_TASK_MODE_PROCESSOR)
+        return 0;
+
+    for (guint i = 0; i < tld->n_inputs; i++) {
+        guint batch_size;
+
+        if (tld->finished[i])
+            continue;
+
+        batch_size = ufo_buffer_get_batch_size (inputs[i]);
+
+        if (batch_size == 0)
+            continue;
+
+        if (requisition->n_dims < 2 || requisition->dims[requisition->n_dims - 1] != batch_size) {
+            g_warning ("%s: output for a batch of %u items does not stack %u items",
+                       ufo_task_node_get_identifier (UFO_TASK_NODE (tld->task)),
+                       batch_size, batch_size);
+            return 0;
+        }
+
+        return batch_size;
+    }
+
+    return 0;
+}
+
+static UfoBuffer *
+get_scratch (TaskLocalData *tld,
+             guint output,
+             UfoRequisition *requisition)
+{
+    if (tld->scratch[output] == NULL)
+        tld->scratch[output] = ufo_buffer_new (requisition, tld->context);
+    else if (ufo_buffer_cmp_dimensions (tld->scratch[output], requisition))
+        ufo_buffer_resize (tld->scratch[output], requisition);
+
+    return tld->scratch[output];
+}
+
+/*
+ * Any output port, including the first one, may have no consumers if only
+ * other ports are connected. Such an output is written into the scratch buffer
+ * of the task and never passed on.
+ */
+static gboolean
+has_consumers (TaskLocalData *tld,
+               guint output)
+{
+    UfoGroup *group;
+
+    group = ufo_task_node_get_output_group (UFO_TASK_NODE (tld->task), output);
+    return ufo_group_get_num_targets (group) > 0;
+}
+
+static UfoBuffer *
+pop_output (TaskLocalData *tld,
+            guint output,
+            UfoRequisition *requisition)
+{
+    UfoGroup *group;
+
+    group = ufo_task_node_get_output_group (UFO_TASK_NODE (tld->task), output);
+
+    if (has_consumers (tld, output))
+        return ufo_group_pop_output_buffer (group, requisition);
+
+    /* nobody consumes this output, so keep writing into the same buffer */
+    return get_scratch (tld, output, requisition);
+}
+
+static void
+push_output (TaskLocalData *tld,
+             guint output,
+             UfoBuffer *buffer)
+{
+    if (has_consumers (tld, output))
+        ufo_group_push_output_buffer (ufo_task_node_get_output_group (UFO_TASK_NODE (tld->task), output), buffer);
+}
+
+static void
+return_output (TaskLocalData *tld,
+               guint output,
+               UfoBuffer *buffer)
+{
+    if (has_consumers (tld, output))
+        ufo_group_return_output_buffer (ufo_task_node_get_output_group (UFO_TASK_NODE (tld->task), output), buffer);
+}
+
+/*
+ * Combine the partial states of the copies of a reductor. @output is %NULL if
+ * the copy did not receive any data, its subtree is then represented by the
+ * first partner that did. Returns %TRUE for the first copy, which then holds
+ * the merged state in @output, and %FALSE for all others once their state was
+ * handed on.
+ */
+static gboolean
+merge_partials (TaskLocalData *tld,
+                UfoBuffer *output)
+{
+    ReduceTree *tree = tld->tree;
+    UfoTask *holder = tld->task;
+
+    for (guint step = 1; step < tree->n_copies; step *= 2) {
+        guint partner;
+
+        if (tld->rank % (2 * step)) {
+            g_mutex_lock (tree->lock);
+            tree->holders[tld->rank] = holder;
+            tree->outputs[tld->rank] = output;
+            tree->merged[tld->rank] = TRUE;
+            g_cond_broadcast (tree->cond);
+            g_mutex_unlock (tree->lock);
+            return FALSE;
+        }
+
+        partner = tld->rank + step;
+
+        if (partner >= tree->n_copies)
+            continue;
+
+        g_mutex_lock (tree->lock);
+
+        while (!tree->merged[partner])
+            g_cond_wait (tree->cond, tree->lock);
+
+        g_mutex_unlock (tree->lock);
+
+        if (tree->outputs[partner] == NULL)
+            continue;
+
+        if (output == NULL) {
+            holder = tree->holders[partner];
+            output = tree->outputs[partner];
+        }
+        else {
+            ufo_task_merge (holder, output, tree->holders[partner], tree->outputs[partner]);
+        }
+    }
+
+    if (holder != tld->task) {
+        g_warning ("%s: first copy received no data, partial results are lost",
+                   ufo_task_node_get_identifier (UFO_TASK_NODE (tld->task)));
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+static void
+pop_extra_outputs (TaskLocalData *tld,
+                   UfoBuffer **inputs,
+                   UfoBuffer **outputs,
+                   UfoRequisition *requisitions)
+{
+    for (guint i = 1; i < tld->n_outputs; i++) {
+        ufo_task_get_output_requisition (tld->task, inputs, i, &requisitions[i]);
+        outputs[i] = pop_output (tld, i, &requisitions[i]);
+        g_assert (outputs[i] != NULL);
+
+        ufo_buffer_discard_location (outputs[i]);
+        ufo_buffer_set_batch_size (outputs[i], get_output_batch_size (tld, inputs, &requisitions[i]));
+
+        for (guint j = 0; j < tld->n_inputs; j++)
+            ufo_buffer_copy_metadata (inputs[j], outputs[i]);
+    }
+}
+
+static void
+push_extra_outputs (TaskLocalData *tld,
+                    UfoBuffer **outputs)
+{
+    for (guint i = 1; i < tld->n_outputs; i++)
+        push_output (tld, i, outputs[i]);
+}
+
+static void
+return_outputs (TaskLocalData *tld,
+                UfoBuffer *output,
+                UfoBuffer **outputs)
+{
+    /* a forwarded input is no output buffer of ours */
+    if (output != NULL)
+        return_output (tld, 0, output);
+
+    for (guint i = 1; i < tld->n_outputs; i++)
+        return_output (tld, i, outputs[i]);
+}
+
+static void
+finish_outputs (TaskLocalData *tld)
+{
+    for (guint i = 0; i < tld->n_outputs; i++)
+        ufo_group_finish (ufo_task_node_get_output_group (UFO_TASK_NODE (tld->task), i));
+}
+
+static gboolean
+process_outputs (TaskLocalData *tld,
+                 UfoBuffer **inputs,
+                 UfoBuffer *output,
+                 UfoBuffer **outputs,
+                 UfoRequisition *requisition,
+                 UfoRequisition *requisitions)
+{
+    if (tld->n_outputs > 1)
+        return ufo_task_process_outputs (tld->task, inputs, outputs, requisitions);
+
+    return ufo_task_process (tld->task, inputs, output, requisition);
+}
+
+static gboolean
+generate_outputs (TaskLocalData *tld,
+                  UfoBuffer *output,
+                  UfoBuffer **outputs,
+                  UfoRequisition *requisition,
+                  UfoRequisition *requisitions)
+{
+    if (tld->n_outputs > 1)
+        return ufo_task_generate_outputs (tld->task, outputs, requisitions);
+
+    return ufo_task_generate (tld->task, output, requisition);
+}
+
+static gboolean
+any (gboolean *values,
+     guint n_values)
+{
+    gboolean result = FALSE;
+
+    for (guint i = 0; i < n_values; i++)
+        result = result || values[i];
+
+    return result;
+}
+
+static gboolean
+has_window (TaskLocalData *tld)
+{
+    return tld->window.size > 0 || tld->window.duration > 0.0;
+}
+
+static void
+free_held_inputs (TaskLocalData *tld,
+                  HeldInputs *held)
+{
+    for (guint i = 0; i < tld->n_inputs; i++) {
+        if (held->inputs[i] != NULL)
+            g_object_unref (held->inputs[i]);
+    }
+
+    g_free (held->inputs);
+    g_free (held);
+}
+
+static void
+clear_held_inputs (TaskLocalData *tld)
+{
+    HeldInputs *held;
+
+    while ((held = g_queue_pop_head (tld->window.held)) != NULL)
+        free_held_inputs (tld, held);
+
+    while ((held = g_queue_pop_head (tld->window.spare)) != NULL)
+        free_held_inputs (tld, held);
+}
+
+/*
+ * Keep copies of @inputs for a sliding window because the buffers themselves
+ * go back to their producers. The copies of evicted items are reused, so that
+ * a window of steady size copies each item once without allocating.
+ */
+static void
+hold_inputs (TaskLocalData *tld,
+             UfoBuffer **inputs,
+             gdouble now)
+{
+    HeldInputs *held;
+
+    held = g_queue_pop_head (tld->window.spare);
+
+    if (held == NULL) {
+        held = g_new0 (HeldInputs, 1);
+        held->inputs = g_new0 (UfoBuffer *, tld->n_inputs);
+    }
+
+    held->time = now;
+
+    for (guint i = 0; i < tld->n_inputs; i++) {
+        UfoRequisition requisition;
+
+        if (tld->finished[i]) {
+            if (held->inputs[i] != NULL) {
+                g_object_unref (held->inputs[i]);
+                held->inputs[i] = NULL;
+            }
+
+            continue;
+        }
+
+        ufo_buffer_get_requisition (inputs[i], &requisition);
+
+        if (held->inputs[i] == NULL)
+            held->inputs[i] = ufo_buffer_dup (inputs[i]);
+        else if (ufo_buffer_cmp_dimensions (held->inputs[i], &requisition))
+            ufo_buffer_resize (held->inputs[i], &requisition);
+
+        ufo_buffer_copy (inputs[i], held->inputs[i]);
+    }
+
+    g_queue_push_tail (tld->window.held, held);
+}
+
+static void
+evict_inputs (TaskLocalData *tld,
+              UfoBuffer *state,
+              UfoRequisition *requisition,
+              gdouble now)
+{
+    ItemWindow *window = &tld->window;
+
+    while (!g_queue_is_empty (window->held)) {
+        HeldInputs *oldest;
+
+        oldest = g_queue_peek_head (window->held);
+
+        if (window->size > 0 ?
+            g_queue_get_length (window->held) <= window->size :
+            now - oldest->time <= window->duration)
+            break;
+
+        g_queue_pop_head (window->held);
+        ufo_task_remove (tld->task, oldest->inputs, state, requisition);
+        g_queue_push_tail (window->spare, oldest);
+    }
+}
+
+static gboolean
+ends_window (TaskLocalData *tld,
+             gdouble now)
+{
+    if (tld->window.size > 0)
+        return tld->window.n_added >= tld->window.step;
+
+    return now >= tld->window.next;
+}
+
+/*
+ * Generate the results of a tumbling window into @output and return the buffer
+ * the next window is reduced into.
+ */
+static UfoBuffer *
+generate_window (TaskLocalData *tld,
+                 UfoBuffer *output,
+                 UfoRequisition *requisition,
+                 UfoProfiler *profiler)
+{
+    UfoGroup *group;
+    gboolean go_on;
+
+    group = ufo_task_node_get_out_group (UFO_TASK_NODE (tld->task));
+
+    do {
+        ufo_profiler_trace_event (profiler, UFO_TRACE_EVENT_GENERATE | UFO_TRACE_EVENT_BEGIN);
+        ufo_profiler_start (profiler, UFO_PROFILER_TIMER_CPU);
+        go_on = ufo_task_generate (tld->task, output, requisition);
+        ufo_profiler_stop (profiler, UFO_PROFILER_TIMER_CPU);
+        ufo_profiler_trace_event (profiler, UFO_TRACE_EVENT_GENERATE | UFO_TRACE_EVENT_END);
+
+        if (go_on && !ufo_task_node_output_skipped (UFO_TASK_NODE (tld->task))) {
+            ufo_group_push_output_buffer (group, output);
+            output = ufo_group_pop_output_buffer (group, requisition);
+            ufo_buffer_set_batch_size (output, 0);
+        }
+    } while (go_on);
+
+    return output;
+}
+
+/*
+ * Generate one result of a sliding window from a copy of @state, so that the
+ * task can go on reducing into @state afterwards.
+ */
+static void
+generate_window_copy (TaskLocalData *tld,
+                      UfoBuffer *state,
+                      UfoRequisition *requisition,
+                      UfoProfiler *profiler)
+{
+    UfoGroup *group;
+    UfoBuffer *output;
+    gboolean result;
+
+    group = ufo_task_node_get_out_group (UFO_TASK_NODE (tld->task));
+    output = ufo_group_pop_output_buffer (group, requisition);
+    ufo_buffer_copy (state, output);
+    ufo_buffer_copy_metadata (state, output);
+    ufo_buffer_set_batch_size (output, 0);
+
+    ufo_profiler_trace_event (profiler, UFO_TRACE_EVENT_GENERATE | UFO_TRACE_EVENT_BEGIN);
+    ufo_profiler_start (profiler, UFO_PROFILER_TIMER_CPU);
+    result = ufo_task_generate (tld->task, output, requisition);
+    ufo_profiler_stop (profiler, UFO_PROFILER_TIMER_CPU);
+    ufo_profiler_trace_event (profiler, UFO_TRACE_EVENT_GENERATE | UFO_TRACE_EVENT_END);
+
+    if (result && !ufo_task_node_output_skipped (UFO_TASK_NODE (tld->task)))
+        ufo_group_push_output_buffer (group, output);
+    else
+        ufo_group_return_output_buffer (group, output);
+}
+
+/*
+ * Reduce the stream window by window, starting with @inputs and the @output
+ * buffer popped for them. Windows end after a number of items or when an item
+ * arrives after the window time is up, and the last one with the stream.
+ * Items the task skips do not count towards a window. If the task finishes,
+ * its last window ends and the rest of the stream is dropped.
+ */
+static void
+run_window (TaskLocalData *tld,
+            UfoBuffer **inputs,
+            UfoBuffer *output,
+            UfoRequisition *requisition,
+            UfoProfiler *profiler)
+{
+    ItemWindow *window = &tld->window;
+    UfoGroup *group;
+    UfoBuffer *state;
+    gboolean active = TRUE;
+
+    group = ufo_task_node_get_out_group (UFO_TASK_NODE (tld->task));
+    window->n_added = 0;
+    window->next = window->interval;
+    g_timer_start (window->timer);
+
+    if (window->sliding) {
+        state = get_scratch (tld, 0, requisition);
+        ufo_buffer_copy_metadata (output, state);
+        ufo_group_return_output_buffer (group, output);
+        output = NULL;
+    }
+    else
+        state = output;
+
+    while (active) {
+        gboolean result;
+        gdouble now;
+
+        ufo_profiler_trace_event (profiler, UFO_TRACE_EVENT_PROCESS | UFO_TRACE_EVENT_BEGIN);
+        ufo_profiler_start (profiler, UFO_PROFILER_TIMER_CPU);
+        result = ufo_task_process (tld->task, inputs, state, requisition);
+        ufo_profiler_stop (profiler, UFO_PROFILER_TIMER_CPU);
+        ufo_profiler_trace_event (profiler, UFO_TRACE_EVENT_PROCESS | UFO_TRACE_EVENT_END);
+
+        now = g_timer_elapsed (window->timer, NULL);
+
+        if (!ufo_task_node_output_skipped (UFO_TASK_NODE (tld->task))) {
+            window->n_added++;
+
+            if (window->sliding) {
+                hold_inputs (tld, inputs, now);
+                evict_inputs (tld, state, requisition, now);
+            }
+        }
+
+        release_inputs (tld, inputs);
+
+        if (!result) {
+            drain_inputs (tld);
+            active = FALSE;
+        }
+        else
+            active = get_inputs (tld, inputs);
+
+        /* the last window ends with the stream, even if it is not complete */
+        if (active ? !ends_window (tld, now) : window->n_added == 0)
+            continue;
+
+        window->n_added = 0;
+
+        while (window->duration > 0.0 && window->next <= now)
+            window->next += window->interval;
+
+        if (window->sliding)
+            generate_window_copy (tld, state, requisition, profiler);
+        else
+            state = output = generate_window (tld, output, requisition, profiler);
+    }
+
+    if (output != NULL)
+        ufo_group_return_output_buffer (group, output);
+}
+
+static void
+run_remote_task (TaskLocalData *tld)
+{
+    UfoRemoteNode *remote;
+    guint n_remote_gpus;
+    gboolean *alive;
+    gboolean active = TRUE;
+
+    remote = UFO_REMOTE_NODE (ufo_task_node_get_proc_node (UFO_TASK_NODE (tld->task)));
+    n_remote_gpus = ufo_remote_node_get_num_gpus (remote);
+    alive = g_new0 (gboolean, n_remote_gpus);
+
+    /*
+     * We launch a new thread for each incoming input data set because then we
+     * can send as many items as we have remote GPUs available without waiting
+     * for processing to stop.
+     */
+    while (active) {
+        for (guint i = 0; i < n_remote_gpus; i++) {
+            UfoBuffer *input = NULL;
+
+            if (get_inputs (tld, &input)) {
+                ufo_remote_node_send_inputs (remote, &input);
+                release_inputs (tld, &input);
+                alive[i] = TRUE;
+            }
+            else {
+                alive[i] = FALSE;
+            }
+        }
+
+        for (guint i = 0; i < n_remote_gpus; i++) {
+            UfoGroup *group;
+            UfoBuffer *output;
+            UfoRequisition requisition;
+
+            if (!alive[i])
+                continue;
+
+            ufo_remote_node_get_requisition (remote, &requisition);
+            group = ufo_task_node_get_out_group (UFO_TASK_NODE (tld->task));
+            output = ufo_group_pop_output_buffer (group, &requisition);
+            ufo_remote_node_get_result (remote, output);
+            ufo_group_push_output_buffer (group, output);
+        }
+
+        active = any (alive, n_remote_gpus);
+    }
+
+    g_free (alive);
+    ufo_group_finish (ufo_task_node_get_out_group (UFO_TASK_NODE (tld->task)));
+}
+
+/* kernel times are only known for profiled command queues */
+static gdouble
+get_kernel_time (UfoProfiler *profiler,
+                 UfoNode *proc_node)
+{
+    if (proc_node != NULL && UFO_IS_GPU_NODE (proc_node) &&
+        ufo_gpu_node_get_profiling (UFO_GPU_NODE (proc_node)))
+        return ufo_profiler_elapsed (profiler, UFO_PROFILER_TIMER_GPU);
+
+    return 0.0;
+}
+
+/*
+ * Kernels that a task waits for are part of its CPU time already, those that
+ * run asynchronously overlap with it, so the task takes at least the longer
+ * of both.
+ */
+static gdouble
+get_cost (UfoProfiler *profiler,
+          UfoNode *proc_node,
+          gdouble cpu_start,
+          gdouble kernel_start)
+{
+    return MAX (ufo_profiler_elapsed (profiler, UFO_PROFILER_TIMER_CPU) - cpu_start,
+                get_kernel_time (profiler, proc_node) - kernel_start);
+}
+
+/*
+ * Lower the priority of the calling thread for low-priority tasks. Raising it
+ * for high-priority tasks usually requires privileges and fails otherwise.
+ */
+static void
+set_thread_priority (UfoTaskNode *node)
+{
+#ifdef __linux__
+    UfoTaskPriority priority;
+
+    priority = ufo_task_node_get_priority (node);
+
+    if (priority == UFO_TASK_PRIORITY_NORMAL)
+        return;
+
+    /* the nice value of a Linux thread only applies to that thread */
+    if (setpriority (PRIO_PROCESS, (id_t) syscall (SYS_gettid),
+                     priority == UFO_TASK_PRIORITY_HIGH ? -5 : 10) < 0) {
+        g_debug ("%s: could not change thread priority: %s",
+                 ufo_task_node_get_identifier (node), g_strerror (errno));
+    }
+#endif
+}
+
+static gpointer
+run_task (TaskLocalData *tld)
+{
+    UfoBuffer *inputs[tld->n_inputs];
+    UfoBuffer *outputs[tld->n_outputs];
+    UfoRequisition requisitions[tld->n_outputs];
+    UfoBuffer *output;
+    UfoTaskNode *node;
+    UfoNode *proc_node;
+    UfoTaskMode mode;
+    UfoProfiler *profiler;
+    UfoRequisition requisition;
+    gboolean produces;
+    gboolean forward;
+    gboolean active;
+    gdouble cpu_start;
+    gdouble kernel_start;
+
+    node = UFO_TASK_NODE (tld->task);
+    active = TRUE;
+    output = NULL;
+    profiler = g_object_ref (ufo_task_node_get_profiler (node));
+
+    for (guint i = 0; i < tld->n_inputs; i++)
+        inputs[i] = NULL;
+
+    if (UFO_IS_REMOTE_TASK (tld->task)) {
+        run_remote_task (tld);
+        return NULL;
+    }
+
+    /* use the same compute queue as the task for stacking batches */
+    proc_node = ufo_task_node_get_proc_node (node);
+    tld->queue = ufo_task_node_get_cmd_queue (node);
+
+    set_thread_priority (node);
+
+    /* the time spent in this run is the task cost for the next mapping */
+    cpu_start = ufo_profiler_elapsed (profiler, UFO_PROFILER_TIMER_CPU);
+    kernel_start = get_kernel_time (profiler, proc_node);
+
+    /* mode without CPU/GPU flag */
+    mode = tld->mode & UFO_TASK_MODE_TYPE_MASK;
+
+    /* only the first copy of a replicated reductor passes data on */
+    produces = mode != UFO_TASK_MODE_SINK && tld->rank == 0;
+
+    while (active) {
+        UfoGroup *group;
+
+        group = ufo_task_node_get_out_group (node);
+
+        /* Get input buffers */
+        active = get_inputs (tld, inputs);
+
+        if (!active) {
+            /* a copy of a reductor without any share still takes part */
+            if (tld->tree != NULL)
+                merge_partials (tld, NULL);
+
+            finish_outputs (tld);
+            break;
+        }
+
+        /* Get output buffers */
+        if (tld->mode & UFO_TASK_MODE_STATIC_REQUISITION) {
+            /* allocate all output buffers as soon as the size is known */
+            if (ufo_task_node_lookup_requisition (node, inputs, tld->n_inputs, &requisition) && produces &&
+                !can_process_inplace (tld, inputs, &requisition))
+                ufo_group_allocate_buffers (group, &requisition);
+        }
+        else
+            ufo_task_get_requisition (tld->task, inputs, &requisition);
+
+        /* Pass the first input on as output without taking an output buffer */
+        forward = produces && can_process_inplace (tld, inputs, &requisition);
+
+        if (forward) {
+            output = inputs[0];
+        }
+        else if (produces) {
+            output = pop_output (tld, 0, &requisition);
+            g_assert (output != NULL);
+        }
+        else if (tld->tree != NULL) {
+            output = get_scratch (tld, 0, &requisition);
+        }
+
+        if (output != NULL) {
+            if (!forward)
+                ufo_buffer_discard_location (output);
+
+            ufo_buffer_set_batch_size (output, get_output_batch_size (tld, inputs, &requisition));
+
+            for (guint i = 0; i < tld->n_inputs; i++) {
+                if (inputs[i] != output)
+                    ufo_buffer_copy_metadata (inputs[i], output);
+            }
+        }
+
+        if (tld->n_outputs > 1) {
+            outputs[0] = output;
+            requisitions[0] = requisition;
+            pop_extra_outputs (tld, inputs, outputs, requisitions);
+        }
+
+        switch (mode) {
+            case UFO_TASK_MODE_PROCESSOR:
+            case UFO_TASK_MODE_SINK:
+                ufo_profiler_trace_event (profiler, UFO_TRACE_EVENT_PROCESS | UFO_TRACE_EVENT_BEGIN);
+                ufo_profiler_start (profiler, UFO_PROFILER_TIMER_CPU);
+                active = process_outputs (tld, inputs, output, outputs, &requisition, requisitions);
+                ufo_profiler_stop (profiler, UFO_PROFILER_TIMER_CPU);
+                ufo_profiler_trace_event (profiler, UFO_TRACE_EVENT_PROCESS | UFO_TRACE_EVENT_END);
+                break;
+
+            case UFO_TASK_MODE_REDUCTOR:
+                if (has_window (tld)) {
+                    run_window (tld, inputs, output, &requisition, profiler);
+                    active = FALSE;
+                    break;
+                }
+
+                do {
+                    gboolean go_on = TRUE;
+
+                    do {
+                        ufo_profiler_trace_event (profiler, UFO_TRACE_EVENT_PROCESS | UFO_TRACE_EVENT_BEGIN);
+                        ufo_profiler_start (profiler, UFO_PROFILER_TIMER_CPU);
+                        go_on = process_outputs (tld, inputs, output, outputs, &requisition, requisitions);
+                        ufo_profiler_stop (profiler, UFO_PROFILER_TIMER_CPU);
+                        ufo_profiler_trace_event (profiler, UFO_TRACE_EVENT_PROCESS | UFO_TRACE_EVENT_END);
+
+                        release_inputs (tld, inputs);
+                        active = get_inputs (tld, inputs);
+                        go_on = go_on && active;
+                    } while (go_on);
+
+                    if (tld->tree != NULL) {
+                        /* other copies only generate through the first one */
+                        if (active && tld->rank > 0)
+                            continue;
+
+                        if (!active && !merge_partials (tld, output))
+                            break;
+                    }
+
+                    do {
+                        ufo_profiler_trace_event (profiler, UFO_TRACE_EVENT_GENERATE | UFO_TRACE_EVENT_BEGIN);
+                        ufo_profiler_start (profiler, UFO_PROFILER_TIMER_CPU);
+                        go_on = generate_outputs (tld, output, outputs, &requisition, requisitions);
+                        ufo_profiler_stop (profiler, UFO_PROFILER_TIMER_CPU);
+                        ufo_profiler_trace_event (profiler, UFO_TRACE_EVENT_GENERATE | UFO_TRACE_EVENT_END);
+
+                        /* a skipped item keeps its buffer for the next one */
+                        if (go_on && !ufo_task_node_output_skipped (node)) {
+                            push_output (tld, 0, output);
+                            output = pop_output (tld, 0, &requisition);
+                            ufo_buffer_set_batch_size (output, 0);
+
+                            if (tld->n_outputs > 1) {
+                                push_extra_outputs (tld, outputs);
+                                outputs[0] = output;
+
+                                for (guint i = 1; i < tld->n_outputs; i++) {
+                                    outputs[i] = pop_output (tld, i, &requisitions[i]);
+                                    ufo_buffer_set_batch_size (outputs[i], 0);
+                                }
+                            }
+                        }
+                    } while (go_on);
+                } while (active);
+
+                break;
+
+            case UFO_TASK_MODE_GENERATOR:
+                ufo_profiler_trace_event (profiler, UFO_TRACE_EVENT_GENERATE | UFO_TRACE_EVENT_BEGIN);
+                ufo_profiler_start (profiler, UFO_PROFILER_TIMER_CPU);
+                active = generate_outputs (tld, output, outputs, &requisition, requisitions);
+                ufo_profiler_stop (profiler, UFO_PROFILER_TIMER_CPU);
+                ufo_profiler_trace_event (profiler, UFO_TRACE_EVENT_GENERATE | UFO_TRACE_EVENT_END);
+                break;
+
+            default:
+                g_warning ("Invalid task mode: %i\n", mode);
+        }
+
+        if (active && produces && (mode != UFO_TASK_MODE_REDUCTOR)) {
+            if (ufo_task_node_output_skipped (node)) {
+                /* recycle the buffers that came from our groups */
+                return_outputs (tld, forward ? NULL : output, outputs);
+            }
+            else {
+                push_output (tld, 0, output);
+
+                if (tld->n_outputs > 1)
+                    push_extra_outputs (tld, outputs);
+
+                if (forward) {
+                    forget_input (tld, 0, inputs[0]);
+                    inputs[0] = NULL;
+                }
+            }
+        }
+
+        /* Release buffers for further consumption */
+        if (active)
+            release_inputs (tld, inputs);
+
+        if (!active)
+            finish_outputs (tld);
+    }
+
+    ufo_task_node_set_cost (node, get_cost (profiler, proc_node, cpu_start, kernel_start));
+    g_object_unref (profiler);
+    return NULL;
+}
+
+static void
+cleanup_task_local_data (TaskLocalData **tlds,
+                         guint n)
+{
+    for (guint i = 0; i < n; i++) {
+        TaskLocalData *tld = tlds[i];
 
         ufo_task_node_reset (UFO_TASK_NODE (tld->task));
 
+        for (guint j = 0; j < tld->n_inputs; j++) {
+            InputBatch *batch = &tld->batches[j];
+
+            if (batch->item != NULL)
+                g_object_unref (batch->item);
+
+            if (batch->partial != NULL)
+                g_object_unref (batch->partial);
+
+            if (batch->stacked != NULL)
+                g_object_unref (batch->stacked);
+
+            if (tld->orders[j].sources != NULL) {
+                clear_held_items (&tld->orders[j]);
+
+                for (guint k = 0; k < tld->orders[j].n_groups; k++)
+                    g_queue_free (tld->orders[j].held[k]);
+
+                g_free (tld->orders[j].groups);
+                g_free (tld->orders[j].held);
+                g_free (tld->orders[j].finished);
+                g_hash_table_destroy (tld->orders[j].sources);
+            }
+        }
+
+        for (guint j = 0; j < tld->n_outputs; j++) {
+            if (tld->scratch[j] != NULL)
+                g_object_unref (tld->scratch[j]);
+        }
+
+        if (tld->window.held != NULL) {
+            clear_held_inputs (tld);
+            g_queue_free (tld->window.held);
+            g_queue_free (tld->window.spare);
+            g_timer_destroy (tld->window.timer);
+        }
+
+        g_free (tld->scratch);
+        g_free (tld->batches);
+        g_free (tld->orders);
         g_free (tld->dims);
         g_free (tld->finished);
         g_free (tld);
@@ -372,34 +1648,119 @@ check_target_connections (UfoTaskGraph *graph,
 
         label = ufo_graph_get_edge_label (UFO_GRAPH (graph),
                                           UFO_NODE (it->data), target);
-        input = GPOINTER_TO_INT (label);
+        input = UFO_EDGE_INPUT (label);
         g_assert (input >= 0 && input < 16);
         connection_bitmap |= 1 << input;
     }
 
-    mask = (1 << n_inputs) - 1;
+    mask = (1 << n_inputs) - 1;
+
+    /* Check if mask matches what we have */
+    if ((mask & connection_bitmap) != mask) {
+        g_set_error (error, UFO_SCHEDULER_ERROR, UFO_SCHEDULER_ERROR_SETUP,
+                     "Not all inputs of `%s' are connected",
+                     ufo_task_node_get_plugin_name (UFO_TASK_NODE (target)));
+
+        result = FALSE;
+    }
+
+    g_list_free (predecessors);
+    return result;
+}
+
+static gboolean
+check_source_connections (UfoTaskGraph *graph,
+                          UfoNode *source,
+                          guint n_outputs,
+                          GError **error)
+{
+    GList *successors;
+    GList *it;
+    gboolean result = TRUE;
+
+    successors = ufo_graph_get_successors (UFO_GRAPH (graph), source);
+
+    g_list_for (successors, it) {
+        gpointer label;
+
+        label = ufo_graph_get_edge_label (UFO_GRAPH (graph), source, UFO_NODE (it->data));
+
+        if (UFO_EDGE_OUTPUT (label) >= n_outputs) {
+            g_set_error (error, UFO_SCHEDULER_ERROR, UFO_SCHEDULER_ERROR_SETUP,
+                         "`%s' has no output %u",
+                         ufo_task_node_get_plugin_name (UFO_TASK_NODE (source)),
+                         UFO_EDGE_OUTPUT (label));
+            result = FALSE;
+            break;
+        }
+    }
+
+    g_list_free (successors);
+    return result;
+}
+
+static ReduceTree *
+find_tree (GList *trees,
+           UfoTask *task,
+           guint *rank)
+{
+    GList *it;
+
+    g_list_for (trees, it) {
+        ReduceTree *tree = (ReduceTree *) it->data;
+
+        for (guint i = 0; i < tree->n_copies; i++) {
+            if (tree->copies[i] == task) {
+                *rank = i;
+                return tree;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+static void
+setup_window (TaskLocalData *tld)
+{
+    UfoTaskNode *node = UFO_TASK_NODE (tld->task);
+    ItemWindow *window = &tld->window;
 
-    /* Check if mask matches what we have */
-    if ((mask & connection_bitmap) != mask) {
-        g_set_error (error, UFO_SCHEDULER_ERROR, UFO_SCHEDULER_ERROR_SETUP,
-                     "Not all inputs of `%s' are connected",
-                     ufo_task_node_get_plugin_name (UFO_TASK_NODE (target)));
+    ufo_task_node_get_window (node, &window->size, &window->step);
+    ufo_task_node_get_time_window (node, &window->duration, &window->interval);
 
-        result = FALSE;
+    if (!has_window (tld))
+        return;
+
+    if ((tld->mode & UFO_TASK_MODE_TYPE_MASK) != UFO_TASK_MODE_REDUCTOR || tld->n_outputs > 1) {
+        g_warning ("%s: windows are only supported for reductors with one output",
+                   ufo_task_node_get_identifier (node));
+        window->size = 0;
+        window->duration = 0.0;
+        return;
     }
 
-    g_list_free (predecessors);
-    return result;
+    if (window->size > 0)
+        window->sliding = window->step < window->size;
+    else
+        window->sliding = window->interval < window->duration;
+
+    window->held = g_queue_new ();
+    window->spare = g_queue_new ();
+    window->timer = g_timer_new ();
 }
 
 static TaskLocalData **
 setup_tasks (UfoBaseScheduler *scheduler,
              UfoTaskGraph *task_graph,
+             GList *trees,
+             guint *n_tasks,
              GError **error)
 {
     UfoResources *resources;
     TaskLocalData **tlds;
     GList *nodes;
+    GList *it;
     guint n_nodes;
     gboolean tracing_enabled;
 
@@ -407,7 +1768,17 @@ setup_tasks (UfoBaseScheduler *scheduler,
     g_object_get (scheduler, "enable-tracing", &tracing_enabled, NULL);
 
     nodes = ufo_graph_get_nodes (UFO_GRAPH (task_graph));
+
+    /* copies of replicated reductors run like any other task */
+    g_list_for (trees, it) {
+        ReduceTree *tree = (ReduceTree *) it->data;
+
+        for (guint i = 1; i < tree->n_copies; i++)
+            nodes = g_list_append (nodes, tree->copies[i]);
+    }
+
     n_nodes = g_list_length (nodes);
+    *n_tasks = n_nodes;
 
     tlds = g_new0 (TaskLocalData *, n_nodes);
 
@@ -419,6 +1790,7 @@ setup_tasks (UfoBaseScheduler *scheduler,
         node = g_list_nth_data (nodes, i);
         tld = g_new0 (TaskLocalData, 1);
         tld->task = UFO_TASK (node);
+        tld->tree = find_tree (trees, tld->task, &tld->rank);
         tlds[i] = tld;
 
         ufo_task_setup (tld->task, resources, error);
@@ -426,200 +1798,859 @@ setup_tasks (UfoBaseScheduler *scheduler,
         tld->n_inputs = ufo_task_get_num_inputs (tld->task);
         tld->dims = g_new0 (guint, tld->n_inputs);
 
-        /* TODO: make this configurable from outside */
-        tld->strict = FALSE;
+        /* TODO: make this configurable from outside */
+        tld->strict = FALSE;
+
+        for (guint j = 0; j < tld->n_inputs; j++)
+            tld->dims[j] = ufo_task_get_num_dimensions (tld->task, j);
+
+        tld->context = ufo_resources_get_context (resources);
+        tld->batches = g_new0 (InputBatch, tld->n_inputs);
+        tld->orders = g_new0 (InputOrder, tld->n_inputs);
+
+        for (guint j = 0; j < tld->n_inputs; j++) {
+            tld->batches[j].size = ufo_task_node_get_batch_size (UFO_TASK_NODE (node), j);
+            tld->orders[j].window = ufo_task_node_get_reorder_window (UFO_TASK_NODE (node), j);
+        }
+
+        tld->n_outputs = MIN (ufo_task_get_num_outputs (tld->task), 16);
+        tld->scratch = g_new0 (UfoBuffer *, tld->n_outputs);
+        tld->finished = g_new0 (gboolean, tld->n_inputs);
+        setup_window (tld);
+
+        if ((error && *error != NULL) ||
+            (tld->rank == 0 &&
+             (!check_target_connections (task_graph, node, tld->n_inputs, error) ||
+              !check_source_connections (task_graph, node, tld->n_outputs, error)))) {
+            cleanup_task_local_data (tlds, i + 1);
+            g_list_free (nodes);
+            return NULL;
+        }
+
+        profiler = ufo_task_node_get_profiler (UFO_TASK_NODE (node));
+        ufo_profiler_enable_tracing (profiler, tracing_enabled);
+    }
+
+    g_list_free (nodes);
+
+    return tlds;
+}
+
+/*
+ * Spread the tasks of each GPU over its compute queues, so that the kernels of
+ * different tasks can overlap while the commands of each task stay in order.
+ * High-priority tasks share a queue that nothing else uses.
+ */
+static void
+assign_cmd_queues (TaskLocalData **tlds,
+                   guint n_tasks)
+{
+    GHashTable *n_assigned;
+
+    n_assigned = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+    for (guint i = 0; i < n_tasks; i++) {
+        UfoTaskNode *node;
+        UfoNode *proc_node;
+        UfoGpuNode *gpu;
+        guint index;
+
+        node = UFO_TASK_NODE (tlds[i]->task);
+        proc_node = ufo_task_node_get_proc_node (node);
+
+        if (proc_node == NULL || !UFO_IS_GPU_NODE (proc_node))
+            continue;
+
+        gpu = UFO_GPU_NODE (proc_node);
+
+        if (ufo_task_node_get_priority (node) == UFO_TASK_PRIORITY_HIGH) {
+            ufo_task_node_set_cmd_queue (node, ufo_gpu_node_get_priority_queue (gpu));
+            continue;
+        }
+
+        index = GPOINTER_TO_UINT (g_hash_table_lookup (n_assigned, gpu));
+        g_hash_table_insert (n_assigned, gpu, GUINT_TO_POINTER (index + 1));
+        ufo_task_node_set_cmd_queue (node, ufo_gpu_node_get_cmd_queue_for (gpu, index));
+    }
+
+    g_hash_table_destroy (n_assigned);
+}
+
+static gboolean
+runs_on_cpu_device (UfoNode *node)
+{
+    UfoNode *proc_node;
+
+    proc_node = ufo_task_node_get_proc_node (UFO_TASK_NODE (node));
+    return proc_node != NULL && UFO_IS_GPU_NODE (proc_node) &&
+           ufo_gpu_node_is_cpu_device (UFO_GPU_NODE (proc_node));
+}
+
+static gboolean
+has_fallback_targets (GList *targets)
+{
+    GList *it;
+    gboolean on_cpu = FALSE;
+    gboolean on_gpu = FALSE;
+
+    g_list_for (targets, it) {
+        if (runs_on_cpu_device (UFO_NODE (it->data)))
+            on_cpu = TRUE;
+        else
+            on_gpu = TRUE;
+    }
+
+    return on_cpu && on_gpu;
+}
+
+static guint
+get_num_scattering (UfoTaskGraph *task_graph,
+                    GList *nodes)
+{
+    GList *it;
+    guint n_scattering = 0;
+
+    g_list_for (nodes, it) {
+        if (ufo_task_node_get_send_pattern (UFO_TASK_NODE (it->data)) == UFO_SEND_SCATTER &&
+            ufo_graph_get_num_successors (UFO_GRAPH (task_graph), UFO_NODE (it->data)) > 1)
+            n_scattering++;
+    }
+
+    return n_scattering;
+}
+
+/*
+ * Copies of a replicated reductor share the groups of its input with the
+ * reductor, so that each of them gets a share of the stream.
+ */
+static GList *
+add_copies (GList *targets,
+            GList *trees)
+{
+    GList *result = NULL;
+    GList *it;
+
+    g_list_for (targets, it) {
+        ReduceTree *tree;
+        guint rank;
+
+        result = g_list_append (result, it->data);
+        tree = find_tree (trees, UFO_TASK (it->data), &rank);
+
+        for (guint i = 1; tree != NULL && i < tree->n_copies; i++)
+            result = g_list_append (result, tree->copies[i]);
+    }
+
+    g_list_free (targets);
+    return result;
+}
+
+/*
+ * A branch that joins at a reordering input must be able to fill the window
+ * on its own, otherwise it could wait for buffers held back at the join
+ * while the join waits for an item of another branch.
+ */
+static guint
+get_in_group_depth (UfoTaskNode *target,
+                    guint input)
+{
+    guint depth;
+    guint window;
+
+    depth = ufo_task_node_get_queue_depth (target, input);
+    window = ufo_task_node_get_reorder_window (target, input);
+
+    if (window > 0 && (depth == UFO_QUEUE_DEPTH_AUTO || depth <= window))
+        return window + 1;
+
+    return depth;
+}
+
+static GList *
+setup_groups (UfoBaseScheduler *scheduler,
+              UfoTaskGraph *task_graph,
+              GList *trees)
+{
+    UfoResources *resources;
+    GList *groups;
+    GList *nodes;
+    GList *it;
+    cl_context context;
+    guint n_scattering;
+
+    groups = NULL;
+    nodes = ufo_graph_get_nodes (UFO_GRAPH (task_graph));
+    resources = ufo_base_scheduler_get_resources (scheduler);
+    context = ufo_resources_get_context (resources);
+    n_scattering = get_num_scattering (task_graph, nodes);
+
+    g_list_for (nodes, it) {
+        UfoNode *node;
+        GList *successors;
+        guint n_outputs;
+
+        node = UFO_NODE (it->data);
+        successors = ufo_graph_get_successors (UFO_GRAPH (task_graph), node);
+        n_outputs = MIN (ufo_task_get_num_outputs (UFO_TASK (node)), 16);
+
+        for (guint output = 0; output < n_outputs; output++) {
+            GList *targets = NULL;
+            GList *jt;
+            UfoGroup *group;
+            UfoSendPattern pattern;
+
+            g_list_for (successors, jt) {
+                gpointer label = ufo_graph_get_edge_label (UFO_GRAPH (task_graph), node, UFO_NODE (jt->data));
+
+                if (UFO_EDGE_OUTPUT (label) == output)
+                    targets = g_list_append (targets, jt->data);
+            }
+
+            targets = add_copies (targets, trees);
+            pattern = ufo_task_node_get_send_pattern (UFO_TASK_NODE (node));
+
+            /*
+             * Targets on a CPU device should only get items when the GPUs are
+             * saturated. Several scattering nodes must keep their round-robin
+             * order though, because their items are matched by position.
+             */
+            if (pattern == UFO_SEND_SCATTER && n_scattering == 1 && has_fallback_targets (targets))
+                pattern = UFO_SEND_LEAST_LOADED;
+
+            group = ufo_group_new (targets, context, pattern);
+            groups = g_list_append (groups, group);
+            ufo_task_node_set_output_group (UFO_TASK_NODE (node), output, group);
+
+            g_list_for (targets, jt) {
+                UfoNode *target;
+                ReduceTree *tree;
+                gpointer label;
+                guint input;
+                guint rank;
+
+                /* copies are connected like the reductor in the graph */
+                target = UFO_NODE (jt->data);
+                tree = find_tree (trees, UFO_TASK (target), &rank);
+                label = ufo_graph_get_edge_label (UFO_GRAPH (task_graph), node,
+                                                  tree != NULL ? UFO_NODE (tree->copies[0]) : target);
+                input = UFO_EDGE_INPUT (label);
+                ufo_task_node_add_in_group (UFO_TASK_NODE (target), input, group);
+
+                if (runs_on_cpu_device (target) && has_fallback_targets (targets))
+                    ufo_group_set_fallback (group, UFO_TASK (target), TRUE);
+
+                ufo_group_set_depth (group, UFO_TASK (target),
+                                     get_in_group_depth (UFO_TASK_NODE (target), input));
+
+                if (ufo_task_node_get_drop_oldest (UFO_TASK_NODE (target), input))
+                    ufo_group_set_drop_oldest (group, UFO_TASK (target), TRUE);
+
+                ufo_group_set_num_expected (group, UFO_TASK (target),
+                                            ufo_task_node_get_num_expected (UFO_TASK_NODE (target),
+                                                                            input));
+            }
+
+            g_list_free (targets);
+        }
+
+        g_list_free (successors);
+    }
+
+    /* copies of a reductor do not pass anything on */
+    g_list_for (trees, it) {
+        ReduceTree *tree = (ReduceTree *) it->data;
+
+        for (guint i = 1; i < tree->n_copies; i++) {
+            UfoGroup *group;
+
+            group = ufo_group_new (NULL, context, UFO_SEND_SCATTER);
+            groups = g_list_append (groups, group);
+            ufo_task_node_set_out_group (UFO_TASK_NODE (tree->copies[i]), group);
+        }
+    }
+
+    g_list_free (nodes);
+    return groups;
+}
+
+static gboolean
+correct_connections (UfoTaskGraph *graph,
+                     GError **error)
+{
+    GList *nodes;
+    GList *it;
+    gboolean result = TRUE;
+
+    nodes = ufo_graph_get_nodes (UFO_GRAPH (graph));
+
+    g_list_for (nodes, it) {
+        UfoTaskNode *node;
+        UfoTaskMode mode;
+        guint n_outputs;
+        guint n_targets = 0;
+
+        node = UFO_TASK_NODE (it->data);
+        mode = ufo_task_get_mode (UFO_TASK (node)) & UFO_TASK_MODE_TYPE_MASK;
+        n_outputs = MIN (ufo_task_get_num_outputs (UFO_TASK (node)), 16);
+
+        /* one connected output port is enough */
+        for (guint i = 0; i < n_outputs; i++)
+            n_targets += ufo_group_get_num_targets (ufo_task_node_get_output_group (node, i));
+
+        if (((mode == UFO_TASK_MODE_GENERATOR) || (mode == UFO_TASK_MODE_REDUCTOR)) &&
+            n_targets < 1) {
+            g_set_error (error, UFO_SCHEDULER_ERROR, UFO_SCHEDULER_ERROR_SETUP,
+                         "No outgoing node for `%s'",
+                         ufo_task_node_get_identifier (node));
+            result = FALSE;
+            break;
+        }
+    }
+
+    g_list_free (nodes);
+    return result;
+}
+
+static void
+replicate_task_graph (UfoTaskGraph *graph,
+                      UfoResources *resources)
+{
+    GList *remotes;
+    GList *it;
+    guint n_graphs;
+    guint idx = 1;
+
+    remotes = ufo_resources_get_remote_nodes (resources);
+    n_graphs = g_list_length (remotes) + 1;
+
+    g_list_for (remotes, it) {
+        UfoRemoteNode *node;
+        gchar *json;
+
+        /* Set partition idx for the remote task graph */
+        ufo_task_graph_set_partition (graph, idx++, n_graphs);
+        json = ufo_task_graph_get_json_data (graph, NULL);
+        node = UFO_REMOTE_NODE (it->data);
+        ufo_remote_node_send_json (node, UFO_REMOTE_MODE_REPLICATE, json);
+        g_free (json);
+    }
+
+    /* Set partition index for the local task graph */
+    ufo_task_graph_set_partition (graph, 0, n_graphs);
+    g_list_free (remotes);
+}
+
+static void
+propagate_partition (UfoTaskGraph *graph)
+{
+    GList *nodes;
+    GList *it;
+    guint idx;
+    guint total;
+
+    ufo_task_graph_get_partition (graph, &idx, &total);
+    nodes = ufo_graph_get_nodes (UFO_GRAPH (graph));
+
+    g_list_for (nodes, it) {
+        ufo_task_node_set_partition (UFO_TASK_NODE (it->data), idx, total);
+    }
+
+    g_list_free (nodes);
+}
+
+/*
+ * A reductor can be replicated if it merges partial states and all of its
+ * input is scattered, so that each copy sees a different share of the stream.
+ */
+static gboolean
+can_replicate (UfoTaskGraph *graph,
+               UfoTask *task)
+{
+    GList *predecessors;
+    GList *it;
+    guint size;
+    gdouble duration;
+    gboolean result;
+
+    if ((ufo_task_get_mode (task) & UFO_TASK_MODE_TYPE_MASK) != UFO_TASK_MODE_REDUCTOR ||
+        !ufo_task_uses_gpu (task) || !ufo_task_can_merge (task) ||
+        ufo_task_get_num_inputs (task) != 1 || ufo_task_get_num_outputs (task) != 1)
+        return FALSE;
+
+    /* windows end at points of the whole stream, not of a share */
+    ufo_task_node_get_window (UFO_TASK_NODE (task), &size, NULL);
+    ufo_task_node_get_time_window (UFO_TASK_NODE (task), &duration, NULL);
+
+    if (size > 0 || duration > 0.0)
+        return FALSE;
+
+    predecessors = ufo_graph_get_predecessors (UFO_GRAPH (graph), UFO_NODE (task));
+    result = predecessors != NULL;
+
+    g_list_for (predecessors, it) {
+        if (ufo_task_node_get_send_pattern (UFO_TASK_NODE (it->data)) != UFO_SEND_SCATTER)
+            result = FALSE;
+    }
+
+    g_list_free (predecessors);
+    return result;
+}
+
+static void
+free_reduce_tree (ReduceTree *tree)
+{
+    for (guint i = 1; i < tree->n_copies; i++)
+        g_object_unref (tree->copies[i]);
+
+    g_free (tree->copies);
+    g_free (tree->holders);
+    g_free (tree->outputs);
+    g_free (tree->merged);
+    g_mutex_free (tree->lock);
+    g_cond_free (tree->cond);
+    g_free (tree);
+}
+
+/*
+ * Create a copy of each mergeable reductor for every other GPU. The copies are
+ * not part of the graph.
+ */
+static GList *
+replicate_reductors (UfoTaskGraph *graph,
+                     GList *gpu_nodes)
+{
+    GList *devices = NULL;
+    GList *trees = NULL;
+    GList *nodes;
+    GList *it;
+    guint n_devices;
+
+    g_list_for (gpu_nodes, it) {
+        if (!ufo_gpu_node_is_cpu_device (UFO_GPU_NODE (it->data)))
+            devices = g_list_append (devices, it->data);
+    }
 
-        for (guint j = 0; j < tld->n_inputs; j++)
-            tld->dims[j] = ufo_task_get_num_dimensions (tld->task, j);
+    n_devices = g_list_length (devices);
+    nodes = ufo_graph_get_nodes (UFO_GRAPH (graph));
 
-        if (!check_target_connections (task_graph, node, tld->n_inputs, error)) {
-            return NULL;
-        }
+    g_list_for (nodes, it) {
+        UfoTask *task;
+        ReduceTree *tree;
+        gint first;
+
+        task = UFO_TASK (it->data);
+
+        if (n_devices < 2 || !can_replicate (graph, task))
+            continue;
+
+        first = g_list_index (devices, ufo_task_node_get_proc_node (UFO_TASK_NODE (task)));
+
+        tree = g_new0 (ReduceTree, 1);
+        tree->copies = g_new0 (UfoTask *, n_devices);
+        tree->holders = g_new0 (UfoTask *, n_devices);
+        tree->outputs = g_new0 (UfoBuffer *, n_devices);
+        tree->merged = g_new0 (gboolean, n_devices);
+        tree->lock = g_mutex_new ();
+        tree->cond = g_cond_new ();
+        tree->copies[0] = task;
+        tree->n_copies = 1;
+
+        for (guint i = 1; i < n_devices; i++) {
+            UfoNode *copy;
+            UfoNode *device;
+            GError *error = NULL;
+
+            copy = ufo_node_copy (UFO_NODE (task), &error);
+
+            if (error != NULL) {
+                g_warning ("Could not copy `%s': %s",
+                           ufo_task_node_get_identifier (UFO_TASK_NODE (task)), error->message);
+                g_error_free (error);
+                break;
+            }
 
-        profiler = ufo_task_node_get_profiler (UFO_TASK_NODE (node));
-        ufo_profiler_enable_tracing (profiler, tracing_enabled);
+            device = UFO_NODE (g_list_nth_data (devices, (MAX (first, 0) + i) % n_devices));
+            ufo_task_node_set_proc_node (UFO_TASK_NODE (copy), device);
+            tree->copies[tree->n_copies++] = UFO_TASK (copy);
+        }
 
-        tld->finished = g_new0 (gboolean, tld->n_inputs);
+        g_debug ("Reduce %s with %u copies",
+                 ufo_task_node_get_identifier (UFO_TASK_NODE (task)), tree->n_copies);
 
-        if (error && *error != NULL) {
-            return NULL;
-        }
+        trees = g_list_append (trees, tree);
     }
 
     g_list_free (nodes);
-
-    return tlds;
+    g_list_free (devices);
+    return trees;
 }
 
-static GList *
-setup_groups (UfoBaseScheduler *scheduler,
-              UfoTaskGraph *task_graph)
+static void
+log_dispatch_stats (UfoTaskGraph *graph)
 {
-    UfoResources *resources;
-    GList *groups;
     GList *nodes;
     GList *it;
-    cl_context context;
 
-    groups = NULL;
-    nodes = ufo_graph_get_nodes (UFO_GRAPH (task_graph));
-    resources = ufo_base_scheduler_get_resources (scheduler);
-    context = ufo_resources_get_context (resources);
+    nodes = ufo_graph_get_nodes (UFO_GRAPH (graph));
 
     g_list_for (nodes, it) {
+        UfoTaskNode *node;
+        UfoGroup *group;
         GList *successors;
         GList *jt;
-        UfoNode *node;
-        UfoGroup *group;
-        UfoSendPattern pattern;
 
-        node = UFO_NODE (it->data);
-        successors = ufo_graph_get_successors (UFO_GRAPH (task_graph), node);
-        pattern = ufo_task_node_get_send_pattern (UFO_TASK_NODE (node));
+        node = UFO_TASK_NODE (it->data);
+        group = ufo_task_node_get_out_group (node);
 
-        group = ufo_group_new (successors, context, pattern);
-        groups = g_list_append (groups, group);
-        ufo_task_node_set_out_group (UFO_TASK_NODE (node), group);
+        if (group == NULL || ufo_group_get_num_targets (group) < 2)
+            continue;
+
+        successors = ufo_graph_get_successors (UFO_GRAPH (graph), UFO_NODE (node));
 
         g_list_for (successors, jt) {
-            UfoNode *target;
-            gpointer label;
-            guint input;
+            guint n_sent;
+            gdouble service_time;
+            gdouble busy_time;
 
-            target = UFO_NODE (jt->data);
-            label = ufo_graph_get_edge_label (UFO_GRAPH (task_graph), node, target);
-            input = (guint) GPOINTER_TO_INT (label);
-            ufo_task_node_add_in_group (UFO_TASK_NODE (target), input, group);
-            ufo_group_set_num_expected (group, UFO_TASK (target),
-                                        ufo_task_node_get_num_expected (UFO_TASK_NODE (target),
-                                                                        input));
+            if (UFO_EDGE_OUTPUT (ufo_graph_get_edge_label (UFO_GRAPH (graph), UFO_NODE (node), UFO_NODE (jt->data))) != 0)
+                continue;
+
+            ufo_group_get_target_stats (group, UFO_TASK (jt->data), &n_sent, &service_time, &busy_time);
+            g_debug ("%s -> %s: %u items, %.3f ms/item, busy %.3f s",
+                     ufo_task_node_get_identifier (node),
+                     ufo_task_node_get_identifier (UFO_TASK_NODE (jt->data)),
+                     n_sent, service_time * 1000.0, busy_time);
         }
 
+        g_debug ("%s: dispatch fairness %.3f",
+                 ufo_task_node_get_identifier (node), ufo_group_get_fairness (group));
+
         g_list_free (successors);
     }
 
     g_list_free (nodes);
-    return groups;
 }
 
-static gboolean
-correct_connections (UfoTaskGraph *graph,
-                     GError **error)
-{
-    GList *nodes;
-    GList *it;
-    gboolean result = TRUE;
+struct _UfoPreparedGraph {
+    UfoTaskGraph    *graph;
+    UfoResources    *resources;
+    TaskLocalData  **tlds;
+    GList           *groups;
+    GList           *trees;
+    guint            n_nodes;
+    GThread        **threads;
+    gboolean         trace;
+    UfoMemoryBudget *budget;
+
+    /* Pass control, protected by lock */
+    GMutex          *lock;
+    GCond           *started;
+    GCond           *finished;
+    guint            pass;
+    guint            n_running;
+    gboolean         closing;
+};
 
-    nodes = ufo_graph_get_nodes (UFO_GRAPH (graph));
+/*
+ * Each node keeps its thread for the lifetime of a prepared graph and runs the
+ * task once per pass.
+ */
+static gpointer
+run_worker (TaskLocalData *tld)
+{
+    UfoPreparedGraph *prepared = tld->prepared;
+    guint pass = 0;
 
-    g_list_for (nodes, it) {
-        UfoTaskNode *node;
-        UfoTaskMode mode;
-        UfoGroup *group;
+    while (TRUE) {
+        g_mutex_lock (prepared->lock);
 
-        node = UFO_TASK_NODE (it->data);
-        mode = ufo_task_get_mode (UFO_TASK (node)) & UFO_TASK_MODE_TYPE_MASK;
-        group = ufo_task_node_get_out_group (node);
+        while (!prepared->closing && prepared->pass == pass)
+            g_cond_wait (prepared->started, prepared->lock);
 
-        if (((mode == UFO_TASK_MODE_GENERATOR) || (mode == UFO_TASK_MODE_REDUCTOR)) &&
-            ufo_group_get_num_targets (group) < 1) {
-            g_set_error (error, UFO_SCHEDULER_ERROR, UFO_SCHEDULER_ERROR_SETUP,
-                         "No outgoing node for `%s'",
-                         ufo_task_node_get_identifier (node));
-            result = FALSE;
+        if (prepared->closing) {
+            g_mutex_unlock (prepared->lock);
             break;
         }
+
+        pass = prepared->pass;
+        g_mutex_unlock (prepared->lock);
+
+        run_task (tld);
+
+        g_mutex_lock (prepared->lock);
+
+        if (--prepared->n_running == 0)
+            g_cond_broadcast (prepared->finished);
+
+        g_mutex_unlock (prepared->lock);
     }
 
-    g_list_free (nodes);
-    return result;
+    return NULL;
 }
 
 static void
-replicate_task_graph (UfoTaskGraph *graph,
-                      UfoResources *resources)
+reset_task_local_data (TaskLocalData *tld)
 {
-    GList *remotes;
+    for (guint i = 0; i < tld->n_inputs; i++) {
+        InputBatch *batch = &tld->batches[i];
+        InputOrder *order = &tld->orders[i];
+
+        tld->finished[i] = FALSE;
+        batch->drained = FALSE;
+        batch->pending = NULL;
+        batch->source = NULL;
+        batch->next = 0;
+
+        if (batch->item != NULL) {
+            g_object_unref (batch->item);
+            batch->item = NULL;
+        }
+
+        if (order->sources != NULL) {
+            clear_held_items (order);
+
+            for (guint j = 0; j < order->n_groups; j++)
+                order->finished[j] = FALSE;
+
+            order->current = 0;
+            order->next = 0;
+            g_hash_table_remove_all (order->sources);
+        }
+    }
+
+    if (tld->window.held != NULL)
+        clear_held_inputs (tld);
+}
+
+/*
+ * Get the output of a task with static requisition if the outputs of all its
+ * predecessors are known. The requisition is cached by the task node, so it
+ * is not asked again for the first item.
+ */
+static gboolean
+lookup_static_output (UfoTaskGraph *graph,
+                      GHashTable *known,
+                      TaskLocalData *tld,
+                      StaticOutput *output)
+{
+    UfoBuffer *inputs[tld->n_inputs];
+    UfoRequisition first;
+    GList *predecessors;
     GList *it;
-    guint n_graphs;
-    guint idx = 1;
+    gboolean complete = TRUE;
 
-    remotes = ufo_resources_get_remote_nodes (resources);
-    n_graphs = g_list_length (remotes) + 1;
+    for (guint i = 0; i < tld->n_inputs; i++)
+        inputs[i] = NULL;
 
-    g_list_for (remotes, it) {
-        UfoRemoteNode *node;
-        gchar *json;
+    predecessors = ufo_graph_get_predecessors (UFO_GRAPH (graph), UFO_NODE (tld->task));
 
-        /* Set partition idx for the remote task graph */
-        ufo_task_graph_set_partition (graph, idx++, n_graphs);
-        json = ufo_task_graph_get_json_data (graph, NULL);
-        node = UFO_REMOTE_NODE (it->data);
-        ufo_remote_node_send_json (node, UFO_REMOTE_MODE_REPLICATE, json);
-        g_free (json);
+    g_list_for (predecessors, it) {
+        StaticOutput *source;
+        gpointer label;
+        guint input;
+
+        source = g_hash_table_lookup (known, it->data);
+        label = ufo_graph_get_edge_label (UFO_GRAPH (graph), UFO_NODE (it->data), UFO_NODE (tld->task));
+        input = UFO_EDGE_INPUT (label);
+
+        /* only the first output of a task is planned */
+        if (source == NULL || UFO_EDGE_OUTPUT (label) != 0 || input >= tld->n_inputs) {
+            complete = FALSE;
+            break;
+        }
+
+        if (inputs[input] == NULL)
+            inputs[input] = ufo_buffer_new (&source->requisition, NULL);
     }
 
-    /* Set partition index for the local task graph */
-    ufo_task_graph_set_partition (graph, 0, n_graphs);
-    g_list_free (remotes);
+    g_list_free (predecessors);
+
+    for (guint i = 0; i < tld->n_inputs; i++)
+        complete = complete && inputs[i] != NULL;
+
+    if (complete) {
+        ufo_task_node_lookup_requisition (UFO_TASK_NODE (tld->task), inputs, tld->n_inputs,
+                                          &output->requisition);
+
+        output->forwards = FALSE;
+
+        if ((tld->mode & UFO_TASK_MODE_INPLACE) &&
+            (tld->mode & UFO_TASK_MODE_TYPE_MASK) == UFO_TASK_MODE_PROCESSOR && tld->n_inputs > 0) {
+            ufo_buffer_get_requisition (inputs[0], &first);
+            output->forwards = same_requisition (&first, &output->requisition) &&
+                               ufo_group_can_forward (ufo_task_node_get_out_group (UFO_TASK_NODE (tld->task)));
+        }
+    }
+
+    for (guint i = 0; i < tld->n_inputs; i++) {
+        if (inputs[i] != NULL)
+            g_object_unref (inputs[i]);
+    }
+
+    return complete;
 }
 
-static void
-propagate_partition (UfoTaskGraph *graph)
+/*
+ * Find the outputs of all tasks whose output size is known at setup, i.e. of
+ * tasks with static requisition that only depend on other such tasks.
+ */
+static GHashTable *
+find_static_outputs (UfoTaskGraph *graph,
+                     TaskLocalData **tlds,
+                     guint n_tasks)
 {
-    GList *nodes;
+    GHashTable *known;
+    gboolean progress;
+
+    known = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, g_free);
+
+    do {
+        progress = FALSE;
+
+        for (guint i = 0; i < n_tasks; i++) {
+            TaskLocalData *tld = tlds[i];
+            StaticOutput output;
+
+            /* batches are stacked at run time and copies are not in the graph */
+            if (!(tld->mode & UFO_TASK_MODE_STATIC_REQUISITION) || (tld->mode & UFO_TASK_MODE_BATCH) ||
+                tld->rank > 0 || UFO_IS_REMOTE_TASK (tld->task) ||
+                g_hash_table_lookup (known, tld->task) != NULL)
+                continue;
+
+            if (lookup_static_output (graph, known, tld, &output)) {
+                g_hash_table_insert (known, tld->task, g_memdup (&output, sizeof (StaticOutput)));
+                progress = TRUE;
+            }
+        }
+    } while (progress);
+
+    return known;
+}
+
+/*
+ * Allocate the output buffers of all tasks whose output size is known at
+ * setup. Each group gets its fewest buffers before any group gets more, so
+ * that the order of allocation does not decide which queues are cut short.
+ * Fails if not even the fewest buffers fit into @budget.
+ */
+static gboolean
+plan_static_buffers (UfoTaskGraph *graph,
+                     TaskLocalData **tlds,
+                     guint n_tasks,
+                     UfoMemoryBudget *budget,
+                     GError **error)
+{
+    GHashTable *known;
+    GList *groups = NULL;
+    GList *outputs = NULL;
     GList *it;
-    guint idx;
-    guint total;
+    GList *jt;
+    gsize required = 0;
+    gsize limit;
+    gboolean fits;
 
-    ufo_task_graph_get_partition (graph, &idx, &total);
-    nodes = ufo_graph_get_nodes (UFO_GRAPH (graph));
+    known = find_static_outputs (graph, tlds, n_tasks);
 
-    g_list_for (nodes, it) {
-        ufo_task_node_set_partition (UFO_TASK_NODE (it->data), idx, total);
+    for (guint i = 0; i < n_tasks; i++) {
+        TaskLocalData *tld = tlds[i];
+        StaticOutput *output;
+        UfoGroup *group;
+
+        output = g_hash_table_lookup (known, tld->task);
+
+        if (output == NULL || output->forwards ||
+            (tld->mode & UFO_TASK_MODE_TYPE_MASK) == UFO_TASK_MODE_SINK)
+            continue;
+
+        group = ufo_task_node_get_out_group (UFO_TASK_NODE (tld->task));
+
+        if (ufo_group_get_num_targets (group) == 0)
+            continue;
+
+        required += ufo_group_get_min_size (group, &output->requisition);
+        groups = g_list_append (groups, group);
+        outputs = g_list_append (outputs, output);
     }
 
-    g_list_free (nodes);
+    limit = ufo_memory_budget_get_limit (budget);
+    fits = limit == 0 || required <= limit;
+
+    if (fits) {
+        for (it = groups, jt = outputs; it != NULL; it = g_list_next (it), jt = g_list_next (jt))
+            ufo_group_allocate_min_buffers (UFO_GROUP (it->data), &((StaticOutput *) jt->data)->requisition);
+
+        for (it = groups, jt = outputs; it != NULL; it = g_list_next (it), jt = g_list_next (jt))
+            ufo_group_allocate_buffers (UFO_GROUP (it->data), &((StaticOutput *) jt->data)->requisition);
+    }
+    else {
+        g_set_error (error, UFO_SCHEDULER_ERROR, UFO_SCHEDULER_ERROR_SETUP,
+                     "Memory budget of %" G_GSIZE_FORMAT " bytes is too small, tasks with "
+                     "static output size need at least %" G_GSIZE_FORMAT " bytes",
+                     limit, required);
+    }
+
+    g_list_free (groups);
+    g_list_free (outputs);
+    g_hash_table_destroy (known);
+    return fits;
 }
 
 static void
-join_threads (GThread **threads, guint n_threads)
+wait_for_pass (UfoPreparedGraph *prepared)
 {
-    for (guint i = 0; i < n_threads; i++)
-        g_thread_join (threads[i]);
+    g_mutex_lock (prepared->lock);
+
+    while (prepared->n_running > 0)
+        g_cond_wait (prepared->finished, prepared->lock);
+
+    g_mutex_unlock (prepared->lock);
 }
 
-static void
-ufo_scheduler_run (UfoBaseScheduler *scheduler,
-                   UfoTaskGraph *task_graph,
-                   GError **error)
+/*
+ * Expand and map @task_graph, set up all tasks, connect them with groups and
+ * start one idle thread per node. Passes are run with
+ * ufo_prepared_graph_start() and ufo_prepared_graph_wait().
+ */
+UfoPreparedGraph *
+ufo_scheduler_prepare (UfoScheduler *scheduler,
+                       UfoTaskGraph *task_graph,
+                       GError **error)
 {
     UfoSchedulerPrivate *priv;
     UfoResources *resources;
     UfoTaskGraph *graph;
+    UfoPreparedGraph *prepared;
     GList *gpu_nodes;
     GList *groups;
-    guint n_nodes;
-    GThread **threads;
+    GList *trees;
     TaskLocalData **tlds;
+    UfoMemoryBudget *budget;
+    guint n_tasks;
     gboolean expand;
     gboolean trace;
+    UfoMappingStrategy mapping;
+    guint64 memory_budget;
 
     priv = UFO_SCHEDULER_GET_PRIVATE (scheduler);
 
     g_object_get (scheduler,
                   "enable-tracing", &trace,
                   "expand", &expand,
+                  "mapping", &mapping,
+                  "memory-budget", &memory_budget,
                   NULL);
 
     graph = task_graph;
-    resources = ufo_base_scheduler_get_resources (scheduler);
+    resources = ufo_base_scheduler_get_resources (UFO_BASE_SCHEDULER (scheduler));
     gpu_nodes = ufo_resources_get_gpu_nodes (resources);
 
     if (priv->mode == UFO_REMOTE_MODE_REPLICATE) {
         replicate_task_graph (graph, resources);
     }
 
+    if (!priv->ran)
+        ufo_task_graph_merge_common (graph);
+
     if (expand) {
         gboolean expand_remote = priv->mode == UFO_REMOTE_MODE_STREAM;
 
@@ -629,55 +2660,174 @@ ufo_scheduler_run (UfoBaseScheduler *scheduler,
             g_debug ("Task graph already expanded, skipping.");
     }
 
+    priv->ran = TRUE;
     propagate_partition (graph);
-    ufo_task_graph_map (graph, gpu_nodes);
+
+    if (mapping == UFO_MAPPING_COST)
+        ufo_task_graph_map_balanced (graph, gpu_nodes);
+    else
+        ufo_task_graph_map (graph, gpu_nodes);
+
+    trees = expand ? replicate_reductors (graph, gpu_nodes) : NULL;
+    g_list_free (gpu_nodes);
 
     /* Prepare task structures */
-    tlds = setup_tasks (scheduler, graph, error);
+    tlds = setup_tasks (UFO_BASE_SCHEDULER (scheduler), graph, trees, &n_tasks, error);
 
     if (tlds == NULL) {
-        return;
+        g_list_foreach (trees, (GFunc) free_reduce_tree, NULL);
+        g_list_free (trees);
+        return NULL;
     }
 
-    groups = setup_groups (scheduler, graph);
-
-    if (!correct_connections (graph, error))
-        return;
+    assign_cmd_queues (tlds, n_tasks);
+    groups = setup_groups (UFO_BASE_SCHEDULER (scheduler), graph, trees);
+    budget = ufo_memory_budget_new ((gsize) memory_budget);
+    g_list_foreach (groups, (GFunc) ufo_group_set_memory_budget, budget);
+
+    if (!correct_connections (graph, error) ||
+        !plan_static_buffers (graph, tlds, n_tasks, budget, error)) {
+        cleanup_task_local_data (tlds, n_tasks);
+        g_list_foreach (groups, (GFunc) g_object_unref, NULL);
+        g_list_free (groups);
+        g_list_foreach (trees, (GFunc) free_reduce_tree, NULL);
+        g_list_free (trees);
+        ufo_memory_budget_free (budget);
+        return NULL;
+    }
 
-    n_nodes = ufo_graph_get_num_nodes (UFO_GRAPH (graph));
-    threads = g_new0 (GThread *, n_nodes);
+    prepared = g_new0 (UfoPreparedGraph, 1);
+    prepared->graph = graph;
+    prepared->resources = resources;
+    prepared->tlds = tlds;
+    prepared->groups = groups;
+    prepared->trees = trees;
+    prepared->trace = trace;
+    prepared->n_nodes = n_tasks;
+    prepared->threads = g_new0 (GThread *, prepared->n_nodes);
+    prepared->lock = g_mutex_new ();
+    prepared->started = g_cond_new ();
+    prepared->finished = g_cond_new ();
+    prepared->budget = budget;
 
     /* Spawn threads */
-    for (guint i = 0; i < n_nodes; i++) {
-        threads[i] = g_thread_create ((GThreadFunc) run_task, tlds[i], TRUE, error);
+    for (guint i = 0; i < prepared->n_nodes; i++) {
+        tlds[i]->prepared = prepared;
+        prepared->threads[i] = g_thread_create ((GThreadFunc) run_worker, tlds[i], TRUE, error);
 
-        if (error && (*error != NULL))
-            return;
+        if (error && (*error != NULL)) {
+            prepared->n_nodes = i;
+            ufo_prepared_graph_free (prepared);
+            return NULL;
+        }
+    }
+
+    return prepared;
+}
+
+/*
+ * Generators other than input tasks ran out of data in the previous pass. Set
+ * them up again so that they start from the beginning, like they would in a
+ * new run of the scheduler.
+ */
+static gboolean
+restart_generators (UfoPreparedGraph *prepared,
+                    GError **error)
+{
+    for (guint i = 0; i < prepared->n_nodes; i++) {
+        TaskLocalData *tld = prepared->tlds[i];
+        GError *tmp_error = NULL;
+
+        if ((tld->mode & UFO_TASK_MODE_TYPE_MASK) != UFO_TASK_MODE_GENERATOR ||
+            UFO_IS_INPUT_TASK (tld->task))
+            continue;
+
+        ufo_task_setup (tld->task, prepared->resources, &tmp_error);
+
+        if (tmp_error != NULL) {
+            g_propagate_error (error, tmp_error);
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+/*
+ * Start a pass over the data produced by the generators. Buffers and groups are
+ * reset from the previous pass, only generators are set up again.
+ */
+gboolean
+ufo_prepared_graph_start (UfoPreparedGraph *prepared,
+                          GError **error)
+{
+    GList *nodes;
+    GList *it;
+
+    wait_for_pass (prepared);
+
+    if (prepared->pass > 0) {
+        if (!restart_generators (prepared, error))
+            return FALSE;
+
+        g_list_foreach (prepared->groups, (GFunc) ufo_group_reset, NULL);
+
+        for (guint i = 0; i < prepared->n_nodes; i++)
+            reset_task_local_data (prepared->tlds[i]);
+
+        g_list_for (prepared->trees, it) {
+            ReduceTree *tree = (ReduceTree *) it->data;
+
+            for (guint i = 0; i < tree->n_copies; i++)
+                tree->merged[i] = FALSE;
+        }
+    }
+
+    nodes = ufo_graph_get_nodes (UFO_GRAPH (prepared->graph));
+
+    g_list_for (nodes, it) {
+        if (UFO_IS_INPUT_TASK (it->data))
+            ufo_input_task_start (UFO_INPUT_TASK (it->data));
     }
 
+    g_list_free (nodes);
+
+    g_mutex_lock (prepared->lock);
+    prepared->n_running = prepared->n_nodes;
+    prepared->pass++;
+    g_cond_broadcast (prepared->started);
+    g_mutex_unlock (prepared->lock);
+    return TRUE;
+}
+
+/*
+ * Wait until the current pass has finished.
+ */
+void
+ufo_prepared_graph_wait (UfoPreparedGraph *prepared)
+{
 #ifdef WITH_PYTHON
     if (Py_IsInitialized ()) {
         PyGILState_STATE state = PyGILState_Ensure ();
         Py_BEGIN_ALLOW_THREADS
 
-        join_threads (threads, n_nodes);
+        wait_for_pass (prepared);
 
         Py_END_ALLOW_THREADS
         PyGILState_Release (state);
     }
     else {
-        join_threads (threads, n_nodes);
+        wait_for_pass (prepared);
     }
 #else
-    join_threads (threads, n_nodes);
+    wait_for_pass (prepared);
 #endif
 
-    /* Cleanup */
-    if (trace) {
+    if (prepared->trace) {
         GList *nodes = NULL;
 
-        for (guint i = 0; i < n_nodes; i++) {
-            nodes = g_list_append (nodes, tlds[i]->task);
+        for (guint i = 0; i < prepared->n_nodes; i++) {
+            nodes = g_list_append (nodes, prepared->tlds[i]->task);
         }
 
         ufo_write_profile_events (nodes);
@@ -686,12 +2836,58 @@ ufo_scheduler_run (UfoBaseScheduler *scheduler,
         g_list_free (nodes);
     }
 
-    cleanup_task_local_data (tlds, n_nodes);
-    g_list_foreach (groups, (GFunc) g_object_unref, NULL);
-    g_list_free (groups);
-    g_free (threads);
+    log_dispatch_stats (prepared->graph);
+    g_debug ("Allocated %" G_GSIZE_FORMAT " bytes for buffers between tasks",
+             ufo_memory_budget_get_used (prepared->budget));
+}
 
-    priv->ran = TRUE;
+/*
+ * Wait for a running pass, stop all threads and release tasks, groups and
+ * their buffers.
+ */
+void
+ufo_prepared_graph_free (UfoPreparedGraph *prepared)
+{
+    wait_for_pass (prepared);
+
+    g_mutex_lock (prepared->lock);
+    prepared->closing = TRUE;
+    g_cond_broadcast (prepared->started);
+    g_mutex_unlock (prepared->lock);
+
+    for (guint i = 0; i < prepared->n_nodes; i++)
+        g_thread_join (prepared->threads[i]);
+
+    cleanup_task_local_data (prepared->tlds, prepared->n_nodes);
+    g_list_foreach (prepared->groups, (GFunc) g_object_unref, NULL);
+    g_list_free (prepared->groups);
+    g_list_foreach (prepared->trees, (GFunc) free_reduce_tree, NULL);
+    g_list_free (prepared->trees);
+    g_free (prepared->threads);
+    ufo_memory_budget_free (prepared->budget);
+
+    g_mutex_free (prepared->lock);
+    g_cond_free (prepared->started);
+    g_cond_free (prepared->finished);
+    g_free (prepared);
+}
+
+static void
+ufo_scheduler_run (UfoBaseScheduler *scheduler,
+                   UfoTaskGraph *task_graph,
+                   GError **error)
+{
+    UfoPreparedGraph *prepared;
+
+    prepared = ufo_scheduler_prepare (UFO_SCHEDULER (scheduler), task_graph, error);
+
+    if (prepared == NULL)
+        return;
+
+    if (ufo_prepared_graph_start (prepared, error))
+        ufo_prepared_graph_wait (prepared);
+
+    ufo_prepared_graph_free (prepared);
 }
 
 static void
@@ -0,0 +1,307 @@
+/*
+ * Copyright (C) 2011-2015 Karlsruhe Institute of Technology
+ *
+ * This file is part of Ufo.
+ *
+ * This library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <ufo/ufo-session.h>
+#include "ufo-priv.h"
+
+/**
+ * SECTION:ufo-session
+ * @Short_description: Run a task graph repeatedly
+ * @Title: UfoSession
+ *
+ * A session expands and maps a task graph, sets up its tasks and connects them
+ * once with the rules of the #UfoScheduler it is created with. Each run then
+ * reuses the node threads, the buffers between the tasks and the kernels
+ * built during setup, which pays off when the same graph processes many small
+ * data sets.
+ *
+ * New data is fed through #UfoInputTask nodes: call ufo_session_start(),
+ * release input buffers with ufo_input_task_release_input_buffer(), stop the
+ * input with ufo_input_task_stop() and collect the results before
+ * ufo_session_wait() returns. ufo_session_run() is a shortcut for graphs whose
+ * generators produce new data on their own.
+ *
+ * Generators other than #UfoInputTask are set up again before each run, so
+ * that they start from the beginning of their data. All other tasks are set
+ * up only once, properties that they read in their setup function do not
+ * change between runs.
+ */
+
+G_DEFINE_TYPE (UfoSession, ufo_session, G_TYPE_OBJECT)
+
+#define UFO_SESSION_GET_PRIVATE(obj) (G_TYPE_INSTANCE_GET_PRIVATE((obj), UFO_TYPE_SESSION, UfoSessionPrivate))
+
+struct _UfoSessionPrivate {
+    UfoScheduler     *scheduler;
+    UfoTaskGraph     *graph;
+    UfoPreparedGraph *prepared;
+    GTimer           *timer;
+    gboolean          running;
+    guint             n_runs;
+};
+
+/**
+ * UfoSessionError:
+ * @UFO_SESSION_ERROR_STATE: Session is closed or a run was started or waited
+ *  for twice
+ */
+GQuark
+ufo_session_error_quark (void)
+{
+    return g_quark_from_static_string ("ufo-session-error-quark");
+}
+
+/**
+ * ufo_session_new:
+ * @scheduler: A #UfoScheduler whose settings are used for the session
+ * @graph: A #UfoTaskGraph
+ * @error: Location for a GError or %NULL
+ *
+ * Prepare @graph for repeated runs. Tasks are set up and threads are started,
+ * but no data is processed until ufo_session_start() or ufo_session_run() is
+ * called.
+ *
+ * Returns: (transfer full): A new #UfoSession or %NULL on error.
+ *
+ * Since: 0.8
+ */
+UfoSession *
+ufo_session_new (UfoScheduler *scheduler,
+                 UfoTaskGraph *graph,
+                 GError **error)
+{
+    UfoSession *session;
+    UfoSessionPrivate *priv;
+    GError *tmp_error = NULL;
+
+    g_return_val_if_fail (UFO_IS_SCHEDULER (scheduler), NULL);
+    g_return_val_if_fail (UFO_IS_TASK_GRAPH (graph), NULL);
+
+    if (!ufo_base_scheduler_begin_run (UFO_BASE_SCHEDULER (scheduler), graph, error))
+        return NULL;
+
+    session = UFO_SESSION (g_object_new (UFO_TYPE_SESSION, NULL));
+    priv = session->priv;
+    priv->scheduler = g_object_ref (scheduler);
+    priv->graph = g_object_ref (graph);
+    priv->prepared = ufo_scheduler_prepare (scheduler, graph, &tmp_error);
+
+    if (priv->prepared == NULL) {
+        /* close the run begun above without saving costs */
+        ufo_base_scheduler_end_run (UFO_BASE_SCHEDULER (scheduler), graph, 0.0, &tmp_error);
+        g_propagate_error (error, tmp_error);
+        g_object_unref (session);
+        return NULL;
+    }
+
+    return session;
+}
+
+/**
+ * ufo_session_start:
+ * @session: A #UfoSession
+ * @error: Location for a GError or %NULL
+ *
+ * Start processing a new stream without waiting for its end. Buffers left
+ * from the previous run are returned to their producers first and generators
+ * are set up again.
+ *
+ * Returns: %TRUE if the run was started.
+ *
+ * Since: 0.8
+ */
+gboolean
+ufo_session_start (UfoSession *session,
+                   GError **error)
+{
+    UfoSessionPrivate *priv;
+
+    g_return_val_if_fail (UFO_IS_SESSION (session), FALSE);
+    priv = session->priv;
+
+    if (priv->prepared == NULL) {
+        g_set_error (error, UFO_SESSION_ERROR, UFO_SESSION_ERROR_STATE,
+                     "Session is closed");
+        return FALSE;
+    }
+
+    if (priv->running) {
+        g_set_error (error, UFO_SESSION_ERROR, UFO_SESSION_ERROR_STATE,
+                     "Session is already running");
+        return FALSE;
+    }
+
+    g_timer_start (priv->timer);
+
+    if (!ufo_prepared_graph_start (priv->prepared, error))
+        return FALSE;
+
+    priv->running = TRUE;
+    return TRUE;
+}
+
+/**
+ * ufo_session_wait:
+ * @session: A #UfoSession
+ * @error: Location for a GError or %NULL
+ *
+ * Wait until all tasks finished the stream started with ufo_session_start().
+ * Task costs are saved afterwards if the scheduler has a cost file.
+ *
+ * Returns: %TRUE on success, %FALSE if the costs could not be saved.
+ *
+ * Since: 0.8
+ */
+gboolean
+ufo_session_wait (UfoSession *session,
+                  GError **error)
+{
+    UfoSessionPrivate *priv;
+
+    g_return_val_if_fail (UFO_IS_SESSION (session), FALSE);
+    priv = session->priv;
+
+    if (!priv->running) {
+        g_set_error (error, UFO_SESSION_ERROR, UFO_SESSION_ERROR_STATE,
+                     "Session is not running");
+        return FALSE;
+    }
+
+    ufo_prepared_graph_wait (priv->prepared);
+    priv->running = FALSE;
+    priv->n_runs++;
+
+    return ufo_base_scheduler_end_run (UFO_BASE_SCHEDULER (priv->scheduler), priv->graph,
+                                       g_timer_elapsed (priv->timer, NULL), error);
+}
+
+/**
+ * ufo_session_run:
+ * @session: A #UfoSession
+ * @error: Location for a GError or %NULL
+ *
+ * Process one stream and wait for its end.
+ *
+ * Returns: %TRUE on success.
+ *
+ * Since: 0.8
+ */
+gboolean
+ufo_session_run (UfoSession *session,
+                 GError **error)
+{
+    if (!ufo_session_start (session, error))
+        return FALSE;
+
+    return ufo_session_wait (session, error);
+}
+
+/**
+ * ufo_session_close:
+ * @session: A #UfoSession
+ *
+ * Wait for a running stream, stop all threads and release the buffers and
+ * task resources of @session. Closing is implied when the last reference to
+ * @session is dropped.
+ *
+ * Since: 0.8
+ */
+void
+ufo_session_close (UfoSession *session)
+{
+    UfoSessionPrivate *priv;
+
+    g_return_if_fail (UFO_IS_SESSION (session));
+    priv = session->priv;
+
+    if (priv->prepared == NULL)
+        return;
+
+    ufo_prepared_graph_free (priv->prepared);
+    priv->prepared = NULL;
+    priv->running = FALSE;
+}
+
+/**
+ * ufo_session_get_num_runs:
+ * @session: A #UfoSession
+ *
+ * Get the number of completed runs.
+ *
+ * Returns: Number of runs.
+ *
+ * Since: 0.8
+ */
+guint
+ufo_session_get_num_runs (UfoSession *session)
+{
+    g_return_val_if_fail (UFO_IS_SESSION (session), 0);
+    return session->priv->n_runs;
+}
+
+static void
+ufo_session_dispose (GObject *object)
+{
+    UfoSessionPrivate *priv;
+
+    priv = UFO_SESSION_GET_PRIVATE (object);
+
+    ufo_session_close (UFO_SESSION (object));
+
+    if (priv->graph) {
+        g_object_unref (priv->graph);
+        priv->graph = NULL;
+    }
+
+    if (priv->scheduler) {
+        g_object_unref (priv->scheduler);
+        priv->scheduler = NULL;
+    }
+
+    G_OBJECT_CLASS (ufo_session_parent_class)->dispose (object);
+}
+
+static void
+ufo_session_finalize (GObject *object)
+{
+    UfoSessionPrivate *priv;
+
+    priv = UFO_SESSION_GET_PRIVATE (object);
+    g_timer_destroy (priv->timer);
+
+    G_OBJECT_CLASS (ufo_session_parent_class)->finalize (object);
+}
+
+static void
+ufo_session_class_init (UfoSessionClass *klass)
+{
+    GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+
+    gobject_class->dispose = ufo_session_dispose;
+    gobject_class->finalize = ufo_session_finalize;
+
+    g_type_class_add_private (gobject_class, sizeof(UfoSessionPrivate));
+}
+
+static void
+ufo_session_init (UfoSession *session)
+{
+    session->priv = UFO_SESSION_GET_PRIVATE (session);
+    session->priv->timer = g_timer_new ();
+}
@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2011-2015 Karlsruhe Institute of Technology
+ *
+ * This file is part of Ufo.
+ *
+ * This library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __UFO_SESSION_H
+#define __UFO_SESSION_H
+
+#if !defined (__UFO_H_INSIDE__) && !defined (UFO_COMPILATION)
+#error "Only <ufo/ufo.h> can be included directly."
+#endif
+
+#include <ufo/ufo-scheduler.h>
+#include <ufo/ufo-task-graph.h>
+
+G_BEGIN_DECLS
+
+#define UFO_TYPE_SESSION             (ufo_session_get_type())
+#define UFO_SESSION(obj)             (G_TYPE_CHECK_INSTANCE_CAST((obj), UFO_TYPE_SESSION, UfoSession))
+#define UFO_IS_SESSION(obj)          (G_TYPE_CHECK_INSTANCE_TYPE((obj), UFO_TYPE_SESSION))
+#define UFO_SESSION_CLASS(klass)     (G_TYPE_CHECK_CLASS_CAST((klass), UFO_TYPE_SESSION, UfoSessionClass))
+#define UFO_IS_SESSION_CLASS(klass)  (G_TYPE_CHECK_CLASS_TYPE((klass), UFO_TYPE_SESSION))
+#define UFO_SESSION_GET_CLASS(obj)   (G_TYPE_INSTANCE_GET_CLASS((obj), UFO_TYPE_SESSION, UfoSessionClass))
+
+#define UFO_SESSION_ERROR            ufo_session_error_quark()
+
+typedef struct _UfoSession           UfoSession;
+typedef struct _UfoSessionClass      UfoSessionClass;
+typedef struct _UfoSessionPrivate    UfoSessionPrivate;
+
+typedef enum {
+    UFO_SESSION_ERROR_STATE
+} UfoSessionError;
+
+/**
+ * UfoSession:
+ *
+ * A task graph that is set up once and run repeatedly. The contents of the
+ * #UfoSession structure are private and should only be accessed via the
+ * provided API.
+ */
+struct _UfoSession {
+    /*< private >*/
+    GObject parent_instance;
+
+    UfoSessionPrivate *priv;
+};
+
+/**
+ * UfoSessionClass:
+ *
+ * #UfoSession class
+ */
+struct _UfoSessionClass {
+    /*< private >*/
+    GObjectClass parent_class;
+};
+
+UfoSession * ufo_session_new            (UfoScheduler   *scheduler,
+                                         UfoTaskGraph   *graph,
+                                         GError        **error);
+gboolean     ufo_session_run            (UfoSession     *session,
+                                         GError        **error);
+gboolean     ufo_session_start          (UfoSession     *session,
+                                         GError        **error);
+gboolean     ufo_session_wait           (UfoSession     *session,
+                                         GError        **error);
+void         ufo_session_close          (UfoSession     *session);
+guint        ufo_session_get_num_runs   (UfoSession     *session);
+GQuark       ufo_session_error_quark    (void);
+GType        ufo_session_get_type       (void);
+
+G_END_DECLS
+
+#endif
@@ -0,0 +1,772 @@
+/*
+ * Copyright (C) 2011-2013 Karlsruhe Institute of Technology
+ *
+ * This file is part of Ufo.
+ *
+ * This library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _GNU_SOURCE
+#include <ufo/ufo-shm-messenger.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+
+/**
+ * SECTION:ufo-shm-messenger
+ * @Short_description: Messenger for daemons on the same host
+ * @Title: UfoShmMessenger
+ *
+ * A #UfoMessenger that exchanges messages through a POSIX shared memory
+ * segment instead of a socket. Addresses have the form shm://name, the server
+ * creates the segment and clients wait for it to appear. The segment holds one
+ * ring of fixed-size slots for requests and one for replies, both sides sleep
+ * on futexes in the ring counters while there is nothing to do.
+ *
+ * Slots are 16 MiB large unless the server address asks for another size, for
+ * example shm://name?slot=64M with an optional k, M or G suffix. Clients take
+ * the size from the segment and ignore the query. The segment needs eight
+ * slots, so the size should fit the largest message but not much more.
+ *
+ * A received message that fits into a single slot is not copied, its payload
+ * points into the slot until the message is freed. Messages created with
+ * ufo_messenger_new_message() are likewise written into the next free slot
+ * directly. Copies still happen
+ *
+ * - for messages created with ufo_message_new(), which includes all replies,
+ * - when ufo_messenger_new_message() is called by a server, for a message
+ *   larger than a slot or while another prepared message was not sent yet,
+ * - on both sides for messages larger than a slot, which are split across
+ *   consecutive slots and joined again by the receiver.
+ *
+ * A thread that got a message from ufo_messenger_new_message() must send or
+ * free it before it sends any other request. If a client process dies during
+ * an exchange with the server, the other clients fail instead of waiting for
+ * the segment forever.
+ */
+
+static void ufo_messenger_interface_init (UfoMessengerIface *iface);
+
+#define UFO_SHM_MESSENGER_GET_PRIVATE(obj) (G_TYPE_INSTANCE_GET_PRIVATE((obj), UFO_TYPE_SHM_MESSENGER, UfoShmMessengerPrivate))
+
+G_DEFINE_TYPE_WITH_CODE (UfoShmMessenger, ufo_shm_messenger, G_TYPE_OBJECT,
+                         G_IMPLEMENT_INTERFACE (UFO_TYPE_MESSENGER,
+                                                ufo_messenger_interface_init))
+
+#define SHM_MAGIC           0x55464f53
+#define N_SLOTS             4
+#define DEFAULT_SLOT_SIZE   (16 << 20)
+#define SLOT_ALIGNMENT      64
+#define CONNECT_TIMEOUT     10
+#define LOCK_POLL_INTERVAL  1
+
+#define ALIGN(size)         (((size) + SLOT_ALIGNMENT - 1) & ~((gsize) SLOT_ALIGNMENT - 1))
+
+enum {
+    RING_REQUESTS = 0,
+    RING_REPLIES,
+    N_RINGS
+};
+
+/*
+ * Slots are filled and consumed in order. The producer fills slot `written',
+ * the consumer takes slot `read' and gives slots back by advancing `released'
+ * over all consumed slots whose payload is not held anymore. The counters wrap
+ * around, only their differences matter.
+ */
+typedef struct {
+    volatile gint written;
+    volatile gint read;
+    volatile gint released;
+} Ring;
+
+/*
+ * Like the zmq data frames, the shared layout only uses fixed-size types. The
+ * slots follow the segment header, each payload starts at an aligned offset
+ * after its slot header.
+ */
+typedef struct {
+    volatile gint magic;
+    guint32 n_slots;
+    guint64 slot_size;
+    volatile gint client_lock;      /* process ID of the owner or 0 */
+    Ring rings[N_RINGS];
+} Segment;
+
+typedef struct {
+    guint32 type;
+    guint32 more;
+    guint64 data_size;
+    guint64 chunk_size;
+    volatile gint held;
+} SlotHeader;
+
+struct _UfoShmMessengerPrivate {
+    gchar *name;
+    GMutex *mutex;
+    Segment *segment;
+    gsize size;
+    UfoMessengerRole role;
+    UfoMessage *reserved;
+    GThread *reserved_by;
+};
+
+/* Keeps a received slot alive until its message is freed */
+typedef struct {
+    UfoShmMessenger *msger;
+    Segment *segment;
+    SlotHeader *slot;
+    guint ring;
+} Borrowed;
+
+UfoShmMessenger *
+ufo_shm_messenger_new (void)
+{
+    return UFO_SHM_MESSENGER (g_object_new (UFO_TYPE_SHM_MESSENGER, NULL));
+}
+
+static void
+futex_wait (volatile gint *address, gint value, const struct timespec *timeout)
+{
+    /* Returns immediately if *address changed in the meantime */
+    syscall (SYS_futex, address, FUTEX_WAIT, value, timeout, NULL, 0);
+}
+
+static void
+futex_wake (volatile gint *address)
+{
+    syscall (SYS_futex, address, FUTEX_WAKE, G_MAXINT, NULL, NULL, 0);
+}
+
+/*
+ * Clients share one request ring, so each of them holds the lock for the whole
+ * request/reply exchange just like a REQ socket. Waiting clients check every
+ * LOCK_POLL_INTERVAL seconds whether the owner is still alive. A client that
+ * died during an exchange leaves the rings in an unknown state, so they fail
+ * instead of taking over the lock.
+ */
+static gboolean
+lock_clients (Segment *segment, GError **error)
+{
+    gint self = (gint) getpid ();
+
+    while (1) {
+        struct timespec timeout = { LOCK_POLL_INTERVAL, 0 };
+        gint owner = g_atomic_int_get (&segment->client_lock);
+
+        if (owner == 0) {
+            if (g_atomic_int_compare_and_exchange (&segment->client_lock, 0, self))
+                return TRUE;
+
+            continue;
+        }
+
+        if (kill ((pid_t) owner, 0) < 0 && errno == ESRCH) {
+            g_set_error (error, UFO_MESSENGER_ERROR, UFO_MESSENGER_CONNECTION_PROBLEM,
+                         "Client %i died while talking to the server", owner);
+            return FALSE;
+        }
+
+        futex_wait (&segment->client_lock, owner, &timeout);
+    }
+}
+
+static void
+unlock_clients (Segment *segment)
+{
+    g_atomic_int_set (&segment->client_lock, 0);
+    futex_wake (&segment->client_lock);
+}
+
+static gsize
+segment_size (guint n_slots, guint64 slot_size)
+{
+    return ALIGN (sizeof (Segment)) + N_RINGS * n_slots * (ALIGN (sizeof (SlotHeader)) + slot_size);
+}
+
+static SlotHeader *
+get_slot (Segment *segment, guint ring, gint count)
+{
+    gchar *base;
+    gsize index;
+
+    base = ((gchar *) segment) + ALIGN (sizeof (Segment));
+    index = ring * segment->n_slots + ((guint) count) % segment->n_slots;
+    return (SlotHeader *) (base + index * (ALIGN (sizeof (SlotHeader)) + segment->slot_size));
+}
+
+static gchar *
+get_payload (SlotHeader *slot)
+{
+    return ((gchar *) slot) + ALIGN (sizeof (SlotHeader));
+}
+
+static SlotHeader *
+wait_for_free_slot (Segment *segment, guint ring)
+{
+    Ring *r = &segment->rings[ring];
+    gint written;
+
+    written = g_atomic_int_get (&r->written);
+
+    while (1) {
+        gint released = g_atomic_int_get (&r->released);
+
+        if ((guint) (written - released) < segment->n_slots)
+            return get_slot (segment, ring, written);
+
+        futex_wait (&r->released, released, NULL);
+    }
+}
+
+static SlotHeader *
+take_slot (Segment *segment, guint ring)
+{
+    Ring *r = &segment->rings[ring];
+    SlotHeader *slot;
+    gint read;
+
+    read = g_atomic_int_get (&r->read);
+
+    while (1) {
+        gint written = g_atomic_int_get (&r->written);
+
+        if (written != read)
+            break;
+
+        futex_wait (&r->written, written, NULL);
+    }
+
+    slot = get_slot (segment, ring, read);
+    g_atomic_int_set (&slot->held, 1);
+    g_atomic_int_inc (&r->read);
+    return slot;
+}
+
+static void
+release_slot (Segment *segment, guint ring, SlotHeader *slot)
+{
+    Ring *r = &segment->rings[ring];
+    gboolean advanced = FALSE;
+
+    g_atomic_int_set (&slot->held, 0);
+
+    /* Slots are handed back in order, a held slot blocks all following ones */
+    while (1) {
+        gint released = g_atomic_int_get (&r->released);
+
+        if (released == g_atomic_int_get (&r->read) ||
+            g_atomic_int_get (&get_slot (segment, ring, released)->held))
+            break;
+
+        if (g_atomic_int_compare_and_exchange (&r->released, released, released + 1))
+            advanced = TRUE;
+    }
+
+    if (advanced)
+        futex_wake (&r->released);
+}
+
+static void
+write_message (Segment *segment, guint ring, UfoMessage *msg)
+{
+    const gchar *data = msg->data;
+    guint64 remaining = msg->data_size;
+
+    do {
+        SlotHeader *slot;
+        guint64 chunk_size;
+
+        slot = wait_for_free_slot (segment, ring);
+        chunk_size = MIN (remaining, segment->slot_size);
+
+        slot->type = msg->type;
+        slot->data_size = msg->data_size;
+        slot->chunk_size = chunk_size;
+        slot->more = remaining > chunk_size;
+        slot->held = 0;
+
+        /* Messages from ufo_messenger_new_message() are already in place */
+        if (chunk_size > 0) {
+            if (data != get_payload (slot))
+                memcpy (get_payload (slot), data, chunk_size);
+
+            data += chunk_size;
+        }
+
+        remaining -= chunk_size;
+
+        g_atomic_int_inc (&segment->rings[ring].written);
+        futex_wake (&segment->rings[ring].written);
+    } while (remaining > 0);
+}
+
+static void
+release_borrowed (Borrowed *borrowed)
+{
+    UfoShmMessengerPrivate *priv = UFO_SHM_MESSENGER_GET_PRIVATE (borrowed->msger);
+
+    g_mutex_lock (priv->mutex);
+
+    /* The slot is gone if the messenger disconnected in the meantime */
+    if (priv->segment == borrowed->segment)
+        release_slot (borrowed->segment, borrowed->ring, borrowed->slot);
+
+    g_mutex_unlock (priv->mutex);
+    g_object_unref (borrowed->msger);
+    g_free (borrowed);
+}
+
+static UfoMessage *
+read_message (UfoShmMessenger *msger, guint ring)
+{
+    UfoShmMessengerPrivate *priv = UFO_SHM_MESSENGER_GET_PRIVATE (msger);
+    Segment *segment = priv->segment;
+    SlotHeader *slot;
+    UfoMessage *msg;
+    gchar *data;
+
+    slot = take_slot (segment, ring);
+
+    if (!slot->more) {
+        Borrowed *borrowed;
+
+        msg = g_malloc0 (sizeof (UfoMessage));
+        msg->type = slot->type;
+        msg->data_size = slot->chunk_size;
+
+        if (msg->data_size == 0) {
+            release_slot (segment, ring, slot);
+            return msg;
+        }
+
+        borrowed = g_new0 (Borrowed, 1);
+        borrowed->msger = g_object_ref (msger);
+        borrowed->segment = segment;
+        borrowed->slot = slot;
+        borrowed->ring = ring;
+
+        msg->data = get_payload (slot);
+        msg->release = (GDestroyNotify) release_borrowed;
+        msg->release_data = borrowed;
+        return msg;
+    }
+
+    msg = ufo_message_new (slot->type, slot->data_size);
+    data = msg->data;
+
+    while (1) {
+        gboolean more = slot->more;
+
+        memcpy (data, get_payload (slot), slot->chunk_size);
+        data += slot->chunk_size;
+        release_slot (segment, ring, slot);
+
+        if (!more)
+            break;
+
+        slot = take_slot (segment, ring);
+    }
+
+    return msg;
+}
+
+/*
+ * Parse the query of a server address, i.e. everything after `?'.
+ */
+static gboolean
+parse_slot_size (const gchar *addr, const gchar *query, guint64 *slot_size, GError **error)
+{
+    guint64 value;
+    gchar *end;
+
+    *slot_size = DEFAULT_SLOT_SIZE;
+
+    if (query == NULL)
+        return TRUE;
+
+    if (!g_str_has_prefix (query, "slot="))
+        goto invalid;
+
+    value = g_ascii_strtoull (query + strlen ("slot="), &end, 10);
+
+    if (end == query + strlen ("slot="))
+        goto invalid;
+
+    switch (*end) {
+        case 'G':
+            value <<= 10;
+            /* fall through */
+        case 'M':
+            value <<= 10;
+            /* fall through */
+        case 'k':
+            value <<= 10;
+            end++;
+        default:
+            break;
+    }
+
+    /* the whole segment must stay addressable */
+    if (*end != '\0' || value == 0 || value > G_MAXSIZE / (2 * N_RINGS * N_SLOTS))
+        goto invalid;
+
+    *slot_size = ALIGN (value);
+    return TRUE;
+
+invalid:
+    g_set_error (error, UFO_MESSENGER_ERROR, UFO_MESSENGER_INVALID_ADDRESS,
+                 "Address `%s' is not of the form shm://name?slot=SIZE[k|M|G]", addr);
+    return FALSE;
+}
+
+static Segment *
+create_segment (const gchar *name, guint64 slot_size, gsize *size, GError **error)
+{
+    Segment *segment;
+    gint fd;
+
+    *size = segment_size (N_SLOTS, slot_size);
+
+    /* Remove whatever a daemon that did not shut down cleanly left behind */
+    shm_unlink (name);
+    fd = shm_open (name, O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+
+    if (fd < 0) {
+        g_set_error (error, UFO_MESSENGER_ERROR, UFO_MESSENGER_CONNECTION_PROBLEM,
+                     "Could not create shared memory `%s': %s", name, g_strerror (errno));
+        return NULL;
+    }
+
+    if (ftruncate (fd, *size) < 0) {
+        g_set_error (error, UFO_MESSENGER_ERROR, UFO_MESSENGER_CONNECTION_PROBLEM,
+                     "Could not resize shared memory `%s': %s", name, g_strerror (errno));
+        close (fd);
+        shm_unlink (name);
+        return NULL;
+    }
+
+    segment = mmap (NULL, *size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close (fd);
+
+    if (segment == MAP_FAILED) {
+        g_set_error (error, UFO_MESSENGER_ERROR, UFO_MESSENGER_CONNECTION_PROBLEM,
+                     "Could not map shared memory `%s': %s", name, g_strerror (errno));
+        shm_unlink (name);
+        return NULL;
+    }
+
+    /* The new segment is zero-filled, clients wait for the magic number */
+    segment->n_slots = N_SLOTS;
+    segment->slot_size = slot_size;
+    g_atomic_int_set (&segment->magic, SHM_MAGIC);
+
+    return segment;
+}
+
+static Segment *
+open_segment (const gchar *name, gsize *size, GError **error)
+{
+    Segment *segment;
+    struct stat st;
+    gint64 end_time;
+    gint fd;
+
+    /* Like zmq, wait for a server that has not been started yet */
+    end_time = g_get_monotonic_time () + CONNECT_TIMEOUT * G_TIME_SPAN_SECOND;
+
+    while (1) {
+        fd = shm_open (name, O_RDWR, 0);
+
+        if (fd >= 0) {
+            if (fstat (fd, &st) == 0 && (gsize) st.st_size >= sizeof (Segment))
+                break;
+
+            close (fd);
+        }
+        else if (errno != ENOENT) {
+            g_set_error (error, UFO_MESSENGER_ERROR, UFO_MESSENGER_CONNECTION_PROBLEM,
+                         "Could not open shared memory `%s': %s", name, g_strerror (errno));
+            return NULL;
+        }
+
+        if (g_get_monotonic_time () > end_time)
+            goto timeout;
+
+        g_usleep (10000);
+    }
+
+    *size = (gsize) st.st_size;
+    segment = mmap (NULL, *size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close (fd);
+
+    if (segment == MAP_FAILED) {
+        g_set_error (error, UFO_MESSENGER_ERROR, UFO_MESSENGER_CONNECTION_PROBLEM,
+                     "Could not map shared memory `%s': %s", name, g_strerror (errno));
+        return NULL;
+    }
+
+    while (g_atomic_int_get (&segment->magic) != SHM_MAGIC) {
+        if (g_get_monotonic_time () > end_time) {
+            munmap (segment, *size);
+            goto timeout;
+        }
+
+        g_usleep (1000);
+    }
+
+    if (*size < segment_size (segment->n_slots, segment->slot_size)) {
+        g_set_error (error, UFO_MESSENGER_ERROR, UFO_MESSENGER_SIZE_MISSMATCH,
+                     "Shared memory `%s' is smaller than its layout", name);
+        munmap (segment, *size);
+        return NULL;
+    }
+
+    return segment;
+
+timeout:
+    g_set_error (error, UFO_MESSENGER_ERROR, UFO_MESSENGER_CONNECTION_PROBLEM,
+                 "No server created `%s' within %i seconds", name, CONNECT_TIMEOUT);
+    return NULL;
+}
+
+static void
+ufo_shm_messenger_connect (UfoMessenger *msger,
+                           const gchar *addr,
+                           UfoMessengerRole role,
+                           GError **error)
+{
+    UfoShmMessengerPrivate *priv = UFO_SHM_MESSENGER_GET_PRIVATE (msger);
+    const gchar *name = NULL;
+    const gchar *query = NULL;
+    guint64 slot_size = DEFAULT_SLOT_SIZE;
+    gsize length = 0;
+
+    if (g_str_has_prefix (addr, "shm://")) {
+        name = addr + strlen ("shm://");
+        query = strchr (name, '?');
+        length = query != NULL ? (gsize) (query - name) : strlen (name);
+    }
+
+    if (length == 0 || memchr (name, '/', length) != NULL) {
+        g_set_error (error, UFO_MESSENGER_ERROR, UFO_MESSENGER_INVALID_ADDRESS,
+                     "Address `%s' is not of the form shm://name", addr);
+        return;
+    }
+
+    if (role == UFO_MESSENGER_SERVER &&
+        !parse_slot_size (addr, query != NULL ? query + 1 : NULL, &slot_size, error))
+        return;
+
+    g_mutex_lock (priv->mutex);
+
+    priv->name = g_strdup_printf ("/ufo-%.*s", (gint) length, name);
+    priv->role = role;
+
+    if (role == UFO_MESSENGER_SERVER)
+        priv->segment = create_segment (priv->name, slot_size, &priv->size, error);
+    else
+        priv->segment = open_segment (priv->name, &priv->size, error);
+
+    if (priv->segment != NULL)
+        g_debug ("Connected to `%s' as %s", priv->name, role == UFO_MESSENGER_SERVER ? "server" : "client");
+
+    g_mutex_unlock (priv->mutex);
+}
+
+static void
+ufo_shm_messenger_disconnect (UfoMessenger *msger)
+{
+    UfoShmMessengerPrivate *priv = UFO_SHM_MESSENGER_GET_PRIVATE (msger);
+
+    g_mutex_lock (priv->mutex);
+
+    if (priv->segment != NULL) {
+        if (priv->reserved != NULL) {
+            unlock_clients (priv->segment);
+            priv->reserved = NULL;
+        }
+
+        munmap (priv->segment, priv->size);
+        priv->segment = NULL;
+
+        if (priv->role == UFO_MESSENGER_SERVER)
+            shm_unlink (priv->name);
+    }
+
+    g_free (priv->name);
+    priv->name = NULL;
+
+    g_mutex_unlock (priv->mutex);
+}
+
+static UfoMessage *
+ufo_shm_messenger_send_blocking (UfoMessenger *msger,
+                                 UfoMessage *request,
+                                 GError **error)
+{
+    UfoShmMessengerPrivate *priv = UFO_SHM_MESSENGER_GET_PRIVATE (msger);
+    UfoMessage *reply = NULL;
+
+    if (request->type == UFO_MESSAGE_ACK && priv->role == UFO_MESSENGER_CLIENT)
+        g_critical ("Clients can't send ACK messages");
+
+    if (priv->segment == NULL) {
+        g_set_error_literal (error, UFO_MESSENGER_ERROR, UFO_MESSENGER_CONNECTION_PROBLEM,
+                             "Messenger is not connected");
+        return NULL;
+    }
+
+    /* Replies go to whichever client holds the lock */
+    if (request->type == UFO_MESSAGE_ACK) {
+        write_message (priv->segment, RING_REPLIES, request);
+        return NULL;
+    }
+
+    /* The prepared message occupies the slot any other request would take */
+    if (priv->reserved != NULL && request != priv->reserved && priv->reserved_by == g_thread_self ()) {
+        g_set_error_literal (error, UFO_MESSENGER_ERROR, UFO_MESSENGER_BUFFER_FULL,
+                             "A message from ufo_messenger_new_message() must be sent first");
+        return NULL;
+    }
+
+    if (request != priv->reserved && !lock_clients (priv->segment, error))
+        return NULL;
+
+    priv->reserved = NULL;
+    write_message (priv->segment, RING_REQUESTS, request);
+
+    /*
+     * A server only sends requests to itself to wake up its receiving thread
+     * (see ufo_daemon_stop()) and nobody reads the reply to that.
+     */
+    if (priv->role == UFO_MESSENGER_CLIENT)
+        reply = read_message (UFO_SHM_MESSENGER (msger), RING_REPLIES);
+
+    unlock_clients (priv->segment);
+    return reply;
+}
+
+static UfoMessage *
+ufo_shm_messenger_recv_blocking (UfoMessenger *msger,
+                                 GError **error)
+{
+    UfoShmMessengerPrivate *priv = UFO_SHM_MESSENGER_GET_PRIVATE (msger);
+
+    g_assert (priv->role == UFO_MESSENGER_SERVER);
+
+    if (priv->segment == NULL) {
+        g_set_error_literal (error, UFO_MESSENGER_ERROR, UFO_MESSENGER_CONNECTION_PROBLEM,
+                             "Messenger is not connected");
+        return NULL;
+    }
+
+    return read_message (UFO_SHM_MESSENGER (msger), RING_REQUESTS);
+}
+
+static void
+release_reserved (UfoShmMessenger *msger)
+{
+    UfoShmMessengerPrivate *priv = UFO_SHM_MESSENGER_GET_PRIVATE (msger);
+
+    /* Freed without being sent, so nobody gave the lock back yet */
+    if (priv->reserved != NULL && priv->segment != NULL) {
+        priv->reserved = NULL;
+        unlock_clients (priv->segment);
+    }
+
+    g_object_unref (msger);
+}
+
+static UfoMessage *
+ufo_shm_messenger_new_message (UfoMessenger *msger,
+                               UfoMessageType type,
+                               guint64 data_size)
+{
+    UfoShmMessengerPrivate *priv = UFO_SHM_MESSENGER_GET_PRIVATE (msger);
+    UfoMessage *msg;
+    SlotHeader *slot;
+
+    if (priv->segment == NULL || priv->role != UFO_MESSENGER_CLIENT || priv->reserved != NULL ||
+        data_size == 0 || data_size > priv->segment->slot_size)
+        return ufo_message_new (type, data_size);
+
+    /* Nobody else may write the request ring until this message is sent */
+    if (!lock_clients (priv->segment, NULL))
+        return ufo_message_new (type, data_size);
+
+    slot = wait_for_free_slot (priv->segment, RING_REQUESTS);
+
+    msg = g_malloc0 (sizeof (UfoMessage));
+    msg->type = type;
+    msg->data_size = data_size;
+    msg->data = get_payload (slot);
+    msg->release = (GDestroyNotify) release_reserved;
+    msg->release_data = g_object_ref (msger);
+
+    priv->reserved = msg;
+    priv->reserved_by = g_thread_self ();
+    return msg;
+}
+
+static void
+ufo_messenger_interface_init (UfoMessengerIface *iface)
+{
+    iface->connect = ufo_shm_messenger_connect;
+    iface->disconnect = ufo_shm_messenger_disconnect;
+    iface->send_blocking = ufo_shm_messenger_send_blocking;
+    iface->recv_blocking = ufo_shm_messenger_recv_blocking;
+    iface->new_message = ufo_shm_messenger_new_message;
+}
+
+static void
+ufo_shm_messenger_dispose (GObject *object)
+{
+    ufo_shm_messenger_disconnect (UFO_MESSENGER (object));
+}
+
+static void
+ufo_shm_messenger_finalize (GObject *object)
+{
+    UfoShmMessengerPrivate *priv = UFO_SHM_MESSENGER_GET_PRIVATE (object);
+
+    g_mutex_free (priv->mutex);
+}
+
+static void
+ufo_shm_messenger_class_init (UfoShmMessengerClass *klass)
+{
+    GObjectClass *oclass = G_OBJECT_CLASS (klass);
+    oclass->dispose      = ufo_shm_messenger_dispose;
+    oclass->finalize     = ufo_shm_messenger_finalize;
+
+    g_type_class_add_private (klass, sizeof(UfoShmMessengerPrivate));
+}
+
+static void
+ufo_shm_messenger_init (UfoShmMessenger *msger)
+{
+    UfoShmMessengerPrivate *priv = UFO_SHM_MESSENGER_GET_PRIVATE (msger);
+    priv->name = NULL;
+    priv->segment = NULL;
+    priv->reserved = NULL;
+    priv->mutex = g_mutex_new ();
+}
@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2011-2013 Karlsruhe Institute of Technology
+ *
+ * This file is part of Ufo.
+ *
+ * This library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __UFO_SHM_MESSENGER_H
+#define __UFO_SHM_MESSENGER_H
+
+#include <ufo/ufo-remote-node.h>
+#include <ufo/ufo-messenger-iface.h>
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define UFO_TYPE_SHM_MESSENGER             (ufo_shm_messenger_get_type())
+#define UFO_SHM_MESSENGER(obj)             (G_TYPE_CHECK_INSTANCE_CAST((obj), UFO_TYPE_SHM_MESSENGER, UfoShmMessenger))
+#define UFO_IS_SHM_MESSENGER(obj)          (G_TYPE_CHECK_INSTANCE_TYPE((obj), UFO_TYPE_SHM_MESSENGER))
+#define UFO_SHM_MESSENGER_CLASS(klass)     (G_TYPE_CHECK_CLASS_CAST((klass), UFO_TYPE_SHM_MESSENGER, UfoShmMessengerClass))
+#define UFO_IS_SHM_MESSENGER_CLASS(klass)  (G_TYPE_CHECK_CLASS_TYPE((klass), UFO_TYPE_SHM_MESSENGER))
+#define UFO_SHM_MESSENGER_GET_CLASS(obj)   (G_TYPE_INSTANCE_GET_CLASS((obj), UFO_TYPE_SHM_MESSENGER, UfoShmMessengerClass))
+
+typedef struct _UfoShmMessenger           UfoShmMessenger;
+typedef struct _UfoShmMessengerClass      UfoShmMessengerClass;
+typedef struct _UfoShmMessengerPrivate    UfoShmMessengerPrivate;
+
+struct _UfoShmMessenger {
+    /*< private >*/
+    GObject parent_instance;
+
+    UfoShmMessengerPrivate *priv;
+};
+
+struct _UfoShmMessengerClass {
+    /*< private >*/
+    GObjectClass parent_class;
+};
+
+UfoShmMessenger    *ufo_shm_messenger_new           (void);
+GType               ufo_shm_messenger_get_type      (void);
+
+G_END_DECLS
+
+#endif
@@ -24,8 +24,11 @@
 #include <ufo/ufo-task-node.h>
 #include <ufo/ufo-remote-node.h>
 #include <ufo/ufo-input-task.h>
+#include <ufo/ufo-output-task.h>
 #include <ufo/ufo-dummy-task.h>
 #include <ufo/ufo-remote-task.h>
+#include <ufo/ufo-enums.h>
+#include "ufo-priv.h"
 #include "compat.h"
 
 /**
@@ -216,20 +219,43 @@ get_json_representation (UfoTaskGraph *graph,
 
         g_list_for (successors, jt) {
             UfoNode *to;
+            gpointer label;
             gint port;
             JsonObject *to_object;
             JsonObject *from_object;
             JsonObject *edge_object;
 
             to = UFO_NODE (jt->data);
-            port = GPOINTER_TO_INT (ufo_graph_get_edge_label (UFO_GRAPH (graph), from, to));
+            label = ufo_graph_get_edge_label (UFO_GRAPH (graph), from, to);
+            port = UFO_EDGE_INPUT (label);
             to_object  = json_object_from_ufo_node (to);
             from_object = json_object_from_ufo_node (from);
             edge_object = json_object_new ();
 
+            if (UFO_EDGE_OUTPUT (label) > 0)
+                json_object_set_int_member (from_object, "output", UFO_EDGE_OUTPUT (label));
+
             json_object_set_int_member (to_object, "input", port);
             json_object_set_object_member (edge_object, "to", to_object);
             json_object_set_object_member (edge_object, "from", from_object);
+
+            if (ufo_task_node_get_batch_size (UFO_TASK_NODE (to), port) > 1)
+                json_object_set_int_member (edge_object, "batch",
+                                            ufo_task_node_get_batch_size (UFO_TASK_NODE (to), port));
+
+            if (ufo_task_node_get_reorder_window (UFO_TASK_NODE (to), port) > 0)
+                json_object_set_int_member (edge_object, "reorder",
+                                            ufo_task_node_get_reorder_window (UFO_TASK_NODE (to), port));
+
+            if (ufo_task_node_get_drop_oldest (UFO_TASK_NODE (to), port))
+                json_object_set_boolean_member (edge_object, "drop-oldest", TRUE);
+
+            if (ufo_task_node_get_queue_depth (UFO_TASK_NODE (to), port) == UFO_QUEUE_DEPTH_AUTO)
+                json_object_set_string_member (edge_object, "depth", "auto");
+            else if (ufo_task_node_get_queue_depth (UFO_TASK_NODE (to), port) > 0)
+                json_object_set_int_member (edge_object, "depth",
+                                            ufo_task_node_get_queue_depth (UFO_TASK_NODE (to), port));
+
             json_array_add_object_element (edges, edge_object);
         }
 
@@ -403,6 +429,58 @@ has_common_ancestries (UfoTaskGraph *graph, GList *path)
     return FALSE;
 }
 
+/*
+ * Inputs shared by all copies of a multi-input node cannot be split among
+ * them in step with the path: items of the path may be skipped or sent to the
+ * least loaded copy. Hence every copy receives all of their items and keeps
+ * using the last one after the input ended, which suits reference data such
+ * as dark and flat field averages. Inputs that carry one item per item of the
+ * path must branch off the path, so that they are copied along with it.
+ */
+static void
+broadcast_side_inputs (UfoTaskGraph *graph,
+                       GList *path)
+{
+    GList *it;
+
+    g_list_for (path, it) {
+        GList *predecessors;
+        GList *jt;
+
+        predecessors = ufo_graph_get_predecessors (UFO_GRAPH (graph), UFO_NODE (it->data));
+
+        if (g_list_length (predecessors) < 2) {
+            g_list_free (predecessors);
+            continue;
+        }
+
+        g_list_for (predecessors, jt) {
+            UfoTaskNode *source;
+            UfoSendPattern pattern;
+
+            source = UFO_TASK_NODE (jt->data);
+            pattern = ufo_task_node_get_send_pattern (source);
+
+            if (g_list_find (path, source) != NULL ||
+                pattern == UFO_SEND_BROADCAST ||
+                ufo_graph_get_num_successors (UFO_GRAPH (graph), UFO_NODE (source)) < 2)
+                continue;
+
+            if (pattern != UFO_SEND_SCATTER)
+                g_warning ("Output of %s is broadcast to all copies of %s instead of distributed",
+                           ufo_task_node_get_identifier (source),
+                           ufo_task_node_get_identifier (UFO_TASK_NODE (it->data)));
+            else
+                g_debug ("Broadcast output of %s to all copies",
+                         ufo_task_node_get_identifier (source));
+
+            ufo_task_node_set_send_pattern (source, UFO_SEND_BROADCAST);
+        }
+
+        g_list_free (predecessors);
+    }
+}
+
 /**
  * ufo_task_graph_expand:
  * @task_graph: A #UfoTaskGraph
@@ -412,7 +490,10 @@ has_common_ancestries (UfoTaskGraph *graph, GList *path)
  *
  * Expands @task_graph in a way that most of the resources in @arch_graph can be
  * occupied. In the simple pipeline case, the longest possible GPU paths are
- * duplicated as much as there are GPUs in @arch_graph.
+ * duplicated as much as there are GPUs in @arch_graph. Nodes with multiple
+ * inputs are duplicated as well. An additional input that branches off the
+ * path is copied along with it, any other additional input is broadcast to all
+ * copies.
  */
 void
 ufo_task_graph_expand (UfoTaskGraph *task_graph,
@@ -428,20 +509,10 @@ ufo_task_graph_expand (UfoTaskGraph *task_graph,
                                         (UfoFilterPredicate) is_gpu_task,
                                         NULL);
 
-    /* Check if any node on the path contains multiple inputs and stop expansion */
-    /* TODO: we need a better strategy at this point */
-    if (has_common_ancestries (task_graph, path)) {
-        g_list_free (path);
-        return;
-    }
-
     if (path != NULL && g_list_length (path) > 1) {
         GList *predecessors;
         GList *successors;
 
-        g_object_unref (UFO_NODE (g_list_first(path)->data));
-        g_object_unref (UFO_NODE (g_list_last(path)->data));
-
         /* Add predecessor and successor nodes to path */
         predecessors = ufo_graph_get_predecessors (UFO_GRAPH (task_graph),
                                                    UFO_NODE (g_list_first (path)->data));
@@ -458,7 +529,11 @@ ufo_task_graph_expand (UfoTaskGraph *task_graph,
         g_list_free (predecessors);
         g_list_free (successors);
 
-        if (expand_remote) {
+        /* Remote graphs are linear and cannot receive additional inputs */
+        if (expand_remote && has_common_ancestries (task_graph, path)) {
+            g_debug ("Path has multiple inputs, not expanding to remote nodes");
+        }
+        else if (expand_remote) {
             GList *remotes;
             guint n_remotes;
 
@@ -477,6 +552,9 @@ ufo_task_graph_expand (UfoTaskGraph *task_graph,
 
         for (guint i = 1; i < n_gpus; i++)
             ufo_graph_expand (UFO_GRAPH (task_graph), path);
+
+        if (n_gpus > 1)
+            broadcast_side_inputs (task_graph, path);
     }
 
     g_list_free (path);
@@ -495,6 +573,256 @@ ufo_task_graph_fuse (UfoTaskGraph *task_graph)
 {
 }
 
+static gboolean
+equal_properties (GObject *a,
+                  GObject *b)
+{
+    GParamSpec **pspecs;
+    guint n_pspecs;
+    gboolean equal = TRUE;
+
+    pspecs = g_object_class_list_properties (G_OBJECT_GET_CLASS (a), &n_pspecs);
+
+    for (guint i = 0; i < n_pspecs && equal; i++) {
+        GParamSpec *pspec = pspecs[i];
+        GValue value_a = {0};
+        GValue value_b = {0};
+
+        /* num-processed and the like describe a run, not the configuration */
+        if (!(pspec->flags & G_PARAM_READABLE) || pspec->owner_type == UFO_TYPE_TASK_NODE)
+            continue;
+
+        g_value_init (&value_a, pspec->value_type);
+        g_value_init (&value_b, pspec->value_type);
+        g_object_get_property (a, pspec->name, &value_a);
+        g_object_get_property (b, pspec->name, &value_b);
+        equal = g_param_values_cmp (pspec, &value_a, &value_b) == 0;
+        g_value_unset (&value_a);
+        g_value_unset (&value_b);
+    }
+
+    g_free (pspecs);
+    return equal;
+}
+
+static gboolean
+is_mergeable (UfoTaskNode *node)
+{
+    /* Data is pushed into or pulled from these by the user */
+    return ufo_task_node_get_plugin_name (node) != NULL &&
+           !UFO_IS_INPUT_TASK (node) &&
+           !UFO_IS_OUTPUT_TASK (node) &&
+           !UFO_IS_REMOTE_TASK (node);
+}
+
+static gboolean
+has_single_output (UfoGraph *graph,
+                   UfoNode *node)
+{
+    return ufo_graph_get_num_successors (graph, node) == 1 ||
+           ufo_task_node_get_send_pattern (UFO_TASK_NODE (node)) == UFO_SEND_BROADCAST;
+}
+
+static gboolean
+same_inputs (UfoGraph *graph,
+             UfoNode *a,
+             UfoNode *b)
+{
+    GList *predecessors;
+    GList *it;
+    gboolean same;
+
+    predecessors = ufo_graph_get_predecessors (graph, a);
+    same = g_list_length (predecessors) == ufo_graph_get_num_predecessors (graph, b);
+
+    /* Only broadcasting predecessors send the same items to both */
+    g_list_for (predecessors, it) {
+        UfoNode *predecessor = UFO_NODE (it->data);
+
+        if (!same)
+            break;
+
+        same = ufo_graph_is_connected (graph, predecessor, b) &&
+               ufo_graph_get_edge_label (graph, predecessor, a) == ufo_graph_get_edge_label (graph, predecessor, b) &&
+               ufo_task_node_get_send_pattern (UFO_TASK_NODE (predecessor)) == UFO_SEND_BROADCAST;
+    }
+
+    g_list_free (predecessors);
+    return same;
+}
+
+static gboolean
+share_successor (UfoGraph *graph,
+                 UfoNode *a,
+                 UfoNode *b)
+{
+    GList *successors;
+    GList *it;
+    gboolean shared = FALSE;
+
+    successors = ufo_graph_get_successors (graph, a);
+
+    g_list_for (successors, it) {
+        if (ufo_graph_is_connected (graph, b, UFO_NODE (it->data)))
+            shared = TRUE;
+    }
+
+    g_list_free (successors);
+    return shared;
+}
+
+static gboolean
+can_merge (UfoGraph *graph,
+           UfoNode *a,
+           UfoNode *b)
+{
+    UfoTaskNode *task_a = UFO_TASK_NODE (a);
+    UfoTaskNode *task_b = UFO_TASK_NODE (b);
+
+    /* Sinks keep their results and are never merged */
+    if (G_OBJECT_TYPE (a) != G_OBJECT_TYPE (b) ||
+        !is_mergeable (task_a) || !is_mergeable (task_b) ||
+        ufo_graph_get_num_successors (graph, a) == 0 ||
+        ufo_graph_get_num_successors (graph, b) == 0)
+        return FALSE;
+
+    return g_strcmp0 (ufo_task_node_get_plugin_name (task_a), ufo_task_node_get_plugin_name (task_b)) == 0 &&
+           has_single_output (graph, a) && has_single_output (graph, b) &&
+           !share_successor (graph, a, b) &&
+           same_inputs (graph, a, b) &&
+           ufo_task_node_equal_settings (task_a, task_b) &&
+           equal_properties (G_OBJECT (a), G_OBJECT (b));
+}
+
+static void
+merge_node (UfoGraph *graph,
+            UfoNode *kept,
+            UfoNode *duplicate)
+{
+    GList *successors;
+    GList *it;
+
+    g_debug ("Merge %s-%p into identical %s-%p",
+             ufo_task_node_get_plugin_name (UFO_TASK_NODE (duplicate)), (gpointer) duplicate,
+             ufo_task_node_get_plugin_name (UFO_TASK_NODE (kept)), (gpointer) kept);
+
+    successors = ufo_graph_get_successors (graph, duplicate);
+
+    g_list_for (successors, it) {
+        UfoNode *successor = UFO_NODE (it->data);
+        ufo_graph_connect_nodes (graph, kept, successor,
+                                 ufo_graph_get_edge_label (graph, duplicate, successor));
+    }
+
+    g_list_free (successors);
+    ufo_graph_remove_node (graph, duplicate);
+
+    if (ufo_graph_get_num_successors (graph, kept) > 1)
+        ufo_task_node_set_send_pattern (UFO_TASK_NODE (kept), UFO_SEND_BROADCAST);
+}
+
+/**
+ * ufo_task_graph_merge_common:
+ * @task_graph: A #UfoTaskGraph
+ *
+ * Merge nodes that compute the same thing, i.e. that run the same plugin with
+ * equal properties and node settings on the same inputs. The remaining node
+ * broadcasts its output to the successors of all nodes it replaced. Because
+ * merging two nodes makes their successors read identical inputs, common
+ * branches collapse from the roots on. Sinks, input and output tasks are never
+ * merged. This should be called before ufo_task_graph_expand().
+ *
+ * Returns: The number of nodes removed from @task_graph.
+ *
+ * Since: 0.8
+ */
+guint
+ufo_task_graph_merge_common (UfoTaskGraph *task_graph)
+{
+    UfoGraph *graph;
+    guint n_merged = 0;
+    gboolean merged;
+
+    g_return_val_if_fail (UFO_IS_TASK_GRAPH (task_graph), 0);
+    graph = UFO_GRAPH (task_graph);
+
+    do {
+        GList *nodes;
+        GList *it;
+        GList *jt;
+
+        merged = FALSE;
+        nodes = ufo_graph_get_nodes (graph);
+
+        for (it = nodes; it != NULL && !merged; it = g_list_next (it)) {
+            for (jt = g_list_next (it); jt != NULL && !merged; jt = g_list_next (jt)) {
+                if (can_merge (graph, UFO_NODE (it->data), UFO_NODE (jt->data))) {
+                    merge_node (graph, UFO_NODE (it->data), UFO_NODE (jt->data));
+                    merged = TRUE;
+                    n_merged++;
+                }
+            }
+        }
+
+        g_list_free (nodes);
+    } while (merged);
+
+    if (n_merged > 0)
+        g_debug ("Merged %u common nodes", n_merged);
+
+    return n_merged;
+}
+
+static UfoNode *
+get_common_proc_node (UfoGraph *graph,
+                      UfoNode *node)
+{
+    GList *predecessors;
+    GList *it;
+    GHashTable *counts;
+    UfoNode *best = NULL;
+    guint best_count = 0;
+
+    predecessors = ufo_graph_get_predecessors (graph, node);
+    counts = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+    /* Pick the processing node that most inputs already live on */
+    g_list_for (predecessors, it) {
+        UfoNode *proc_node;
+        guint count;
+
+        proc_node = ufo_task_node_get_proc_node (UFO_TASK_NODE (it->data));
+
+        if (proc_node == NULL)
+            continue;
+
+        count = GPOINTER_TO_UINT (g_hash_table_lookup (counts, proc_node)) + 1;
+        g_hash_table_insert (counts, proc_node, GUINT_TO_POINTER (count));
+
+        if (count > best_count) {
+            best = proc_node;
+            best_count = count;
+        }
+    }
+
+    g_hash_table_destroy (counts);
+    g_list_free (predecessors);
+    return best;
+}
+
+static UfoNode *
+get_first_non_cpu_node (GList *gpu_nodes)
+{
+    GList *it;
+
+    g_list_for (gpu_nodes, it) {
+        if (!ufo_gpu_node_is_cpu_device (UFO_GPU_NODE (it->data)))
+            return UFO_NODE (it->data);
+    }
+
+    return NULL;
+}
+
 static void
 map_proc_node (UfoGraph *graph,
                UfoNode *node,
@@ -506,8 +834,31 @@ map_proc_node (UfoGraph *graph,
     GList *it;
     guint n_gpus;
 
+    /*
+     * Joining nodes are placed on the device that holds most of their inputs
+     * to avoid moving data between devices.
+     */
+    if (ufo_graph_get_num_predecessors (graph, node) > 1 &&
+        !ufo_task_node_get_proc_node (UFO_TASK_NODE (node))) {
+        UfoNode *common;
+
+        common = get_common_proc_node (graph, node);
+
+        if (common != NULL && g_list_index (gpu_nodes, common) >= 0)
+            proc_index = (guint) g_list_index (gpu_nodes, common);
+    }
+
     proc_node = UFO_NODE (g_list_nth_data (gpu_nodes, proc_index));
 
+    /* CPU devices only take over copies of an expanded path */
+    if (proc_node != NULL && ufo_node_get_total (node) < 2 &&
+        ufo_gpu_node_is_cpu_device (UFO_GPU_NODE (proc_node))) {
+        UfoNode *gpu = get_first_non_cpu_node (gpu_nodes);
+
+        if (gpu != NULL)
+            proc_node = gpu;
+    }
+
     if ((ufo_task_uses_gpu (UFO_TASK (node)) || UFO_IS_INPUT_TASK (node)) &&
         (!ufo_task_node_get_proc_node (UFO_TASK_NODE (node)))) {
 
@@ -624,6 +975,317 @@ ufo_task_graph_map (UfoTaskGraph *task_graph,
     g_list_free (roots);
 }
 
+typedef struct {
+    UfoTaskNode *node;
+    gdouble      cost;
+    guint        order;
+} MappedTask;
+
+static gint
+cmp_mapped_task (gconstpointer a,
+                 gconstpointer b)
+{
+    const MappedTask *ta = (const MappedTask *) a;
+    const MappedTask *tb = (const MappedTask *) b;
+
+    if (ta->cost != tb->cost)
+        return ta->cost < tb->cost ? 1 : -1;
+
+    return (gint) ta->order - (gint) tb->order;
+}
+
+static guint
+count_cut_edges (UfoGraph *graph,
+                 UfoNode *node,
+                 UfoNode *proc_node,
+                 GHashTable *placed)
+{
+    GList *neighbours;
+    GList *it;
+    guint n_cut = 0;
+
+    neighbours = g_list_concat (ufo_graph_get_predecessors (graph, node),
+                                ufo_graph_get_successors (graph, node));
+
+    g_list_for (neighbours, it) {
+        UfoNode *other = g_hash_table_lookup (placed, it->data);
+
+        if (other != NULL && other != proc_node)
+            n_cut++;
+    }
+
+    g_list_free (neighbours);
+    return n_cut;
+}
+
+/**
+ * ufo_task_graph_map_balanced:
+ * @task_graph: A #UfoTaskGraph
+ * @gpu_nodes: (transfer none) (element-type Ufo.GpuNode): List of #UfoGpuNode objects
+ *
+ * Map task nodes of @task_graph to the processing nodes in @gpu_nodes according
+ * to the estimated cost of each task (see ufo_task_node_set_cost()). Tasks are
+ * placed from the most to the least expensive on the processing node that
+ * minimizes its accumulated cost, where each edge to a task on another
+ * processing node counts as much as an average task. Tasks without an estimate
+ * are assumed to be average as well.
+ *
+ * Since: 0.8
+ */
+void
+ufo_task_graph_map_balanced (UfoTaskGraph *task_graph,
+                             GList *gpu_nodes)
+{
+    GList *nodes;
+    GList *it;
+    GArray *tasks;
+    GHashTable *placed;
+    gdouble *loads;
+    gdouble total = 0.0;
+    gdouble average;
+    guint n_known = 0;
+    guint n_gpus;
+    gboolean has_gpus;
+
+    g_return_if_fail (UFO_IS_TASK_GRAPH (task_graph));
+
+    n_gpus = g_list_length (gpu_nodes);
+
+    if (n_gpus < 2) {
+        ufo_task_graph_map (task_graph, gpu_nodes);
+        return;
+    }
+
+    nodes = ufo_graph_get_nodes (UFO_GRAPH (task_graph));
+    tasks = g_array_new (FALSE, FALSE, sizeof (MappedTask));
+
+    g_list_for (nodes, it) {
+        MappedTask task;
+
+        if (!(ufo_task_uses_gpu (UFO_TASK (it->data)) || UFO_IS_INPUT_TASK (it->data)) ||
+            UFO_IS_REMOTE_TASK (it->data))
+            continue;
+
+        task.node = UFO_TASK_NODE (it->data);
+        task.cost = ufo_task_node_get_cost (task.node);
+        task.order = tasks->len;
+        g_array_append_val (tasks, task);
+
+        if (task.cost > 0.0) {
+            total += task.cost;
+            n_known++;
+        }
+    }
+
+    average = n_known > 0 ? total / n_known : 1.0;
+
+    for (guint i = 0; i < tasks->len; i++) {
+        MappedTask *task = &g_array_index (tasks, MappedTask, i);
+
+        if (task->cost <= 0.0)
+            task->cost = average;
+    }
+
+    g_array_sort (tasks, cmp_mapped_task);
+    has_gpus = get_first_non_cpu_node (gpu_nodes) != NULL;
+    placed = g_hash_table_new (g_direct_hash, g_direct_equal);
+    loads = g_new0 (gdouble, n_gpus);
+
+    for (guint i = 0; i < tasks->len; i++) {
+        MappedTask *task = &g_array_index (tasks, MappedTask, i);
+        UfoNode *best = NULL;
+        gdouble best_cost = G_MAXDOUBLE;
+        guint best_index = 0;
+        guint index = 0;
+
+        g_list_for (gpu_nodes, it) {
+            gdouble cost;
+
+            /* CPU devices only take over copies of an expanded path */
+            if (has_gpus && ufo_node_get_total (UFO_NODE (task->node)) < 2 &&
+                ufo_gpu_node_is_cpu_device (UFO_GPU_NODE (it->data))) {
+                index++;
+                continue;
+            }
+
+            cost = loads[index] + task->cost +
+                   average * count_cut_edges (UFO_GRAPH (task_graph), UFO_NODE (task->node),
+                                              UFO_NODE (it->data), placed);
+
+            if (cost < best_cost) {
+                best = UFO_NODE (it->data);
+                best_cost = cost;
+                best_index = index;
+            }
+
+            index++;
+        }
+
+        g_debug ("Mapping UfoGpuNode-%p to %s-%p (cost %.3fs)",
+                 (gpointer) best, G_OBJECT_TYPE_NAME (task->node),
+                 (gpointer) task->node, task->cost);
+
+        loads[best_index] += task->cost;
+        g_hash_table_insert (placed, task->node, best);
+        ufo_task_node_set_proc_node (task->node, best);
+    }
+
+    g_free (loads);
+    g_hash_table_destroy (placed);
+    g_array_free (tasks, TRUE);
+    g_list_free (nodes);
+}
+
+/* costs of copies are stored under the identifier of their original */
+static const gchar *
+get_orig_identifier (UfoNode *node)
+{
+    return ufo_task_node_get_identifier (UFO_TASK_NODE (ufo_node_get_orig (node)));
+}
+
+/**
+ * ufo_task_graph_read_costs:
+ * @task_graph: A #UfoTaskGraph
+ * @filename: Path of a file written by ufo_task_graph_save_costs()
+ * @error: Location for a GError or %NULL
+ *
+ * Set the cost of every task node in @task_graph whose identifier is listed in
+ * @filename. Copies of such a node, made before or by a later expansion, get
+ * the same cost.
+ *
+ * Returns: %TRUE if @filename could be read, %FALSE otherwise.
+ *
+ * Since: 0.8
+ */
+gboolean
+ufo_task_graph_read_costs (UfoTaskGraph *task_graph,
+                           const gchar *filename,
+                           GError **error)
+{
+    JsonParser *parser;
+    JsonNode *root;
+    JsonObject *object;
+    GList *nodes;
+    GList *it;
+
+    g_return_val_if_fail (UFO_IS_TASK_GRAPH (task_graph) && filename != NULL, FALSE);
+
+    parser = json_parser_new ();
+
+    if (!json_parser_load_from_file (parser, filename, error)) {
+        g_object_unref (parser);
+        return FALSE;
+    }
+
+    root = json_parser_get_root (parser);
+
+    if (root == NULL || !JSON_NODE_HOLDS_OBJECT (root)) {
+        g_set_error (error, UFO_TASK_GRAPH_ERROR, UFO_TASK_GRAPH_ERROR_JSON_KEY,
+                     "`%s' does not contain a cost object", filename);
+        g_object_unref (parser);
+        return FALSE;
+    }
+
+    object = json_node_get_object (root);
+    nodes = ufo_graph_get_nodes (UFO_GRAPH (task_graph));
+
+    g_list_for (nodes, it) {
+        const gchar *identifier;
+
+        identifier = get_orig_identifier (UFO_NODE (it->data));
+
+        if (identifier != NULL && json_object_has_member (object, identifier))
+            ufo_task_node_set_cost (UFO_TASK_NODE (it->data),
+                                    json_object_get_double_member (object, identifier));
+    }
+
+    g_list_free (nodes);
+    g_object_unref (parser);
+    return TRUE;
+}
+
+/**
+ * ufo_task_graph_save_costs:
+ * @task_graph: A #UfoTaskGraph
+ * @filename: Path of the file to write
+ * @error: Location for a GError or %NULL
+ *
+ * Write the cost of every task node with known cost to @filename, so that a
+ * later run can be mapped with %UFO_MAPPING_COST. Copies made by an expansion
+ * are stored under the identifier of their original with the average cost of
+ * the original and all of its copies.
+ *
+ * Returns: %TRUE if @filename could be written, %FALSE otherwise.
+ *
+ * Since: 0.8
+ */
+gboolean
+ufo_task_graph_save_costs (UfoTaskGraph *task_graph,
+                           const gchar *filename,
+                           GError **error)
+{
+    JsonGenerator *generator;
+    JsonObject *object;
+    JsonNode *root;
+    GHashTable *costs;
+    GHashTableIter iter;
+    gpointer key;
+    gpointer value;
+    GList *nodes;
+    GList *it;
+    gboolean result;
+
+    g_return_val_if_fail (UFO_IS_TASK_GRAPH (task_graph) && filename != NULL, FALSE);
+
+    object = json_object_new ();
+    nodes = ufo_graph_get_nodes (UFO_GRAPH (task_graph));
+    costs = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, g_free);
+
+    g_list_for (nodes, it) {
+        const gchar *identifier;
+        gdouble *sum;
+        gdouble cost;
+
+        identifier = get_orig_identifier (UFO_NODE (it->data));
+        cost = ufo_task_node_get_cost (UFO_TASK_NODE (it->data));
+
+        if (identifier == NULL || cost <= 0.0)
+            continue;
+
+        /* the sum of costs followed by the number of nodes */
+        sum = g_hash_table_lookup (costs, identifier);
+
+        if (sum == NULL) {
+            sum = g_new0 (gdouble, 2);
+            g_hash_table_insert (costs, (gpointer) identifier, sum);
+        }
+
+        sum[0] += cost;
+        sum[1] += 1.0;
+    }
+
+    g_list_free (nodes);
+    g_hash_table_iter_init (&iter, costs);
+
+    while (g_hash_table_iter_next (&iter, &key, &value)) {
+        gdouble *sum = (gdouble *) value;
+        json_object_set_double_member (object, (const gchar *) key, sum[0] / sum[1]);
+    }
+
+    g_hash_table_destroy (costs);
+
+    root = json_node_new (JSON_NODE_OBJECT);
+    json_node_take_object (root, object);
+    generator = json_generator_new ();
+    json_generator_set_pretty (generator, TRUE);
+    json_generator_set_root (generator, root);
+    result = json_generator_to_file (generator, filename, error);
+
+    json_node_free (root);
+    g_object_unref (generator);
+    return result;
+}
+
 /**
  * ufo_task_graph_connect_nodes:
  * @graph: A #UfoTaskGraph
@@ -656,7 +1318,60 @@ ufo_task_graph_connect_nodes_full (UfoTaskGraph *graph,
                                    UfoTaskNode *n2,
                                    guint input)
 {
-    ufo_graph_connect_nodes (UFO_GRAPH (graph), UFO_NODE (n1), UFO_NODE (n2), GINT_TO_POINTER (input));
+    ufo_task_graph_connect_ports (graph, n1, 0, n2, input);
+}
+
+/**
+ * ufo_task_graph_connect_ports:
+ * @graph: A #UfoTaskGraph
+ * @n1: A source node
+ * @output: Output port of @n1
+ * @n2: A destination node
+ * @input: Input port of @n2
+ *
+ * Connect output @output of @n1 with the @input port of @n2.
+ *
+ * Since: 0.8
+ */
+void
+ufo_task_graph_connect_ports (UfoTaskGraph *graph,
+                              UfoTaskNode *n1,
+                              guint output,
+                              UfoTaskNode *n2,
+                              guint input)
+{
+    g_return_if_fail (output < 16 && input < 16);
+    ufo_graph_connect_nodes (UFO_GRAPH (graph), UFO_NODE (n1), UFO_NODE (n2), UFO_EDGE_LABEL (output, input));
+}
+
+/**
+ * ufo_task_graph_get_ports:
+ * @graph: A #UfoTaskGraph
+ * @n1: A source node
+ * @n2: A destination node connected to @n1
+ * @output: (out) (allow-none): Location for the output port of @n1
+ * @input: (out) (allow-none): Location for the input port of @n2
+ *
+ * Get the ports that the edge from @n1 to @n2 connects.
+ *
+ * Since: 0.8
+ */
+void
+ufo_task_graph_get_ports (UfoTaskGraph *graph,
+                          UfoTaskNode *n1,
+                          UfoTaskNode *n2,
+                          guint *output,
+                          guint *input)
+{
+    gpointer label;
+
+    label = ufo_graph_get_edge_label (UFO_GRAPH (graph), UFO_NODE (n1), UFO_NODE (n2));
+
+    if (output != NULL)
+        *output = UFO_EDGE_OUTPUT (label);
+
+    if (input != NULL)
+        *input = UFO_EDGE_INPUT (label);
 }
 
 void
@@ -759,6 +1474,59 @@ handle_json_task_node (JsonNode *element,
         json_object_foreach_member (prop_object, handle_json_single_prop, plugin);
     }
 
+    if (json_object_has_member (object, "send-pattern")) {
+        const gchar *nick;
+        GEnumClass *enum_class;
+        GEnumValue *value;
+
+        nick = json_object_get_string_member (object, "send-pattern");
+        enum_class = g_type_class_ref (UFO_TYPE_SEND_PATTERN);
+        value = g_enum_get_value_by_nick (enum_class, nick);
+
+        if (value != NULL)
+            ufo_task_node_set_send_pattern (plugin, (UfoSendPattern) value->value);
+        else
+            g_warning ("Unknown send pattern `%s' for `%s'", nick, name);
+
+        g_type_class_unref (enum_class);
+    }
+
+    if (json_object_has_member (object, "priority")) {
+        const gchar *nick;
+        GEnumClass *enum_class;
+        GEnumValue *value;
+
+        nick = json_object_get_string_member (object, "priority");
+        enum_class = g_type_class_ref (UFO_TYPE_TASK_PRIORITY);
+        value = g_enum_get_value_by_nick (enum_class, nick);
+
+        if (value != NULL)
+            ufo_task_node_set_priority (plugin, (UfoTaskPriority) value->value);
+        else
+            g_warning ("Unknown priority `%s' for `%s'", nick, name);
+
+        g_type_class_unref (enum_class);
+    }
+
+    if (json_object_has_member (object, "window")) {
+        JsonObject *window;
+        gboolean has_step;
+
+        window = json_object_get_object_member (object, "window");
+        has_step = json_object_has_member (window, "step");
+
+        if (json_object_has_member (window, "size"))
+            ufo_task_node_set_window (plugin,
+                                      (guint) json_object_get_int_member (window, "size"),
+                                      has_step ? (guint) json_object_get_int_member (window, "step") : 0);
+        else if (json_object_has_member (window, "duration"))
+            ufo_task_node_set_time_window (plugin,
+                                           json_object_get_double_member (window, "duration"),
+                                           has_step ? json_object_get_double_member (window, "step") : 0.0);
+        else
+            g_warning ("Window of `%s' has neither `size' nor `duration'", name);
+    }
+
     if (json_object_has_member (object, "prop-refs")) {
         JsonArray *prop_refs;
 
@@ -793,6 +1561,7 @@ handle_json_task_edge (JsonArray *array,
     JsonObject *edge;
     UfoTaskNode *from_node, *to_node;
     JsonObject *from_object, *to_object;
+    guint from_port;
     guint to_port;
     const gchar *from_name;
     const gchar *to_name;
@@ -815,6 +1584,10 @@ handle_json_task_edge (JsonArray *array,
     }
 
     from_name = json_object_get_string_member (from_object, "name");
+    from_port = 0;
+
+    if (json_object_has_member (from_object, "output"))
+        from_port = (guint) json_object_get_int_member (from_object, "output");
 
     /* Get to details */
     to_object = json_object_get_object_member (edge, "to");
@@ -840,7 +1613,32 @@ handle_json_task_edge (JsonArray *array,
     if (to_node == NULL)
         g_error ("No filter `%s' defined", to_name);
 
-    ufo_task_graph_connect_nodes_full (graph, from_node, to_node, to_port);
+    ufo_task_graph_connect_ports (graph, from_node, from_port, to_node, to_port);
+
+    if (json_object_has_member (edge, "batch"))
+        ufo_task_node_set_batch_size (to_node, to_port,
+                                      (guint) json_object_get_int_member (edge, "batch"));
+
+    if (json_object_has_member (edge, "reorder"))
+        ufo_task_node_set_reorder_window (to_node, to_port,
+                                          (guint) json_object_get_int_member (edge, "reorder"));
+
+    if (json_object_has_member (edge, "drop-oldest"))
+        ufo_task_node_set_drop_oldest (to_node, to_port,
+                                       json_object_get_boolean_member (edge, "drop-oldest"));
+
+    if (json_object_has_member (edge, "depth")) {
+        JsonNode *depth = json_object_get_member (edge, "depth");
+
+        if (json_node_get_value_type (depth) == G_TYPE_STRING) {
+            if (!g_strcmp0 (json_node_get_string (depth), "auto"))
+                ufo_task_node_set_queue_depth (to_node, to_port, UFO_QUEUE_DEPTH_AUTO);
+            else
+                g_warning ("Unknown queue depth `%s'", json_node_get_string (depth));
+        }
+        else
+            ufo_task_node_set_queue_depth (to_node, to_port, (guint) json_node_get_int (depth));
+    }
 
     if (error != NULL)
         g_warning ("%s", error->message);
@@ -886,6 +1684,10 @@ add_task_node_to_json_array (UfoTaskNode *node, JsonArray *array)
 {
     JsonObject *node_object;
     JsonNode *prop_node;
+    guint window_size;
+    guint window_step;
+    gdouble window_duration;
+    gdouble window_interval;
 
     node_object = json_object_new ();
     const gchar *plugin_name = ufo_task_node_get_plugin_name (node);
@@ -898,6 +1700,51 @@ add_task_node_to_json_array (UfoTaskNode *node, JsonArray *array)
 
     prop_node = json_gobject_serialize (G_OBJECT (node));
     json_object_set_member (node_object, "properties", prop_node);
+
+    if (ufo_task_node_get_send_pattern (node) != UFO_SEND_SCATTER) {
+        GEnumClass *enum_class;
+        GEnumValue *value;
+
+        enum_class = g_type_class_ref (UFO_TYPE_SEND_PATTERN);
+        value = g_enum_get_value (enum_class, ufo_task_node_get_send_pattern (node));
+
+        if (value != NULL)
+            json_object_set_string_member (node_object, "send-pattern", value->value_nick);
+
+        g_type_class_unref (enum_class);
+    }
+
+    if (ufo_task_node_get_priority (node) != UFO_TASK_PRIORITY_NORMAL) {
+        GEnumClass *enum_class;
+        GEnumValue *value;
+
+        enum_class = g_type_class_ref (UFO_TYPE_TASK_PRIORITY);
+        value = g_enum_get_value (enum_class, ufo_task_node_get_priority (node));
+
+        if (value != NULL)
+            json_object_set_string_member (node_object, "priority", value->value_nick);
+
+        g_type_class_unref (enum_class);
+    }
+
+    ufo_task_node_get_window (node, &window_size, &window_step);
+    ufo_task_node_get_time_window (node, &window_duration, &window_interval);
+
+    if (window_size > 0) {
+        JsonObject *window = json_object_new ();
+
+        json_object_set_int_member (window, "size", window_size);
+        json_object_set_int_member (window, "step", window_step);
+        json_object_set_object_member (node_object, "window", window);
+    }
+    else if (window_duration > 0.0) {
+        JsonObject *window = json_object_new ();
+
+        json_object_set_double_member (window, "duration", window_duration);
+        json_object_set_double_member (window, "step", window_interval);
+        json_object_set_object_member (node_object, "window", window);
+    }
+
     json_array_add_object_element (array, node_object);
 }
 
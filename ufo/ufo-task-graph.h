@@ -49,6 +49,22 @@ typedef enum {
     UFO_TASK_GRAPH_ERROR_BAD_INPUTS
 } UfoTaskGraphError;
 
+/**
+ * UfoMappingStrategy:
+ * @UFO_MAPPING_ROUND_ROBIN: Assign the successors of a node to processing nodes
+ *  in turn
+ * @UFO_MAPPING_COST: Balance the estimated cost of tasks among the processing
+ *  nodes while keeping connected tasks on the same processing node
+ *
+ * Strategy used to map tasks to processing nodes.
+ *
+ * Since: 0.8
+ */
+typedef enum {
+    UFO_MAPPING_ROUND_ROBIN,
+    UFO_MAPPING_COST
+} UfoMappingStrategy;
+
 /**
  * UfoTaskGraph:
  *
@@ -90,6 +106,14 @@ gboolean     ufo_task_graph_is_alright          (UfoTaskGraph       *task_graph,
                                                  GError            **error);
 void         ufo_task_graph_map                 (UfoTaskGraph       *task_graph,
                                                  GList              *gpu_nodes);
+void         ufo_task_graph_map_balanced        (UfoTaskGraph       *task_graph,
+                                                 GList              *gpu_nodes);
+gboolean     ufo_task_graph_read_costs          (UfoTaskGraph       *task_graph,
+                                                 const gchar        *filename,
+                                                 GError            **error);
+gboolean     ufo_task_graph_save_costs          (UfoTaskGraph       *task_graph,
+                                                 const gchar        *filename,
+                                                 GError            **error);
 void         ufo_task_graph_expand              (UfoTaskGraph       *task_graph,
                                                  UfoResources       *resources,
                                                  guint               n_gpus,
@@ -101,7 +125,18 @@ void         ufo_task_graph_connect_nodes_full  (UfoTaskGraph       *graph,
                                                  UfoTaskNode        *n1,
                                                  UfoTaskNode        *n2,
                                                  guint               input);
+void         ufo_task_graph_connect_ports       (UfoTaskGraph       *graph,
+                                                 UfoTaskNode        *n1,
+                                                 guint               output,
+                                                 UfoTaskNode        *n2,
+                                                 guint               input);
+void         ufo_task_graph_get_ports           (UfoTaskGraph       *graph,
+                                                 UfoTaskNode        *n1,
+                                                 UfoTaskNode        *n2,
+                                                 guint              *output,
+                                                 guint              *input);
 void         ufo_task_graph_fuse                (UfoTaskGraph       *task_graph);
+guint        ufo_task_graph_merge_common        (UfoTaskGraph       *task_graph);
 void         ufo_task_graph_set_partition       (UfoTaskGraph       *task_graph,
                                                  guint               index,
                                                  guint               total);
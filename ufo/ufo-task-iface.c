@@ -20,6 +20,7 @@
 #include <ufo/ufo-task-iface.h>
 #include <ufo/ufo-task-node.h>
 #include <ufo/ufo-misc.h>
+#include "ufo-priv.h"
 
 /**
  * SECTION:ufo-task-iface
@@ -32,6 +33,31 @@
  * iteration the task is asked about its size requirements using
  * ufo_task_get_requisition() and then executed using ufo_task_process() and/or
  * ufo_task_generate().
+ *
+ * Both functions return %TRUE as long as the task produces data and %FALSE to
+ * end the stream. To drop a single item, e.g. a frame rejected by a quality
+ * check, they call ufo_task_node_skip_output() and return %TRUE: the scheduler
+ * then recycles the output buffer without passing it on and continues with the
+ * next item.
+ *
+ * A task with more than one output reports their number with
+ * ufo_task_get_num_outputs(). It is then asked for the size of each additional
+ * output with ufo_task_get_output_requisition() and executed using
+ * ufo_task_process_outputs() and/or ufo_task_generate_outputs(), which receive
+ * one buffer per output.
+ *
+ * Reductors process the whole stream before generating their result, which
+ * makes them a bottleneck for long streams. A reductor that can combine the
+ * partial state of one of its copies into its own implements merge, see
+ * ufo_task_merge(). Its copies then reduce shares of the stream in parallel.
+ *
+ * A reductor can also reduce windows of its stream, see
+ * ufo_task_node_set_window(). Each item is added with ufo_task_process(). At
+ * the end of a tumbling window, ufo_task_generate() is called until it returns
+ * %FALSE like at the end of the stream, after which the task starts over. For
+ * sliding windows, items that leave the window are removed with
+ * ufo_task_remove() and ufo_task_generate() is called once per step on a copy
+ * of the window state, so it must not change the state of the task.
  */
 
 typedef UfoTaskIface UfoTaskInterface;
@@ -107,6 +133,25 @@ ufo_task_set_json_object_property (UfoTask *task,
     UFO_TASK_GET_IFACE (task)->set_json_object_property (task, prop_name, object);
 }
 
+/*
+ * Tasks must return a plain boolean. Other values are treated as %TRUE, so that
+ * a task which returns some non-zero status still keeps its stream running.
+ */
+static gboolean
+check_result (UfoTask *task,
+              const gchar *func,
+              gboolean result)
+{
+    if (result != TRUE && result != FALSE) {
+        g_warning ("%s: `%s' returned %i instead of TRUE or FALSE, "
+                   "use ufo_task_node_skip_output() to skip an item",
+                   G_OBJECT_TYPE_NAME (task), func, result);
+        return TRUE;
+    }
+
+    return result;
+}
+
 gboolean
 ufo_task_process (UfoTask *task,
                   UfoBuffer **inputs,
@@ -114,11 +159,12 @@ ufo_task_process (UfoTask *task,
                   UfoRequisition *requisition)
 {
     gboolean result;
+    ufo_task_node_clear_skip_output (UFO_TASK_NODE (task));
     result = UFO_TASK_GET_IFACE (task)->process (task, inputs, output, requisition);
     ufo_signal_emit (task, signals[PROCESSED], 0);
     ufo_task_node_increase_processed (UFO_TASK_NODE (task));
 
-    return result;
+    return check_result (task, "process", result);
 }
 
 gboolean
@@ -127,10 +173,168 @@ ufo_task_generate (UfoTask *task,
                    UfoRequisition *requisition)
 {
     gboolean result;
+    ufo_task_node_clear_skip_output (UFO_TASK_NODE (task));
     result = UFO_TASK_GET_IFACE (task)->generate (task, output, requisition);
     ufo_signal_emit (task, signals[GENERATED], 0);
 
-    return result;
+    return check_result (task, "generate", result);
+}
+
+/**
+ * ufo_task_get_num_outputs:
+ * @task: A #UfoTask
+ *
+ * Get the number of outputs of @task. Tasks that do not implement
+ * get_num_outputs have one output.
+ *
+ * Returns: Number of outputs.
+ *
+ * Since: 0.8
+ */
+guint
+ufo_task_get_num_outputs (UfoTask *task)
+{
+    return UFO_TASK_GET_IFACE (task)->get_num_outputs (task);
+}
+
+/**
+ * ufo_task_get_output_requisition:
+ * @task: A #UfoTask
+ * @inputs: (array): Input buffers
+ * @output: Output port of @task
+ * @requisition: (out): Location for the size of @output
+ *
+ * Get the size of output @output. For output 0 this is the same as
+ * ufo_task_get_requisition().
+ *
+ * Since: 0.8
+ */
+void
+ufo_task_get_output_requisition (UfoTask *task,
+                                 UfoBuffer **inputs,
+                                 guint output,
+                                 UfoRequisition *requisition)
+{
+    UFO_TASK_GET_IFACE (task)->get_output_requisition (task, inputs, output, requisition);
+}
+
+/**
+ * ufo_task_process_outputs:
+ * @task: A #UfoTask
+ * @inputs: (array): Input buffers
+ * @outputs: (array): One buffer for each output
+ * @requisitions: (array): Size of each output
+ *
+ * Process @inputs into all outputs of @task at once. Tasks that do not
+ * implement process_outputs are processed with ufo_task_process() on the
+ * first output.
+ *
+ * Returns: %FALSE if @task does not accept more input.
+ *
+ * Since: 0.8
+ */
+gboolean
+ufo_task_process_outputs (UfoTask *task,
+                          UfoBuffer **inputs,
+                          UfoBuffer **outputs,
+                          UfoRequisition *requisitions)
+{
+    gboolean result;
+    ufo_task_node_clear_skip_output (UFO_TASK_NODE (task));
+    result = UFO_TASK_GET_IFACE (task)->process_outputs (task, inputs, outputs, requisitions);
+    ufo_signal_emit (task, signals[PROCESSED], 0);
+    ufo_task_node_increase_processed (UFO_TASK_NODE (task));
+
+    return check_result (task, "process_outputs", result);
+}
+
+/**
+ * ufo_task_generate_outputs:
+ * @task: A #UfoTask
+ * @outputs: (array): One buffer for each output
+ * @requisitions: (array): Size of each output
+ *
+ * Generate data for all outputs of @task at once. Tasks that do not implement
+ * generate_outputs are run with ufo_task_generate() on the first output.
+ *
+ * Returns: %FALSE if @task does not produce more data.
+ *
+ * Since: 0.8
+ */
+gboolean
+ufo_task_generate_outputs (UfoTask *task,
+                           UfoBuffer **outputs,
+                           UfoRequisition *requisitions)
+{
+    gboolean result;
+    ufo_task_node_clear_skip_output (UFO_TASK_NODE (task));
+    result = UFO_TASK_GET_IFACE (task)->generate_outputs (task, outputs, requisitions);
+    ufo_signal_emit (task, signals[GENERATED], 0);
+
+    return check_result (task, "generate_outputs", result);
+}
+
+/**
+ * ufo_task_can_merge:
+ * @task: A #UfoTask
+ *
+ * Check if @task implements merge and can combine its state with that of a
+ * copy, see ufo_task_merge().
+ *
+ * Returns: %TRUE if ufo_task_merge() can be called on @task.
+ *
+ * Since: 0.8
+ */
+gboolean
+ufo_task_can_merge (UfoTask *task)
+{
+    return UFO_TASK_GET_IFACE (task)->merge != NULL;
+}
+
+/**
+ * ufo_task_merge:
+ * @task: A #UfoTask in reductor mode
+ * @output: The output buffer @task has reduced into
+ * @partial: A copy of @task that has reduced another share of the stream
+ * @partial_output: The output buffer @partial has reduced into
+ *
+ * Fold the partial state of @partial and @partial_output into @task and
+ * @output, so that a following ufo_task_generate() produces the result of the
+ * whole stream. The scheduler may then run copies of a reductor on several
+ * devices, each on a share of the stream.
+ *
+ * Since: 0.8
+ */
+void
+ufo_task_merge (UfoTask *task,
+                UfoBuffer *output,
+                UfoTask *partial,
+                UfoBuffer *partial_output)
+{
+    g_return_if_fail (ufo_task_can_merge (task));
+    UFO_TASK_GET_IFACE (task)->merge (task, output, partial, partial_output);
+}
+
+/**
+ * ufo_task_remove:
+ * @task: A #UfoTask in reductor mode
+ * @inputs: (array): Input buffers that were passed to ufo_task_process()
+ *  before
+ * @output: The output buffer @task reduces into
+ * @requisition: Size of @output
+ *
+ * Undo ufo_task_process() for @inputs, which left a sliding window of @task,
+ * see ufo_task_node_set_window().
+ *
+ * Since: 0.8
+ */
+void
+ufo_task_remove (UfoTask *task,
+                 UfoBuffer **inputs,
+                 UfoBuffer *output,
+                 UfoRequisition *requisition)
+{
+    UFO_TASK_GET_IFACE (task)->remove (task, inputs, output, requisition);
 }
 
 gboolean
@@ -217,6 +421,50 @@ ufo_task_generate_real (UfoTask *task,
     return FALSE;
 }
 
+static void
+ufo_task_remove_real (UfoTask *task,
+                      UfoBuffer **inputs,
+                      UfoBuffer *output,
+                      UfoRequisition *requisition)
+{
+    warn_unimplemented (task, "remove");
+}
+
+static guint
+ufo_task_get_num_outputs_real (UfoTask *task)
+{
+    return 1;
+}
+
+static void
+ufo_task_get_output_requisition_real (UfoTask *task,
+                                      UfoBuffer **inputs,
+                                      guint output,
+                                      UfoRequisition *requisition)
+{
+    if (output == 0)
+        UFO_TASK_GET_IFACE (task)->get_requisition (task, inputs, requisition);
+    else
+        warn_unimplemented (task, "get_output_requisition");
+}
+
+static gboolean
+ufo_task_process_outputs_real (UfoTask *task,
+                               UfoBuffer **inputs,
+                               UfoBuffer **outputs,
+                               UfoRequisition *requisitions)
+{
+    return UFO_TASK_GET_IFACE (task)->process (task, inputs, outputs[0], &requisitions[0]);
+}
+
+static gboolean
+ufo_task_generate_outputs_real (UfoTask *task,
+                                UfoBuffer **outputs,
+                                UfoRequisition *requisitions)
+{
+    return UFO_TASK_GET_IFACE (task)->generate (task, outputs[0], &requisitions[0]);
+}
+
 static void
 ufo_task_default_init (UfoTaskInterface *iface)
 {
@@ -228,6 +476,12 @@ ufo_task_default_init (UfoTaskInterface *iface)
     iface->set_json_object_property = ufo_task_set_json_object_property_real;
     iface->process = ufo_task_process_real;
     iface->generate = ufo_task_generate_real;
+    iface->get_num_outputs = ufo_task_get_num_outputs_real;
+    iface->get_output_requisition = ufo_task_get_output_requisition_real;
+    iface->process_outputs = ufo_task_process_outputs_real;
+    iface->generate_outputs = ufo_task_generate_outputs_real;
+    iface->merge = NULL;
+    iface->remove = ufo_task_remove_real;
 
     signals[PROCESSED] =
         g_signal_new ("processed",
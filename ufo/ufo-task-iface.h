@@ -56,6 +56,15 @@ typedef enum {
  * @UFO_TASK_MODE_GPU: runs on GPU
  * @UFO_TASK_MODE_CPU: runs on CPU
  * @UFO_TASK_MODE_SHARE_DATA: sibling tasks share the same input data
+ * @UFO_TASK_MODE_BATCH: accepts batches of items stacked along an additional
+ *  outermost dimension, see ufo_task_node_set_batch_size()
+ * @UFO_TASK_MODE_STATIC_REQUISITION: the output size only depends on the sizes
+ *  of the inputs and not on their contents. The requisition is then only
+ *  requested again when an input size changes or after
+ *  ufo_task_node_invalidate_requisition()
+ * @UFO_TASK_MODE_INPLACE: a processor that may write its output into its first
+ *  input. If the output has the same size as that input, the scheduler may
+ *  pass the input buffer as output to ufo_task_process()
  * @UFO_TASK_MODE_TYPE_MASK: mask to get type from UfoTaskMode
  * @UFO_TASK_MODE_PROCESSOR_MASK: mask to get processor from UfoTaskMode
  *
@@ -70,6 +79,9 @@ typedef enum {
     UFO_TASK_MODE_CPU           = 1 << 4,
     UFO_TASK_MODE_GPU           = 1 << 5,
     UFO_TASK_MODE_SHARE_DATA    = 1 << 6,
+    UFO_TASK_MODE_BATCH         = 1 << 7,
+    UFO_TASK_MODE_STATIC_REQUISITION = 1 << 8,
+    UFO_TASK_MODE_INPLACE       = 1 << 9,
 
     UFO_TASK_MODE_TYPE_MASK     = UFO_TASK_MODE_PROCESSOR | UFO_TASK_MODE_GENERATOR | UFO_TASK_MODE_REDUCTOR  | UFO_TASK_MODE_SINK,
 
@@ -110,6 +122,26 @@ struct _UfoTaskIface {
     gboolean (*generate)                (UfoTask        *task,
                                          UfoBuffer      *output,
                                          UfoRequisition *requisition);
+    guint   (*get_num_outputs)          (UfoTask        *task);
+    void    (*get_output_requisition)   (UfoTask        *task,
+                                         UfoBuffer     **inputs,
+                                         guint           output,
+                                         UfoRequisition *requisition);
+    gboolean (*process_outputs)         (UfoTask        *task,
+                                         UfoBuffer     **inputs,
+                                         UfoBuffer     **outputs,
+                                         UfoRequisition *requisitions);
+    gboolean (*generate_outputs)        (UfoTask        *task,
+                                         UfoBuffer     **outputs,
+                                         UfoRequisition *requisitions);
+    void    (*merge)                    (UfoTask        *task,
+                                         UfoBuffer      *output,
+                                         UfoTask        *partial,
+                                         UfoBuffer      *partial_output);
+    void    (*remove)                   (UfoTask        *task,
+                                         UfoBuffer     **inputs,
+                                         UfoBuffer      *output,
+                                         UfoRequisition *requisition);
 };
 
 void    ufo_task_setup              (UfoTask        *task,
@@ -134,6 +166,28 @@ gboolean ufo_task_process           (UfoTask        *task,
 gboolean ufo_task_generate          (UfoTask        *task,
                                      UfoBuffer      *output,
                                      UfoRequisition *requisition);
+guint   ufo_task_get_num_outputs    (UfoTask        *task);
+void    ufo_task_get_output_requisition
+                                    (UfoTask        *task,
+                                     UfoBuffer     **inputs,
+                                     guint           output,
+                                     UfoRequisition *requisition);
+gboolean ufo_task_process_outputs   (UfoTask        *task,
+                                     UfoBuffer     **inputs,
+                                     UfoBuffer     **outputs,
+                                     UfoRequisition *requisitions);
+gboolean ufo_task_generate_outputs  (UfoTask        *task,
+                                     UfoBuffer     **outputs,
+                                     UfoRequisition *requisitions);
+gboolean ufo_task_can_merge         (UfoTask        *task);
+void    ufo_task_merge              (UfoTask        *task,
+                                     UfoBuffer      *output,
+                                     UfoTask        *partial,
+                                     UfoBuffer      *partial_output);
+void    ufo_task_remove             (UfoTask        *task,
+                                     UfoBuffer     **inputs,
+                                     UfoBuffer      *output,
+                                     UfoRequisition *requisition);
 gboolean ufo_task_uses_gpu          (UfoTask        *task);
 gboolean ufo_task_uses_cpu          (UfoTask        *task);
 
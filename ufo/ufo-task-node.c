@@ -20,6 +20,7 @@
 #define _GNU_SOURCE
 #include <sched.h>
 #include <ufo/ufo-task-node.h>
+#include "ufo-priv.h"
 
 /**
  * SECTION:ufo-task-node
@@ -43,12 +44,28 @@ struct _UfoTaskNodePrivate {
     gchar           *plugin;
     gchar           *identifier;
     UfoSendPattern   pattern;
+    UfoTaskPriority  priority;
     UfoNode         *proc_node;
-    UfoGroup        *out_group;
+    gpointer         cmd_queue;         /* assigned by the scheduler */
+    UfoGroup        *out_groups[16];
     UfoProfiler     *profiler;
     GList           *in_groups[16];
     GList           *current[16];
     gint             n_expected[16];
+    guint            batch_size[16];
+    guint            reorder_window[16];
+    gboolean         drop_oldest[16];
+    guint            queue_depth[16];
+    guint            window_size;
+    guint            window_step;
+    gdouble          window_duration;
+    gdouble          window_interval;
+    gdouble          cost;
+    UfoRequisition   requisition;       /* cached for static requisitions */
+    UfoRequisition   in_requisitions[16];
+    guint            n_in_requisitions;
+    gint             requisition_valid;
+    gboolean         skip_output;
     guint            index;
     guint            total;
     guint            num_processed;
@@ -117,6 +134,80 @@ ufo_task_node_get_send_pattern (UfoTaskNode *node)
     return node->priv->pattern;
 }
 
+/**
+ * ufo_task_node_set_priority:
+ * @node: A #UfoTaskNode
+ * @priority: Priority class of @node
+ *
+ * Set the priority class of @node. The default scheduler assigns high-priority
+ * tasks a separate command queue of their device, see
+ * ufo_task_node_get_cmd_queue(), so that their kernels do not wait behind the
+ * commands of other tasks, and lowers the thread
+ * priority of low-priority tasks where the platform allows it.
+ *
+ * Since: 0.8
+ */
+void
+ufo_task_node_set_priority (UfoTaskNode *node,
+                            UfoTaskPriority priority)
+{
+    g_return_if_fail (UFO_IS_TASK_NODE (node));
+    node->priv->priority = priority;
+}
+
+/**
+ * ufo_task_node_get_priority:
+ * @node: A #UfoTaskNode
+ *
+ * Get the priority class of @node.
+ *
+ * Returns: The priority class, %UFO_TASK_PRIORITY_NORMAL unless set otherwise.
+ *
+ * Since: 0.8
+ */
+UfoTaskPriority
+ufo_task_node_get_priority (UfoTaskNode *node)
+{
+    g_return_val_if_fail (UFO_IS_TASK_NODE (node), UFO_TASK_PRIORITY_NORMAL);
+    return node->priv->priority;
+}
+
+/**
+ * ufo_task_node_set_cost:
+ * @node: A #UfoTaskNode
+ * @cost: Estimated processing time in seconds
+ *
+ * Set the estimated time @node takes to process its share of the data. The
+ * scheduler records the time measured during each run and the
+ * %UFO_MAPPING_COST strategy uses it to balance devices.
+ *
+ * Since: 0.8
+ */
+void
+ufo_task_node_set_cost (UfoTaskNode *node,
+                        gdouble cost)
+{
+    g_return_if_fail (UFO_IS_TASK_NODE (node));
+    node->priv->cost = cost;
+}
+
+/**
+ * ufo_task_node_get_cost:
+ * @node: A #UfoTaskNode
+ *
+ * Get the estimated processing time of @node.
+ *
+ * Returns: Processing time in seconds or 0.0 if unknown.
+ *
+ * Since: 0.8
+ */
+gdouble
+ufo_task_node_get_cost (UfoTaskNode *node)
+{
+    g_return_val_if_fail (UFO_IS_TASK_NODE (node), 0.0);
+    return node->priv->cost;
+}
+
 void
 ufo_task_node_set_num_expected (UfoTaskNode *node,
                                 guint pos,
@@ -136,12 +227,292 @@ ufo_task_node_get_num_expected (UfoTaskNode *node,
     return node->priv->n_expected[pos];
 }
 
+/**
+ * ufo_task_node_set_batch_size:
+ * @node: A #UfoTaskNode
+ * @pos: Input position of @node
+ * @batch_size: Number of items to stack
+ *
+ * Let the scheduler stack @batch_size consecutive items of identical size
+ * arriving at input @pos into one buffer with an additional outermost
+ * dimension. Batches are only formed if @node has the #UFO_TASK_MODE_BATCH
+ * flag set, a @batch_size of 0 or 1 disables batching.
+ *
+ * Since: 0.8
+ */
+void
+ufo_task_node_set_batch_size (UfoTaskNode *node,
+                              guint pos,
+                              guint batch_size)
+{
+    g_return_if_fail (UFO_IS_TASK_NODE (node));
+    g_return_if_fail (pos < 16);
+    node->priv->batch_size[pos] = batch_size;
+}
+
+/**
+ * ufo_task_node_get_batch_size:
+ * @node: A #UfoTaskNode
+ * @pos: Input position of @node
+ *
+ * Get the number of items stacked at input @pos of @node.
+ *
+ * Returns: The batch size or 0 if batching is disabled.
+ *
+ * Since: 0.8
+ */
+guint
+ufo_task_node_get_batch_size (UfoTaskNode *node,
+                              guint pos)
+{
+    g_return_val_if_fail (UFO_IS_TASK_NODE (node), 0);
+    g_return_val_if_fail (pos < 16, 0);
+    return node->priv->batch_size[pos];
+}
+
+/**
+ * ufo_task_node_set_reorder_window:
+ * @node: A #UfoTaskNode
+ * @pos: Input position of @node
+ * @window: Maximum number of items held back or 0
+ *
+ * If several nodes, e.g. the copies of an expanded branch, are connected to
+ * input @pos, restore the order in which their items were scattered (see
+ * #UFO_SEQUENCE_METADATA) before passing them to @node. Up to @window items
+ * are held back while the next one is missing and the oldest of them is
+ * passed on out of order once the window is full. Each branch gets at least
+ * @window + 1 buffers to fill the window, so an item dropped in one branch
+ * delays the stream but does not stall it. A @window of 0 disables
+ * reordering.
+ *
+ * Since: 0.8
+ */
+void
+ufo_task_node_set_reorder_window (UfoTaskNode *node,
+                                  guint pos,
+                                  guint window)
+{
+    g_return_if_fail (UFO_IS_TASK_NODE (node));
+    g_return_if_fail (pos < 16);
+    node->priv->reorder_window[pos] = window;
+}
+
+/**
+ * ufo_task_node_get_reorder_window:
+ * @node: A #UfoTaskNode
+ * @pos: Input position of @node
+ *
+ * Get the reorder window of input @pos.
+ *
+ * Returns: The window or 0 if items are passed in arrival order.
+ *
+ * Since: 0.8
+ */
+guint
+ufo_task_node_get_reorder_window (UfoTaskNode *node,
+                                  guint pos)
+{
+    g_return_val_if_fail (UFO_IS_TASK_NODE (node), 0);
+    g_return_val_if_fail (pos < 16, 0);
+    return node->priv->reorder_window[pos];
+}
+
+/**
+ * ufo_task_node_set_drop_oldest:
+ * @node: A #UfoTaskNode
+ * @pos: Input position of @node
+ * @drop_oldest: %TRUE to drop items instead of waiting for @node
+ *
+ * If @node cannot keep up with the items arriving at input @pos, drop the
+ * oldest item it did not fetch yet instead of blocking the producer. This
+ * bounds the latency of e.g. a preview branch at the cost of skipping items,
+ * so it should not be combined with a reorder window.
+ *
+ * Since: 0.8
+ */
+void
+ufo_task_node_set_drop_oldest (UfoTaskNode *node,
+                               guint pos,
+                               gboolean drop_oldest)
+{
+    g_return_if_fail (UFO_IS_TASK_NODE (node));
+    g_return_if_fail (pos < 16);
+    node->priv->drop_oldest[pos] = drop_oldest;
+}
+
+/**
+ * ufo_task_node_get_drop_oldest:
+ * @node: A #UfoTaskNode
+ * @pos: Input position of @node
+ *
+ * Check if input @pos of @node drops its oldest items when it is full.
+ *
+ * Returns: %TRUE if items are dropped.
+ *
+ * Since: 0.8
+ */
+gboolean
+ufo_task_node_get_drop_oldest (UfoTaskNode *node,
+                               guint pos)
+{
+    g_return_val_if_fail (UFO_IS_TASK_NODE (node), FALSE);
+    g_return_val_if_fail (pos < 16, FALSE);
+    return node->priv->drop_oldest[pos];
+}
+
+/**
+ * ufo_task_node_set_queue_depth:
+ * @node: A #UfoTaskNode
+ * @pos: Input position of @node
+ * @depth: Number of buffers, 0 for the default or #UFO_QUEUE_DEPTH_AUTO
+ *
+ * Set the number of buffers a producer can fill for input @pos before it has
+ * to wait for @node. Deeper queues absorb bursts of a source but cost memory
+ * for large items. With #UFO_QUEUE_DEPTH_AUTO, the default scheduler starts
+ * with the default depth and adds buffers within the memory budget while the
+ * producer often waits for buffers and @node often waits for items.
+ *
+ * Since: 0.8
+ */
+void
+ufo_task_node_set_queue_depth (UfoTaskNode *node,
+                               guint pos,
+                               guint depth)
+{
+    g_return_if_fail (UFO_IS_TASK_NODE (node));
+    g_return_if_fail (pos < 16);
+    node->priv->queue_depth[pos] = depth;
+}
+
+/**
+ * ufo_task_node_get_queue_depth:
+ * @node: A #UfoTaskNode
+ * @pos: Input position of @node
+ *
+ * Get the queue depth of input @pos, see ufo_task_node_set_queue_depth().
+ *
+ * Returns: The depth, 0 for the default or #UFO_QUEUE_DEPTH_AUTO.
+ *
+ * Since: 0.8
+ */
+guint
+ufo_task_node_get_queue_depth (UfoTaskNode *node,
+                               guint pos)
+{
+    g_return_val_if_fail (UFO_IS_TASK_NODE (node), 0);
+    g_return_val_if_fail (pos < 16, 0);
+    return node->priv->queue_depth[pos];
+}
+
+/**
+ * ufo_task_node_set_window:
+ * @node: A #UfoTaskNode in reductor mode
+ * @size: Number of items in a window or 0
+ * @step: Number of items after which the next window starts or 0
+ *
+ * Let @node reduce windows of @size consecutive items instead of the whole
+ * stream and emit a result at the end of each window while the stream goes
+ * on. If @step is 0 or not smaller than @size, windows are tumbling and do not
+ * overlap. Otherwise they are sliding: a result is emitted every @step items
+ * and items that leave the window are removed with ufo_task_remove(). A @size
+ * of 0 disables windows. This replaces any time window set with
+ * ufo_task_node_set_time_window().
+ *
+ * Since: 0.8
+ */
+void
+ufo_task_node_set_window (UfoTaskNode *node,
+                          guint size,
+                          guint step)
+{
+    g_return_if_fail (UFO_IS_TASK_NODE (node));
+    node->priv->window_size = size;
+    node->priv->window_step = step == 0 || step > size ? size : step;
+    node->priv->window_duration = 0.0;
+    node->priv->window_interval = 0.0;
+}
+
+/**
+ * ufo_task_node_get_window:
+ * @node: A #UfoTaskNode
+ * @size: (out) (allow-none): Location for the number of items in a window
+ * @step: (out) (allow-none): Location for the number of items between windows
+ *
+ * Get the count-based window of @node, see ufo_task_node_set_window(). @size
+ * is 0 if no such window is set.
+ *
+ * Since: 0.8
+ */
+void
+ufo_task_node_get_window (UfoTaskNode *node,
+                          guint *size,
+                          guint *step)
+{
+    g_return_if_fail (UFO_IS_TASK_NODE (node));
+
+    if (size != NULL)
+        *size = node->priv->window_size;
+
+    if (step != NULL)
+        *step = node->priv->window_step;
+}
+
+/**
+ * ufo_task_node_set_time_window:
+ * @node: A #UfoTaskNode in reductor mode
+ * @duration: Length of a window in seconds or 0
+ * @step: Seconds after which the next window starts or 0
+ *
+ * Like ufo_task_node_set_window() but windows cover all items that arrived
+ * within @duration seconds. Window boundaries are checked whenever an item
+ * arrives. A @duration of 0 disables windows. This replaces any count-based
+ * window.
+ *
+ * Since: 0.8
+ */
+void
+ufo_task_node_set_time_window (UfoTaskNode *node,
+                               gdouble duration,
+                               gdouble step)
+{
+    g_return_if_fail (UFO_IS_TASK_NODE (node));
+    node->priv->window_duration = MAX (duration, 0.0);
+    node->priv->window_interval = step <= 0.0 || step > duration ? node->priv->window_duration : step;
+    node->priv->window_size = 0;
+    node->priv->window_step = 0;
+}
+
+/**
+ * ufo_task_node_get_time_window:
+ * @node: A #UfoTaskNode
+ * @duration: (out) (allow-none): Location for the length of a window
+ * @step: (out) (allow-none): Location for the time between windows
+ *
+ * Get the time window of @node, see ufo_task_node_set_time_window(). @duration
+ * is 0 if no such window is set.
+ *
+ * Since: 0.8
+ */
+void
+ufo_task_node_get_time_window (UfoTaskNode *node,
+                               gdouble *duration,
+                               gdouble *step)
+{
+    g_return_if_fail (UFO_IS_TASK_NODE (node));
+
+    if (duration != NULL)
+        *duration = node->priv->window_duration;
+
+    if (step != NULL)
+        *step = node->priv->window_interval;
+}
+
 void
 ufo_task_node_set_out_group (UfoTaskNode *node,
                              UfoGroup *group)
 {
     g_return_if_fail (UFO_IS_TASK_NODE (node));
-    node->priv->out_group = group;
+    node->priv->out_groups[0] = group;
 }
 
 /**
@@ -157,7 +528,48 @@ UfoGroup *
 ufo_task_node_get_out_group (UfoTaskNode *node)
 {
     g_return_val_if_fail (UFO_IS_TASK_NODE (node), NULL);
-    return node->priv->out_group;
+    return node->priv->out_groups[0];
+}
+
+/**
+ * ufo_task_node_set_output_group:
+ * @node: A #UfoTaskNode
+ * @output: Output port of @node
+ * @group: The #UfoGroup receiving the data of @output
+ *
+ * Set the group for output @output. Output 0 is the same as the out group set
+ * with ufo_task_node_set_out_group().
+ *
+ * Since: 0.8
+ */
+void
+ufo_task_node_set_output_group (UfoTaskNode *node,
+                                guint output,
+                                UfoGroup *group)
+{
+    g_return_if_fail (UFO_IS_TASK_NODE (node));
+    g_return_if_fail (output < 16);
+    node->priv->out_groups[output] = group;
+}
+
+/**
+ * ufo_task_node_get_output_group:
+ * @node: A #UfoTaskNode
+ * @output: Output port of @node
+ *
+ * Get the group for output @output.
+ *
+ * Return value: (transfer none): The #UfoGroup of @output or %NULL.
+ *
+ * Since: 0.8
+ */
+UfoGroup *
+ufo_task_node_get_output_group (UfoTaskNode *node,
+                                guint output)
+{
+    g_return_val_if_fail (UFO_IS_TASK_NODE (node), NULL);
+    g_return_val_if_fail (output < 16, NULL);
+    return node->priv->out_groups[output];
 }
 
 void
@@ -171,6 +583,151 @@ ufo_task_node_add_in_group (UfoTaskNode *node,
     node->priv->current[pos] = node->priv->in_groups[pos];
 }
 
+/**
+ * ufo_task_node_invalidate_requisition:
+ * @node: A #UfoTaskNode
+ *
+ * Signal that the output size of a task with #UFO_TASK_MODE_STATIC_REQUISITION
+ * changes although the sizes of its inputs stay the same, for example because
+ * a property was set. The scheduler asks the task for its requisition again
+ * before the next item. This function may be called from any thread.
+ *
+ * Since: 0.8
+ */
+void
+ufo_task_node_invalidate_requisition (UfoTaskNode *node)
+{
+    g_return_if_fail (UFO_IS_TASK_NODE (node));
+    g_atomic_int_set (&node->priv->requisition_valid, FALSE);
+}
+
+/**
+ * ufo_task_node_skip_output:
+ * @node: A #UfoTaskNode
+ *
+ * Drop the output of the current item, e.g. a frame rejected by a quality
+ * check. Call this from within ufo_task_process() or ufo_task_generate() and
+ * return %TRUE to go on with the next item: the scheduler then recycles the
+ * output buffer instead of passing it on.
+ *
+ * Since: 0.8
+ */
+void
+ufo_task_node_skip_output (UfoTaskNode *node)
+{
+    g_return_if_fail (UFO_IS_TASK_NODE (node));
+    node->priv->skip_output = TRUE;
+}
+
+/*
+ * Forget a skip request, called before the task processes or generates the
+ * next item.
+ */
+void
+ufo_task_node_clear_skip_output (UfoTaskNode *node)
+{
+    node->priv->skip_output = FALSE;
+}
+
+/*
+ * Check if the task called ufo_task_node_skip_output() for its last item.
+ */
+gboolean
+ufo_task_node_output_skipped (UfoTaskNode *node)
+{
+    return node->priv->skip_output;
+}
+
+static gboolean
+requisition_equal (UfoRequisition *a,
+                   UfoRequisition *b)
+{
+    if (a->n_dims != b->n_dims)
+        return FALSE;
+
+    for (guint i = 0; i < a->n_dims; i++) {
+        if (a->dims[i] != b->dims[i])
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+/*
+ * Get the requisition of a task that declared #UFO_TASK_MODE_STATIC_REQUISITION.
+ * The task is only asked again if the size of one of its inputs changed or
+ * the requisition was invalidated. Returns TRUE if the task was asked.
+ */
+gboolean
+ufo_task_node_lookup_requisition (UfoTaskNode *node,
+                                  UfoBuffer **inputs,
+                                  guint n_inputs,
+                                  UfoRequisition *requisition)
+{
+    UfoTaskNodePrivate *priv;
+    UfoRequisition in_requisitions[16];
+    gboolean valid;
+
+    priv = node->priv;
+    n_inputs = MIN (n_inputs, 16);
+    valid = g_atomic_int_get (&priv->requisition_valid) && priv->n_in_requisitions == n_inputs;
+
+    for (guint i = 0; i < n_inputs; i++) {
+        ufo_buffer_get_requisition (inputs[i], &in_requisitions[i]);
+        valid = valid && requisition_equal (&in_requisitions[i], &priv->in_requisitions[i]);
+    }
+
+    if (valid) {
+        *requisition = priv->requisition;
+        return FALSE;
+    }
+
+    g_atomic_int_set (&priv->requisition_valid, TRUE);
+    ufo_task_get_requisition (UFO_TASK (node), inputs, requisition);
+
+    for (guint i = 0; i < n_inputs; i++)
+        priv->in_requisitions[i] = in_requisitions[i];
+
+    priv->n_in_requisitions = n_inputs;
+    priv->requisition = *requisition;
+    return TRUE;
+}
+
+/*
+ * Compare everything that is configured on the task node itself rather than
+ * through properties of the task, i.e. how the scheduler feeds @a and @b.
+ */
+gboolean
+ufo_task_node_equal_settings (UfoTaskNode *a,
+                              UfoTaskNode *b)
+{
+    UfoTaskNodePrivate *pa;
+    UfoTaskNodePrivate *pb;
+
+    pa = a->priv;
+    pb = b->priv;
+
+    if (pa->priority != pb->priority ||
+        pa->proc_node != pb->proc_node ||
+        pa->window_size != pb->window_size ||
+        pa->window_step != pb->window_step ||
+        pa->window_duration != pb->window_duration ||
+        pa->window_interval != pb->window_interval ||
+        pa->index != pb->index ||
+        pa->total != pb->total)
+        return FALSE;
+
+    for (guint i = 0; i < 16; i++) {
+        if (pa->batch_size[i] != pb->batch_size[i] ||
+            pa->reorder_window[i] != pb->reorder_window[i] ||
+            pa->drop_oldest[i] != pb->drop_oldest[i] ||
+            pa->queue_depth[i] != pb->queue_depth[i])
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
 /**
  * ufo_task_node_reset:
  * @node: A #UfoTaskNode
@@ -184,15 +741,36 @@ ufo_task_node_reset (UfoTaskNode *node)
 
     g_return_if_fail (UFO_IS_TASK_NODE (node));
     priv = UFO_TASK_NODE_GET_PRIVATE (node);
-    priv->out_group = NULL;
     priv->proc_node = NULL;
+    priv->cmd_queue = NULL;
+    priv->requisition_valid = FALSE;
 
     for (guint i = 0; i < 16; i++) {
+        priv->out_groups[i] = NULL;
         g_list_free (priv->in_groups[i]);
         priv->in_groups[i] = NULL;
     }
 }
 
+/**
+ * ufo_task_node_get_in_groups:
+ * @node: A #UfoTaskNode
+ * @pos: Input position of @node
+ *
+ * Get all groups connected to input @pos of @node.
+ *
+ * Return value: (transfer none) (element-type UfoGroup): List of #UfoGroup
+ * objects.
+ */
+GList *
+ufo_task_node_get_in_groups (UfoTaskNode *node,
+                             guint pos)
+{
+    g_return_val_if_fail (UFO_IS_TASK_NODE (node), NULL);
+    g_return_val_if_fail (pos < 16, NULL);
+    return node->priv->in_groups[pos];
+}
+
 /**
  * ufo_task_node_get_current_in_group:
  * @node: A #UfoTaskNode
@@ -234,6 +812,7 @@ ufo_task_node_set_proc_node (UfoTaskNode *task_node,
 {
     g_return_if_fail (UFO_IS_TASK_NODE (task_node) && UFO_IS_NODE (proc_node));
     task_node->priv->proc_node = proc_node;
+    task_node->priv->cmd_queue = NULL;
 }
 
 void
@@ -279,6 +858,53 @@ ufo_task_node_get_proc_node (UfoTaskNode *node)
     return node->priv->proc_node;
 }
 
+/**
+ * ufo_task_node_set_cmd_queue:
+ * @node: A #UfoTaskNode
+ * @cmd_queue: A cl_command_queue of the processing node of @node
+ *
+ * Assign the command queue that @node uses for all of its commands. This is
+ * called by the scheduler and reset when the processing node changes.
+ *
+ * Since: 0.8
+ */
+void
+ufo_task_node_set_cmd_queue (UfoTaskNode *node,
+                             gpointer cmd_queue)
+{
+    g_return_if_fail (UFO_IS_TASK_NODE (node));
+    node->priv->cmd_queue = cmd_queue;
+}
+
+/**
+ * ufo_task_node_get_cmd_queue:
+ * @node: A #UfoTaskNode
+ *
+ * Get the command queue that the scheduler assigned to @node. If none was
+ * assigned, this is the default queue of the #UfoGpuNode that @node runs on.
+ *
+ * Returns: (transfer none): A cl_command_queue object or %NULL if @node does
+ * not run on a #UfoGpuNode.
+ *
+ * Since: 0.8
+ */
+gpointer
+ufo_task_node_get_cmd_queue (UfoTaskNode *node)
+{
+    UfoTaskNodePrivate *priv;
+
+    g_return_val_if_fail (UFO_IS_TASK_NODE (node), NULL);
+    priv = node->priv;
+
+    if (priv->cmd_queue != NULL)
+        return priv->cmd_queue;
+
+    if (priv->proc_node != NULL && UFO_IS_GPU_NODE (priv->proc_node))
+        return ufo_gpu_node_get_cmd_queue (UFO_GPU_NODE (priv->proc_node));
+
+    return NULL;
+}
+
 void
 ufo_task_node_set_partition (UfoTaskNode *node,
                              guint index,
@@ -318,9 +944,21 @@ ufo_task_node_copy (UfoNode *node,
     orig = UFO_TASK_NODE (node);
 
     copy->priv->pattern = orig->priv->pattern;
+    copy->priv->priority = orig->priv->priority;
+    copy->priv->cost = orig->priv->cost;
 
-    for (guint i = 0; i < 16; i++)
+    for (guint i = 0; i < 16; i++) {
         copy->priv->n_expected[i] = orig->priv->n_expected[i];
+        copy->priv->batch_size[i] = orig->priv->batch_size[i];
+        copy->priv->reorder_window[i] = orig->priv->reorder_window[i];
+        copy->priv->drop_oldest[i] = orig->priv->drop_oldest[i];
+        copy->priv->queue_depth[i] = orig->priv->queue_depth[i];
+    }
+
+    copy->priv->window_size = orig->priv->window_size;
+    copy->priv->window_step = orig->priv->window_step;
+    copy->priv->window_duration = orig->priv->window_duration;
+    copy->priv->window_interval = orig->priv->window_interval;
 
     ufo_task_node_set_plugin_name (copy, orig->priv->plugin);
 
@@ -408,7 +1046,7 @@ ufo_task_node_init (UfoTaskNode *self)
     self->priv->identifier = NULL;
     self->priv->pattern = UFO_SEND_SCATTER;
     self->priv->proc_node = NULL;
-    self->priv->out_group = NULL;
+    self->priv->cmd_queue = NULL;
     self->priv->index = 0;
     self->priv->total = 1;
     self->priv->num_processed = 0;
@@ -65,6 +65,29 @@ struct _UfoTaskNodeClass {
     UfoNodeClass parent_class;
 };
 
+/**
+ * UFO_QUEUE_DEPTH_AUTO:
+ *
+ * Queue depth that lets the scheduler grow the queue of an input while its
+ * producer waits for buffers and the consumer waits for items, see
+ * ufo_task_node_set_queue_depth().
+ */
+#define UFO_QUEUE_DEPTH_AUTO G_MAXUINT
+
+/**
+ * UfoTaskPriority:
+ * @UFO_TASK_PRIORITY_LOW: Background work that may yield to all other tasks
+ * @UFO_TASK_PRIORITY_NORMAL: Default priority
+ * @UFO_TASK_PRIORITY_HIGH: Latency-sensitive work, e.g. a live preview
+ *
+ * Priority class of a task, see ufo_task_node_set_priority().
+ */
+typedef enum {
+    UFO_TASK_PRIORITY_LOW = -1,
+    UFO_TASK_PRIORITY_NORMAL = 0,
+    UFO_TASK_PRIORITY_HIGH = 1
+} UfoTaskPriority;
+
 void            ufo_task_node_setup                 (UfoTaskNode    *node);
 void            ufo_task_node_set_plugin_name       (UfoTaskNode    *node,
                                                      const gchar    *name);
@@ -75,17 +98,62 @@ void            ufo_task_node_set_identifier        (UfoTaskNode    *node,
 void            ufo_task_node_set_send_pattern      (UfoTaskNode    *node,
                                                      UfoSendPattern  pattern);
 UfoSendPattern  ufo_task_node_get_send_pattern      (UfoTaskNode    *node);
+void            ufo_task_node_set_priority          (UfoTaskNode    *node,
+                                                     UfoTaskPriority priority);
+UfoTaskPriority ufo_task_node_get_priority          (UfoTaskNode    *node);
 void            ufo_task_node_set_num_expected      (UfoTaskNode    *node,
                                                      guint           pos,
                                                      gint            n_expected);
 gint            ufo_task_node_get_num_expected      (UfoTaskNode    *node,
                                                      guint           pos);
+void            ufo_task_node_set_cost              (UfoTaskNode    *node,
+                                                     gdouble         cost);
+gdouble         ufo_task_node_get_cost              (UfoTaskNode    *node);
+void            ufo_task_node_set_batch_size        (UfoTaskNode    *node,
+                                                     guint           pos,
+                                                     guint           batch_size);
+guint           ufo_task_node_get_batch_size        (UfoTaskNode    *node,
+                                                     guint           pos);
+void            ufo_task_node_set_reorder_window    (UfoTaskNode    *node,
+                                                     guint           pos,
+                                                     guint           window);
+guint           ufo_task_node_get_reorder_window    (UfoTaskNode    *node,
+                                                     guint           pos);
+void            ufo_task_node_set_drop_oldest       (UfoTaskNode    *node,
+                                                     guint           pos,
+                                                     gboolean        drop_oldest);
+gboolean        ufo_task_node_get_drop_oldest       (UfoTaskNode    *node,
+                                                     guint           pos);
+void            ufo_task_node_set_queue_depth       (UfoTaskNode    *node,
+                                                     guint           pos,
+                                                     guint           depth);
+guint           ufo_task_node_get_queue_depth       (UfoTaskNode    *node,
+                                                     guint           pos);
+void            ufo_task_node_set_window            (UfoTaskNode    *node,
+                                                     guint           size,
+                                                     guint           step);
+void            ufo_task_node_get_window            (UfoTaskNode    *node,
+                                                     guint          *size,
+                                                     guint          *step);
+void            ufo_task_node_set_time_window       (UfoTaskNode    *node,
+                                                     gdouble         duration,
+                                                     gdouble         step);
+void            ufo_task_node_get_time_window       (UfoTaskNode    *node,
+                                                     gdouble        *duration,
+                                                     gdouble        *step);
 void            ufo_task_node_set_out_group         (UfoTaskNode    *node,
                                                      UfoGroup       *group);
 UfoGroup       *ufo_task_node_get_out_group         (UfoTaskNode    *node);
+void            ufo_task_node_set_output_group      (UfoTaskNode    *node,
+                                                     guint           output,
+                                                     UfoGroup       *group);
+UfoGroup       *ufo_task_node_get_output_group      (UfoTaskNode    *node,
+                                                     guint           output);
 void            ufo_task_node_add_in_group          (UfoTaskNode    *node,
                                                      guint           pos,
                                                      UfoGroup       *group);
+GList          *ufo_task_node_get_in_groups         (UfoTaskNode    *node,
+                                                     guint           pos);
 UfoGroup       *ufo_task_node_get_current_in_group  (UfoTaskNode    *node,
                                                      guint           pos);
 void            ufo_task_node_switch_in_group       (UfoTaskNode    *node,
@@ -93,6 +161,9 @@ void            ufo_task_node_switch_in_group       (UfoTaskNode    *node,
 void            ufo_task_node_set_proc_node         (UfoTaskNode    *task_node,
                                                      UfoNode        *proc_node);
 UfoNode        *ufo_task_node_get_proc_node         (UfoTaskNode    *node);
+void            ufo_task_node_set_cmd_queue         (UfoTaskNode    *node,
+                                                     gpointer        cmd_queue);
+gpointer        ufo_task_node_get_cmd_queue         (UfoTaskNode    *node);
 void            ufo_task_node_set_partition         (UfoTaskNode    *node,
                                                      guint           index,
                                                      guint           total);
@@ -101,6 +172,9 @@ void            ufo_task_node_get_partition         (UfoTaskNode    *node,
                                                      guint          *total);
 void            ufo_task_node_set_profiler          (UfoTaskNode    *node,
                                                      UfoProfiler    *profiler);
+void            ufo_task_node_invalidate_requisition
+                                                    (UfoTaskNode    *node);
+void            ufo_task_node_skip_output           (UfoTaskNode    *node);
 void            ufo_task_node_reset                 (UfoTaskNode    *node);
 UfoProfiler    *ufo_task_node_get_profiler          (UfoTaskNode    *node);
 void            ufo_task_node_increase_processed    (UfoTaskNode    *node);
@@ -76,6 +76,23 @@ ufo_two_way_queue_consumer_pop (UfoTwoWayQueue *queue)
     return g_async_queue_pop (queue->consumer_queue);
 }
 
+/**
+ * ufo_two_way_queue_consumer_timeout_pop: (skip)
+ * @queue: A #UfoTwoWayQueue
+ * @timeout: Number of microseconds to wait
+ *
+ * Fetch an item for consumption but wait at most @timeout microseconds for
+ * one.
+ *
+ * Returns: (transfer none): A consumable item or %NULL if none arrived in
+ * time.
+ */
+gpointer
+ufo_two_way_queue_consumer_timeout_pop (UfoTwoWayQueue *queue, guint64 timeout)
+{
+    return g_async_queue_timeout_pop (queue->consumer_queue, timeout);
+}
+
 void
 ufo_two_way_queue_consumer_push (UfoTwoWayQueue *queue, gpointer data)
 {
@@ -102,6 +119,22 @@ ufo_two_way_queue_producer_push (UfoTwoWayQueue *queue, gpointer data)
     g_async_queue_push (queue->consumer_queue, data);
 }
 
+/**
+ * ufo_two_way_queue_producer_steal: (skip)
+ * @queue: A #UfoTwoWayQueue
+ *
+ * Take back the oldest item that was pushed for consumption but not fetched
+ * yet, dropping it for the consumer.
+ *
+ * Returns: (transfer none): A producable item or %NULL if the consumer has
+ * fetched all items.
+ */
+gpointer
+ufo_two_way_queue_producer_steal (UfoTwoWayQueue *queue)
+{
+    return g_async_queue_try_pop (queue->consumer_queue);
+}
+
 void
 ufo_two_way_queue_insert (UfoTwoWayQueue *queue, gpointer data)
 {
@@ -114,3 +147,20 @@ ufo_two_way_queue_get_capacity (UfoTwoWayQueue *queue)
 {
     return queue->capacity;
 }
+
+/**
+ * ufo_two_way_queue_get_num_available: (skip)
+ * @queue: A #UfoTwoWayQueue
+ *
+ * Get the number of items that the producer can fetch without blocking.
+ *
+ * Returns: Number of available items.
+ */
+guint
+ufo_two_way_queue_get_num_available (UfoTwoWayQueue *queue)
+{
+    gint length;
+
+    length = g_async_queue_length (queue->producer_queue);
+    return length > 0 ? (guint) length : 0;
+}
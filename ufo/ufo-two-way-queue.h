@@ -33,14 +33,20 @@ typedef struct _UfoTwoWayQueue          UfoTwoWayQueue;
 UfoTwoWayQueue  * ufo_two_way_queue_new             (GList *init);
 void              ufo_two_way_queue_free            (UfoTwoWayQueue *queue);
 gpointer          ufo_two_way_queue_consumer_pop    (UfoTwoWayQueue *queue);
+gpointer          ufo_two_way_queue_consumer_timeout_pop
+                                                    (UfoTwoWayQueue *queue,
+                                                     guint64 timeout);
 void              ufo_two_way_queue_consumer_push   (UfoTwoWayQueue *queue,
                                                      gpointer data);
 gpointer          ufo_two_way_queue_producer_pop    (UfoTwoWayQueue *queue);
 void              ufo_two_way_queue_producer_push   (UfoTwoWayQueue *queue,
                                                      gpointer data);
+gpointer          ufo_two_way_queue_producer_steal  (UfoTwoWayQueue *queue);
 void              ufo_two_way_queue_insert          (UfoTwoWayQueue *queue,
                                                      gpointer data);
 guint             ufo_two_way_queue_get_capacity    (UfoTwoWayQueue *queue);
+guint             ufo_two_way_queue_get_num_available
+                                                    (UfoTwoWayQueue *queue);
 
 G_END_DECLS
 
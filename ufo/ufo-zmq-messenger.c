@@ -68,9 +68,13 @@ ufo_zmq_messenger_new (void)
 static gboolean
 zmq_listen_address_valid (gchar *addr, GError **error)
 {
+    /* Local sockets are named by a path, nothing else to check */
+    if (g_str_has_prefix (addr, "ipc://"))
+        return TRUE;
+
     if (!g_str_has_prefix (addr, "tcp://")) {
         g_set_error_literal (error, UFO_MESSENGER_ERROR, UFO_MESSENGER_CONNECTION_PROBLEM,
-                             "Address does not use 'tcp://' scheme.");
+                             "Address does not use 'tcp://' or 'ipc://' scheme.");
         return FALSE;
     }
 
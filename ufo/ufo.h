@@ -41,6 +41,7 @@
 #include <ufo/ufo-remote-task.h>
 #include <ufo/ufo-resources.h>
 #include <ufo/ufo-scheduler.h>
+#include <ufo/ufo-session.h>
 #include <ufo/ufo-task-graph.h>
 #include <ufo/ufo-task-iface.h>
 #include <ufo/ufo-task-node.h>